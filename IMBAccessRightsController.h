@@ -67,6 +67,8 @@
 @interface IMBAccessRightsController : NSObject
 {
 	NSMutableArray* _bookmarks;
+	NSMutableArray* _bookmarkURLs;		// Resolved URLs, in the same order as _bookmarks
+	id _grantedPaths;					// Trie of path components of _bookmarkURLs
 }
 
 // Create singleton instance of the controller...
@@ -75,7 +77,8 @@
 
 // Accessor method. Returns a security scoped bookmark, if the user has granted acccess to this part of the
 // file system. Please note that the bookmark may point to an ancestor of the specified URL. If the user
-// hasn't granted access, then nil may be returned...
+// hasn't granted access, then nil may be returned. Bookmarks are resolved only once (when they are added or 
+// loaded), so hasBookmarkForURL: is cheap and doesn't touch the file system...
 
 @property (retain) NSMutableArray* bookmarks;
 
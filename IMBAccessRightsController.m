@@ -79,7 +79,86 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 + (NSURL*) _urlForBookmark:(NSData*)inBookmark;
 
 + (NSData*) _appScopedBookmarkForURL:(NSURL*)inURL;
-+ (NSURL*) _urlForAppScopedBookmark:(NSData*)inBookmark;
++ (NSURL*) _urlForAppScopedBookmark:(NSData*)inBookmark stale:(BOOL*)outStale;
+
+- (void) _setBookmarks:(NSArray*)inBookmarks urls:(NSArray*)inURLs;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// A trie of path components. A node is marked as granted if access was granted to the folder it represents, so
+// checking whether a path is covered by any bookmark takes as many lookups as the path has components...
+
+@interface IMBAccessRightsTrieNode : NSObject
+{
+	NSMutableDictionary* _children;
+	BOOL _isGranted;
+}
+
+- (void) addPath:(NSString*)inPath;
+- (BOOL) coversPath:(NSString*)inPath;
+
+@end
+
+
+@implementation IMBAccessRightsTrieNode
+
+
+- (void) dealloc
+{
+	IMBRelease(_children);
+	[super dealloc];
+}
+
+
+- (void) addPath:(NSString*)inPath
+{
+	IMBAccessRightsTrieNode* node = self;
+	
+	for (NSString* component in [[inPath stringByStandardizingPath] pathComponents])
+	{
+		if (node->_isGranted) return;	// Already covered by an ancestor
+		if (node->_children == nil) node->_children = [[NSMutableDictionary alloc] init];
+		
+		IMBAccessRightsTrieNode* child = [node->_children objectForKey:component];
+		
+		if (child == nil)
+		{
+			child = [[IMBAccessRightsTrieNode alloc] init];
+			[node->_children setObject:child forKey:component];
+			[child release];
+		}
+		
+		node = child;
+	}
+	
+	// Descendants are covered by this node from now on, so they can go...
+	
+	node->_isGranted = YES;
+	IMBRelease(node->_children);
+}
+
+
+- (BOOL) coversPath:(NSString*)inPath
+{
+	IMBAccessRightsTrieNode* node = self;
+	
+	for (NSString* component in [[inPath stringByStandardizingPath] pathComponents])
+	{
+		if (node->_isGranted) return YES;
+		
+		node = [node->_children objectForKey:component];
+		if (node == nil) return NO;
+	}
+	
+	return node->_isGranted;
+}
+
 
 @end
 
@@ -136,6 +215,8 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 - (void) dealloc
 {
 	IMBRelease(_bookmarks);
+	IMBRelease(_bookmarkURLs);
+	IMBRelease(_grantedPaths);
 	[super dealloc];
 }
 
@@ -147,23 +228,65 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 #pragma mark Accessors
 
 
-// Check if we have a bookmark that grants us access to the specified URL...
+// Setting the bookmarks from outside resolves them once, so that the resolved URLs are in sync again...
 
-- (BOOL) hasBookmarkForURL:(NSURL*)inURL
+- (void) setBookmarks:(NSMutableArray*)inBookmarks
 {
-	NSString* path = [inURL path];
+	NSMutableArray* urls = [NSMutableArray arrayWithCapacity:[inBookmarks count]];
 	
-	for (NSData* bookmark in self.bookmarks)
+	for (NSData* bookmark in inBookmarks)
 	{
 		NSURL* url = [[self class] _urlForBookmark:bookmark];
+		[urls addObject:url ? (id)url : (id)[NSNull null]];
+	}
+	
+	[self _setBookmarks:inBookmarks urls:urls];
+}
 
-		if (url && [path hasPathPrefix:[url path]])
-		{
-			return YES;
-		}
+
+- (NSMutableArray*) bookmarks
+{
+	@synchronized(self)
+	{
+		return [[_bookmarks retain] autorelease];
+	}
+}
+
+
+// Replaces the bookmarks and their resolved URLs, and rebuilds the trie of granted paths...
+
+- (void) _setBookmarks:(NSArray*)inBookmarks urls:(NSArray*)inURLs
+{
+	IMBAccessRightsTrieNode* grantedPaths = [[IMBAccessRightsTrieNode alloc] init];
+	
+	for (NSURL* url in inURLs)
+	{
+		if (url != (id)[NSNull null]) [grantedPaths addPath:[url path]];
 	}
 	
-	return NO;
+	@synchronized(self)
+	{
+		IMBRelease(_bookmarks);
+		IMBRelease(_bookmarkURLs);
+		IMBRelease(_grantedPaths);
+		_bookmarks = [[NSMutableArray alloc] initWithArray:inBookmarks];
+		_bookmarkURLs = [[NSMutableArray alloc] initWithArray:inURLs];
+		_grantedPaths = grantedPaths;
+	}
+}
+
+
+// Check if we have a bookmark that grants us access to the specified URL...
+
+- (BOOL) hasBookmarkForURL:(NSURL*)inURL
+{
+	NSString* path = [inURL path];
+	if (path == nil) return NO;
+	
+	@synchronized(self)
+	{
+		return [(IMBAccessRightsTrieNode*)_grantedPaths coversPath:path];
+	}
 }
 
 
@@ -178,11 +301,15 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 {
 	NSURL* url = [[self class] _urlForBookmark:inBookmark];
 	
+	if (url == nil) return nil;
+	
     @synchronized(self)
     {
         if (![self hasBookmarkForURL:url])
         {
-            [self.bookmarks addObject:inBookmark];
+            [_bookmarks addObject:inBookmark];
+            [_bookmarkURLs addObject:url];
+            [(IMBAccessRightsTrieNode*)_grantedPaths addPath:[url path]];
             [self saveToPrefs];
             
             return url;
@@ -202,16 +329,20 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 
 // Load the dictionary from the prefs, and then resolve each bookmark to a URL to make sure that the app has
 // access to the respective part of the file system. Start access, thus granting the rights. Please note that
-// we won't balance with stopAccessing until the app terminates...
+// we won't balance with stopAccessing until the app terminates. The resolved URLs are kept, so that we never
+// need to resolve the bookmarks again. Only bookmarks that are reported as stale are recreated...
 
 - (void) loadFromPrefs
 {
-	NSArray* bookmarks = [IMBConfig prefsValueForKey:kBookmarksPrefsKey];
-	self.bookmarks = [NSMutableArray arrayWithArray:bookmarks];
+	NSArray* prefsBookmarks = [IMBConfig prefsValueForKey:kBookmarksPrefsKey];
+	NSMutableArray* bookmarks = [NSMutableArray arrayWithCapacity:[prefsBookmarks count]];
+	NSMutableArray* urls = [NSMutableArray arrayWithCapacity:[prefsBookmarks count]];
+	BOOL needsSave = NO;
     
-	for (NSData* bookmark in self.bookmarks)
+	for (NSData* bookmark in prefsBookmarks)
 	{
-		NSURL* url = [[self class] _urlForAppScopedBookmark:bookmark];
+		BOOL stale = NO;
+		NSURL* url = [[self class] _urlForAppScopedBookmark:bookmark stale:&stale];
         
         // NOTE: We do not balance -startAccessing... with a corresponding -stopAccessing somewhere else
         //       since we want to be able to access the resource throughout the lifetime of the process
@@ -224,8 +355,25 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
             [url startAccessingSecurityScopedResource];
         }
         
+        if (url && stale)
+        {
+            NSData* freshBookmark = [[self class] _appScopedBookmarkForURL:url];
+            
+            if (freshBookmark)
+            {
+                bookmark = freshBookmark;
+                needsSave = YES;
+            }
+        }
+        
+        [bookmarks addObject:bookmark];
+        [urls addObject:url ? (id)url : (id)[NSNull null]];
+        
 //        NSLog(@"Entitlements: Loaded from preferences security scoped URL %@", url);
 	}
+	
+	[self _setBookmarks:bookmarks urls:urls];
+	if (needsSave) [self saveToPrefs];
 }
 
 
@@ -235,12 +383,18 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 {
     // Only SSBs are persistent
     
-    NSMutableArray* SSBs = [NSMutableArray arrayWithCapacity:[self.bookmarks count]];
+    NSArray* urls = nil;
+    
+    @synchronized(self)
+    {
+        urls = [[_bookmarkURLs copy] autorelease];
+    }
+    
+    NSMutableArray* SSBs = [NSMutableArray arrayWithCapacity:[urls count]];
     NSData* anSSB = nil;
-    NSURL* aURL = nil;
-	for (NSData* bookmark in self.bookmarks)
+	for (NSURL* aURL in urls)
 	{
-        aURL = [[self class] _urlForBookmark:bookmark];
+        if (aURL == (id)[NSNull null]) continue;
         anSSB = [[self class] _appScopedBookmarkForURL:aURL];
         
         if (anSSB) [SSBs addObject:anSSB];
@@ -342,7 +496,7 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 
 // Resolve an app scoped SSB to a URL...
 
-+ (NSURL*) _urlForAppScopedBookmark:(NSData*)inBookmark
++ (NSURL*) _urlForAppScopedBookmark:(NSData*)inBookmark stale:(BOOL*)outStale
 {
 	NSError* error = nil;
 	BOOL stale = NO;
@@ -354,6 +508,8 @@ static NSString* kBookmarksPrefsKey = @"accessRightsBookmarks";
 		bookmarkDataIsStale:&stale
 		error:&error];
 
+	if (outStale) *outStale = stale;
+
 //	NSLog(@"%s url=%@ error=%@",__FUNCTION__,url,error);
 		
 	return url;
@@ -0,0 +1,100 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// IMBAlbumDataStore is a compact binary representation of an AlbumData.xml (iPhoto) or ApertureData.xml (Aperture)
+// property list. The XML file is converted only once, and the result is written to the caches folder together with
+// a fingerprint (path, size and modification date) of the XML file. Later launches simply memory map the store file.
+// Strings are kept in a deduplicated string pool, dictionaries with numeric keys (like the master image list) are 
+// stored as tables sorted by key, and arrays of numeric keys (like "KeyList") are stored as plain int arrays.
+//
+// The contents are accessed through the regular NSDictionary and NSArray API. The returned dictionaries and arrays
+// are lightweight proxies that materialize their values on demand, so a parser may keep the root dictionary around
+// for as long as it likes. Instances are immutable and can be shared between threads...
+
+@interface IMBAlbumDataStore : NSObject
+{
+	NSData* _data;
+	const uint8_t* _bytes;
+	const uint32_t* _nodes;
+	const uint64_t* _numbers;
+	const uint32_t* _strings;
+	const uint32_t* _blobs;
+	NSArray* _keys;
+	NSDictionary* _keyIndexes;
+}
+
+// Returns a store for the XML file at inPath. If an up-to-date store file exists in the caches folder, it is mapped
+// into memory. Otherwise inBuilder is called to load the property list, which is then converted and saved. The 
+// variant distinguishes stores built from the same XML file by different builders (e.g. different parser classes
+// that post-process the property list)...
+
++ (IMBAlbumDataStore*) storeForFileAtPath:(NSString*)inPath variant:(NSString*)inVariant builder:(NSDictionary*(^)(void))inBuilder;
+
+// Converts a property list into a store without touching the disk...
+
++ (IMBAlbumDataStore*) storeWithPropertyList:(NSDictionary*)inPropertyList;
+
+// The root dictionary of the property list...
+
+@property (readonly) NSDictionary* rootDictionary;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,1218 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBAlbumDataStore.h"
+#import <sys/stat.h>
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+static NSString* kIMBAlbumDataStoreFolderName = @"com.karelia.imedia.albumdata";
+static NSString* kIMBAlbumDataStoreExtension = @"albumdata";
+
+#define kIMBAlbumDataStoreMagic		0x41424d49	// 'IMBA'
+#define kIMBAlbumDataStoreVersion	1
+
+// Every value is stored as a (type,payload) pair of 32 bit words. Depending on the type the payload is the value
+// itself, an index into one of the pools or the position of a container in the node table...
+
+enum
+{
+	kIMBAlbumDataTypeString = 1,				// payload: index in string pool
+	kIMBAlbumDataTypeInteger,					// payload: int32_t value
+	kIMBAlbumDataTypeLargeInteger,				// payload: index in number table (int64_t)
+	kIMBAlbumDataTypeReal,						// payload: index in number table (double)
+	kIMBAlbumDataTypeDate,						// payload: index in number table (double, since reference date)
+	kIMBAlbumDataTypeBoolean,					// payload: 0 or 1
+	kIMBAlbumDataTypeData,						// payload: index in blob pool
+	kIMBAlbumDataTypeDictionary,				// payload: node with count, then (key index,type,payload) sorted by key index
+	kIMBAlbumDataTypeNumericKeyDictionary,		// payload: node with count, then (key,type,payload) sorted by numeric key
+	kIMBAlbumDataTypeArray,						// payload: node with count, then (type,payload)
+	kIMBAlbumDataTypeNumericKeyArray			// payload: node with count, then numeric keys
+};
+
+// Header of a store file. All offsets are in bytes from the start of the file. Pools start with a count, followed
+// by count+1 offsets (relative to the end of the offset table) and the bytes of all entries...
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t rootType;
+	uint32_t rootNode;
+	uint32_t fingerprint;			// Index in string pool
+	uint32_t reserved;
+	uint64_t length;
+	uint64_t nodesOffset;
+	uint64_t numbersOffset;
+	uint64_t keysOffset;
+	uint64_t stringsOffset;
+	uint64_t blobsOffset;
+}
+IMBAlbumDataStoreHeader;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Keys of dictionaries like "Master Image List" or "List of Faces" are numbers in string form. If a string is the 
+// canonical representation of an unsigned 32 bit number, then we store the number rather than the string...
+
+static BOOL _IMBNumericKeyForString(NSString* inString,uint32_t* outKey)
+{
+	if (![inString isKindOfClass:[NSString class]]) return NO;
+	
+	NSUInteger length = [inString length];
+	if (length == 0 || length > 10) return NO;
+	
+	unichar characters[10];
+	[inString getCharacters:characters range:NSMakeRange(0,length)];
+	if (characters[0] == '0' && length > 1) return NO;
+	
+	uint64_t value = 0;
+	
+	for (NSUInteger i=0; i<length; i++)
+	{
+		unichar c = characters[i];
+		if (c < '0' || c > '9') return NO;
+		value = value * 10 + (c - '0');
+	}
+	
+	if (value > UINT32_MAX) return NO;
+	*outKey = (uint32_t)value;
+	return YES;
+}
+
+
+static NSString* _IMBStringForNumericKey(uint32_t inKey)
+{
+	char buffer[16];
+	int length = snprintf(buffer,sizeof(buffer),"%u",inKey);
+	return [[[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding] autorelease];
+}
+
+
+static const uint8_t* _IMBPoolEntry(const uint32_t* inPool,uint32_t inIndex,NSUInteger* outLength)
+{
+	uint32_t count = inPool[0];
+	if (inIndex >= count) return NULL;
+	
+	const uint32_t* offsets = inPool + 1;
+	const uint8_t* bytes = (const uint8_t*)(offsets + count + 1);
+	*outLength = offsets[inIndex+1] - offsets[inIndex];
+	return bytes + offsets[inIndex];
+}
+
+
+static int _IMBCompareEntries(const void* inEntry1,const void* inEntry2)
+{
+	uint32_t key1 = *(const uint32_t*)inEntry1;
+	uint32_t key2 = *(const uint32_t*)inEntry2;
+	return key1 < key2 ? -1 : (key1 > key2 ? 1 : 0);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBAlbumDataStore ()
+
+- (id) initWithData:(NSData*)inData;
+- (NSString*) _fingerprint;
+- (BOOL) _keyIndexForKey:(id)inKey index:(uint32_t*)outIndex;
+- (NSString*) _keyAtIndex:(uint32_t)inIndex;
+- (const uint32_t*) _nodeAtIndex:(uint32_t)inIndex;
+- (id) _objectWithType:(uint32_t)inType payload:(uint32_t)inPayload;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// A pool of byte sequences (UTF-8 strings or raw data) that is written as an offset table followed by the bytes.
+// Strings are deduplicated, so that e.g. "Image" or "Regular" is only stored once...
+
+@interface IMBAlbumDataPoolBuilder : NSObject
+{
+	NSMutableData* _offsets;
+	NSMutableData* _bytes;
+	NSMutableDictionary* _indexes;
+	uint32_t _count;
+}
+
+- (uint32_t) indexForString:(NSString*)inString;
+- (uint32_t) indexForData:(NSData*)inData;
+- (NSData*) poolData;
+
+@end
+
+
+@implementation IMBAlbumDataPoolBuilder
+
+
+- (id) init
+{
+	if (self = [super init])
+	{
+		_offsets = [[NSMutableData alloc] init];
+		_bytes = [[NSMutableData alloc] init];
+		_indexes = [[NSMutableDictionary alloc] init];
+		
+		uint32_t offset = 0;
+		[_offsets appendBytes:&offset length:sizeof(offset)];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_offsets);
+	IMBRelease(_bytes);
+	IMBRelease(_indexes);
+	[super dealloc];
+}
+
+
+- (uint32_t) _appendBytes:(const void*)inBytes length:(NSUInteger)inLength
+{
+	[_bytes appendBytes:inBytes length:inLength];
+	uint32_t offset = (uint32_t)[_bytes length];
+	[_offsets appendBytes:&offset length:sizeof(offset)];
+	return _count++;
+}
+
+
+- (uint32_t) indexForString:(NSString*)inString
+{
+	NSNumber* index = [_indexes objectForKey:inString];
+	if (index) return [index unsignedIntValue];
+	
+	// Do not rely on UTF8String here: it returns NULL for strings that cannot be converted, and strlen() would
+	// cut off strings containing NUL characters...
+	
+	NSUInteger length = [inString lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	NSMutableData* utf8 = [NSMutableData dataWithLength:length];
+	[inString getBytes:[utf8 mutableBytes] maxLength:length usedLength:NULL encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0,[inString length]) remainingRange:NULL];
+	uint32_t result = [self _appendBytes:[utf8 bytes] length:length];
+	[_indexes setObject:[NSNumber numberWithUnsignedInt:result] forKey:inString];
+	return result;
+}
+
+
+- (uint32_t) indexForData:(NSData*)inData
+{
+	return [self _appendBytes:[inData bytes] length:[inData length]];
+}
+
+
+- (NSData*) poolData
+{
+	NSMutableData* data = [NSMutableData dataWithCapacity:sizeof(uint32_t) + [_offsets length] + [_bytes length]];
+	[data appendBytes:&_count length:sizeof(_count)];
+	[data appendData:_offsets];
+	[data appendData:_bytes];
+	return data;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Converts a property list into the binary format. Containers are written depth first, so that a container node 
+// can refer to the (already written) nodes of its children...
+
+@interface IMBAlbumDataStoreWriter : NSObject
+{
+	NSMutableData* _nodes;
+	NSMutableData* _numbers;
+	IMBAlbumDataPoolBuilder* _keys;
+	IMBAlbumDataPoolBuilder* _strings;
+	IMBAlbumDataPoolBuilder* _blobs;
+}
+
+- (NSData*) dataWithPropertyList:(NSDictionary*)inPropertyList fingerprint:(NSString*)inFingerprint;
+
+@end
+
+
+@implementation IMBAlbumDataStoreWriter
+
+
+- (id) init
+{
+	if (self = [super init])
+	{
+		_nodes = [[NSMutableData alloc] init];
+		_numbers = [[NSMutableData alloc] init];
+		_keys = [[IMBAlbumDataPoolBuilder alloc] init];
+		_strings = [[IMBAlbumDataPoolBuilder alloc] init];
+		_blobs = [[IMBAlbumDataPoolBuilder alloc] init];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_nodes);
+	IMBRelease(_numbers);
+	IMBRelease(_keys);
+	IMBRelease(_strings);
+	IMBRelease(_blobs);
+	[super dealloc];
+}
+
+
+- (uint32_t) _appendNumber:(uint64_t)inBits
+{
+	uint32_t index = (uint32_t)([_numbers length] / sizeof(uint64_t));
+	[_numbers appendBytes:&inBits length:sizeof(inBits)];
+	return index;
+}
+
+
+- (uint32_t) _appendNode:(const uint32_t*)inWords count:(NSUInteger)inCount
+{
+	uint32_t index = (uint32_t)([_nodes length] / sizeof(uint32_t));
+	[_nodes appendBytes:inWords length:inCount * sizeof(uint32_t)];
+	return index;
+}
+
+
+- (BOOL) _encodeDictionary:(NSDictionary*)inDict type:(uint32_t*)outType payload:(uint32_t*)outPayload
+{
+	NSUInteger count = [inDict count];
+	BOOL numericKeys = count > 0;
+	uint32_t key = 0;
+	
+	for (id dictKey in inDict)
+	{
+		if (!_IMBNumericKeyForString(dictKey,&key))
+		{
+			numericKeys = NO;
+			break;
+		}
+	}
+	
+	uint32_t* words = (uint32_t*) malloc((1 + 3*count) * sizeof(uint32_t));
+	uint32_t* entry = words + 1;
+	uint32_t n = 0;
+	
+	for (id dictKey in inDict)
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		
+		if ([self _encodeObject:[inDict objectForKey:dictKey] type:&entry[1] payload:&entry[2]])
+		{
+			if (numericKeys) _IMBNumericKeyForString(dictKey,&entry[0]);
+			else entry[0] = [_keys indexForString:[dictKey description]];
+			entry += 3;
+			n++;
+		}
+		
+		[pool drain];
+	}
+	
+	words[0] = n;
+	qsort(words + 1,n,3 * sizeof(uint32_t),_IMBCompareEntries);
+	
+	*outType = numericKeys ? kIMBAlbumDataTypeNumericKeyDictionary : kIMBAlbumDataTypeDictionary;
+	*outPayload = [self _appendNode:words count:1 + 3*n];
+	free(words);
+	return YES;
+}
+
+
+- (BOOL) _encodeArray:(NSArray*)inArray type:(uint32_t*)outType payload:(uint32_t*)outPayload
+{
+	NSUInteger count = [inArray count];
+	BOOL numericKeys = count > 0;
+	uint32_t key = 0;
+	
+	for (id object in inArray)
+	{
+		if (!_IMBNumericKeyForString(object,&key))
+		{
+			numericKeys = NO;
+			break;
+		}
+	}
+	
+	uint32_t* words = (uint32_t*) malloc((1 + 2*count) * sizeof(uint32_t));
+	uint32_t n = 0;
+	
+	if (numericKeys)
+	{
+		for (NSString* object in inArray)
+		{
+			_IMBNumericKeyForString(object,&words[1 + n++]);
+		}
+	}
+	else
+	{
+		for (id object in inArray)
+		{
+			if ([self _encodeObject:object type:&words[1 + 2*n] payload:&words[2 + 2*n]]) n++;
+		}
+	}
+	
+	words[0] = n;
+	
+	*outType = numericKeys ? kIMBAlbumDataTypeNumericKeyArray : kIMBAlbumDataTypeArray;
+	*outPayload = [self _appendNode:words count:numericKeys ? 1 + n : 1 + 2*n];
+	free(words);
+	return YES;
+}
+
+
+- (BOOL) _encodeObject:(id)inObject type:(uint32_t*)outType payload:(uint32_t*)outPayload
+{
+	if ([inObject isKindOfClass:[NSString class]])
+	{
+		*outType = kIMBAlbumDataTypeString;
+		*outPayload = [_strings indexForString:inObject];
+	}
+	else if ([inObject isKindOfClass:[NSNumber class]])
+	{
+		if (CFGetTypeID((CFTypeRef)inObject) == CFBooleanGetTypeID())
+		{
+			*outType = kIMBAlbumDataTypeBoolean;
+			*outPayload = [inObject boolValue] ? 1 : 0;
+		}
+		else if (CFNumberIsFloatType((CFNumberRef)inObject))
+		{
+			double value = [inObject doubleValue];
+			uint64_t bits = 0;
+			memcpy(&bits,&value,sizeof(bits));
+			*outType = kIMBAlbumDataTypeReal;
+			*outPayload = [self _appendNumber:bits];
+		}
+		else
+		{
+			long long value = [inObject longLongValue];
+			
+			if (value >= INT32_MIN && value <= INT32_MAX)
+			{
+				*outType = kIMBAlbumDataTypeInteger;
+				*outPayload = (uint32_t)(int32_t)value;
+			}
+			else
+			{
+				*outType = kIMBAlbumDataTypeLargeInteger;
+				*outPayload = [self _appendNumber:(uint64_t)value];
+			}
+		}
+	}
+	else if ([inObject isKindOfClass:[NSDate class]])
+	{
+		double value = [inObject timeIntervalSinceReferenceDate];
+		uint64_t bits = 0;
+		memcpy(&bits,&value,sizeof(bits));
+		*outType = kIMBAlbumDataTypeDate;
+		*outPayload = [self _appendNumber:bits];
+	}
+	else if ([inObject isKindOfClass:[NSData class]])
+	{
+		*outType = kIMBAlbumDataTypeData;
+		*outPayload = [_blobs indexForData:inObject];
+	}
+	else if ([inObject isKindOfClass:[NSDictionary class]])
+	{
+		return [self _encodeDictionary:inObject type:outType payload:outPayload];
+	}
+	else if ([inObject isKindOfClass:[NSArray class]])
+	{
+		return [self _encodeArray:inObject type:outType payload:outPayload];
+	}
+	else
+	{
+		return NO;
+	}
+	
+	return YES;
+}
+
+
+static void _IMBAppendAligned(NSMutableData* ioData,NSData* inData,uint64_t* outOffset)
+{
+	NSUInteger padding = (8 - [ioData length] % 8) % 8;
+	[ioData increaseLengthBy:padding];
+	*outOffset = [ioData length];
+	[ioData appendData:inData];
+}
+
+
+- (NSData*) dataWithPropertyList:(NSDictionary*)inPropertyList fingerprint:(NSString*)inFingerprint
+{
+	IMBAlbumDataStoreHeader header;
+	memset(&header,0,sizeof(header));
+	header.magic = kIMBAlbumDataStoreMagic;
+	header.version = kIMBAlbumDataStoreVersion;
+	header.fingerprint = [_strings indexForString:inFingerprint ? inFingerprint : @""];
+	
+	[self _encodeDictionary:inPropertyList type:&header.rootType payload:&header.rootNode];
+	
+	NSMutableData* data = [NSMutableData dataWithLength:sizeof(header)];
+	_IMBAppendAligned(data,_nodes,&header.nodesOffset);
+	_IMBAppendAligned(data,_numbers,&header.numbersOffset);
+	_IMBAppendAligned(data,[_keys poolData],&header.keysOffset);
+	_IMBAppendAligned(data,[_strings poolData],&header.stringsOffset);
+	_IMBAppendAligned(data,[_blobs poolData],&header.blobsOffset);
+	header.length = [data length];
+	
+	[data replaceBytesInRange:NSMakeRange(0,sizeof(header)) withBytes:&header];
+	return data;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Immutable dictionary backed by a dictionary node of a store. Values are materialized on every access...
+
+@interface IMBAlbumDataDictionary : NSDictionary
+{
+	IMBAlbumDataStore* _store;
+	const uint32_t* _node;
+	BOOL _numericKeys;
+}
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys;
+
+@end
+
+
+@interface IMBAlbumDataKeyEnumerator : NSEnumerator
+{
+	IMBAlbumDataStore* _store;
+	const uint32_t* _node;
+	BOOL _numericKeys;
+	uint32_t _index;
+}
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys;
+
+@end
+
+
+@implementation IMBAlbumDataDictionary
+
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys
+{
+	if (self = [super init])
+	{
+		_store = [inStore retain];
+		_node = inNode;
+		_numericKeys = inNumericKeys;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_store);
+	[super dealloc];
+}
+
+
+- (NSUInteger) count
+{
+	return _node[0];
+}
+
+
+- (id) objectForKey:(id)inKey
+{
+	uint32_t key = 0;
+	
+	if (_numericKeys)
+	{
+		if (!_IMBNumericKeyForString(inKey,&key)) return nil;
+	}
+	else
+	{
+		if (![_store _keyIndexForKey:inKey index:&key]) return nil;
+	}
+	
+	const uint32_t* entry = bsearch(&key,_node + 1,_node[0],3 * sizeof(uint32_t),_IMBCompareEntries);
+	if (entry == NULL) return nil;
+	
+	return [_store _objectWithType:entry[1] payload:entry[2]];
+}
+
+
+- (NSEnumerator*) keyEnumerator
+{
+	return [[[IMBAlbumDataKeyEnumerator alloc] initWithStore:_store node:_node numericKeys:_numericKeys] autorelease];
+}
+
+
+// Immutable, so there is no need to copy anything. Archived as a regular dictionary...
+
+- (id) copyWithZone:(NSZone*)inZone
+{
+	return [self retain];
+}
+
+
+- (Class) classForCoder
+{
+	return [NSDictionary class];
+}
+
+
+- (Class) classForKeyedArchiver
+{
+	return [NSDictionary class];
+}
+
+
+@end
+
+
+@implementation IMBAlbumDataKeyEnumerator
+
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys
+{
+	if (self = [super init])
+	{
+		_store = [inStore retain];
+		_node = inNode;
+		_numericKeys = inNumericKeys;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_store);
+	[super dealloc];
+}
+
+
+- (id) nextObject
+{
+	if (_index >= _node[0]) return nil;
+	
+	uint32_t key = _node[1 + 3*_index++];
+	return _numericKeys ? _IMBStringForNumericKey(key) : [_store _keyAtIndex:key];
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Immutable array backed by an array node of a store. Arrays of numeric keys are returned as strings, just like 
+// they appear in the XML file...
+
+@interface IMBAlbumDataArray : NSArray
+{
+	IMBAlbumDataStore* _store;
+	const uint32_t* _node;
+	BOOL _numericKeys;
+}
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys;
+
+@end
+
+
+@implementation IMBAlbumDataArray
+
+
+- (id) initWithStore:(IMBAlbumDataStore*)inStore node:(const uint32_t*)inNode numericKeys:(BOOL)inNumericKeys
+{
+	if (self = [super init])
+	{
+		_store = [inStore retain];
+		_node = inNode;
+		_numericKeys = inNumericKeys;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_store);
+	[super dealloc];
+}
+
+
+- (NSUInteger) count
+{
+	return _node[0];
+}
+
+
+- (id) objectAtIndex:(NSUInteger)inIndex
+{
+	if (inIndex >= _node[0])
+	{
+		[NSException raise:NSRangeException format:@"%s: index %lu beyond bounds [0 .. %lu]",__FUNCTION__,(unsigned long)inIndex,(unsigned long)_node[0]];
+	}
+	
+	if (_numericKeys)
+	{
+		return _IMBStringForNumericKey(_node[1 + inIndex]);
+	}
+	
+	return [_store _objectWithType:_node[1 + 2*inIndex] payload:_node[2 + 2*inIndex]];
+}
+
+
+- (id) copyWithZone:(NSZone*)inZone
+{
+	return [self retain];
+}
+
+
+- (Class) classForCoder
+{
+	return [NSArray class];
+}
+
+
+- (Class) classForKeyedArchiver
+{
+	return [NSArray class];
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBAlbumDataStore
+
+
+// Store files are named after a hash of the XML file path and the variant, so that each library gets its own file...
+
++ (NSString*) _storePathForFileAtPath:(NSString*)inPath variant:(NSString*)inVariant
+{
+	NSArray* paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory,NSUserDomainMask,YES);
+	NSString* folder = [paths count] > 0 ? [paths objectAtIndex:0] : NSTemporaryDirectory();
+	folder = [folder stringByAppendingPathComponent:kIMBAlbumDataStoreFolderName];
+	
+	NSString* identity = [NSString stringWithFormat:@"%@|%@",inPath,inVariant];
+	NSData* data = [identity dataUsingEncoding:NSUTF8StringEncoding allowLossyConversion:YES];
+	const uint8_t* bytes = (const uint8_t*)[data bytes];
+	NSUInteger length = [data length];
+	uint64_t hash = 14695981039346656037ULL;	// FNV-1a
+	
+	for (NSUInteger i=0; i<length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	
+	NSString* filename = [NSString stringWithFormat:@"%016llx.%@",(unsigned long long)hash,kIMBAlbumDataStoreExtension];
+	return [folder stringByAppendingPathComponent:filename];
+}
+
+
++ (IMBAlbumDataStore*) storeForFileAtPath:(NSString*)inPath variant:(NSString*)inVariant builder:(NSDictionary*(^)(void))inBuilder
+{
+	struct stat info;
+	
+	if (inPath == nil || stat([inPath fileSystemRepresentation],&info) != 0)
+	{
+		return nil;
+	}
+	
+	NSString* variant = inVariant ? inVariant : @"";
+	NSString* fingerprint = [NSString stringWithFormat:@"%@|%lld|%ld.%09ld|%@",
+		inPath,
+		(long long)info.st_size,
+		(long)info.st_mtimespec.tv_sec,
+		(long)info.st_mtimespec.tv_nsec,
+		variant];
+	
+	// Map an existing store if it was built from the same version of the XML file...
+	
+	NSString* storePath = [self _storePathForFileAtPath:inPath variant:variant];
+	NSData* data = [NSData dataWithContentsOfFile:storePath options:NSDataReadingMappedAlways error:NULL];
+	IMBAlbumDataStore* store = data ? [[[self alloc] initWithData:data] autorelease] : nil;
+	
+	if ([[store _fingerprint] isEqualToString:fingerprint])
+	{
+		return store;
+	}
+	
+	// Otherwise convert the XML file once and save the result. The (large) property list only lives as long as
+	// the autorelease pool, so that the parser doesn't hold on to it...
+	
+	store = nil;
+	NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+	
+	NSDictionary* plist = inBuilder();
+	
+	if (plist)
+	{
+		IMBAlbumDataStoreWriter* writer = [[IMBAlbumDataStoreWriter alloc] init];
+		data = [writer dataWithPropertyList:plist fingerprint:fingerprint];
+		[writer release];
+		
+		if (data)
+		{
+			NSString* folder = [storePath stringByDeletingLastPathComponent];
+			[[NSFileManager defaultManager] createDirectoryAtPath:folder withIntermediateDirectories:YES attributes:nil error:NULL];
+			
+			if ([data writeToFile:storePath atomically:YES])
+			{
+				NSData* mappedData = [NSData dataWithContentsOfFile:storePath options:NSDataReadingMappedAlways error:NULL];
+				if (mappedData) data = mappedData;
+			}
+			
+			store = [[IMBAlbumDataStore alloc] initWithData:data];
+		}
+	}
+	
+	[pool drain];
+	return [store autorelease];
+}
+
+
++ (IMBAlbumDataStore*) storeWithPropertyList:(NSDictionary*)inPropertyList
+{
+	IMBAlbumDataStoreWriter* writer = [[IMBAlbumDataStoreWriter alloc] init];
+	NSData* data = [writer dataWithPropertyList:inPropertyList fingerprint:nil];
+	[writer release];
+	
+	return data ? [[[IMBAlbumDataStore alloc] initWithData:data] autorelease] : nil;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// A store file may be truncated or damaged (or written by a buggy version), and the proxies below read from the 
+// mapping without any further checks. So before a file is used, every offset, count and index in it is checked once 
+// against the mapped length. Pools must lie within their section and have an ascending offset table...
+
+static BOOL _IMBIsValidPool(const uint8_t* inBytes,uint64_t inOffset,uint64_t inEnd,uint32_t* outCount)
+{
+	if (inOffset % sizeof(uint32_t) != 0 || inOffset + sizeof(uint32_t) > inEnd) return NO;
+	
+	const uint32_t* pool = (const uint32_t*)(inBytes + inOffset);
+	uint64_t count = pool[0];
+	uint64_t tableEnd = inOffset + (count + 2) * sizeof(uint32_t);
+	if (tableEnd > inEnd) return NO;
+	
+	const uint32_t* offsets = pool + 1;
+	
+	for (uint64_t i=0; i<count; i++)
+	{
+		if (offsets[i] > offsets[i+1]) return NO;
+	}
+	
+	if (tableEnd + offsets[count] > inEnd) return NO;
+	
+	*outCount = (uint32_t)count;
+	return YES;
+}
+
+
+// State of the validation of the node table. Container nodes are queued on a stack rather than validated 
+// recursively, so that deeply nested (or malicious) files cannot overflow the call stack...
+
+typedef struct
+{
+	const uint32_t* nodes;
+	uint64_t nodeCount;				// In words
+	uint64_t numberCount;
+	uint32_t keyCount;
+	uint32_t stringCount;
+	uint32_t blobCount;
+	uint8_t* nodeTypes;				// Container type a node is used as, or 0 if it isn't referenced (yet)
+	uint32_t* stack;
+	uint64_t stackCount;
+	uint64_t stackCapacity;
+}
+IMBAlbumDataValidation;
+
+
+// Checks a (type,payload) pair. Containers are always written before their parent, so a child node must come
+// before inParent in the node table, which also rules out cycles. A node that is referenced several times is only
+// validated once, but it must always be used as the same type of container...
+
+static BOOL _IMBIsValidValue(IMBAlbumDataValidation* ioValidation,uint32_t inType,uint32_t inPayload,uint64_t inParent)
+{
+	switch (inType)
+	{
+		case kIMBAlbumDataTypeString:
+			return inPayload < ioValidation->stringCount;
+			
+		case kIMBAlbumDataTypeInteger:
+		case kIMBAlbumDataTypeBoolean:
+			return YES;
+			
+		case kIMBAlbumDataTypeLargeInteger:
+		case kIMBAlbumDataTypeReal:
+		case kIMBAlbumDataTypeDate:
+			return inPayload < ioValidation->numberCount;
+			
+		case kIMBAlbumDataTypeData:
+			return inPayload < ioValidation->blobCount;
+			
+		case kIMBAlbumDataTypeDictionary:
+		case kIMBAlbumDataTypeNumericKeyDictionary:
+		case kIMBAlbumDataTypeArray:
+		case kIMBAlbumDataTypeNumericKeyArray:
+			
+			if (inPayload >= inParent) return NO;
+			if (ioValidation->nodeTypes[inPayload] == inType) return YES;
+			if (ioValidation->nodeTypes[inPayload] != 0) return NO;
+			
+			if (ioValidation->stackCount == ioValidation->stackCapacity)
+			{
+				uint64_t capacity = ioValidation->stackCapacity ? 2 * ioValidation->stackCapacity : 256;
+				uint32_t* stack = (uint32_t*) realloc(ioValidation->stack,capacity * sizeof(uint32_t));
+				if (stack == NULL) return NO;
+				ioValidation->stack = stack;
+				ioValidation->stackCapacity = capacity;
+			}
+			
+			ioValidation->nodeTypes[inPayload] = (uint8_t)inType;
+			ioValidation->stack[ioValidation->stackCount++] = inPayload;
+			return YES;
+	}
+	
+	return NO;
+}
+
+
+// Checks that a container node and all of its entries fit into the node table. Dictionary entries must be sorted
+// by key, since lookups use a binary search...
+
+static BOOL _IMBIsValidNode(IMBAlbumDataValidation* ioValidation,uint32_t inIndex)
+{
+	uint32_t type = ioValidation->nodeTypes[inIndex];
+	const uint32_t* node = ioValidation->nodes + inIndex;
+	uint64_t count = node[0];
+	uint64_t stride = 1;
+	
+	if (type == kIMBAlbumDataTypeDictionary || type == kIMBAlbumDataTypeNumericKeyDictionary) stride = 3;
+	else if (type == kIMBAlbumDataTypeArray) stride = 2;
+	
+	if (inIndex + 1 + count * stride > ioValidation->nodeCount) return NO;
+	
+	for (uint64_t i=0; i<count; i++)
+	{
+		const uint32_t* entry = node + 1 + i * stride;
+		
+		if (stride == 3)
+		{
+			if (i > 0 && entry[0] <= entry[-3]) return NO;
+			if (type == kIMBAlbumDataTypeDictionary && entry[0] >= ioValidation->keyCount) return NO;
+			if (!_IMBIsValidValue(ioValidation,entry[1],entry[2],inIndex)) return NO;
+		}
+		else if (stride == 2)
+		{
+			if (!_IMBIsValidValue(ioValidation,entry[0],entry[1],inIndex)) return NO;
+		}
+	}
+	
+	return YES;
+}
+
+
+// Sections are written in the order nodes, numbers, keys, strings, blobs, so each of them ends where the next one
+// starts. Only nodes that are reachable from the root are validated, which are the only ones a client can get at...
+
+static BOOL _IMBIsValidStore(const uint8_t* inBytes,uint64_t inLength)
+{
+	if (inLength < sizeof(IMBAlbumDataStoreHeader)) return NO;
+	
+	const IMBAlbumDataStoreHeader* header = (const IMBAlbumDataStoreHeader*)inBytes;
+	
+	if (header->magic != kIMBAlbumDataStoreMagic ||
+		header->version != kIMBAlbumDataStoreVersion ||
+		header->length != inLength ||
+		(header->rootType != kIMBAlbumDataTypeDictionary && header->rootType != kIMBAlbumDataTypeNumericKeyDictionary))
+	{
+		return NO;
+	}
+	
+	if (header->nodesOffset < sizeof(IMBAlbumDataStoreHeader) ||
+		header->numbersOffset < header->nodesOffset ||
+		header->keysOffset < header->numbersOffset ||
+		header->stringsOffset < header->keysOffset ||
+		header->blobsOffset < header->stringsOffset ||
+		header->blobsOffset > inLength ||
+		header->nodesOffset % sizeof(uint32_t) != 0 ||
+		header->numbersOffset % sizeof(uint64_t) != 0)
+	{
+		return NO;
+	}
+	
+	IMBAlbumDataValidation validation;
+	memset(&validation,0,sizeof(validation));
+	validation.nodes = (const uint32_t*)(inBytes + header->nodesOffset);
+	validation.nodeCount = (header->numbersOffset - header->nodesOffset) / sizeof(uint32_t);
+	validation.numberCount = (header->keysOffset - header->numbersOffset) / sizeof(uint64_t);
+	
+	if (validation.nodeCount == 0 || validation.nodeCount > UINT32_MAX ||
+		!_IMBIsValidPool(inBytes,header->keysOffset,header->stringsOffset,&validation.keyCount) ||
+		!_IMBIsValidPool(inBytes,header->stringsOffset,header->blobsOffset,&validation.stringCount) ||
+		!_IMBIsValidPool(inBytes,header->blobsOffset,inLength,&validation.blobCount) ||
+		header->fingerprint >= validation.stringCount)
+	{
+		return NO;
+	}
+	
+	validation.nodeTypes = (uint8_t*) calloc(validation.nodeCount,sizeof(uint8_t));
+	if (validation.nodeTypes == NULL) return NO;
+	
+	BOOL valid = _IMBIsValidValue(&validation,header->rootType,header->rootNode,validation.nodeCount);
+	
+	while (valid && validation.stackCount > 0)
+	{
+		valid = _IMBIsValidNode(&validation,validation.stack[--validation.stackCount]);
+	}
+	
+	free(validation.nodeTypes);
+	free(validation.stack);
+	return valid;
+}
+
+
+// Sets up the pointers into the (validated) mapped data. The key pool is small (a few dozen distinct dictionary 
+// keys), so it is materialized right away...
+
+- (id) initWithData:(NSData*)inData
+{
+	if (self = [super init])
+	{
+		_data = [inData retain];
+		_bytes = [inData bytes];
+		
+		if (!_IMBIsValidStore(_bytes,[inData length]))
+		{
+			[self release];
+			return nil;
+		}
+		
+		const IMBAlbumDataStoreHeader* header = (const IMBAlbumDataStoreHeader*)_bytes;
+		_nodes = (const uint32_t*)(_bytes + header->nodesOffset);
+		_numbers = (const uint64_t*)(_bytes + header->numbersOffset);
+		_strings = (const uint32_t*)(_bytes + header->stringsOffset);
+		_blobs = (const uint32_t*)(_bytes + header->blobsOffset);
+		
+		const uint32_t* keys = (const uint32_t*)(_bytes + header->keysOffset);
+		NSMutableArray* keyArray = [NSMutableArray arrayWithCapacity:keys[0]];
+		NSMutableDictionary* keyIndexes = [NSMutableDictionary dictionaryWithCapacity:keys[0]];
+		
+		for (uint32_t i=0; i<keys[0]; i++)
+		{
+			NSUInteger keyLength = 0;
+			const uint8_t* keyBytes = _IMBPoolEntry(keys,i,&keyLength);
+			NSString* key = [[NSString alloc] initWithBytes:keyBytes length:keyLength encoding:NSUTF8StringEncoding];
+			if (key == nil) key = [@"" retain];
+			
+			[keyArray addObject:key];
+			[keyIndexes setObject:[NSNumber numberWithUnsignedInt:i] forKey:key];
+			[key release];
+		}
+		
+		_keys = [keyArray copy];
+		_keyIndexes = [keyIndexes copy];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_data);
+	IMBRelease(_keys);
+	IMBRelease(_keyIndexes);
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (NSDictionary*) rootDictionary
+{
+	const IMBAlbumDataStoreHeader* header = (const IMBAlbumDataStoreHeader*)_bytes;
+	return [self _objectWithType:header->rootType payload:header->rootNode];
+}
+
+
+- (NSString*) _fingerprint
+{
+	const IMBAlbumDataStoreHeader* header = (const IMBAlbumDataStoreHeader*)_bytes;
+	return [self _objectWithType:kIMBAlbumDataTypeString payload:header->fingerprint];
+}
+
+
+- (BOOL) _keyIndexForKey:(id)inKey index:(uint32_t*)outIndex
+{
+	NSNumber* index = [_keyIndexes objectForKey:inKey];
+	if (index == nil) return NO;
+	
+	*outIndex = [index unsignedIntValue];
+	return YES;
+}
+
+
+- (NSString*) _keyAtIndex:(uint32_t)inIndex
+{
+	return inIndex < [_keys count] ? [_keys objectAtIndex:inIndex] : nil;
+}
+
+
+- (const uint32_t*) _nodeAtIndex:(uint32_t)inIndex
+{
+	return _nodes + inIndex;
+}
+
+
+- (id) _objectWithType:(uint32_t)inType payload:(uint32_t)inPayload
+{
+	NSUInteger length = 0;
+	const uint8_t* bytes = NULL;
+	NSString* string = nil;
+	double value = 0.0;
+	
+	switch (inType)
+	{
+		case kIMBAlbumDataTypeString:
+			bytes = _IMBPoolEntry(_strings,inPayload,&length);
+			string = [[[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] autorelease];
+			return string ? string : @"";
+			
+		case kIMBAlbumDataTypeInteger:
+			return [NSNumber numberWithInt:(int32_t)inPayload];
+			
+		case kIMBAlbumDataTypeLargeInteger:
+			return [NSNumber numberWithLongLong:(long long)_numbers[inPayload]];
+			
+		case kIMBAlbumDataTypeReal:
+			memcpy(&value,&_numbers[inPayload],sizeof(value));
+			return [NSNumber numberWithDouble:value];
+			
+		case kIMBAlbumDataTypeDate:
+			memcpy(&value,&_numbers[inPayload],sizeof(value));
+			return [NSDate dateWithTimeIntervalSinceReferenceDate:value];
+			
+		case kIMBAlbumDataTypeBoolean:
+			return [NSNumber numberWithBool:inPayload != 0];
+			
+		case kIMBAlbumDataTypeData:
+			bytes = _IMBPoolEntry(_blobs,inPayload,&length);
+			return bytes ? [NSData dataWithBytes:bytes length:length] : nil;
+			
+		case kIMBAlbumDataTypeDictionary:
+		case kIMBAlbumDataTypeNumericKeyDictionary:
+			return [[[IMBAlbumDataDictionary alloc] 
+				initWithStore:self 
+				node:[self _nodeAtIndex:inPayload] 
+				numericKeys:inType == kIMBAlbumDataTypeNumericKeyDictionary] autorelease];
+			
+		case kIMBAlbumDataTypeArray:
+		case kIMBAlbumDataTypeNumericKeyArray:
+			return [[[IMBAlbumDataArray alloc] 
+				initWithStore:self 
+				node:[self _nodeAtIndex:inPayload] 
+				numericKeys:inType == kIMBAlbumDataTypeNumericKeyArray] autorelease];
+	}
+	
+	return nil;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -750,7 +750,7 @@
 					[object release];
 
 					object.location = [NSURL fileURLWithPath:path isDirectory:NO];
-                    object.accessibility = [self accessibilityForObject:object];
+                    object.accessibility = kIMBResourceAccessibilityUnknown;		// Resolved lazily in batches
 					object.name = caption;
 					object.preliminaryMetadata = preliminaryMetadata;	// This metadata from the XML file is available immediately
 					object.metadata = nil;                              // Build lazily when needed (takes longer)
@@ -515,7 +515,7 @@ NSString *kIMBMLMediaGroupTypeFacesFolder = @"FacesFolder";
         object.accessibility = kIMBResourceIsAccessibleSecurityScoped;
     } else {
         object.location = mediaObject.URL;
-        object.accessibility = [self accessibilityForObject:object];
+        object.accessibility = kIMBResourceAccessibilityUnknown;		// Resolved lazily in batches
     }
 // Since the following two operations are expensive we postpone them to the point when we actually need the data
 //    object.locationBookmark = [self bookmarkForURL:mediaObject.URL error:&error];
@@ -108,6 +108,8 @@ extern NSString* const kIMBiPhotoNodeObjectTypeFace;  // = @"faces"
 	NSString* _appPath;
 	NSDictionary* _plist;
 	NSDate* _modificationDate;
+	NSArray* _collectedFaces;
+	NSDate* _collectedFacesModificationDate;
 	BOOL _shouldDisplayLibraryName;
 }
 
@@ -52,6 +52,7 @@
 #pragma mark HEADERS
 
 #import "IMBAppleMediaParser+iMediaPrivate.h"
+#import "IMBAlbumDataStore.h"
 #import "NSWorkspace+iMedia.h"
 #import "NSFileManager+iMedia.h"
 #import "IMBNode.h"
@@ -90,6 +91,128 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 @end
 
 
+//----------------------------------------------------------------------------------------------------------------------
+
+#pragma mark -
+
+// A single occurence of a face in a master image. The image key is stored as an index into an array of image keys
+// that is shared by all faces...
+
+#define kIMBFaceOccurenceNoFaceIndex INT32_MIN
+
+typedef struct
+{
+	uint32_t imageIndex;
+	int32_t faceIndex;
+	uint32_t order;		// Position in the master image list, makes sorting by date stable
+	double date;
+}
+IMBFaceOccurence;
+
+
+static int _IMBCompareFaceOccurences(const void* inOccurence1,const void* inOccurence2)
+{
+	const IMBFaceOccurence* occurence1 = (const IMBFaceOccurence*)inOccurence1;
+	const IMBFaceOccurence* occurence2 = (const IMBFaceOccurence*)inOccurence2;
+	
+	if (occurence1->date < occurence2->date) return -1;
+	if (occurence1->date > occurence2->date) return 1;
+	return occurence1->order < occurence2->order ? -1 : (occurence1->order > occurence2->order ? 1 : 0);
+}
+
+
+// Immutable array over face occurences. Depending on keysOnly it either contains the image keys (aka "KeyList") 
+// or small metadata dictionaries with the keys "image key", "face index" and "DateAsTimerInterval" (aka 
+// "ImageFaceMetadataList"). The elements are created on demand...
+
+@interface IMBFaceOccurenceList : NSArray
+{
+	NSData* _occurences;
+	NSArray* _imageKeys;
+	BOOL _keysOnly;
+}
+
+- (id) initWithOccurences:(NSData*)inOccurences imageKeys:(NSArray*)inImageKeys keysOnly:(BOOL)inKeysOnly;
+
+@end
+
+
+@implementation IMBFaceOccurenceList
+
+
+- (id) initWithOccurences:(NSData*)inOccurences imageKeys:(NSArray*)inImageKeys keysOnly:(BOOL)inKeysOnly
+{
+	if (self = [super init])
+	{
+		_occurences = [inOccurences retain];
+		_imageKeys = [inImageKeys retain];
+		_keysOnly = inKeysOnly;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_occurences);
+	IMBRelease(_imageKeys);
+	[super dealloc];
+}
+
+
+- (NSUInteger) count
+{
+	return [_occurences length] / sizeof(IMBFaceOccurence);
+}
+
+
+- (id) objectAtIndex:(NSUInteger)inIndex
+{
+	if (inIndex >= [self count])
+	{
+		[NSException raise:NSRangeException format:@"%s: index %lu beyond bounds [0 .. %lu]",__FUNCTION__,(unsigned long)inIndex,(unsigned long)[self count]];
+	}
+	
+	const IMBFaceOccurence* occurence = (const IMBFaceOccurence*)[_occurences bytes] + inIndex;
+	NSString* imageKey = [_imageKeys objectAtIndex:occurence->imageIndex];
+	
+	if (_keysOnly)
+	{
+		return imageKey;
+	}
+	
+	NSNumber* faceIndex = occurence->faceIndex != kIMBFaceOccurenceNoFaceIndex ? [NSNumber numberWithInt:occurence->faceIndex] : nil;
+	
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+		imageKey, @"image key",
+		[NSNumber numberWithDouble:occurence->date], @"DateAsTimerInterval",
+		faceIndex, @"face index",		// May be nil
+		nil];
+}
+
+
+- (id) copyWithZone:(NSZone*)inZone
+{
+	return [self retain];
+}
+
+
+- (Class) classForCoder
+{
+	return [NSArray class];
+}
+
+
+- (Class) classForKeyedArchiver
+{
+	return [NSArray class];
+}
+
+
+@end
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 #pragma mark -
@@ -110,6 +233,8 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 	IMBRelease(_appPath);
 	IMBRelease(_plist);
 	IMBRelease(_modificationDate);
+	IMBRelease(_collectedFaces);
+	IMBRelease(_collectedFacesModificationDate);
 	[super dealloc];
 }
 
@@ -234,9 +359,69 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+// Reads the XML file into a property list and adds the special albums to it. This is only done when there is no 
+// up-to-date IMBAlbumDataStore for the XML file yet...
+
+- (NSDictionary*) albumDataFromXMLFileAtPath:(NSString*)inPath
+{
+	// Since we want to add events and faces to the list of albums we will need
+	// to modify the album data dictionary (see further down below)
+	NSMutableDictionary* dict = [NSMutableDictionary dictionaryWithContentsOfFile:inPath];
+	
+	// WORKAROUND
+	if (dict == nil || 0 == dict.count)	// unable to read. possibly due to unencoded '&'.  rdar://7469235
+	{
+		NSData *data = [NSData dataWithContentsOfFile:inPath];
+		if (data)
+		{
+			NSString *eString = nil;
+			NSError *e = nil;
+			@try
+			{
+				NSXMLDocument *xmlDoc = [[NSXMLDocument alloc] initWithData:data
+																	options:NSXMLDocumentTidyXML error:&e];
+				dict = [NSPropertyListSerialization
+						propertyListFromData:[xmlDoc XMLData]
+						mutabilityOption:0					// Apple doc: The opt parameter is currently unused and should be set to 0.
+						format:NULL errorDescription:&eString];
+				[xmlDoc release];
+				
+				// the assignment to 'dict' in the code above yields
+				// a mutable dictionary as this code snippet would reveal:
+				// Class dictClass = [dict classForCoder];
+				// NSLog(@"Dictionary class: %@", [dictClass description]);
+			}
+			@catch(NSException *e)
+			{
+				NSLog(@"%s %@", __FUNCTION__, e);
+			}
+			// When we start targetting 10.6, we should use propertyListWithData:options:format:error:
+		}
+	}			
+	
+	//	If there is an AlbumData.xml file, there should be something inside!
+	
+	if (dict == nil || 0 == dict.count)
+	{
+		NSLog (@"The iPhoto or Aperture XML file seems to be empty. This is an unhealthy condition!");
+	} else {
+		// Since this parser confines itself to deal with the "List of Albums" only
+		// we add an events node to the album list to incorporate events in the browser.
+		// This is why we need a mutable library dictionary.
+		
+		[self addSpecialAlbumsToAlbumsInLibrary:dict];
+	}
+	
+	return dict;
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 // Load the XML file into a plist lazily (on demand). If we notice that an existing cached plist is out-of-date 
-// we get rid of it and load it anew...
+// we get rid of it and load it anew. The plist is backed by a compact IMBAlbumDataStore, which is converted from 
+// the XML file only once and memory mapped on later launches. The special albums contain localized names, so the
+// store is specific to the parser class and the localization...
 
 
 - (NSDictionary*) plist
@@ -264,55 +449,17 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 			
 			if (_plist == nil)
 			{
-				// Since we want to add events and faces to the list of albums we will need
-				// to modify the album data dictionary (see further down below)
-				NSMutableDictionary* dict = [NSMutableDictionary dictionaryWithContentsOfFile:path];
-				
-				// WORKAROUND
-				if (dict == nil || 0 == dict.count)	// unable to read. possibly due to unencoded '&'.  rdar://7469235
-				{
-					NSData *data = [NSData dataWithContentsOfFile:path];
-					if (data)
-					{
-						NSString *eString = nil;
-						NSError *e = nil;
-						@try
-						{
-							NSXMLDocument *xmlDoc = [[NSXMLDocument alloc] initWithData:data
-																				options:NSXMLDocumentTidyXML error:&e];
-							dict = [NSPropertyListSerialization
-									propertyListFromData:[xmlDoc XMLData]
-									mutabilityOption:0					// Apple doc: The opt parameter is currently unused and should be set to 0.
-									format:NULL errorDescription:&eString];
-							[xmlDoc release];
-							
-							// the assignment to 'dict' in the code above yields
-							// a mutable dictionary as this code snippet would reveal:
-							// Class dictClass = [dict classForCoder];
-							// NSLog(@"Dictionary class: %@", [dictClass description]);
-						}
-						@catch(NSException *e)
-						{
-							NSLog(@"%s %@", __FUNCTION__, e);
-						}
-						// When we start targetting 10.6, we should use propertyListWithData:options:format:error:
-					}
-				}			
-				
-				//	If there is an AlbumData.xml file, there should be something inside!
+				NSArray* localizations = [IMBBundle() preferredLocalizations];
+				NSString* variant = [NSString stringWithFormat:@"%@-%@",
+					NSStringFromClass([self class]),
+					[localizations count] > 0 ? [localizations objectAtIndex:0] : @""];
 				
-				if (dict == nil || 0 == dict.count)
+				IMBAlbumDataStore* store = [IMBAlbumDataStore storeForFileAtPath:path variant:variant builder:^NSDictionary*()
 				{
-					NSLog (@"The iPhoto or Aperture XML file seems to be empty. This is an unhealthy condition!");
-				} else {
-                    // Since this parser confines itself to deal with the "List of Albums" only
-                    // we add an events node to the album list to incorporate events in the browser.
-                    // This is why we need a mutable library dictionary.
-                    
-					[self addSpecialAlbumsToAlbumsInLibrary:dict];
-                }
+					return [self albumDataFromXMLFileAtPath:path];
+				}];
 				
-				self.atomic_plist = dict;
+				self.atomic_plist = store.rootDictionary;
 				self.modificationDate = modificationDate;
 			}
 			
@@ -552,6 +699,17 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+// Returns whether the faces on the provided master image should be shown. Called once per image when collecting
+// face occurences, so that faces nodes only list images of the media type of this parser. Subclass for specific
+// behavior.
+
+- (BOOL) shouldUseFacesOfImage:(NSDictionary*)inImageDict
+{
+	return YES;
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 // Returns an icon for an album of this type. Must be subclassed.
 
@@ -714,132 +872,173 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 // Returns array of all face dictionaries (sorted by name). These are also enriched by several keys:
 // ImageFaceMetadataList: list of meta info of face occurences in images (sorted by date)
 // KeyPhotoKey:           key of key image ('KeyPhotoKey' is an event-compatible key)
+// key image face index:  face index in the key image (only if the key image was taken from KeyList)
 // KeyList:               list of all images in which a face occurs (sorted by date)
+// PhotoCount:            number of images in KeyList
+//
+// All face occurences are collected in a single pass over the master images. Images that don't pass 
+// -shouldUseFacesOfImage: are skipped right there, so the lists never need to be filtered by media type later on.
+// The occurences are kept as plain structs, and the ImageFaceMetadataList and KeyList arrays create their elements
+// only when they are accessed. Paths of clipped face images are not computed here at all, but when a face is 
+// actually displayed (see -imagePathForFaceIndex:inImageWithKey:). The result only depends on the XML file (and 
+// the media type of the parser), so it is kept until the plist is reloaded...
 
 - (NSArray*) faces:(NSDictionary*)inFaces collectedFromImages:(NSDictionary*)inImages
 {
-	// Need the enriched copy mutable style
-	NSMutableDictionary* facesDict = [NSMutableDictionary dictionaryWithDictionary:inFaces];
-	
-	// Collect all occurences faces. We iterate over master images because only there AlbumData.xml
-	// stores occurences of faces.
+	NSDate* modificationDate = self.modificationDate;
 	
-	NSArray* facesOnImage = nil;
-	NSDictionary* imageDict = nil;
-	NSMutableDictionary* faceDict = nil;	// Will need to add keys like "KeyList" to dictionary
+	@synchronized(self)
+	{
+		if (_collectedFaces != nil && [_collectedFacesModificationDate isEqualToDate:modificationDate])
+		{
+			return [[_collectedFaces retain] autorelease];
+		}
+	}
 	
 	NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
 	
-	for (NSString* imageDictKey in [inImages keyEnumerator])
+	// Look up each face dictionary only once...
+	
+	NSUInteger faceCount = [inFaces count];
+	NSMutableArray* faceDicts = [NSMutableArray arrayWithCapacity:faceCount];
+	NSMutableArray* keyImages = [NSMutableArray arrayWithCapacity:faceCount];
+	NSMutableArray* occurences = [NSMutableArray arrayWithCapacity:faceCount];
+	NSMutableDictionary* faceIndexes = [NSMutableDictionary dictionaryWithCapacity:faceCount];
+	
+	for (NSString* faceKey in [inFaces keyEnumerator])
 	{
-		imageDict = [inImages objectForKey:imageDictKey];
+		NSDictionary* faceDict = [inFaces objectForKey:faceKey];
+		id keyImage = [faceDict objectForKey:@"key image"];
 		
-		// Get all known faces that appear on this image
-		facesOnImage = [imageDict objectForKey:@"Faces"];
+		[faceIndexes setObject:[NSNumber numberWithUnsignedInteger:[faceDicts count]] forKey:faceKey];
+		[faceDicts addObject:faceDict];
+		[keyImages addObject:keyImage ? keyImage : (id)[NSNull null]];
+		[occurences addObject:[NSMutableData data]];
+	}
+	
+	NSMutableArray* keyPhotoKeys = [NSMutableArray arrayWithCapacity:faceCount];
+	for (NSUInteger i=0; i<faceCount; i++) [keyPhotoKeys addObject:[NSNull null]];
+	
+	// Collect all occurences of faces. We iterate over master images because only there AlbumData.xml
+	// stores occurences of faces...
+	
+	NSMutableArray* imageKeys = [NSMutableArray array];
+	uint32_t order = 0;
+	
+	for (NSString* imageDictKey in [inImages keyEnumerator])
+	{
+		NSAutoreleasePool* innerPool = [[NSAutoreleasePool alloc] init];
+		NSDictionary* imageDict = [inImages objectForKey:imageDictKey];
+		NSArray* facesOnImage = [imageDict objectForKey:@"Faces"];
 		
-		NSString* imageFaceKey = nil;
-		NSMutableArray* imageFaceMetadataList = nil;
-		NSDictionary* imageFaceMetadata = nil;
-		for (NSDictionary* imageFaceDict in facesOnImage)
+		if ([facesOnImage count] > 0 && [self shouldUseFacesOfImage:imageDict])
 		{
-			// Get face dictionary for given face key.
-			// Face dictionary will be the basis of our subnode to be created.
-			
-			imageFaceKey = [imageFaceDict objectForKey:@"face key"];
-			faceDict = [facesDict objectForKey:imageFaceKey];
+			NSString* imageGUID = [imageDict objectForKey:@"GUID"];
+			double date = [[imageDict objectForKey:@"DateAsTimerInterval"] doubleValue];
+			uint32_t imageIndex = UINT32_MAX;
 			
-			// It might well be that found face in image is now longer known...
-			if (faceDict)
+			for (NSDictionary* imageFaceDict in facesOnImage)
 			{
-				// Coming here we found a face on an image and this face is known.
-				// Now add some key/value pairs to face dictionary
+				// It might well be that found face in image is now longer known. Just skip this one...
 				
-				// First convert to a mutable dictionary to be able to add the extra pairs
-				faceDict = [NSMutableDictionary dictionaryWithDictionary:faceDict];
-				[facesDict setObject:faceDict forKey:imageFaceKey];
+				NSNumber* index = [faceIndexes objectForKey:[imageFaceDict objectForKey:@"face key"]];
+				if (index == nil) continue;
 				
-                // Provide key image key under event-compatible key "KeyPhotoKey" once current image matches.
-                // NOTE: iPhoto 9.4 changed the value stored under "key image" from image key to image GUID.
-                
-                NSString* keyImage = [faceDict objectForKey:@"key image"];
-                NSString* imageGUID = [imageDict objectForKey:@"GUID"];
-                
-                if ((imageGUID  && [imageGUID isEqualToString:keyImage]) ||     // Should be YES once for >= iPhoto 9.4
-                    [imageDictKey isEqualToString:keyImage])                    // Should be YES once for < iPhoto 9.4
-                {
-                    [faceDict setObject:imageDictKey forKey:@"KeyPhotoKey"];
-                }
-                
-				// Add image face meta data to this face (need this later)
-				// (Create meta data list when first occurence of face in some image is detected)
+				NSUInteger i = [index unsignedIntegerValue];
 				
-				imageFaceMetadataList = [faceDict objectForKey:@"ImageFaceMetadataList"];
-				if (!imageFaceMetadataList)
+				if (imageIndex == UINT32_MAX)
 				{
-					imageFaceMetadataList = [NSMutableArray array];
-					[faceDict setObject:imageFaceMetadataList forKey:@"ImageFaceMetadataList"];
+					imageIndex = (uint32_t)[imageKeys count];
+					[imageKeys addObject:imageDictKey];
 				}
-                NSNumber *faceIndex = [imageFaceDict objectForKey:@"face index"];
-                NSString *path = [self imagePathForFaceIndex:faceIndex inImageWithKey:imageDictKey];
-				imageFaceMetadata = [NSDictionary dictionaryWithObjectsAndKeys:
-									 imageDictKey, @"image key",
-									 faceIndex, @"face index",
-									 [imageDict objectForKey:@"DateAsTimerInterval"], @"DateAsTimerInterval",
-                                     path, @"path",
-                                     nil];
 				
-				[imageFaceMetadataList addObject:imageFaceMetadata];
+				// Provide key image key under event-compatible key "KeyPhotoKey" once current image matches.
+				// NOTE: iPhoto 9.4 changed the value stored under "key image" from image key to image GUID.
+				
+				id keyImage = [keyImages objectAtIndex:i];
+				
+				if ((imageGUID && [imageGUID isEqual:keyImage]) ||		// Should be YES once for >= iPhoto 9.4
+					[imageDictKey isEqual:keyImage])					// Should be YES once for < iPhoto 9.4
+				{
+					[keyPhotoKeys replaceObjectAtIndex:i withObject:imageDictKey];
+				}
 				
-			} else {
-				// We found a face in a master image but that face is not associated
-				// with a known face anymore. Just skip this one.
+				NSNumber* faceIndex = [imageFaceDict objectForKey:@"face index"];
 				
-				//NSLog(@"Found unknown face with ID %@ in image %@", faceKey, imageDictKey);
+				IMBFaceOccurence occurence;
+				occurence.imageIndex = imageIndex;
+				occurence.faceIndex = faceIndex ? [faceIndex intValue] : kIMBFaceOccurenceNoFaceIndex;
+				occurence.order = order++;
+				occurence.date = date;
+				[[occurences objectAtIndex:i] appendBytes:&occurence length:sizeof(occurence)];
 			}
 		}
+		
+		[innerPool drain];
 	}
 	
-	// For each face dictionary sort associated images by date (this is how iPhoto displays them)
+	// For each face sort associated images by date (this is how iPhoto displays them), and enrich a copy of the 
+	// face dictionary with the lazy lists...
 	
-	NSSortDescriptor* dateDescriptor = [[NSSortDescriptor alloc] initWithKey:@"DateAsTimerInterval" ascending:YES];
-	NSArray* sortDescriptors = [NSArray arrayWithObject:dateDescriptor];
-	[dateDescriptor release];
+	NSMutableArray* faces = [NSMutableArray arrayWithCapacity:faceCount];
+	NSArray* sharedImageKeys = [[imageKeys copy] autorelease];
 	
-	NSArray* imageFaceMetadataList = nil;
-	for (NSString* faceKey in [facesDict keyEnumerator])
+	for (NSUInteger i=0; i<faceCount; i++)
 	{
-		faceDict = [facesDict objectForKey:faceKey];
+		NSMutableData* data = [occurences objectAtIndex:i];
+		NSUInteger occurenceCount = [data length] / sizeof(IMBFaceOccurence);
+		qsort([data mutableBytes],occurenceCount,sizeof(IMBFaceOccurence),_IMBCompareFaceOccurences);
+		
+		IMBFaceOccurenceList* metadataList = [[IMBFaceOccurenceList alloc] initWithOccurences:data imageKeys:sharedImageKeys keysOnly:NO];
+		IMBFaceOccurenceList* keyList = [[IMBFaceOccurenceList alloc] initWithOccurences:data imageKeys:sharedImageKeys keysOnly:YES];
+		
+		NSMutableDictionary* faceDict = [NSMutableDictionary dictionaryWithDictionary:[faceDicts objectAtIndex:i]];
+		[faceDict setObject:metadataList forKey:@"ImageFaceMetadataList"];
+		[faceDict setObject:keyList forKey:@"KeyList"];
+		[faceDict setObject:[NSNumber numberWithUnsignedInteger:occurenceCount] forKey:@"PhotoCount"];
 		
-		// Sort images related to face by date
+		// If the key image was skipped (e.g. because it is a photo and this parser shows movies), then the 
+		// first image with this face stands in for it...
 		
-		imageFaceMetadataList = [faceDict objectForKey:@"ImageFaceMetadataList"];
-		if (imageFaceMetadataList)
+		id keyPhotoKey = [keyPhotoKeys objectAtIndex:i];
+		
+		if (keyPhotoKey != [NSNull null])
 		{
-			imageFaceMetadataList = [imageFaceMetadataList sortedArrayUsingDescriptors:sortDescriptors];
-		} else {
-			// Obviously a metadata list has yet not been created for this face.
-			// Given the code further above this really means that this face does not appear
-			// on any image. This should probably not be but there were crash logs indicating just this.
-			// Create an empty metadata list to avoid crash.
-			imageFaceMetadataList = [NSArray array];
+			[faceDict setObject:keyPhotoKey forKey:@"KeyPhotoKey"];
+		}
+		else if (occurenceCount > 0)
+		{
+			const IMBFaceOccurence* first = (const IMBFaceOccurence*)[data bytes];
+			[faceDict setObject:[sharedImageKeys objectAtIndex:first->imageIndex] forKey:@"KeyPhotoKey"];
+			
+			if (first->faceIndex != kIMBFaceOccurenceNoFaceIndex)
+			{
+				[faceDict setObject:[NSNumber numberWithInt:first->faceIndex] forKey:@"key image face index"];
+			}
 		}
-		[faceDict setObject:imageFaceMetadataList forKey:@"ImageFaceMetadataList"]; // JJ/2012-09-21: again?????
 		
-        // Also store a sorted key list in face dictionary
-		[faceDict setObject:[imageFaceMetadataList valueForKey:@"image key"] forKey:@"KeyList"];
+		[faces addObject:[[faceDict copy] autorelease]];
+		[metadataList release];
+		[keyList release];
 	}
 	
-	[pool drain];
-	
-	// Sort faces dictionary by names (this is how iPhoto displays faces)
+	// Sort faces by names (this is how iPhoto displays faces)
 	
 	NSSortDescriptor* nameDescriptor = [[NSSortDescriptor alloc] initWithKey:@"name" ascending:YES];
-	sortDescriptors = [NSArray arrayWithObject:nameDescriptor];
+	NSArray* sortedFaces = [[faces sortedArrayUsingDescriptors:[NSArray arrayWithObject:nameDescriptor]] retain];
 	[nameDescriptor release];
 	
-	NSArray* sortedFaces = [[facesDict allValues] sortedArrayUsingDescriptors:sortDescriptors];
+	[pool drain];
+	
+	@synchronized(self)
+	{
+		IMBRelease(_collectedFaces);
+		IMBRelease(_collectedFacesModificationDate);
+		_collectedFaces = [sortedFaces retain];
+		_collectedFacesModificationDate = [modificationDate retain];
+	}
 	
-	return sortedFaces;
+	return [sortedFaces autorelease];
 }
 
 
@@ -883,15 +1082,11 @@ NSString* const kIMBiPhotoNodeObjectTypeFace  = @"faces";
 			[self shouldUseAlbum:faceDict images:inImages])
 		{
             // Validate node dictionary and repair if necessary
-            // For that we need a mutable version of node dictionary
+            // For that we need a mutable version of node dictionary. Note that "KeyPhotoKey", "KeyList" and
+            // "PhotoCount" already only refer to images of our media type (see -faces:collectedFromImages:)...
             
             faceDict = [NSMutableDictionary dictionaryWithDictionary:faceDict];
             
-			// Adjust keys "KeyPhotoKey", "KeyList", and "PhotoCount" in metadata dictionary
-			// because movies and images are not jointly displayed in iMedia browser...
-			
-			[faceDict addEntriesFromDictionary:[self childrenInfoForNode:faceDict images:inImages]];
-			
             if (![self ensureValidKeyPhotoKeyForSkimmableNode:faceDict relativeToMasterImageList:inImages]) {
                 continue;
             }
@@ -267,6 +267,7 @@ static NSString* kCurrentNodeKey = @"currentNode";
 					break;
 					
                     case kIMBResourceIsAccessible:
+                    case kIMBResourceAccessibilityUnknown:
 					[self startPlayingSelection:inSender];
 					break;
                         
@@ -304,6 +305,7 @@ static NSString* kCurrentNodeKey = @"currentNode";
 			break;
 			
             case kIMBResourceIsAccessible:
+            case kIMBResourceAccessibilityUnknown:
 			if (self.audioPlayer.isPlaying) [self startPlayingSelection:nil];
 			break;
                 
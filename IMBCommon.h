@@ -157,7 +157,12 @@ enum
      Resource exists and we have at least read access but we must wrap access to resource URL
      with -startAccessingSecurityScopedResource / -stopAccessingSecurityScopedResource
      */
-    kIMBResourceIsAccessibleSecurityScoped
+    kIMBResourceIsAccessibleSecurityScoped,
+    /**
+     Resource has not been probed yet. Parsers resolve this lazily (in batches) when thumbnails or metadata
+     of the object are loaded. Until then clients should treat the resource as accessible.
+     */
+    kIMBResourceAccessibilityUnknown
 };
 typedef NSUInteger IMBResourceAccessibility;
 
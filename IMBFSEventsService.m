@@ -83,9 +83,14 @@ static dispatch_queue_t sDispatchQueue = NULL;
 {
 //	[sConnection sendLog:[NSString stringWithFormat:@"DETECTED CHANGE FOR PATH %@",inPath]];
 	
+	BOOL replayed = [inNotification isEqualToString:IMBFileWatcherHistoryWriteNotification];
+	BOOL rescan = [inNotification isEqualToString:IMBFileWatcherRescanNotification];
+	
 	[sConnection sendMessage:[XPCMessage messageWithObjectsAndKeys:
 		@"pathDidChange",@"operation",
 		inPath,@"path",
+		[NSNumber numberWithBool:replayed],@"replayed",
+		[NSNumber numberWithBool:rescan],@"rescan",
 		nil]];
 }
 
@@ -143,6 +148,7 @@ int main(int argc,const char *argv[])
 			else if ([operation isEqual:@"stop"])
 			{
 //				[sConnection sendLog:@"STOPPING FSEVENTS SERVICE"];
+				[[IMBFSEventsWatcher sharedFileWatcher] persistLastEventId];
 				IMBRelease(sConnection);
 				xpc_transaction_end();
 			}
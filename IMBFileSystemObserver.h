@@ -65,6 +65,8 @@
 #pragma mark CONSTANTS
 
 extern NSString* kIMBPathDidChangeNotification;
+extern NSString* kIMBPathDidChangeReplayedKey;	// userInfo key: YES if the change happened before this launch
+extern NSString* kIMBPathDidChangeRescanKey;	// userInfo key: YES if everything at or below the path must be rescanned
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -69,6 +69,8 @@
 #pragma mark CONSTANTS
 
 NSString* kIMBPathDidChangeNotification = @"IMBPathDidChange";
+NSString* kIMBPathDidChangeReplayedKey = @"replayed";
+NSString* kIMBPathDidChangeRescanKey = @"rescan";
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -176,12 +178,16 @@ NSString* kIMBPathDidChangeNotification = @"IMBPathDidChange";
 	{
 		NSString* operation = [inMessage objectForKey:@"operation"];
 		NSString* path = [inMessage objectForKey:@"path"];
+		BOOL replayed = [[inMessage objectForKey:@"replayed"] boolValue];
+		BOOL rescan = [[inMessage objectForKey:@"rescan"] boolValue];
 			
 		if ([operation isEqual:@"pathDidChange"])
 		{
 			dispatch_async(dispatch_get_main_queue(),^()
 			{	
-				[self sendDidChangeNotificationForPath:path];
+				if (rescan) [self sendRescanNotificationForPath:path];
+				else if (replayed) [self sendReplayedChangeNotificationForPath:path];
+				else [self sendDidChangeNotificationForPath:path];
 			});
 		}
 	};
@@ -274,7 +280,18 @@ NSString* kIMBPathDidChangeNotification = @"IMBPathDidChange";
 
 - (void) watcher:(id<IMBFileWatcher>)inWatcher receivedNotification:(NSString*)inNotification forPath:(NSString*)inPath
 {
-	[self sendDidChangeNotificationForPath:inPath];
+	if ([inNotification isEqualToString:IMBFileWatcherRescanNotification])
+	{
+		[self sendRescanNotificationForPath:inPath];
+	}
+	else if ([inNotification isEqualToString:IMBFileWatcherHistoryWriteNotification])
+	{
+		[self sendReplayedChangeNotificationForPath:inPath];
+	}
+	else
+	{
+		[self sendDidChangeNotificationForPath:inPath];
+	}
 }
 
 
@@ -295,6 +312,42 @@ NSString* kIMBPathDidChangeNotification = @"IMBPathDidChange";
 }
 
 
+// Changes that happened while the app wasn't running are replayed at launch. These are marked in the userInfo,
+// so that listeners can skip nodes that are going to be loaded from scratch anyway...
+
+- (void) sendReplayedChangeNotificationForPath:(NSString*)inPath
+{
+	SEL method = @selector(_sendReplayedChangeNotificationForPath:);
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:method object:inPath];
+	[self performSelector:method withObject:inPath afterDelay:_notificationDelay];
+}
+
+
+- (void) _sendReplayedChangeNotificationForPath:(NSString*)inPath
+{
+	NSDictionary* userInfo = [NSDictionary dictionaryWithObject:[NSNumber numberWithBool:YES] forKey:kIMBPathDidChangeReplayedKey];
+	[[NSNotificationCenter defaultCenter] postNotificationName:kIMBPathDidChangeNotification object:inPath userInfo:userInfo];
+}
+
+
+// If FSEvents coalesced or dropped events, then we cannot tell what exactly has changed below the path. These
+// are coalesced separately, so that a following regular change for the same path doesn't cancel them...
+
+- (void) sendRescanNotificationForPath:(NSString*)inPath
+{
+	SEL method = @selector(_sendRescanNotificationForPath:);
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:method object:inPath];
+	[self performSelector:method withObject:inPath afterDelay:_notificationDelay];
+}
+
+
+- (void) _sendRescanNotificationForPath:(NSString*)inPath
+{
+	NSDictionary* userInfo = [NSDictionary dictionaryWithObject:[NSNumber numberWithBool:YES] forKey:kIMBPathDidChangeRescanKey];
+	[[NSNotificationCenter defaultCenter] postNotificationName:kIMBPathDidChangeNotification object:inPath userInfo:userInfo];
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
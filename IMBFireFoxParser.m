@@ -347,6 +347,9 @@
 	
 	NSUInteger index = 0;
 
+	int idColumn = [rs columnIndexForName:@"id"];
+	int titleColumn = [rs columnIndexForName:@"title"];
+	
 	while ([rs next])
 	{		
 //		NSLog(@"%@>%@ '%@' %@", 
@@ -355,8 +358,8 @@
 //			  [rs stringForColumn:@"title"],
 //			  @"type=2");
 
-		int theID = [rs intForColumn:@"id"];
-		NSString *theName = [rs stringForColumn:@"title"];
+		int theID = [rs intForColumnIndex:idColumn];
+		NSString *theName = [rs stringForColumnIndex:titleColumn];
 		if (theName && ![theName isEqualToString:@""])	// make sure we have a title; otherwise bogus
 		{
 			IMBNode* node = [[[IMBNode alloc] init] autorelease];
@@ -406,6 +409,11 @@
 		}
 	}
 	
+	int bookmarkTitleColumn = [rs columnIndexForName:@"title"];
+	int urlColumn = [rs columnIndexForName:@"url"];
+	int dataColumn = [rs columnIndexForName:@"data"];
+	int mimeTypeColumn = [rs columnIndexForName:@"mime_type"];
+	
 	while ([rs next])
 	{		
 		IMBObject *object = [[[IMBObject alloc] init] autorelease];
@@ -417,13 +425,13 @@
 //			  [rs stringForColumn:@"type"]);
 
 		
-		object.name = [rs stringForColumn:@"title"];
-		object.location = [NSURL URLWithString:[rs stringForColumn:@"url"]];
+		object.name = [rs stringForColumnIndex:bookmarkTitleColumn];
+		object.location = [NSURL URLWithString:[rs stringForColumnIndex:urlColumn]];
 		
-		NSData *imageData = [rs dataForColumn:@"data"];
+		NSData *imageData = [rs dataForColumnIndex:dataColumn];
 		if (imageData)
 		{
-			NSImage *iconImage = [NSImage imb_imageWithData:imageData mimeType:[rs stringForColumn:@"mime_type"]];
+			NSImage *iconImage = [NSImage imb_imageWithData:imageData mimeType:[rs stringForColumnIndex:mimeTypeColumn]];
 //			[icon setScalesWhenResized:YES];
 //			[icon setSize:NSMakeSize(16.0,16.0)];
 			object.imageRepresentationType = IKImageBrowserNSImageRepresentationType;
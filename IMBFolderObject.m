@@ -109,7 +109,7 @@
 
 // Override to do nothing...
 
-- (void) loadThumbnail
+- (void) loadThumbnailWithPriority:(IMBThumbnailPriority)inPriority
 {
 
 }
@@ -63,13 +63,17 @@
 
 #pragma mark 
 
-// This parser class creates nodes for a folder and populates it with files that conform to the specified uti...
+// This parser class creates nodes for a folder and populates it with files that conform to the specified uti.
+// For every populated folder it keeps a snapshot (inode, modification date, size, UTI of each item), so that
+// file system changes can be applied incrementally (see -changesForNode:error:)...
  
 @interface IMBFolderParser : IMBParser
 {
 	NSString* _fileUTI;
 	NSUInteger _displayPriority;
 	BOOL _isUserAdded;
+	NSMutableDictionary* _snapshots;
+	NSMutableDictionary* _conformingTypes;
 }
 
 @property (retain) NSString* fileUTI;
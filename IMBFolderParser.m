@@ -69,11 +69,59 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark CONSTANTS
+
+// Keys for the snapshot entries that we keep for every populated folder...
+
+static NSString* kIMBSnapshotNameKey = @"name";
+static NSString* kIMBSnapshotIsFolderKey = @"isFolder";
+static NSString* kIMBSnapshotInodeKey = @"inode";
+static NSString* kIMBSnapshotModificationDateKey = @"modificationDate";
+static NSString* kIMBSnapshotSizeKey = @"size";
+static NSString* kIMBSnapshotTypeKey = @"type";
+static NSString* kIMBSnapshotHasSubfoldersKey = @"hasSubfolders";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark GLOBALS
+
+// Uniform type identifiers by (lowercase) filename extension. Shared by all folder parsers...
+
+static NSMutableDictionary* sTypesByExtension = nil;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBFolderParser ()
+
+- (NSArray*) _contentsOfDirectoryAtURL:(NSURL*)inURL error:(NSError**)outError;
+- (NSDictionary*) _snapshotEntryForURL:(NSURL*)inURL previousEntry:(NSDictionary*)inPreviousEntry;
+- (BOOL) _snapshotEntry:(NSDictionary*)inEntry1 isEqualToSnapshotEntry:(NSDictionary*)inEntry2;
+- (NSString*) _typeIdentifierForURL:(NSURL*)inURL isDirectory:(BOOL)inIsDirectory;
+- (BOOL) _isMediaFileSnapshotEntry:(NSDictionary*)inEntry;
+- (NSDictionary*) _snapshotForNode:(IMBNode*)inNode;
+- (void) _setSnapshot:(NSDictionary*)inSnapshot forNode:(IMBNode*)inNode;
+- (void) _removeSnapshotsForFolderURL:(NSURL*)inURL;
+- (IMBNode*) _subnodeForFolderURL:(NSURL*)inURL name:(NSString*)inName error:(NSError**)outError;
+- (IMBNode*) _subnodeForFolderURL:(NSURL*)inURL name:(NSString*)inName hasSubfolders:(NSNumber*)inHasSubfolders;
+- (IMBFolderObject*) _folderObjectForSubnode:(IMBNode*)inSubnode index:(NSUInteger)inIndex;
+- (NSNumber*) directoryHasVisibleSubfolders:(NSURL*)directory error:(NSError**)outError;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark 
 
 @implementation IMBFolderParser
 
-@synthesize fileUTI = _fileUTI;
 @synthesize displayPriority = _displayPriority;
 @synthesize isUserAdded = _isUserAdded;
 
@@ -88,6 +136,8 @@
 		self.fileUTI = nil;
 		self.displayPriority = 5;	// default middle-of-the-pack priority
 		self.isUserAdded = NO;
+		_snapshots = [[NSMutableDictionary alloc] init];
+		_conformingTypes = [[NSMutableDictionary alloc] init];
 	}
 	
 	return self;
@@ -96,6 +146,8 @@
 - (void) dealloc
 {
 	IMBRelease(_fileUTI);
+	IMBRelease(_snapshots);
+	IMBRelease(_conformingTypes);
 	[super dealloc];
 }
 
@@ -160,41 +212,55 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// Populating a folder node only touches the node itself and the snapshot cache (which is locked), so 
+// reloading a folder tree can repopulate its subfolders in parallel...
+
+- (BOOL) canPopulateNodesConcurrently
+{
+	return YES;
+}
+
+
+// The expensive parts (fetching resource values and probing each subfolder for subfolders of its own) are done 
+// concurrently, then the results are merged in the original (Finder-like) order. When the folder was populated 
+// before, the snapshot tells us which subfolders haven't changed, so we can skip probing them altogether...
+
 - (BOOL) populateNode:(IMBNode*)inNode error:(NSError**)outError
 {
 	NSError* error = nil;
 	NSAutoreleasePool* pool = nil;
 	NSInteger index = 0;
-	BOOL ok;
     BOOL result = YES;
 	
 	// Scan the folder for files and directories...
 	
-	NSFileManager* fileManager = [[NSFileManager alloc] init];
-
-	NSArray* urls = [fileManager contentsOfDirectoryAtURL:
-		inNode.mediaSource 
-		includingPropertiesForKeys:[NSArray arrayWithObjects:NSURLLocalizedNameKey,NSURLIsDirectoryKey,NSURLIsPackageKey,nil] 
-		options:NSDirectoryEnumerationSkipsHiddenFiles 
-		error:&error];
-
-    [fileManager release];
-
-	// Sort in Finder-like manner...
-	
-	urls = [urls sortedArrayUsingComparator:^NSComparisonResult(NSURL* url1,NSURL* url2)
-	{
-		return [url1.path localizedStandardCompare:url2.path];
-	}];
+	NSArray* urls = [self _contentsOfDirectoryAtURL:inNode.mediaSource error:&error];
 	
 	if (urls)
 	{
 		NSMutableArray* subnodes = [inNode mutableArrayForPopulatingSubnodes];
 		NSMutableArray* objects = [NSMutableArray arrayWithCapacity:urls.count];
 		NSMutableArray* folders = [NSMutableArray array];
+		NSMutableDictionary* snapshot = [NSMutableDictionary dictionaryWithCapacity:urls.count];
+		NSDictionary* previousSnapshot = [self _snapshotForNode:inNode];
+		dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0);
 		inNode.displayedObjectCount = 0;
 		
-		for (NSURL* url in urls)
+		// Get some info about each file or folder and remember it for incremental updates later...
+		
+		NSUInteger count = urls.count;
+		NSMutableDictionary** entries = (NSMutableDictionary**) calloc(MAX(count,1),sizeof(NSMutableDictionary*));
+		
+		dispatch_apply(count,queue,^(size_t i)
+		{
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			NSURL* url = [urls objectAtIndex:i];
+			NSDictionary* previousEntry = [previousSnapshot objectForKey:[url lastPathComponent]];
+			entries[i] = (NSMutableDictionary*) [[self _snapshotEntryForURL:url previousEntry:previousEntry] retain];
+			[pool drain];
+		});
+		
+		for (NSUInteger i=0; i<count; i++)
 		{
 			if (index%32 == 0)
 			{
@@ -202,43 +268,25 @@
 				pool = [[NSAutoreleasePool alloc] init];
 			}
 
-			// Get some info about the file or folder...
+			NSURL* url = [urls objectAtIndex:i];
+			NSDictionary* entry = [entries[i] autorelease];
+			if (entry == nil) continue;
 			
-			NSString* localizedName = nil;
-			ok = [url getResourceValue:&localizedName forKey:NSURLLocalizedNameKey error:&error];
-			if (!ok) continue;
-			
-			NSNumber* isDirectory = nil;
-			ok = [url getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:&error];
-			if (!ok) continue;
-
-			NSNumber* isPackage = nil;
-			ok = [url getResourceValue:&isPackage forKey:NSURLIsPackageKey error:&error];
-			if (!ok) continue;
+			[snapshot setObject:entry forKey:[url lastPathComponent]];
 			
 			// If we found a folder (that is not a package, then remember it for later. Folders will be added
 			// after regular files...
 			
-			if ([isDirectory boolValue] && ![isPackage boolValue])
+			if ([[entry objectForKey:kIMBSnapshotIsFolderKey] boolValue])
 			{
-				if (![IMBConfig isLibraryAtURL:url])
-				{
-					[folders addObject:url];
-				}
-				else
-				{
-					// NSLog(@"IGNORING LIBRARY PATH: %@", path);
-				}
+				[folders addObject:url];
 			}
 			
 			// Regular files are added immediately (if they have the correct UTI)...
 			
-            NSString *type;
-            ok = [url getResourceValue:&type forKey:NSURLTypeIdentifierKey error:&error];
-			
-            if (ok && UTTypeConformsTo((CFStringRef)type, (CFStringRef)_fileUTI))
+            if ([self _isMediaFileSnapshotEntry:entry])
             {
-				IMBObject* object = [self objectForURL:url name:localizedName index:index++];
+				IMBObject* object = [self objectForURL:url name:[entry objectForKey:kIMBSnapshotNameKey] index:index++];
                 
                 if ([self canUseObject:object forPopulatingNode:inNode])
                 {
@@ -247,12 +295,42 @@
                 }
 			}
 		}
-				
+		
+		free(entries);
 		IMBDrain(pool);
 
+		// Find out which folders have subfolders. Adding or removing a subfolder changes the modification date  
+		// of a folder, so if a folder is unchanged since the last scan, then the cached answer is still valid...
+		
+		NSUInteger folderCount = folders.count;
+		NSNumber** hasSubfolders = (NSNumber**) calloc(MAX(folderCount,1),sizeof(NSNumber*));
+		
+		dispatch_apply(folderCount,queue,^(size_t i)
+		{
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			NSURL* url = [folders objectAtIndex:i];
+			NSString* filename = [url lastPathComponent];
+			NSDictionary* entry = [snapshot objectForKey:filename];
+			NSDictionary* previousEntry = [previousSnapshot objectForKey:filename];
+			NSNumber* value = nil;
+			
+			if (previousEntry && [self _snapshotEntry:previousEntry isEqualToSnapshotEntry:entry])
+			{
+				value = [previousEntry objectForKey:kIMBSnapshotHasSubfoldersKey];
+			}
+			
+			if (value == nil)
+			{
+				value = [self directoryHasVisibleSubfolders:url error:NULL];
+			}
+			
+			hasSubfolders[i] = [value retain];
+			[pool drain];
+		});
+		
 		// Now we can actually handle the folders. Add a subnode and an IMBNodeObject for each folder...
 				
-		for (NSURL* url in folders)
+		for (NSUInteger i=0; i<folderCount; i++)
 		{
 			if (index%32 == 0)
 			{
@@ -260,42 +338,26 @@
 				pool = [[NSAutoreleasePool alloc] init];
 			}
 			
-			NSString* name;
-			if (![url getResourceValue:&name forKey:NSURLLocalizedNameKey error:&error]) continue;
+			NSURL* url = [folders objectAtIndex:i];
+			NSNumber* value = [hasSubfolders[i] autorelease];
+			if (value == nil) continue;
 			
-			NSNumber* hasSubfolders = [self directoryHasVisibleSubfolders:url error:&error];
-			if (!hasSubfolders) continue;
+			NSMutableDictionary* entry = [snapshot objectForKey:[url lastPathComponent]];
+			[entry setObject:value forKey:kIMBSnapshotHasSubfoldersKey];
 			
-			IMBNode* subnode = [[IMBNode alloc] initWithParser:self topLevel:NO];
-			subnode.icon = [self iconForItemAtURL:url error:NULL];
-			subnode.name = name;
-			
-            NSString* path = [url path];
-			subnode.identifier = [self identifierForPath:path];
-            
-			subnode.mediaSource = url;
-			subnode.isLeafNode = ![hasSubfolders boolValue];
-			subnode.groupType = kIMBGroupTypeFolder;
-			subnode.isIncludedInPopup = NO;
-			subnode.watchedPath = path;					// These two lines are important to make file watching work for nested 
-			subnode.watcherType = kIMBWatcherTypeNone;	// subfolders. See IMBLibraryController _reloadNodesWithWatchedPath:
+			NSString* name = [entry objectForKey:kIMBSnapshotNameKey];
+			IMBNode* subnode = [self _subnodeForFolderURL:url name:name hasSubfolders:value];
 			
             [subnodes addObject:subnode];
-			[subnode release];
-
-			IMBFolderObject* object = [[IMBFolderObject alloc] init];
-			object.representedNodeIdentifier = subnode.identifier;
-			object.location = url;
-			object.name = name;
-			object.metadata = nil;
-			object.parserIdentifier = self.identifier;
-			object.index = index++;
-			[objects addObject:object];
-			[object release];
+			[objects addObject:[self _folderObjectForSubnode:subnode index:index++]];
 		}
 		
+		free(hasSubfolders);
+		
 		inNode.objects = objects;
 		inNode.isLeafNode = [subnodes count] == 0;
+		
+		[self _setSnapshot:snapshot forNode:inNode];
 	}
 	else
     {
@@ -307,6 +369,180 @@
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Rescan the folder of an already populated node and compare the result with the snapshot that was taken when 
+// the node was last populated. Unchanged files (same inode, modification date and size) keep their IMBObjects 
+// on the host side, so their thumbnails and metadata are not lost. If we do not have a snapshot for this node
+// (e.g. because the XPC service was relaunched), or if the changes cannot be expressed as objects and subnodes
+// that were added to or removed from this folder, then we return nil and the node tree is reloaded instead.
+// The folder is scanned without holding the snapshot lock. The new snapshot is only stored if nobody else has
+// stored one in the meantime, so that two concurrent calls for the same folder cannot both report the same change...
+
+- (NSDictionary*) changesForNode:(IMBNode*)inNode error:(NSError**)outError
+{
+	NSError* error = nil;
+	NSDictionary* oldSnapshot = [self _snapshotForNode:inNode];
+	
+	if (oldSnapshot == nil || !inNode.isPopulated)
+	{
+		if (outError) *outError = nil;
+		return nil;
+	}
+	
+	NSArray* urls = [self _contentsOfDirectoryAtURL:inNode.mediaSource error:&error];
+	
+	if (urls == nil)
+	{
+		[self _removeSnapshotsForFolderURL:inNode.mediaSource];
+		if (outError) *outError = error;
+		return nil;
+	}
+	
+	NSMutableDictionary* newSnapshot = [NSMutableDictionary dictionaryWithCapacity:urls.count];
+	NSMutableArray* addedObjects = [NSMutableArray array];
+	NSMutableArray* modifiedObjects = [NSMutableArray array];
+	NSMutableArray* removedLocations = [NSMutableArray array];
+	NSMutableArray* addedSubnodes = [NSMutableArray array];
+	NSMutableArray* removedSubnodeIdentifiers = [NSMutableArray array];
+	NSMutableArray* removedFolderURLs = [NSMutableArray array];
+	
+	for (NSURL* url in urls)
+	{
+		NSString* filename = [url lastPathComponent];
+		NSDictionary* oldEntry = [oldSnapshot objectForKey:filename];
+		NSDictionary* newEntry = [self _snapshotEntryForURL:url previousEntry:oldEntry];
+		if (newEntry == nil) continue;
+		
+		[newSnapshot setObject:newEntry forKey:filename];
+		
+		BOOL wasMediaFile = oldEntry != nil && [self _isMediaFileSnapshotEntry:oldEntry];
+		BOOL isMediaFile = [self _isMediaFileSnapshotEntry:newEntry];
+		BOOL wasFolder = [[oldEntry objectForKey:kIMBSnapshotIsFolderKey] boolValue];
+		BOOL isFolder = [[newEntry objectForKey:kIMBSnapshotIsFolderKey] boolValue];
+		NSString* name = [newEntry objectForKey:kIMBSnapshotNameKey];
+		
+		// Media files...
+		
+		if (isMediaFile && (!wasMediaFile || ![self _snapshotEntry:oldEntry isEqualToSnapshotEntry:newEntry]))
+		{
+			IMBObject* object = [self objectForURL:url name:name index:0];
+			
+			if ([self canUseObject:object forPopulatingNode:inNode])
+			{
+				if (wasMediaFile) [modifiedObjects addObject:object];
+				else [addedObjects addObject:object];
+			}
+			else if (wasMediaFile)
+			{
+				[removedLocations addObject:url];
+			}
+		}
+		else if (wasMediaFile && !isMediaFile)
+		{
+			[removedLocations addObject:url];
+		}
+		
+		// Folders. Changes inside a subfolder are reported for the subfolder itself, as every subnode watches 
+		// its own path. The exception is whether a subfolder has subfolders itself, as that is reflected by the 
+		// isLeafNode flag of its subnode here. If that has changed (or we cannot tell), then the subnode needs to 
+		// be replaced, which is beyond a flat list of changes, so the whole node tree is reloaded instead...
+		
+		if (isFolder && wasFolder)
+		{
+			id hasSubfolders = [oldEntry objectForKey:kIMBSnapshotHasSubfoldersKey];
+			
+			if (![self _snapshotEntry:oldEntry isEqualToSnapshotEntry:newEntry])
+			{
+				NSNumber* value = [self directoryHasVisibleSubfolders:url error:NULL];
+				
+				if (value == nil || hasSubfolders == nil || ![value isEqual:hasSubfolders])
+				{
+					if (outError) *outError = nil;
+					return nil;
+				}
+			}
+			
+			if (hasSubfolders) [(NSMutableDictionary*)newEntry setObject:hasSubfolders forKey:kIMBSnapshotHasSubfoldersKey];
+		}
+		else if (isFolder && !wasFolder)
+		{
+			IMBNode* subnode = [self _subnodeForFolderURL:url name:name error:&error];
+			
+			if (subnode)
+			{
+				[(NSMutableDictionary*)newEntry setObject:[NSNumber numberWithBool:!subnode.isLeafNode] forKey:kIMBSnapshotHasSubfoldersKey];
+				[addedSubnodes addObject:subnode];
+				[addedObjects addObject:[self _folderObjectForSubnode:subnode index:0]];
+			}
+		}
+		else if (wasFolder && !isFolder)
+		{
+			[removedSubnodeIdentifiers addObject:[self identifierForPath:[url path]]];
+			[removedLocations addObject:url];
+			[removedFolderURLs addObject:url];
+		}
+	}
+	
+	// Anything that is in the old snapshot, but not in the new one has been deleted (or renamed)...
+	
+	NSURL* folderURL = inNode.mediaSource;
+	
+	for (NSString* filename in oldSnapshot)
+	{
+		if ([newSnapshot objectForKey:filename] == nil)
+		{
+			NSDictionary* oldEntry = [oldSnapshot objectForKey:filename];
+			NSURL* url = [folderURL URLByAppendingPathComponent:filename];
+			
+			if ([[oldEntry objectForKey:kIMBSnapshotIsFolderKey] boolValue])
+			{
+				[removedSubnodeIdentifiers addObject:[self identifierForPath:[url path]]];
+				[removedLocations addObject:url];
+				[removedFolderURLs addObject:url];
+			}
+			else if ([self _isMediaFileSnapshotEntry:oldEntry])
+			{
+				[removedLocations addObject:url];
+			}
+		}
+	}
+	
+	// If another call has stored a snapshot for this folder while we were scanning, then we cannot tell which
+	// of our changes it has already reported. Let the caller reload the node tree in that case...
+	
+	@synchronized(_snapshots)
+	{
+		if ([self _snapshotForNode:inNode] != oldSnapshot)
+		{
+			if (outError) *outError = nil;
+			return nil;
+		}
+		
+		[self _setSnapshot:newSnapshot forNode:inNode];
+	}
+	
+	for (NSURL* url in removedFolderURLs)
+	{
+		[self _removeSnapshotsForFolderURL:url];
+	}
+
+	NSMutableDictionary* changes = [NSMutableDictionary dictionary];
+	if ([addedObjects count]) [changes setObject:addedObjects forKey:kIMBNodeChangesAddedObjectsKey];
+	if ([modifiedObjects count]) [changes setObject:modifiedObjects forKey:kIMBNodeChangesModifiedObjectsKey];
+	if ([removedLocations count]) [changes setObject:removedLocations forKey:kIMBNodeChangesRemovedLocationsKey];
+	if ([addedSubnodes count]) [changes setObject:addedSubnodes forKey:kIMBNodeChangesAddedSubnodesKey];
+	if ([removedSubnodeIdentifiers count]) [changes setObject:removedSubnodeIdentifiers forKey:kIMBNodeChangesRemovedSubnodeIdentifiersKey];
+
+	if (outError) *outError = nil;
+	return changes;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 // This is a hook for subclasses that can be overridden to exclude some object when populating a node...
 
 - (BOOL) canUseObject:(IMBObject*)inObject forPopulatingNode:(IMBNode*)inNode
@@ -318,6 +554,48 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// Changing the fileUTI invalidates the cached type conformance...
+
+- (void) setFileUTI:(NSString*)inFileUTI
+{
+	@synchronized (_conformingTypes)
+	{
+		[_fileUTI autorelease];
+		_fileUTI = [inFileUTI retain];
+		[_conformingTypes removeAllObjects];
+	}
+}
+
+
+- (NSString*) fileUTI
+{
+	@synchronized (_conformingTypes)
+	{
+		return [[_fileUTI retain] autorelease];
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// The readable flag was already fetched along with the directory contents (see _contentsOfDirectoryAtURL:error:)
+// and is still cached in the NSURL. Only if it isn't available do we have to hit the file system again...
+
+- (IMBResourceAccessibility) accessibilityForObject:(IMBObject*)inObject
+{
+	NSURL* url = inObject.location;
+	NSNumber* isReadable = nil;
+	
+	if ([url isFileURL] && [url getResourceValue:&isReadable forKey:NSURLIsReadableKey error:NULL] && isReadable != nil)
+	{
+		return [isReadable boolValue] ? kIMBResourceIsAccessible : kIMBResourceNoPermission;
+	}
+	
+	return [super accessibilityForObject:inObject];
+}
+
+
 // Since we know that we have local files we can use the helper method supplied by the base class...
 
 - (NSData*) bookmarkForObject:(IMBObject*)inObject error:(NSError**)outError
@@ -368,6 +646,265 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// Returns the contents of a folder sorted in a Finder-like manner. All resource values that we need later on 
+// are prefetched in the same call...
+
+- (NSArray*) _contentsOfDirectoryAtURL:(NSURL*)inURL error:(NSError**)outError
+{
+	NSFileManager* fileManager = [[NSFileManager alloc] init];
+
+	NSArray* urls = [fileManager contentsOfDirectoryAtURL:
+		inURL 
+		includingPropertiesForKeys:[NSArray arrayWithObjects:
+			NSURLLocalizedNameKey,
+			NSURLIsDirectoryKey,
+			NSURLIsPackageKey,
+			NSURLFileResourceIdentifierKey,
+			NSURLContentModificationDateKey,
+			NSURLFileSizeKey,
+			NSURLIsReadableKey,
+			nil] 
+		options:NSDirectoryEnumerationSkipsHiddenFiles 
+		error:outError];
+
+    [fileManager release];
+	
+	return [urls sortedArrayUsingComparator:^NSComparisonResult(NSURL* url1,NSURL* url2)
+	{
+		return [url1.path localizedStandardCompare:url2.path];
+	}];
+}
+
+
+// Creates the snapshot entry (inode, modification date, size, UTI) for a file or folder. If the file is unchanged
+// compared to the previous entry, then we can save ourselves the UTI lookup...
+
+- (NSDictionary*) _snapshotEntryForURL:(NSURL*)inURL previousEntry:(NSDictionary*)inPreviousEntry
+{
+	NSString* localizedName = nil;
+	if (![inURL getResourceValue:&localizedName forKey:NSURLLocalizedNameKey error:NULL]) return nil;
+	
+	NSNumber* isDirectory = nil;
+	if (![inURL getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:NULL]) return nil;
+
+	NSNumber* isPackage = nil;
+	if (![inURL getResourceValue:&isPackage forKey:NSURLIsPackageKey error:NULL]) return nil;
+
+	id inode = nil;
+	[inURL getResourceValue:&inode forKey:NSURLFileResourceIdentifierKey error:NULL];
+	
+	NSDate* modificationDate = nil;
+	[inURL getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:NULL];
+	
+	NSNumber* size = nil;
+	[inURL getResourceValue:&size forKey:NSURLFileSizeKey error:NULL];
+	
+	BOOL isFolder = [isDirectory boolValue] && ![isPackage boolValue] && ![IMBConfig isLibraryAtURL:inURL];
+	
+	NSMutableDictionary* entry = [NSMutableDictionary dictionaryWithCapacity:6];
+	[entry setObject:localizedName forKey:kIMBSnapshotNameKey];
+	[entry setObject:[NSNumber numberWithBool:isFolder] forKey:kIMBSnapshotIsFolderKey];
+	if (inode) [entry setObject:inode forKey:kIMBSnapshotInodeKey];
+	if (modificationDate) [entry setObject:modificationDate forKey:kIMBSnapshotModificationDateKey];
+	if (size) [entry setObject:size forKey:kIMBSnapshotSizeKey];
+	
+	NSString* type = nil;
+	
+	if (inPreviousEntry && [self _snapshotEntry:inPreviousEntry isEqualToSnapshotEntry:entry])
+	{
+		type = [inPreviousEntry objectForKey:kIMBSnapshotTypeKey];
+	}
+	else
+	{
+		type = [self _typeIdentifierForURL:inURL isDirectory:[isDirectory boolValue]];
+	}
+	
+	if (type) [entry setObject:type forKey:kIMBSnapshotTypeKey];
+	
+	return entry;
+}
+
+
+- (BOOL) _snapshotEntry:(NSDictionary*)inEntry1 isEqualToSnapshotEntry:(NSDictionary*)inEntry2
+{
+	id inode1 = [inEntry1 objectForKey:kIMBSnapshotInodeKey];
+	id inode2 = [inEntry2 objectForKey:kIMBSnapshotInodeKey];
+	NSDate* date1 = [inEntry1 objectForKey:kIMBSnapshotModificationDateKey];
+	NSDate* date2 = [inEntry2 objectForKey:kIMBSnapshotModificationDateKey];
+	NSNumber* size1 = [inEntry1 objectForKey:kIMBSnapshotSizeKey];
+	NSNumber* size2 = [inEntry2 objectForKey:kIMBSnapshotSizeKey];
+	
+	if (inode1 == nil || date1 == nil) return NO;
+	
+	return [inode1 isEqual:inode2] && [date1 isEqualToDate:date2] && (size1 == size2 || [size1 isEqualToNumber:size2]);
+}
+
+
+// For regular files the type usually only depends on the filename extension, so we can cache it instead of asking 
+// LaunchServices for every single file. Directories (and packages) still get their type from the file system, and 
+// so do files without extension (e.g. old files with HFS type codes), as the extension would only yield a dyn. type...
+
+- (NSString*) _typeIdentifierForURL:(NSURL*)inURL isDirectory:(BOOL)inIsDirectory
+{
+	NSString* type = nil;
+	NSString* extension = [[inURL pathExtension] lowercaseString];
+	
+	if (inIsDirectory || [extension length] == 0)
+	{
+		[inURL getResourceValue:&type forKey:NSURLTypeIdentifierKey error:NULL];
+		return type;
+	}
+	
+	@synchronized ([IMBFolderParser class])
+	{
+		if (sTypesByExtension == nil) sTypesByExtension = [[NSMutableDictionary alloc] init];
+		type = [[[sTypesByExtension objectForKey:extension] retain] autorelease];
+	}
+	
+	if (type == nil)
+	{
+		type = [(NSString*)UTTypeCreatePreferredIdentifierForTag(kUTTagClassFilenameExtension,(CFStringRef)extension,NULL) autorelease];
+		if (type == nil) return nil;
+		
+		@synchronized ([IMBFolderParser class])
+		{
+			[sTypesByExtension setObject:type forKey:extension];
+		}
+	}
+	
+	return type;
+}
+
+
+// Whether a type conforms to our fileUTI is cached as well, as there are only a handful of different types 
+// in a typical folder...
+
+- (BOOL) _isMediaFileSnapshotEntry:(NSDictionary*)inEntry
+{
+	NSString* type = [inEntry objectForKey:kIMBSnapshotTypeKey];
+	if (type == nil) return NO;
+	
+	NSNumber* conforms = nil;
+	
+	@synchronized (_conformingTypes)
+	{
+		conforms = [_conformingTypes objectForKey:type];
+		
+		if (conforms == nil)
+		{
+			conforms = [NSNumber numberWithBool:UTTypeConformsTo((CFStringRef)type,(CFStringRef)_fileUTI)];
+			[_conformingTypes setObject:conforms forKey:type];
+		}
+	}
+	
+	return [conforms boolValue];
+}
+
+
+// Snapshots are kept per folder path for the lifetime of the parser instance (i.e. the XPC service)...
+
+- (NSDictionary*) _snapshotForNode:(IMBNode*)inNode
+{
+	NSString* path = [[inNode.mediaSource path] stringByStandardizingPath];
+	if (path == nil) return nil;
+	
+	@synchronized(_snapshots)
+	{
+		return [[[_snapshots objectForKey:path] retain] autorelease];
+	}
+}
+
+
+- (void) _setSnapshot:(NSDictionary*)inSnapshot forNode:(IMBNode*)inNode
+{
+	NSString* path = [[inNode.mediaSource path] stringByStandardizingPath];
+	if (path == nil) return;
+	
+	@synchronized(_snapshots)
+	{
+		if (inSnapshot) [_snapshots setObject:inSnapshot forKey:path];
+		else [_snapshots removeObjectForKey:path];
+	}
+}
+
+
+// Drops the snapshots of a folder that went away, including those of all folders inside it...
+
+- (void) _removeSnapshotsForFolderURL:(NSURL*)inURL
+{
+	NSString* path = [[inURL path] stringByStandardizingPath];
+	if (path == nil) return;
+	
+	NSString* prefix = [path hasSuffix:@"/"] ? path : [path stringByAppendingString:@"/"];
+	
+	@synchronized(_snapshots)
+	{
+		NSMutableArray* removedPaths = [NSMutableArray array];
+		
+		for (NSString* snapshotPath in _snapshots)
+		{
+			if ([snapshotPath isEqualToString:path] || [snapshotPath hasPrefix:prefix])
+			{
+				[removedPaths addObject:snapshotPath];
+			}
+		}
+		
+		[_snapshots removeObjectsForKeys:removedPaths];
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Creates an unpopulated subnode for a subfolder. Returns nil if we cannot tell whether the subfolder has 
+// any subfolders itself (e.g. because it just disappeared)...
+
+- (IMBNode*) _subnodeForFolderURL:(NSURL*)inURL name:(NSString*)inName error:(NSError**)outError
+{
+	NSNumber* hasSubfolders = [self directoryHasVisibleSubfolders:inURL error:outError];
+	if (!hasSubfolders) return nil;
+	
+	return [self _subnodeForFolderURL:inURL name:inName hasSubfolders:hasSubfolders];
+}
+
+
+- (IMBNode*) _subnodeForFolderURL:(NSURL*)inURL name:(NSString*)inName hasSubfolders:(NSNumber*)hasSubfolders
+{
+	IMBNode* subnode = [[[IMBNode alloc] initWithParser:self topLevel:NO] autorelease];
+	subnode.icon = [self iconForItemAtURL:inURL error:NULL];
+	subnode.name = inName;
+	
+	NSString* path = [inURL path];
+	subnode.identifier = [self identifierForPath:path];
+	
+	subnode.mediaSource = inURL;
+	subnode.isLeafNode = ![hasSubfolders boolValue];
+	subnode.groupType = kIMBGroupTypeFolder;
+	subnode.isIncludedInPopup = NO;
+	subnode.watchedPath = path;					// These two lines are important to make file watching work for nested 
+	subnode.watcherType = kIMBWatcherTypeNone;	// subfolders. See IMBLibraryController _reloadNodesWithWatchedPath:
+	
+	return subnode;
+}
+
+
+- (IMBFolderObject*) _folderObjectForSubnode:(IMBNode*)inSubnode index:(NSUInteger)inIndex
+{
+	IMBFolderObject* object = [[[IMBFolderObject alloc] init] autorelease];
+	object.representedNodeIdentifier = inSubnode.identifier;
+	object.location = inSubnode.mediaSource;
+	object.name = inSubnode.name;
+	object.metadata = nil;
+	object.parserIdentifier = self.identifier;
+	object.index = inIndex;
+	return object;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 // @YES if there is at least one visible subfolder
 // @NO if there are definitely none, perhaps because the URL isn't even a directory
 // nil if couldn't tell, in which case error pointer is filled in
@@ -508,6 +508,7 @@ extern NSString *const IKImageBrowserCellPlaceHolderLayer __attribute__((weak_im
             break;
         case kIMBResourceIsAccessible:
         case kIMBResourceIsAccessibleSecurityScoped:
+        case kIMBResourceAccessibilityUnknown:     // Not probed yet, so treated as accessible
         {
             IMBObjectViewController* objectViewController = (IMBObjectViewController*) [[self imageBrowserView] delegate];
             id <IMBObjectViewControllerDelegate> delegate = [objectViewController delegate];
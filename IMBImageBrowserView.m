@@ -311,9 +311,15 @@ enum IMBMouseOperation
 - (BOOL) _shouldProcessLongTasks
 {
 	// If there still is plenty of space left in the cache we can allow some background loading, but do not
-	// fill it up all the way. Try to leave some space for when it is needed...
+	// fill it up all the way. Try to leave some space for when it is needed. Both the byte budget and the object
+	// count limit (512 by default) apply, so that a large visible range isn't processed in one go...
 	
-	return [IMBObjectFifoCache count] < [IMBObjectFifoCache size]-64;
+	NSUInteger budget = [IMBObjectFifoCache thumbnailBudget];
+	NSUInteger size = [IMBObjectFifoCache size];
+	
+	return 
+		[IMBObjectFifoCache thumbnailBytes] < budget - budget/8 &&
+		[IMBObjectFifoCache count] < size - size/8;
 }
 
 
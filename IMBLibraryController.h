@@ -100,6 +100,10 @@ extern NSString* kIMBDidCreateTopLevelNodeNotification;
 @interface IMBLibraryController : NSObject
 {
 	NSMutableArray* _subnodes;
+	NSMutableDictionary* _nodesByIdentifier;
+	NSMutableDictionary* _nodesByWatchedPath;
+	NSMutableDictionary* _objectPageTokens;
+	NSMutableSet* _replayedChangedPaths;
 	BOOL _isReplacingNode;
 	NSString* _mediaType;
 	id _delegate;
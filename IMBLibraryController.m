@@ -57,6 +57,9 @@
 #import "IMBAccessRightsController.h"
 #import "IMBNode.h"
 #import "IMBObject.h"
+#import "IMBNodeObject.h"
+#import "IMBObjectFifoCache.h"
+#import "IMBParser.h"
 #import "IMBParserMessenger.h"
 #import "IMBAccessRightsViewController.h"
 #import "IMBImageFolderParserMessenger.h"
@@ -91,6 +94,12 @@ NSString* kIMBNodesWillChangeNotification = @"IMBNodesWillChangeNotification";
 NSString* kIMBNodesDidChangeNotification = @"IMBNodesDidChangeNotification";
 NSString* kIMBDidCreateTopLevelNodeNotification = @"IMBDidCreateTopLevelNodeNotification";
 
+// Large nodes are populated in pages. The first page is small, so that the user sees something quickly, then
+// the page size is doubled for each subsequent page...
+
+static const NSUInteger kIMBPopulateFirstPageSize = 500;
+static const NSUInteger kIMBPopulateMaxPageSize = 8000;
+
 #ifndef RESPONDS
 #define RESPONDS(delegate,selector) (delegate!=nil && [delegate respondsToSelector:selector])
 #endif 
@@ -123,8 +132,18 @@ static NSMutableDictionary* sLibraryControllers = nil;
 - (void) _reloadTopLevelNode:(IMBNode*)inNode;
 - (void) _replaceNode:(IMBNode*)inOldNode withNode:(IMBNode*)inNewNode parentNodeIdentifier:(NSString*)inParentNodeIdentifier;
 
+- (void) _indexNodeTree:(IMBNode*)inNode;
+- (void) _unindexNodeTree:(IMBNode*)inNode;
+- (void) _rebuildNodeIndex;
+- (BOOL) _isNodeInTree:(IMBNode*)inNode;
+- (NSArray*) _nodesWithWatchedPath:(NSString*)inPath;
+- (NSArray*) _nodesWithWatchedPathsInsidePath:(NSString*)inPath;
+
 - (void) _reloadNodesWithWatchedPath:(NSString*)inPath;
-- (void) _reloadNodesWithWatchedPath:(NSString*)inPath nodes:(NSArray*)inNodes;
+- (void) _updateNodeWithFileSystemChanges:(IMBNode*)inNode;
+- (void) _applyReplayedChangesToNode:(IMBNode*)inNode;
+- (void) _loadObjectPageForNode:(IMBNode*)inNode token:(NSString*)inToken offset:(NSUInteger)inOffset pageSize:(NSUInteger)inPageSize totalCount:(NSUInteger)inTotalCount resetsDisplayedObjectCount:(BOOL)inResetsDisplayedObjectCount;
+- (void) _applyChanges:(NSDictionary*)inChanges toNode:(IMBNode*)inNode;
 - (void) _unmountNodes:(NSArray*)inNodes onVolume:(NSString*)inVolume;
 
 //- (void) _attachAccessRightsBookmarksToParserMessenger:(IMBParserMessenger*)inParserMessenger;
@@ -194,6 +213,10 @@ static NSMutableDictionary* sLibraryControllers = nil;
 	{
 		self.mediaType = inMediaType;
 		self.subnodes = nil; //[NSMutableArray array];
+		_nodesByIdentifier = [[NSMutableDictionary alloc] init];
+		_nodesByWatchedPath = [[NSMutableDictionary alloc] init];
+		_objectPageTokens = [[NSMutableDictionary alloc] init];
+		_replayedChangedPaths = [[NSMutableSet alloc] init];
 		_isReplacingNode = NO;
 		
         // Ensure that app-scoped bookmarks are loaded from prefs
@@ -247,6 +270,10 @@ static NSMutableDictionary* sLibraryControllers = nil;
 
 	IMBRelease(_mediaType);
 	IMBRelease(_subnodes);
+	IMBRelease(_nodesByIdentifier);
+	IMBRelease(_nodesByWatchedPath);
+	IMBRelease(_objectPageTokens);
+	IMBRelease(_replayedChangedPaths);
 	[super dealloc];
 }
 
@@ -396,7 +423,8 @@ static NSMutableDictionary* sLibraryControllers = nil;
 
 
 // Populate the specified node. This is done by a XPC service on our behalf. Once the service is done, 
-// it will send back a reply with the new node as a result and call the completion block...
+// it will send back a reply with the new node as a result and call the completion block. Nodes with many
+// objects only come back with the first page of objects, the remaining objects are appended page by page...
 
 - (void)populateNode:(IMBNode *)inNode errorHandler:(void(^)(NSError* error))inErrorHandler
 {
@@ -433,14 +461,24 @@ static NSMutableDictionary* sLibraryControllers = nil;
 
 	NSString* parentNodeIdentifier = inNode.parentNode.identifier;
 	IMBParserMessenger* messenger = inNode.parserMessenger;
+	
+	NSDictionary* request = [NSDictionary dictionaryWithObjectsAndKeys:
+		inNode,kIMBPopulatePageNodeKey,
+		[NSNumber numberWithUnsignedInteger:kIMBPopulateFirstPageSize],kIMBPopulatePageSizeKey,
+		nil];
+		
 	SBPerformSelectorAsync(messenger.connection,
                            messenger,
-                           @selector(populateNode:error:),
-                           inNode,
+                           @selector(populateNodeInPages:error:),
+                           request,
                            dispatch_get_main_queue(),
 	
-		^(IMBNode* inNewNode,NSError* inError)
+		^(NSDictionary* inReply,NSError* inError)
 		{
+			IMBNode* inNewNode = [inReply objectForKey:kIMBPopulatePageNodeKey];
+			NSString* token = [inReply objectForKey:kIMBPopulatePageTokenKey];
+			NSUInteger totalCount = [[inReply objectForKey:kIMBPopulatePageTotalCountKey] unsignedIntegerValue];
+			
 			// Got a new node. Do some consistency checks (was it populated correctly)...
 			
 			if (inError == nil)
@@ -476,12 +514,46 @@ static NSMutableDictionary* sLibraryControllers = nil;
                 inNewNode.badgeTypeNormal = [inNode badgeTypeNormalNonLoading];
 				inNewNode.error = inError;
 				[self _setParserMessenger:messenger nodeTree:inNewNode];
+				
+				// If more objects are coming, then keep the loading badge, and display the total count right 
+				// away (unless the parser already provided a count of its own)...
+				
+				BOOL resetsDisplayedObjectCount = NO;
+				
+				if (token)
+				{
+					inNewNode.badgeTypeNormal = kIMBBadgeTypeLoading;
+					
+					if (inNewNode.displayedObjectCount < 0)
+					{
+						inNewNode.displayedObjectCount = totalCount;
+						resetsDisplayedObjectCount = YES;
+					}
+				}
+				
 				[self _replaceNode:inNode withNode:inNewNode parentNodeIdentifier:parentNodeIdentifier];
 			
 				if (RESPONDS(_delegate,@selector(libraryController:didPopulateNode:)))
 				{
 					[_delegate libraryController:self didPopulateNode:inNewNode];
 				}
+				
+				if (token == nil)
+				{
+					[self _applyReplayedChangesToNode:inNewNode];
+				}
+				else
+				{
+					NSUInteger offset = [inNewNode.objects count];
+					[_objectPageTokens setObject:token forKey:inNewNode.identifier];
+					
+					[self _loadObjectPageForNode:inNewNode 
+						token:token 
+						offset:offset 
+						pageSize:MIN(2*offset,kIMBPopulateMaxPageSize) 
+						totalCount:totalCount 
+						resetsDisplayedObjectCount:resetsDisplayedObjectCount];
+				}
 			}
 			
 			// If populating failed, then we'll have to keep the old node, but we'll clear the loading 
@@ -507,6 +579,90 @@ static NSMutableDictionary* sLibraryControllers = nil;
 }
 
 
+// Fetch the next page of objects of a paged population and append it to the node. If the node was replaced or
+// removed in the meantime, then the remaining objects are discarded in the XPC service...
+
+- (void) _loadObjectPageForNode:(IMBNode*)inNode token:(NSString*)inToken offset:(NSUInteger)inOffset pageSize:(NSUInteger)inPageSize totalCount:(NSUInteger)inTotalCount resetsDisplayedObjectCount:(BOOL)inResetsDisplayedObjectCount
+{
+	NSString* identifier = inNode.identifier;
+	IMBParserMessenger* messenger = inNode.parserMessenger;
+	
+	NSDictionary* request = [NSDictionary dictionaryWithObjectsAndKeys:
+		inToken,kIMBPopulatePageTokenKey,
+		[NSNumber numberWithUnsignedInteger:inOffset],kIMBPopulatePageOffsetKey,
+		[NSNumber numberWithUnsignedInteger:inPageSize],kIMBPopulatePageSizeKey,
+		nil];
+		
+	SBPerformSelectorAsync(messenger.connection,
+                           messenger,
+                           @selector(objectsPage:error:),
+                           request,
+                           dispatch_get_main_queue(),
+	
+		^(NSArray* inObjects,NSError* inError)
+		{
+			BOOL isCurrent = 
+				[self nodeWithIdentifier:identifier] == inNode && 
+				[[_objectPageTokens objectForKey:identifier] isEqualToString:inToken];
+			
+			if (!isCurrent)
+			{
+				if (inError == nil && inOffset + [inObjects count] < inTotalCount)
+				{
+					NSDictionary* cancel = [NSDictionary dictionaryWithObjectsAndKeys:inToken,kIMBPopulatePageTokenKey,nil];
+					SBPerformSelectorAsync(messenger.connection,messenger,@selector(objectsPage:error:),cancel,dispatch_get_main_queue(),^(id inResult,NSError* inCancelError){});
+				}
+				
+				if ([[_objectPageTokens objectForKey:identifier] isEqualToString:inToken])
+				{
+					[_objectPageTokens removeObjectForKey:identifier];
+				}
+				
+				return;
+			}
+			
+			if (inError == nil)
+			{
+				NSMutableArray* objects = [NSMutableArray arrayWithCapacity:[inNode.objects count] + [inObjects count]];
+				[objects addObjectsFromArray:inNode.objects];
+				
+				for (IMBObject* object in inObjects)
+				{
+					object.parserMessenger = messenger;
+					[objects addObject:object];
+				}
+				
+				inNode.objects = objects;
+			}
+			
+			NSUInteger offset = inOffset + [inObjects count];
+			
+			if (inError == nil && offset < inTotalCount)
+			{
+				[self _loadObjectPageForNode:inNode 
+					token:inToken 
+					offset:offset 
+					pageSize:MIN(2*inPageSize,kIMBPopulateMaxPageSize) 
+					totalCount:inTotalCount 
+					resetsDisplayedObjectCount:inResetsDisplayedObjectCount];
+			}
+			else
+			{
+				if (inError)
+				{
+					NSLog(@"%s ERROR:\n\n%@",__FUNCTION__,inError);
+					inNode.error = inError;
+				}
+				
+				[_objectPageTokens removeObjectForKey:identifier];
+				if (inResetsDisplayedObjectCount) inNode.displayedObjectCount = -1;
+				inNode.badgeTypeNormal = [inNode badgeTypeNormalNonLoading];
+				[self _applyReplayedChangesToNode:inNode];
+			}
+		});		
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
@@ -905,6 +1061,11 @@ static NSMutableDictionary* sLibraryControllers = nil;
 			[subnodes insertObject:inNewNode atIndex:index];
         }
 
+		// Keep the lookup tables up to date...
+		
+		if (inOldNode) [self _unindexNodeTree:inOldNode];
+		if (inNewNode) [self _indexNodeTree:inNewNode];
+		
 		// Remove loading badge from new node...
 		
 		if (inNewNode)
@@ -988,6 +1149,7 @@ static NSMutableDictionary* sLibraryControllers = nil;
 	if (inIndex <= _subnodes.count)
 	{
 		[_subnodes insertObject:inNode atIndex:inIndex];
+		[self _indexNodeTree:inNode];
 	}
 	else 
 	{
@@ -1000,6 +1162,7 @@ static NSMutableDictionary* sLibraryControllers = nil;
 {
 	if (inIndex < _subnodes.count)
 	{
+		[self _unindexNodeTree:[_subnodes objectAtIndex:inIndex]];
 		[_subnodes removeObjectAtIndex:inIndex];
 	}
 	else 
@@ -1013,7 +1176,9 @@ static NSMutableDictionary* sLibraryControllers = nil;
 {
 	if (inIndex < _subnodes.count)
 	{
+		[self _unindexNodeTree:[_subnodes objectAtIndex:inIndex]];
 		[_subnodes replaceObjectAtIndex:inIndex withObject:inNode];
+		[self _indexNodeTree:inNode];
 	}
 	else 
 	{
@@ -1090,37 +1255,193 @@ static NSMutableDictionary* sLibraryControllers = nil;
 #pragma mark 
 
 
+// The controller keeps two lookup tables for the node tree: identifier to node, and standardized watched path to
+// the nodes watching it. Both are updated whenever the tree is modified (see _replaceNode:withNode:parentNodeIdentifier:
+// and the subnode accessors above), so that lookups don't need to walk the whole tree...
+
+- (void) _indexNodeTree:(IMBNode*)inNode
+{
+	NSString* identifier = inNode.identifier;
+	if (identifier) [_nodesByIdentifier setObject:inNode forKey:identifier];
+	
+	NSString* watchedPath = [(NSString*)inNode.watchedPath stringByStandardizingPath];
+	
+	if (watchedPath)
+	{
+		NSMutableArray* nodes = [_nodesByWatchedPath objectForKey:watchedPath];
+		
+		if (nodes == nil)
+		{
+			nodes = [NSMutableArray arrayWithCapacity:1];
+			[_nodesByWatchedPath setObject:nodes forKey:watchedPath];
+		}
+		
+		if ([nodes indexOfObjectIdenticalTo:inNode] == NSNotFound)
+		{
+			[nodes addObject:inNode];
+		}
+	}
+	
+	for (IMBNode* subnode in inNode.subnodes)
+	{
+		[self _indexNodeTree:subnode];
+	}
+}
+
+
+// Only remove entries that still point to the given node, as a node with the same identifier may already have 
+// been indexed in its place...
+
+- (void) _unindexNodeTree:(IMBNode*)inNode
+{
+	NSString* identifier = inNode.identifier;
+	
+	if (identifier && [_nodesByIdentifier objectForKey:identifier] == inNode)
+	{
+		[_nodesByIdentifier removeObjectForKey:identifier];
+	}
+	
+	NSString* watchedPath = [(NSString*)inNode.watchedPath stringByStandardizingPath];
+	
+	if (watchedPath)
+	{
+		NSMutableArray* nodes = [_nodesByWatchedPath objectForKey:watchedPath];
+		NSUInteger index = [nodes indexOfObjectIdenticalTo:inNode];
+		if (index != NSNotFound) [nodes removeObjectAtIndex:index];
+		if (nodes != nil && [nodes count] == 0) [_nodesByWatchedPath removeObjectForKey:watchedPath];
+	}
+	
+	for (IMBNode* subnode in inNode.subnodes)
+	{
+		[self _unindexNodeTree:subnode];
+	}
+}
+
+
+- (void) _rebuildNodeIndex
+{
+	[_nodesByIdentifier removeAllObjects];
+	[_nodesByWatchedPath removeAllObjects];
+	
+	for (IMBNode* node in _subnodes)
+	{
+		[self _indexNodeTree:node];
+	}
+}
+
+
+// Nodes can be detached without the controller noticing (e.g. -[IMBNode unpopulate]). Walking up the parent 
+// chain is cheap, so we check that a node found in the tables is still part of the tree before returning it...
+
+- (BOOL) _isNodeInTree:(IMBNode*)inNode
+{
+	IMBNode* node = inNode;
+	
+	while (node.parentNode)
+	{
+		node = node.parentNode;
+	}
+	
+	return [_subnodes indexOfObjectIdenticalTo:node] != NSNotFound;
+}
+
+
 // Find the node with the specified identifier...
 	
-- (IMBNode*) _nodeWithIdentifier:(NSString*)inIdentifier inParentNode:(IMBNode*)inParentNode
+- (IMBNode*) nodeWithIdentifier:(NSString*)inIdentifier
+{
+	if (inIdentifier == nil) return nil;
+	
+	IMBNode* node = [_nodesByIdentifier objectForKey:inIdentifier];
+	
+	if (node != nil && (![self _isNodeInTree:node] || ![node.identifier isEqualToString:inIdentifier]))
+	{
+		[self _rebuildNodeIndex];
+		node = [_nodesByIdentifier objectForKey:inIdentifier];
+	}
+	
+	return node;
+}
+
+
+// Find the nodes watching the specified path. If a node and one of its ancestors watch the same path, then only 
+// the ancestor is returned, as it takes care of its whole subtree...
+
+- (NSArray*) _nodesWithWatchedPath:(NSString*)inPath
 {
-	NSArray* nodes = inParentNode ? inParentNode.subnodes : self.subnodes;
+	NSString* watchedPath = [inPath stringByStandardizingPath];
+	NSArray* nodes = [_nodesByWatchedPath objectForKey:watchedPath];
 	
 	for (IMBNode* node in nodes)
 	{
-		if ([node.identifier isEqualToString:inIdentifier])
+		if (![self _isNodeInTree:node])
 		{
-			return node;
+			[self _rebuildNodeIndex];
+			nodes = [_nodesByWatchedPath objectForKey:watchedPath];
+			break;
 		}
-		else
+	}
+	
+	NSMutableArray* result = [NSMutableArray arrayWithCapacity:[nodes count]];
+	
+	for (IMBNode* node in nodes)
+	{
+		BOOL hasWatchingAncestor = NO;
+		
+		for (IMBNode* parentNode = node.parentNode; parentNode != nil; parentNode = parentNode.parentNode)
 		{
-			IMBNode* match = [self _nodeWithIdentifier:inIdentifier inParentNode:node];
-			if (match) return match;
+			if ([nodes indexOfObjectIdenticalTo:parentNode] != NSNotFound)
+			{
+				hasWatchingAncestor = YES;
+				break;
+			}
 		}
+		
+		if (!hasWatchingAncestor) [result addObject:node];
 	}
 	
-	return nil;
+	return result;
 }
 
 
-- (IMBNode*) nodeWithIdentifier:(NSString*)inIdentifier
+// Find the nodes watching the specified path or any path below it. Again only the topmost nodes are returned...
+
+- (NSArray*) _nodesWithWatchedPathsInsidePath:(NSString*)inPath
 {
-	if (inIdentifier)
+	NSString* path = [inPath stringByStandardizingPath];
+	NSString* prefix = [path hasSuffix:@"/"] ? path : [path stringByAppendingString:@"/"];
+	NSMutableArray* nodes = [NSMutableArray array];
+	
+	for (NSString* watchedPath in _nodesByWatchedPath)
 	{
-		return [self _nodeWithIdentifier:inIdentifier inParentNode:nil];
+		if ([watchedPath isEqualToString:path] || [watchedPath hasPrefix:prefix])
+		{
+			for (IMBNode* node in [_nodesByWatchedPath objectForKey:watchedPath])
+			{
+				if ([self _isNodeInTree:node]) [nodes addObject:node];
+			}
+		}
 	}
 	
-	return nil;
+	NSMutableArray* result = [NSMutableArray arrayWithCapacity:[nodes count]];
+	
+	for (IMBNode* node in nodes)
+	{
+		BOOL hasWatchingAncestor = NO;
+		
+		for (IMBNode* parentNode = node.parentNode; parentNode != nil; parentNode = parentNode.parentNode)
+		{
+			if ([nodes indexOfObjectIdenticalTo:parentNode] != NSNotFound)
+			{
+				hasWatchingAncestor = YES;
+				break;
+			}
+		}
+		
+		if (!hasWatchingAncestor) [result addObject:node];
+	}
+	
+	return result;
 }
 
 
@@ -1394,7 +1715,62 @@ static NSMutableDictionary* sLibraryControllers = nil;
 - (void) pathDidChange:(NSNotification*)inNotification 
 {
 	NSString* path = [inNotification object];
-	[self _reloadNodesWithWatchedPath:path];
+	BOOL replayed = [[[inNotification userInfo] objectForKey:kIMBPathDidChangeReplayedKey] boolValue];
+	BOOL rescan = [[[inNotification userInfo] objectForKey:kIMBPathDidChangeRescanKey] boolValue];
+	
+	// If FSEvents has coalesced or dropped events, then we cannot tell which folders have changed. Reload all 
+	// node trees at or below the path...
+	
+	if (rescan)
+	{
+		for (IMBNode* node in [self _nodesWithWatchedPathsInsidePath:path])
+		{
+			[self reloadNodeTree:node];
+		}
+		
+		return;
+	}
+	
+	// At launch the FSEvents history since the previous session is replayed. The event stream is only started
+	// after the libraries have been created, so a replayed change may also have happened after a library was 
+	// read. Libraries that haven't started loading yet are read from scratch, so their replayed changes are 
+	// skipped. Libraries that are already populated are updated right away. For libraries that are still 
+	// loading, the changed root is recorded, and the library is updated once it has been populated...
+	
+	if (replayed)
+	{
+		for (IMBNode* node in [self _nodesWithWatchedPath:path])
+		{
+			if (node.isLoading || [_objectPageTokens objectForKey:node.identifier])
+			{
+				NSString* watchedPath = [node.watchedPath stringByStandardizingPath];
+				if (watchedPath) [_replayedChangedPaths addObject:watchedPath];
+			}
+			else if (node.isPopulated)
+			{
+				[self _updateNodeWithFileSystemChanges:node];
+			}
+		}
+	}
+	else
+	{
+		[self _reloadNodesWithWatchedPath:path];
+	}
+}
+
+
+// Called when a node has been populated completely. If changes to its watched path were replayed while it was
+// loading, then they are applied now...
+
+- (void) _applyReplayedChangesToNode:(IMBNode*)inNode
+{
+	NSString* watchedPath = [inNode.watchedPath stringByStandardizingPath];
+	
+	if (watchedPath != nil && [_replayedChangedPaths containsObject:watchedPath])
+	{
+		[_replayedChangedPaths removeObject:watchedPath];
+		[self _updateNodeWithFileSystemChanges:inNode];
+	}
 }
 
 
@@ -1402,30 +1778,185 @@ static NSMutableDictionary* sLibraryControllers = nil;
 
 - (void) _reloadNodesWithWatchedPath:(NSString*)inPath
 {
-	[self _reloadNodesWithWatchedPath:inPath nodes:self.subnodes];
-}	
+	for (IMBNode* node in [self _nodesWithWatchedPath:inPath])
+	{
+		[self _updateNodeWithFileSystemChanges:node];
+	}
+}
 
 
-- (void) _reloadNodesWithWatchedPath:(NSString*)inPath nodes:(NSArray*)inNodes
+// Ask the parser what exactly has changed in a populated node. If it can tell, then we apply the changes in place, 
+// so that unchanged IMBObjects (and their thumbnails) and the expanded state of subnodes are preserved. Otherwise 
+// (or if the node isn't populated yet) we fall back to reloading the whole node tree...
+
+- (void) _updateNodeWithFileSystemChanges:(IMBNode*)inNode
 {
-	NSString* watchedPath = [inPath stringByStandardizingPath];
+	if (!inNode.isPopulated || inNode.isLoading || [_objectPageTokens objectForKey:inNode.identifier])
+	{
+		[self reloadNodeTree:inNode];
+		return;
+	}
 	
-	for (IMBNode* node in inNodes)
+	IMBParserMessenger* messenger = inNode.parserMessenger;
+	SBPerformSelectorAsync(messenger.connection,
+                           messenger,
+                           @selector(changesForNode:error:),
+                           inNode,
+                           dispatch_get_main_queue(),
+	
+		^(NSDictionary* inChanges,NSError* inError)
+		{
+			if (inError || inChanges == nil)
+			{
+				[self reloadNodeTree:inNode];
+			}
+			else if ([inChanges count] > 0)
+			{
+				[self _applyChanges:inChanges toNode:inNode];
+			}
+		});		
+}
+
+
+// Objects are kept in the same order as IMBFolderParser creates them: files first, then folders, each sorted in
+// a Finder-like manner...
+
+static NSComparisonResult _IMBCompareObjectsByPath(IMBObject* inObject1,IMBObject* inObject2)
+{
+	BOOL isNodeObject1 = [inObject1 isKindOfClass:[IMBNodeObject class]];
+	BOOL isNodeObject2 = [inObject2 isKindOfClass:[IMBNodeObject class]];
+	
+	if (isNodeObject1 && !isNodeObject2) return NSOrderedDescending;
+	if (!isNodeObject1 && isNodeObject2) return NSOrderedAscending;
+	
+	return [[[inObject1 URL] path] localizedStandardCompare:[[inObject2 URL] path]];
+}
+
+
+- (void) _applyChanges:(NSDictionary*)inChanges toNode:(IMBNode*)inNode
+{
+	// The node may have been replaced or removed while the parser was busy...
+	
+	if ([self nodeWithIdentifier:inNode.identifier] != inNode) return;
+	
+	IMBParserMessenger* messenger = inNode.parserMessenger;
+	NSArray* addedObjects = [inChanges objectForKey:kIMBNodeChangesAddedObjectsKey];
+	NSArray* modifiedObjects = [inChanges objectForKey:kIMBNodeChangesModifiedObjectsKey];
+	NSArray* removedLocations = [inChanges objectForKey:kIMBNodeChangesRemovedLocationsKey];
+	NSArray* addedSubnodes = [inChanges objectForKey:kIMBNodeChangesAddedSubnodesKey];
+	NSArray* removedSubnodeIdentifiers = [inChanges objectForKey:kIMBNodeChangesRemovedSubnodeIdentifiersKey];
+	
+	// Update the objects. Removed and modified objects are dropped from the fifo cache, so that it doesn't hold
+	// on to them any longer...
+	
+	NSMutableSet* removedPaths = [NSMutableSet set];
+	
+	for (NSURL* url in removedLocations)
 	{
-		NSString* nodePath = [(NSString*)node.watchedPath stringByStandardizingPath];
+		[removedPaths addObject:[[url path] stringByStandardizingPath]];
+	}
+	
+	for (IMBObject* object in modifiedObjects)
+	{
+		[removedPaths addObject:[[[object URL] path] stringByStandardizingPath]];
+	}
+	
+	NSMutableArray* objects = [NSMutableArray arrayWithCapacity:[inNode.objects count] + [addedObjects count]];
+	NSMutableSet* paths = [NSMutableSet setWithCapacity:[inNode.objects count] + [addedObjects count]];
+	
+	for (IMBObject* object in inNode.objects)
+	{
+		NSString* path = [[[object URL] path] stringByStandardizingPath];
 		
-		if ([nodePath isEqualToString:watchedPath])
+		if ([removedPaths containsObject:path])
 		{
-//			if ([node.parser respondsToSelector:@selector(watchedPathDidChange:)])
-//			{
-//				[node.parser watchedPathDidChange:watchedPath];
-//			}
-				
-			[self reloadNodeTree:node];
+			[IMBObjectFifoCache removeObject:object];
 		}
 		else
 		{
-			[self _reloadNodesWithWatchedPath:inPath nodes:node.subnodes];
+			[objects addObject:object];
+			if (path) [paths addObject:path];
+		}
+	}
+	
+	// Two overlapping change sets may both report the same file as added, so skip objects for locations that
+	// are already present...
+	
+	for (IMBObject* object in [addedObjects arrayByAddingObjectsFromArray:modifiedObjects])
+	{
+		NSString* path = [[[object URL] path] stringByStandardizingPath];
+		if (path && [paths containsObject:path]) continue;
+		if (path) [paths addObject:path];
+		
+		object.parserMessenger = messenger;
+		[objects addObject:object];
+	}
+	
+	[objects sortUsingComparator:^NSComparisonResult(id inObject1,id inObject2)
+	{
+		return _IMBCompareObjectsByPath(inObject1,inObject2);
+	}];
+	
+	NSUInteger index = 0;
+	NSInteger displayedObjectCount = 0;
+	
+	for (IMBObject* object in objects)
+	{
+		object.index = index++;
+		if (![object isKindOfClass:[IMBNodeObject class]]) displayedObjectCount++;
+	}
+	
+	inNode.objects = objects;
+	if (inNode.displayedObjectCount >= 0) inNode.displayedObjectCount = displayedObjectCount;
+
+	// Update the subnodes. As this modifies the node tree, we need to notify the user interface, so that it
+	// can save and restore its expanded state...
+	
+	if ([addedSubnodes count] > 0 || [removedSubnodeIdentifiers count] > 0)
+	{
+		_isReplacingNode = YES;
+		[[NSNotificationCenter defaultCenter] postNotificationName:kIMBNodesWillChangeNotification object:self];
+		
+		@try
+		{
+			NSMutableArray* subnodes = [inNode mutableArrayForPopulatingSubnodes];
+			NSSet* removedIdentifiers = [NSSet setWithArray:removedSubnodeIdentifiers];
+			NSIndexSet* removedIndexes = [inNode.subnodes indexesOfObjectsPassingTest:^BOOL(IMBNode* inSubnode,NSUInteger inIndex,BOOL* outStop)
+			{
+				return [removedIdentifiers containsObject:inSubnode.identifier];
+			}];
+			
+			for (IMBNode* subnode in [inNode.subnodes objectsAtIndexes:removedIndexes])
+			{
+				[self _unindexNodeTree:subnode];
+			}
+			
+			[subnodes removeObjectsAtIndexes:removedIndexes];
+			
+			for (IMBNode* subnode in addedSubnodes)
+			{
+				if ([[inNode.subnodes valueForKey:@"identifier"] containsObject:subnode.identifier]) continue;
+				
+				[self _setParserMessenger:messenger nodeTree:subnode];
+				
+				NSString* path = [subnode.mediaSource path];
+				NSUInteger i = 0, n = [subnodes count];
+				
+				while (i < n && [[[[subnodes objectAtIndex:i] mediaSource] path] localizedStandardCompare:path] == NSOrderedAscending)
+				{
+					i++;
+				}
+				
+				[subnodes insertObject:subnode atIndex:i];
+				[self _indexNodeTree:subnode];
+			}
+			
+			inNode.isLeafNode = [subnodes count] == 0;
+		}
+		@finally
+		{
+			_isReplacingNode = NO;
+			[[NSNotificationCenter defaultCenter] postNotificationName:kIMBNodesDidChangeNotification object:self];
 		}
 	}
 }
@@ -143,12 +143,18 @@
 		inNode.displayedObjectCount = 0;
 	}
 
-	FMDatabase	*database				= self.database;
+	FMDatabase	*database				= [self checkoutDatabase];
 
 	if (database == nil) {
 		return;
 	}
 
+	[self populateObjectsForSmartCollectionNode:inNode database:database];
+	[self checkinDatabase:database];
+}
+
+- (void)populateObjectsForSmartCollectionNode:(IMBNode *)inNode database:(FMDatabase *)database
+{
 	NSNumber	*collectionId			= [self idLocalFromAttributes:inNode.attributes];
 
 	NSString	*rulesQuery				= [self smartCollectionRulesQuery];
@@ -225,24 +231,30 @@
 
 	FMResultSet *results				= [database executeQuery:objectQuery withArgumentsInArray:objectMatchArguments];
 
+	NSMutableArray	*objects			= [NSMutableArray array];
 	NSUInteger	index					= 0;
 
+	int pyramidPathColumn = [results optionalColumnIndexForName:@"pyramidPath"];
+	int absolutePathColumn = [results columnIndexForName:@"absolutePath"];
+	int idxFilenameColumn = [results columnIndexForName:@"idx_filename"];
+	int idLocalColumn = [results columnIndexForName:@"id_local"];
+	int fileHeightColumn = [results columnIndexForName:@"fileHeight"];
+	int fileWidthColumn = [results columnIndexForName:@"fileWidth"];
+	int orientationColumn = [results columnIndexForName:@"orientation"];
+	int captionColumn = [results columnIndexForName:@"caption"];
+	
 	while ([results next]) {
-		NSString	*absolutePath	= [results stringForColumn:@"absolutePath"];
-		NSString	*filename		= [results stringForColumn:@"idx_filename"];
-		NSNumber	*idLocal		= [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-		NSNumber	*fileHeight		= [NSNumber numberWithDouble:[results doubleForColumn:@"fileHeight"]];
-		NSNumber	*fileWidth		= [NSNumber numberWithDouble:[results doubleForColumn:@"fileWidth"]];
-		NSString	*orientation	= [results stringForColumn:@"orientation"];
-		NSString	*caption		= [results stringForColumn:@"caption"];
-		NSString	*pyramidPath	= ([results hasColumnWithName:@"pyramidPath"] ? [results stringForColumn:@"pyramidPath"] : nil);
+		NSString	*absolutePath	= [results stringForColumnIndex:absolutePathColumn];
+		NSString	*filename		= [results stringForColumnIndex:idxFilenameColumn];
+		NSNumber	*idLocal		= [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+		NSNumber	*fileHeight		= [NSNumber numberWithDouble:[results doubleForColumnIndex:fileHeightColumn]];
+		NSNumber	*fileWidth		= [NSNumber numberWithDouble:[results doubleForColumnIndex:fileWidthColumn]];
+		NSString	*orientation	= [results stringForColumnIndex:orientationColumn];
+		NSString	*caption		= [results stringForColumnIndex:captionColumn];
+		NSString	*pyramidPath	= [results stringNoCopyForColumnIndex:pyramidPathColumn];
 		NSString	*name			= caption != nil ? caption : filename;
 		NSString	*path			= [absolutePath stringByAppendingString:filename];
 
-		if (pyramidPath == nil) {
-			pyramidPath = [self pyramidPathForImage:idLocal];
-		}
-
 		if ([self canOpenImageFileAtPath:path]) {
 			NSMutableDictionary *metadata	= [NSMutableDictionary dictionary];
 
@@ -263,12 +275,15 @@
 											pyramidPath:pyramidPath
 											   metadata:metadata
 												  index:index++];
+			[objects addObject:object];
 			[(NSMutableArray *)inNode.objects addObject : object];
 			inNode.displayedObjectCount++;
 		}
 	}
 
 	[results close];
+
+	[self resolvePyramidPathsForObjects:objects];
 }
 
 // TODO: Not yet used
@@ -67,6 +67,218 @@
 #import "NSWorkspace+iMedia.h"
 #import "SBUtilities.h"
 #import <Quartz/Quartz.h>
+#import <sys/stat.h>
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark TYPES
+
+// One preview level inside a .lrprev pyramid file. Offset and length locate the embedded JPEG, width and height
+// come from its SOF header...
+
+typedef struct
+{
+	unsigned long long offset;
+	unsigned long long length;
+	NSUInteger width;
+	NSUInteger height;
+}
+IMBLightroomPreviewLevel;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Number of parsed pyramid files kept in memory...
+
+static const NSUInteger kIMBLightroomPreviewDirectoryCacheCount = 2000;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Reads the pixel size of a JPEG from its SOF marker segment, without decoding any image data...
+
+static BOOL _IMBJPEGPixelSize(const uint8_t* inBytes, unsigned long long inLength, NSUInteger* outWidth, NSUInteger* outHeight)
+{
+	if (inLength < 4 || inBytes[0] != 0xFF || inBytes[1] != 0xD8) return NO;
+	
+	unsigned long long i = 2;
+	
+	while (i + 4 <= inLength)
+	{
+		if (inBytes[i] != 0xFF) return NO;
+		
+		uint8_t marker = inBytes[i+1];
+		
+		// Fill bytes and standalone markers carry no length...
+		
+		if (marker == 0xFF)
+		{
+			i += 1;
+			continue;
+		}
+		
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+		{
+			i += 2;
+			continue;
+		}
+		
+		// Image data or end of image before any frame header means there is nothing to find...
+		
+		if (marker == 0xDA || marker == 0xD9) return NO;
+		
+		unsigned long long segmentLength = (inBytes[i+2] << 8) | inBytes[i+3];
+		
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+		{
+			if (i + 9 > inLength) return NO;
+			
+			*outHeight = (inBytes[i+5] << 8) | inBytes[i+6];
+			*outWidth = (inBytes[i+7] << 8) | inBytes[i+8];
+			return YES;
+		}
+		
+		if (segmentLength < 2) return NO;
+		i += 2 + segmentLength;
+	}
+	
+	return NO;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// The level directory of one .lrprev file. Sections are walked by their header lengths instead of searching for 
+// the marker, and only JPEG sections are recorded as levels (smallest first, as Lightroom writes them). The file 
+// size and modification date are remembered so that a stale directory can be detected...
+
+@interface IMBLightroomPreviewDirectory : NSObject
+{
+	NSData* _levels;
+	off_t _fileSize;
+	time_t _modificationTime;
+}
+
+- (id) initWithData:(NSData*)inData fileSize:(off_t)inFileSize modificationTime:(time_t)inModificationTime;
+- (BOOL) isValidForFileSize:(off_t)inFileSize modificationTime:(time_t)inModificationTime;
+- (NSUInteger) levelCount;
+- (IMBLightroomPreviewLevel) levelAtIndex:(NSUInteger)inIndex;
+
+@end
+
+
+@implementation IMBLightroomPreviewDirectory
+
+
+//		'AgHg'					-- a magic marker
+//		header length			-- 2 bytes, big endian includes marker and length
+//		version					-- 1 byte, zero for now
+//		kind					-- 1 bytes, 0 == string, 1 == blob
+//		data length				-- 8 bytes, big endian
+//		data padding length		-- 8 bytes, big endian
+//		name					-- zero terminated
+//		< padding for rest of header >
+//		< data >
+//		< data padding >
+
+- (id) initWithData:(NSData*)inData fileSize:(off_t)inFileSize modificationTime:(time_t)inModificationTime
+{
+	if ((self = [super init]))
+	{
+		static const char pattern[4] = { 0x41, 0x67, 0x48, 0x67 };
+		
+		NSMutableData* levels = [NSMutableData data];
+		const uint8_t* bytes = [inData bytes];
+		NSUInteger length = [inData length];
+		NSUInteger index = 0;
+		
+		while (index + 24 <= length)
+		{
+			// If the section chain is broken, resynchronize on the next marker...
+			
+			if (memcmp(bytes + index, pattern, 4) != 0)
+			{
+				index = [inData indexOfBytes:pattern length:4 options:0 range:NSMakeRange(index, length - index)];
+				if (index == NSNotFound || index + 24 > length) break;
+			}
+			
+			unsigned short headerLength;
+			unsigned long long dataLength;
+			unsigned long long paddingLength;
+			
+			memcpy(&headerLength, bytes + index + 4, 2);
+			memcpy(&dataLength, bytes + index + 8, 8);
+			memcpy(&paddingLength, bytes + index + 16, 8);
+			
+			headerLength = NSSwapBigShortToHost(headerLength);
+			dataLength = NSSwapBigLongLongToHost(dataLength);
+			paddingLength = NSSwapBigLongLongToHost(paddingLength);
+
+			// The lengths come straight from the file, so check each of them against the rest of the data before 
+			// subtracting it (a truncated file would otherwise wrap around)...
+			
+			if (headerLength < 24 || headerLength > length - index) break;
+			if (dataLength > length - index - headerLength) break;
+			
+			IMBLightroomPreviewLevel level;
+			level.offset = index + headerLength;
+			level.length = dataLength;
+			
+			if (_IMBJPEGPixelSize(bytes + level.offset, level.length, &level.width, &level.height))
+			{
+				[levels appendBytes:&level length:sizeof(level)];
+			}
+			
+			if (paddingLength > length - level.offset - dataLength) break;
+			unsigned long long next = level.offset + dataLength + paddingLength;
+			if (next <= index) break;
+			index = (NSUInteger)next;
+		}
+		
+		_levels = [levels copy];
+		_fileSize = inFileSize;
+		_modificationTime = inModificationTime;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_levels);
+	[super dealloc];
+}
+
+
+- (BOOL) isValidForFileSize:(off_t)inFileSize modificationTime:(time_t)inModificationTime
+{
+	return _fileSize == inFileSize && _modificationTime == inModificationTime;
+}
+
+
+- (NSUInteger) levelCount
+{
+	return [_levels length] / sizeof(IMBLightroomPreviewLevel);
+}
+
+
+- (IMBLightroomPreviewLevel) levelAtIndex:(NSUInteger)inIndex
+{
+	return ((const IMBLightroomPreviewLevel*)[_levels bytes])[inIndex];
+}
+
+
+@end
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -77,6 +289,7 @@
 @interface IMBLightroomModernParser ()
 
 - (NSNumber*) databaseVersion;
++ (NSCache*) previewDirectoryCache;
 
 @end
 
@@ -151,7 +364,7 @@
 
 - (NSNumber*) databaseVersion
 {
-	FMDatabase *database = [self database];
+	FMDatabase *database = [self checkoutDatabase];
 	NSNumber *databaseVersion = nil;
 	
 	if (database != nil) {		
@@ -169,6 +382,8 @@
 		[results close];
 	}
 	
+	[self checkinDatabase:database];
+	
 	return databaseVersion;
 }
 
@@ -252,42 +467,67 @@
 	inRootNode.objects = objects;
 }
 
-- (NSString*) pyramidPathForImage:(NSNumber*)idLocal
+// Since Lightroom 3 the preview file name is derived from the image's global id and develop settings digest,
+// so the preview locators come from the catalog rather than the previews database...
+
+- (void) fetchPyramidPathsForImages:(NSArray*)inIdLocals placeholders:(NSString*)inPlaceholders into:(NSMutableDictionary*)ioPyramidPaths
 {
-	FMDatabase *database = [self database];
-	NSString *uuid = nil;
-	NSString *digest = nil;
+	FMDatabase *database = [self checkoutDatabase];
+	NSMutableDictionary *uuids = [NSMutableDictionary dictionary];
+	NSMutableDictionary *digests = [NSMutableDictionary dictionary];
 
 	if (database != nil) {
-		NSString* query =	@" SELECT alf.id_global uuid, ids.digest"
+		NSString* query = [NSString stringWithFormat:
+		@" SELECT ids.image, alf.id_global uuid, ids.digest"
 		@" FROM Adobe_imageDevelopSettings ids"
 		@" INNER JOIN Adobe_images ai ON ai.id_local = ids.image"
 		@" INNER JOIN AgLibraryFile alf on alf.id_local = ai.rootFile"
-		@" WHERE ids.image = ?"
-		@" ORDER BY alf.id_global ASC";
+		@" WHERE ids.image IN (%@)"
+		@" ORDER BY ids.image ASC, alf.id_global ASC",
+		inPlaceholders];
+
+		FMResultSet* results = [database executeQuery:query withArgumentsInArray:inIdLocals];
 
-		FMResultSet* results = [database executeQuery:query, idLocal];
+		int imageColumn = [results columnIndexForName:@"image"];
+		int uuidColumn = [results columnIndexForName:@"uuid"];
+		int digestColumn = [results columnIndexForName:@"digest"];
 
         // JJ/2012-10-02: For some reason we may get multiple rows with some of them not properly filled. Try best we can.
 
-        while ([results next] && (uuid == nil || digest == nil || [uuid isEqualToString:@""] || [digest isEqualToString:@""]))
+        while ([results next])
         {
-			uuid = [results stringForColumn:@"uuid"];
-			digest = [results stringForColumn:@"digest"];
+			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumnIndex:imageColumn]];
+			NSString* uuid = [uuids objectForKey:idLocal];
+			NSString* digest = [digests objectForKey:idLocal];
+			
+			if (uuid == nil || digest == nil || [uuid isEqualToString:@""] || [digest isEqualToString:@""])
+			{
+				uuid = [results stringForColumnIndex:uuidColumn];
+				digest = [results stringForColumnIndex:digestColumn];
+				
+				if (uuid) [uuids setObject:uuid forKey:idLocal]; else [uuids removeObjectForKey:idLocal];
+				if (digest) [digests setObject:digest forKey:idLocal]; else [digests removeObjectForKey:idLocal];
+			}
         }
 
 		[results close];
 	}
 
-	if ((uuid != nil) && (digest != nil)) {
-		NSString* prefixOne = [uuid substringToIndex:1];
-		NSString* prefixFour = [uuid substringToIndex:4];
-		NSString* fileName = [[NSString stringWithFormat:@"%@-%@", uuid, digest] stringByAppendingPathExtension:@"lrprev"];
+	[self checkinDatabase:database];
 
-		return [[prefixOne stringByAppendingPathComponent:prefixFour] stringByAppendingPathComponent:fileName];
-	}
+	for (NSNumber* idLocal in uuids)
+	{
+		NSString* uuid = [uuids objectForKey:idLocal];
+		NSString* digest = [digests objectForKey:idLocal];
+		
+		if ((uuid != nil) && (digest != nil) && (uuid.length >= 4)) {
+			NSString* prefixOne = [uuid substringToIndex:1];
+			NSString* prefixFour = [uuid substringToIndex:4];
+			NSString* fileName = [[NSString stringWithFormat:@"%@-%@", uuid, digest] stringByAppendingPathExtension:@"lrprev"];
 
-	return nil;
+			[ioPyramidPaths setObject:[[prefixOne stringByAppendingPathComponent:prefixFour] stringByAppendingPathComponent:fileName] forKey:idLocal];
+		}
+	}
 }
 
 - (NSData*) previewDataForObject:(IMBObject*)inObject maximumSize:(NSNumber*)maximumSize
@@ -299,100 +539,83 @@
 	return nil;
 }
 
+// Parsed level directories keyed by pyramid file path. NSCache is threadsafe and evicts on its own...
+
++ (NSCache*) previewDirectoryCache
+{
+	static NSCache* sPreviewDirectoryCache = nil;
+	static dispatch_once_t sOnceToken = 0;
+	
+	dispatch_once(&sOnceToken,^()
+	{
+		sPreviewDirectoryCache = [[NSCache alloc] init];
+		[sPreviewDirectoryCache setCountLimit:kIMBLightroomPreviewDirectoryCacheCount];
+	});
+	
+	return sPreviewDirectoryCache;
+}
+
+
+// Returns the largest preview level that fits into maximumSize (or the smallest level if none fits). Without
+// maximumSize the largest level is returned. The level sizes come from the cached directory, so selecting a level
+// does not decode any JPEG data...
+
 + (NSData*) previewDataForLightroomObject:(IMBLightroomObject*)lightroomObject maximumSize:(NSNumber*)maximumSize
 {
 	NSString* absolutePyramidPath = [lightroomObject absolutePyramidPath];
-	NSData* data = nil;
+	struct stat info;
 
-	if (absolutePyramidPath != nil) {
-		data = [NSData dataWithContentsOfMappedFile:absolutePyramidPath];
+	if (absolutePyramidPath == nil || stat([absolutePyramidPath fileSystemRepresentation],&info) != 0) {
+		return nil;
 	}
 
-	if (data != nil) {
-		NSData* data = [NSData dataWithContentsOfMappedFile:absolutePyramidPath];
+	NSData* data = [NSData dataWithContentsOfMappedFile:absolutePyramidPath];
 
-		//		'AgHg'					-- a magic marker
-		//		header length			-- 2 bytes, big endian includes marker and length
-		//		version					-- 1 byte, zero for now
-		//		kind					-- 1 bytes, 0 == string, 1 == blob
-		//		data length				-- 8 bytes, big endian
-		//		data padding length		-- 8 bytes, big endian
-		//		name					-- zero terminated
-		//		< padding for rest of header >
-		//		< data >
-		//		< data padding >
+	if (data == nil) {
+		return nil;
+	}
 
-		const char pattern[4] = { 0x41, 0x67, 0x48, 0x67 };
+	NSCache* cache = [self previewDirectoryCache];
+	IMBLightroomPreviewDirectory* directory = [cache objectForKey:absolutePyramidPath];
 
-		NSUInteger index = NSNotFound;
+	if (directory == nil || ![directory isValidForFileSize:info.st_size modificationTime:info.st_mtime]) {
+		directory = [[[IMBLightroomPreviewDirectory alloc] initWithData:data fileSize:info.st_size modificationTime:info.st_mtime] autorelease];
+		[cache setObject:directory forKey:absolutePyramidPath];
+	}
 
-		if (maximumSize == nil) {
-			index = [data lastIndexOfBytes:pattern length:4];
-		}
-		else {
-			index = [data indexOfBytes:pattern length:4];
-		}
+	NSUInteger count = [directory levelCount];
 
-		NSData* previousData = nil;
-		CGFloat maximumSizeFloat = [maximumSize floatValue];
-
-		while (index != NSNotFound) {
-			unsigned short headerLengthValue; // size 2
-			unsigned long long dataLengthValue; // size 8
+	if (count == 0) {
+		return nil;
+	}
 
-			[data getBytes:&headerLengthValue range:NSMakeRange(index + 4, 2)];
-			[data getBytes:&dataLengthValue range:NSMakeRange(index + 4 + 2 + 1 + 1, 8)];
+	NSUInteger bestIndex = count - 1;
 
-			headerLengthValue = NSSwapBigShortToHost(headerLengthValue);
-			dataLengthValue = NSSwapBigLongLongToHost(dataLengthValue);
+	if (maximumSize != nil) {
+		CGFloat maximumSizeFloat = [maximumSize floatValue];
+		bestIndex = 0;
 
-			NSData* jpegData = nil;
+		for (NSUInteger i=0; i<count; i++) {
+			IMBLightroomPreviewLevel level = [directory levelAtIndex:i];
 
-            if ((index + headerLengthValue + dataLengthValue) <= [data length]) {
-                jpegData = [data subdataWithRange:NSMakeRange(index + headerLengthValue, dataLengthValue)];
-            }
-			else {
+			if ((level.width > maximumSizeFloat) || (level.height > maximumSizeFloat)) {
 				break;
 			}
 
-			if (maximumSize == nil) {
-				return jpegData;
-			}
-
-			if (previousData == nil) {
-				previousData = jpegData;
-			}
-
-			if (jpegData != nil) {
-				CGImageSourceRef source = CGImageSourceCreateWithData((CFDataRef)jpegData, nil);
-
-				if (source != NULL) {
-					CGImageRef imageRepresentation = CGImageSourceCreateImageAtIndex(source, 0, NULL);
-
-					CFRelease(source);
-
-					if (imageRepresentation != NULL) {
-						CGFloat width = CGImageGetWidth(imageRepresentation);
-						CGFloat height = CGImageGetHeight(imageRepresentation);
-
-						CFRelease(imageRepresentation);
-
-						if ((width > maximumSizeFloat) || (height > maximumSizeFloat)) {
-							break;
-						}
-					}
+			bestIndex = i;
+		}
+	}
 
-					previousData = jpegData;
-				}
-			}
+	IMBLightroomPreviewLevel level = [directory levelAtIndex:bestIndex];
 
-			index = [data indexOfBytes:pattern length:4 options:0 range:NSMakeRange(index + 4, [data length] - index - 4)];
-		}
+	// The file may have been rewritten after we mapped it...
 
-		return previousData;
+	if (level.offset + level.length > [data length]) {
+		[cache removeObjectForKey:absolutePyramidPath];
+		return nil;
 	}
 
-	return nil;
+	return [data subdataWithRange:NSMakeRange(level.offset, level.length)];
 }
 
 
@@ -65,6 +65,7 @@
 #pragma mark CLASSES
 
 @class FMDatabase;
+@class IMBLightroomDatabasePool;
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -92,20 +93,20 @@ IMBLightroomNodeType;
 	NSString* _dataPath;
 	BOOL _shouldDisplayLibraryName;
 
-	// We keep a separate FMDatabase instance for each thread that we are invoked from.
+	// Connections are leased to one thread at a time from small bounded pools.
 	// SQLite is basically threadsafe, but I have seen issues when using the same database
 	// instance across multiple threads, and we can't predict which thread we will be called on.
-	NSMutableDictionary* _databases;
-	NSMutableDictionary* _thumbnailDatabases;
+	IMBLightroomDatabasePool* _databasePool;
+	IMBLightroomDatabasePool* _thumbnailDatabasePool;
+	
+	// Preview locators looked up for the thumbnail runs that are currently being loaded...
+	NSMutableDictionary* _prefetchedPyramidPaths;
+	NSUInteger _prefetchCount;
 }
 
 @property (retain) NSString* appPath;
 @property (retain) NSString* atomicDataPath;
 @property (assign) BOOL shouldDisplayLibraryName;
-@property (nonatomic, retain) NSMutableDictionary *databases;
-@property (nonatomic, retain) NSMutableDictionary *thumbnailDatabases;
-@property (retain,readonly) FMDatabase* database;
-@property (retain,readonly) FMDatabase* thumbnailDatabase;
 
 + (NSString*) identifier;
 + (NSString*) lightroomPath;
@@ -125,16 +126,20 @@ IMBLightroomNodeType;
                                   nodeType:(IMBLightroomNodeType)inNodeType;
 
 
-// Returns a cached FMDatabase for the current thread
-- (FMDatabase*) database;
-- (FMDatabase*) thumbnailDatabase;
+// Lease an open FMDatabase to the current thread. Every checkout must be balanced by a checkin on the
+// same thread. Nested checkouts on one thread return the same connection...
+- (FMDatabase*) checkoutDatabase;
+- (void) checkinDatabase:(FMDatabase*)inDatabase;
+- (FMDatabase*) checkoutThumbnailDatabase;
+- (void) checkinThumbnailDatabase:(FMDatabase*)inDatabase;
 
 // Unconditionally creates an autoreleased FMDatabase instance. Used 
-// by the above caching accessors to instantiate as needed per-thread.
+// by the above connection pools to instantiate as needed.
 - (FMDatabase*) libraryDatabase;
 - (FMDatabase*) previewsDatabase;
 
 - (NSString*)pyramidPathForImage:(NSNumber*)idLocal;
+- (NSDictionary*)pyramidPathsForImages:(NSArray*)inIdLocals;
 - (NSData*)previewDataForObject:(IMBObject*)inObject maximumSize:(NSNumber*)maximumSize;
 
 @end
@@ -189,6 +194,9 @@ IMBLightroomNodeType;
 					 metadata:(NSDictionary*)inMetadata
 						index:(NSUInteger)inIndex;
 
+- (void) fetchPyramidPathsForImages:(NSArray*)inIdLocals placeholders:(NSString*)inPlaceholders into:(NSMutableDictionary*)ioPyramidPaths;
+- (void) resolvePyramidPathsForObjects:(NSArray*)inObjects;
+
 @end
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -74,6 +74,30 @@
 #import "SBUtilities.h"
 
 #import <Quartz/Quartz.h>
+#import <sys/stat.h>
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Upper bound for open connections per database. GCD may call us on any number of worker threads, so callers
+// beyond this limit wait for a connection to be checked in...
+
+static const long kIMBLightroomMaxDatabaseConnections = 4;
+
+// The catalog is read through memory mapped I/O (where the SQLite version supports it)...
+
+static const unsigned long long kIMBLightroomCatalogMmapSize = 256 * 1024 * 1024;
+
+// Number of images looked up per query by pyramidPathsForImages:. SQLite allows at most 999 bound parameters...
+
+static const NSUInteger kIMBLightroomPyramidPathBatchSize = 500;
+
+// Set to 1 to log the execution time of every SQL statement...
+
+#define LOG_QUERY_TIMES 0
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -87,6 +111,203 @@ static NSArray* sSupportedUTIs = nil;
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark 
+
+#if LOG_QUERY_TIMES
+
+static void _IMBLightroomLogQueryTime(void* inContext, const char* inSQL, sqlite3_uint64 inNanoseconds)
+{
+	NSLog(@"%s: %.3fms %s",__FUNCTION__,(double)inNanoseconds / 1000000.0,inSQL);
+}
+
+#endif
+
+
+// A small pool of read-only connections to one SQLite database. A connection is leased exclusively to the calling 
+// thread until it is checked in again. Nested checkouts on the same thread (e.g. pyramidPathForImage: while 
+// populating a node) return the connection that is already leased, so they can neither deadlock nor exceed the
+// bound. Every connection caches its prepared statements keyed by SQL string, so the same query is only prepared
+// once per connection...
+
+@interface IMBLightroomDatabasePool : NSObject
+{
+	id _owner;
+	SEL _factorySelector;
+	unsigned long long _mmapSize;
+	dispatch_semaphore_t _semaphore;
+	NSMutableArray* _idleDatabases;
+	NSMutableDictionary* _leasedDatabases;
+	NSMutableDictionary* _leaseCounts;
+}
+
+- (id) initWithOwner:(id)inOwner factorySelector:(SEL)inFactorySelector mmapSize:(unsigned long long)inMmapSize;
+- (FMDatabase*) checkoutDatabase;
+- (void) checkinDatabase:(FMDatabase*)inDatabase;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+@implementation IMBLightroomDatabasePool
+
+
+// The owner is not retained. It creates unopened FMDatabase instances via inFactorySelector...
+
+- (id) initWithOwner:(id)inOwner factorySelector:(SEL)inFactorySelector mmapSize:(unsigned long long)inMmapSize
+{
+	if ((self = [super init]))
+	{
+		_owner = inOwner;
+		_factorySelector = inFactorySelector;
+		_mmapSize = inMmapSize;
+		_semaphore = dispatch_semaphore_create(kIMBLightroomMaxDatabaseConnections);
+		_idleDatabases = [[NSMutableArray alloc] init];
+		_leasedDatabases = [[NSMutableDictionary alloc] init];
+		_leaseCounts = [[NSMutableDictionary alloc] init];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	for (FMDatabase* database in _idleDatabases)
+	{
+		[database close];
+	}
+	
+	dispatch_release(_semaphore);
+	IMBRelease(_idleDatabases);
+	IMBRelease(_leasedDatabases);
+	IMBRelease(_leaseCounts);
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Opens a new connection. We never write to a Lightroom database, so open it read-only (falling back to a
+// regular open for older catalogs that refuse that)...
+
+- (FMDatabase*) _openDatabase
+{
+	FMDatabase* database = [_owner performSelector:_factorySelector];
+	
+	if (![database openWithFlags:SQLITE_OPEN_READONLY] && ![database open])
+	{
+		return nil;
+	}
+	
+	[database setShouldCacheStatements:YES];
+	
+	if (_mmapSize > 0)
+	{
+		NSString* pragma = [NSString stringWithFormat:@"PRAGMA mmap_size = %llu",_mmapSize];
+		sqlite3_exec([database sqliteHandle],[pragma UTF8String],NULL,NULL,NULL);
+	}
+	
+	#if LOG_QUERY_TIMES
+	sqlite3_profile([database sqliteHandle],_IMBLightroomLogQueryTime,NULL);
+	#endif
+	
+	return database;
+}
+
+
+// Leases a connection to the current thread. Blocks while all connections are leased to other threads...
+
+- (FMDatabase*) checkoutDatabase
+{
+	NSValue* thread = [NSValue valueWithPointer:[NSThread currentThread]];
+	FMDatabase* database = nil;
+	
+	@synchronized (self)
+	{
+		database = [_leasedDatabases objectForKey:thread];
+		
+		if (database != nil)
+		{
+			NSUInteger count = [[_leaseCounts objectForKey:thread] unsignedIntegerValue];
+			[_leaseCounts setObject:[NSNumber numberWithUnsignedInteger:count+1] forKey:thread];
+			return database;
+		}
+	}
+	
+	dispatch_semaphore_wait(_semaphore,DISPATCH_TIME_FOREVER);
+	
+	@synchronized (self)
+	{
+		database = [[[_idleDatabases lastObject] retain] autorelease];
+		if (database) [_idleDatabases removeLastObject];
+	}
+	
+	// Opening is done outside of the lock, as it may be slow (Lightroom 3 clones the catalog first)...
+	
+	if (database == nil)
+	{
+		database = [self _openDatabase];
+	}
+	
+	if (database == nil)
+	{
+		dispatch_semaphore_signal(_semaphore);
+		return nil;
+	}
+	
+	@synchronized (self)
+	{
+		[_leasedDatabases setObject:database forKey:thread];
+		[_leaseCounts setObject:[NSNumber numberWithUnsignedInteger:1] forKey:thread];
+	}
+	
+	return database;
+}
+
+
+// Balances a checkoutDatabase on the same thread. The outermost checkin returns the connection to the pool...
+
+- (void) checkinDatabase:(FMDatabase*)inDatabase
+{
+	if (inDatabase == nil) return;
+	
+	NSValue* thread = [NSValue valueWithPointer:[NSThread currentThread]];
+	BOOL didReturnDatabase = NO;
+	
+	@synchronized (self)
+	{
+		NSUInteger count = [[_leaseCounts objectForKey:thread] unsignedIntegerValue];
+		NSAssert([_leasedDatabases objectForKey:thread] == inDatabase,@"Database must be checked in on the thread that checked it out");
+		
+		if (count > 1)
+		{
+			[_leaseCounts setObject:[NSNumber numberWithUnsignedInteger:count-1] forKey:thread];
+		}
+		else
+		{
+			[_idleDatabases addObject:inDatabase];
+			[_leasedDatabases removeObjectForKey:thread];
+			[_leaseCounts removeObjectForKey:thread];
+			didReturnDatabase = YES;
+		}
+	}
+	
+	if (didReturnDatabase)
+	{
+		dispatch_semaphore_signal(_semaphore);
+	}
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark 
 
 @interface IMBLightroomParser ()
@@ -126,8 +347,6 @@ static NSArray* sSupportedUTIs = nil;
 @synthesize appPath = _appPath;
 @synthesize atomicDataPath = _dataPath;
 @synthesize shouldDisplayLibraryName = _shouldDisplayLibraryName;
-@synthesize databases = _databases;
-@synthesize thumbnailDatabases = _thumbnailDatabases;
 
 
 // Check if Lightroom is installed...
@@ -180,8 +399,9 @@ static NSArray* sSupportedUTIs = nil;
 	{
 		self.appPath = [[self class] lightroomPath];
 		
-		_databases = [[NSMutableDictionary alloc] init];
-		_thumbnailDatabases = [[NSMutableDictionary alloc] init];		
+		_databasePool = [[IMBLightroomDatabasePool alloc] initWithOwner:self factorySelector:@selector(libraryDatabase) mmapSize:kIMBLightroomCatalogMmapSize];
+		_thumbnailDatabasePool = [[IMBLightroomDatabasePool alloc] initWithOwner:self factorySelector:@selector(previewsDatabase) mmapSize:0];
+		_prefetchedPyramidPaths = [[NSMutableDictionary alloc] init];
 		
 		[self supportedUTIs];	// Init early and in the main thread!
 	}
@@ -194,8 +414,9 @@ static NSArray* sSupportedUTIs = nil;
 {
 	IMBRelease(_appPath);
 	IMBRelease(_dataPath);
-	IMBRelease(_databases);
-	IMBRelease(_thumbnailDatabases);
+	IMBRelease(_databasePool);
+	IMBRelease(_thumbnailDatabasePool);
+	IMBRelease(_prefetchedPyramidPaths);
 	[super dealloc];
 }
 
@@ -446,8 +667,8 @@ static NSArray* sSupportedUTIs = nil;
 //{
 //	@synchronized (self)
 //	{
-//		self.databases = nil;
-//		self.thumbnailDatabases = nil;
+//		IMBRelease(_databasePool);
+//		IMBRelease(_thumbnailDatabasePool);
 //	}
 //}
 
@@ -455,6 +676,90 @@ static NSArray* sSupportedUTIs = nil;
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// Looks up the preview locators of a whole thumbnail run with a few batch queries, instead of one query per
+// object. Lightroom may have rewritten a preview since the objects were populated, so the locators of all objects
+// are refreshed. Runs may be loaded concurrently, so the prefetched locators are kept until the last run is done...
+
+- (void) willLoadThumbnailsForObjects:(NSArray*)inObjects
+{
+	NSMutableArray* idLocals = [NSMutableArray arrayWithCapacity:inObjects.count];
+	
+	for (IMBObject* object in inObjects)
+	{
+		if ([object isKindOfClass:[IMBLightroomObject class]] && [(IMBLightroomObject*)object idLocal] != nil)
+		{
+			[idLocals addObject:[(IMBLightroomObject*)object idLocal]];
+		}
+	}
+	
+	NSDictionary* pyramidPaths = [self pyramidPathsForImages:idLocals];
+	NSString* dataPath = self.dataPath;
+	
+	@synchronized (_prefetchedPyramidPaths)
+	{
+		[_prefetchedPyramidPaths addEntriesFromDictionary:pyramidPaths];
+		_prefetchCount++;
+	}
+	
+	for (IMBObject* object in inObjects)
+	{
+		if (![object isKindOfClass:[IMBLightroomObject class]]) continue;
+		
+		IMBLightroomObject* lightroomObject = (IMBLightroomObject*)object;
+		NSString* pyramidPath = lightroomObject.idLocal ? [pyramidPaths objectForKey:lightroomObject.idLocal] : nil;
+		
+		if (pyramidPath != nil)
+		{
+			NSString* absolutePyramidPath = [dataPath stringByAppendingPathComponent:pyramidPath];
+			
+			if (![absolutePyramidPath isEqualToString:lightroomObject.absolutePyramidPath])
+			{
+				lightroomObject.absolutePyramidPath = absolutePyramidPath;
+				lightroomObject.accessibility = [self accessibilityForObject:lightroomObject];
+			}
+		}
+	}
+}
+
+
+- (void) didLoadThumbnailsForObjects:(NSArray*)inObjects
+{
+	@synchronized (_prefetchedPyramidPaths)
+	{
+		if (_prefetchCount > 0) _prefetchCount--;
+		if (_prefetchCount == 0) [_prefetchedPyramidPaths removeAllObjects];
+	}
+}
+
+
+// Thumbnails are taken from the preview pyramid, which Lightroom rewrites (often under a new name) when the image 
+// is developed. So the pyramid file and its modification date are part of the thumbnail cache key...
+
+- (NSString*) thumbnailStampForObject:(IMBObject*)inObject
+{
+	IMBLightroomObject* lightroomObject = (IMBLightroomObject*)inObject;
+	
+	if (lightroomObject.absolutePyramidPath == nil)
+	{
+		[self resolvePyramidPathsForObjects:[NSArray arrayWithObject:lightroomObject]];
+	}
+	
+	NSString* path = lightroomObject.absolutePyramidPath;
+	struct stat info;
+	
+	if (path == nil || stat([path fileSystemRepresentation],&info) != 0)
+	{
+		return @"nopreview";
+	}
+	
+	return [NSString stringWithFormat:@"%@|%lld|%ld.%09ld",
+		[path lastPathComponent],
+		(long long)info.st_size,
+		(long)info.st_mtimespec.tv_sec,
+		(long)info.st_mtimespec.tv_nsec];
+}
+
+
 // Build a thumbnail for our object...
 
 - (id) thumbnailForObject:(IMBObject*)inObject error:(NSError**)outError
@@ -700,18 +1005,22 @@ static NSArray* sSupportedUTIs = nil;
 	
 	// Query the database for the root folders and create a node for each one we find...
 	
-	FMDatabase *database = self.database;
+	FMDatabase *database = [self checkoutDatabase];
 	
 	if (database != nil) {
 		NSString* query = [(id<IMBLightroomParser>)self rootFolderQuery];
 		FMResultSet* results = [database executeQuery:query];
 		NSInteger index = 0;
 		
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int absolutePathColumn = [results columnIndexForName:@"absolutePath"];
+		int nameColumn = [results columnIndexForName:@"name"];
+		
 		while ([results next]) {
 			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
-			NSNumber* id_local = [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-			NSString* path = [results stringForColumn:@"absolutePath"];
-			NSString* name = [results stringForColumn:@"name"];
+			NSNumber* id_local = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSString* path = [results stringForColumnIndex:absolutePathColumn];
+			NSString* name = [results stringForColumnIndex:nameColumn];
 			
 			if (name == nil) {
 				name = NSLocalizedStringWithDefaultValue(
@@ -752,6 +1061,8 @@ static NSArray* sSupportedUTIs = nil;
 		[results close];
 	}
 	
+	[self checkinDatabase:database];
+	
 	inFoldersNode.objects = objects;
 }
 
@@ -772,7 +1083,7 @@ static NSArray* sSupportedUTIs = nil;
 	
 	// Query the database for subfolder and add a node for each one we find...
 	
-	FMDatabase *database = self.database;
+	FMDatabase *database = [self checkoutDatabase];
 	
 	if (database != nil) {
 		NSDictionary* attributes = inParentNode.attributes;
@@ -795,9 +1106,12 @@ static NSArray* sSupportedUTIs = nil;
 		FMResultSet* results = [database executeQuery:query, parentRootFolder, pathFromRootAccept, pathFromRootReject];
 		NSInteger index = 0;
 		
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int pathFromRootColumn = [results columnIndexForName:@"pathFromRoot"];
+		
 		while ([results next]) {
-			NSNumber* id_local = [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-			NSString* pathFromRoot = [results stringForColumn:@"pathFromRoot"];
+			NSNumber* id_local = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSString* pathFromRoot = [results stringForColumnIndex:pathFromRootColumn];
 			
 			if ([pathFromRoot hasSuffix:@"/"]) {
 				pathFromRoot = [pathFromRoot substringToIndex:(pathFromRoot.length - 1)];
@@ -842,6 +1156,8 @@ static NSArray* sSupportedUTIs = nil;
 		[results close];
 	}
 	
+	[self checkinDatabase:database];
+	
 	inParentNode.objects = objects;
 }
 
@@ -864,7 +1180,7 @@ static NSArray* sSupportedUTIs = nil;
 	
 	// Now query the database for subnodes to the specified parent node...
 	
-	FMDatabase *database = self.database;
+	FMDatabase *database = [self checkoutDatabase];
 
 	if (database != nil) {
 		NSDictionary* attributes = inParentNode.attributes;
@@ -883,13 +1199,18 @@ static NSArray* sSupportedUTIs = nil;
 
 		NSInteger index = 0;
 		
+		int creationidColumn = [results optionalColumnIndexForName:@"creationid"];
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int parentColumn = [results columnIndexForName:@"parent"];
+		int nameColumn = [results columnIndexForName:@"name"];
+		
 		while ([results next]) {
 			// Get properties for next collection. Also substitute missing names...
 			
-			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-			NSNumber* idParentLocal = [NSNumber numberWithLong:[results longForColumn:@"parent"]];
-			NSString* name = [results stringForColumn:@"name"];
-			NSString* creationId = [results hasColumnWithName:@"creationid"] ? [results stringForColumn:@"creationid"] : nil;
+			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSNumber* idParentLocal = [NSNumber numberWithLong:[results longForColumnIndex:parentColumn]];
+			NSString* name = [results stringForColumnIndex:nameColumn];
+			NSString* creationId = [results stringForColumnIndex:creationidColumn];
 			BOOL isGroup = NO;
 			
 			if (name == nil)
@@ -945,6 +1266,8 @@ static NSArray* sSupportedUTIs = nil;
 		[results close];
 	}
 	
+	[self checkinDatabase:database];
+	
 	inParentNode.objects = objects;
 }
 
@@ -991,7 +1314,7 @@ static NSArray* sSupportedUTIs = nil;
 	
 	// Query the database for image files for the specified node. Add an IMBObject for each one we find...
 	
-	FMDatabase *database = self.database;
+	FMDatabase *database = [self checkoutDatabase];
 	
 	if (database != nil) {
 		NSMutableArray* objects = [NSMutableArray array];
@@ -1003,22 +1326,27 @@ static NSArray* sSupportedUTIs = nil;
 		FMResultSet* results = [database executeQuery:query, folderId, folderId];
 		NSUInteger index = 0;
 		
+		int pyramidPathColumn = [results optionalColumnIndexForName:@"pyramidPath"];
+		int idxFilenameColumn = [results columnIndexForName:@"idx_filename"];
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int captureTimeColumn = [results columnIndexForName:@"captureTime"];
+		int fileHeightColumn = [results columnIndexForName:@"fileHeight"];
+		int fileWidthColumn = [results columnIndexForName:@"fileWidth"];
+		int orientationColumn = [results columnIndexForName:@"orientation"];
+		int captionColumn = [results columnIndexForName:@"caption"];
+		
 		while ([results next]) {
-			NSString* filename = [results stringForColumn:@"idx_filename"];
-			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-			NSString* captureTime = [results stringForColumn:@"captureTime"];
-			NSNumber* fileHeight = [NSNumber numberWithDouble:[results doubleForColumn:@"fileHeight"]];
-			NSNumber* fileWidth = [NSNumber numberWithDouble:[results doubleForColumn:@"fileWidth"]];
-			NSString* orientation = [results stringForColumn:@"orientation"];
-			NSString* caption = [results stringForColumn:@"caption"];
-			NSString* pyramidPath = ([results hasColumnWithName:@"pyramidPath"] ? [results stringForColumn:@"pyramidPath"] : nil);
+			NSString* filename = [results stringForColumnIndex:idxFilenameColumn];
+			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSString* captureTime = [results stringForColumnIndex:captureTimeColumn];
+			NSNumber* fileHeight = [NSNumber numberWithDouble:[results doubleForColumnIndex:fileHeightColumn]];
+			NSNumber* fileWidth = [NSNumber numberWithDouble:[results doubleForColumnIndex:fileWidthColumn]];
+			NSString* orientation = [results stringForColumnIndex:orientationColumn];
+			NSString* caption = [results stringForColumnIndex:captionColumn];
+			NSString* pyramidPath = [results stringNoCopyForColumnIndex:pyramidPathColumn];	// Only used to build absolutePyramidPath
 			NSString* name = filename;
 			NSString* path = [folderPath stringByAppendingPathComponent:filename];
 			
-			if (pyramidPath == nil) {
-				pyramidPath = [self pyramidPathForImage:idLocal];
-			}
-			
 			if ([self canOpenImageFileAtPath:path]) {
 				NSMutableDictionary* metadata = [NSMutableDictionary dictionary];
 				
@@ -1055,9 +1383,15 @@ static NSArray* sSupportedUTIs = nil;
 		
 		[results close];
 		
+		// Look up missing preview locators for the whole folder at once instead of once per image...
+		
+		[self resolvePyramidPathsForObjects:objects];
+		
 		[objects addObjectsFromArray:inNode.objects];
 		inNode.objects = objects;
 	}
+	
+	[self checkinDatabase:database];
 }
 
 
@@ -1078,30 +1412,36 @@ static NSArray* sSupportedUTIs = nil;
 	
 	// Query the database for image files for the specified node. Add an IMBObject for each one we find...
 	
-	FMDatabase *database = self.database;
+	FMDatabase *database = [self checkoutDatabase];
 	
 	if (database != nil) {
 		NSString* query = [(id<IMBLightroomParser>)self collectionObjectsQuery];
 		NSNumber* collectionId = [self idLocalFromAttributes:inNode.attributes];
 		FMResultSet* results = [database executeQuery:query, collectionId];
+		NSMutableArray* objects = [NSMutableArray array];
 		NSUInteger index = 0;
 		
+		int pyramidPathColumn = [results optionalColumnIndexForName:@"pyramidPath"];
+		int absolutePathColumn = [results columnIndexForName:@"absolutePath"];
+		int idxFilenameColumn = [results columnIndexForName:@"idx_filename"];
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int fileHeightColumn = [results columnIndexForName:@"fileHeight"];
+		int fileWidthColumn = [results columnIndexForName:@"fileWidth"];
+		int orientationColumn = [results columnIndexForName:@"orientation"];
+		int captionColumn = [results columnIndexForName:@"caption"];
+		
 		while ([results next]) {
-			NSString* absolutePath = [results stringForColumn:@"absolutePath"];
-			NSString* filename = [results stringForColumn:@"idx_filename"];
-			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumn:@"id_local"]];
-			NSNumber* fileHeight = [NSNumber numberWithDouble:[results doubleForColumn:@"fileHeight"]];
-			NSNumber* fileWidth = [NSNumber numberWithDouble:[results doubleForColumn:@"fileWidth"]];
-			NSString* orientation = [results stringForColumn:@"orientation"];
-			NSString* caption = [results stringForColumn:@"caption"];
-			NSString* pyramidPath = ([results hasColumnWithName:@"pyramidPath"] ? [results stringForColumn:@"pyramidPath"] : nil);
+			NSString* absolutePath = [results stringForColumnIndex:absolutePathColumn];
+			NSString* filename = [results stringForColumnIndex:idxFilenameColumn];
+			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSNumber* fileHeight = [NSNumber numberWithDouble:[results doubleForColumnIndex:fileHeightColumn]];
+			NSNumber* fileWidth = [NSNumber numberWithDouble:[results doubleForColumnIndex:fileWidthColumn]];
+			NSString* orientation = [results stringForColumnIndex:orientationColumn];
+			NSString* caption = [results stringForColumnIndex:captionColumn];
+			NSString* pyramidPath = [results stringNoCopyForColumnIndex:pyramidPathColumn];	// Only used to build absolutePyramidPath
 			NSString* name = caption!= nil ? caption : filename;
 			NSString* path = [absolutePath stringByAppendingString:filename];
 			
-			if (pyramidPath == nil) {
-				pyramidPath = [self pyramidPathForImage:idLocal];
-			}
-			
 			if ([self canOpenImageFileAtPath:path]) {
 				NSMutableDictionary* metadata = [NSMutableDictionary dictionary];
 				
@@ -1122,13 +1462,18 @@ static NSArray* sSupportedUTIs = nil;
 											 pyramidPath:pyramidPath
 												metadata:metadata
 												   index:index++];
+				[objects addObject:object];
 				[(NSMutableArray*)inNode.objects addObject:object];
 				inNode.displayedObjectCount++;
 			}
 		}
 		
 		[results close];
+		
+		[self resolvePyramidPathsForObjects:objects];
 	}
+	
+	[self checkinDatabase:database];
 }
 
 
@@ -1301,27 +1646,119 @@ static NSArray* sSupportedUTIs = nil;
 
 - (NSString*)pyramidPathForImage:(NSNumber*)idLocal
 {
-	FMDatabase *database = [self thumbnailDatabase];
-	NSString *pyramidPath = nil;
+	if (idLocal == nil) return nil;
+	
+	@synchronized (_prefetchedPyramidPaths)
+	{
+		NSString* pyramidPath = [_prefetchedPyramidPaths objectForKey:idLocal];
+		if (pyramidPath) return [[pyramidPath retain] autorelease];
+	}
+	
+	NSDictionary* pyramidPaths = [self pyramidPathsForImages:[NSArray arrayWithObject:idLocal]];
+	return [pyramidPaths objectForKey:idLocal];
+}
+
+
+// Looks up the preview locators for many images with a few set-based queries. The id_local list is split into
+// chunks to stay below SQLite's limit on bound parameters. Returns a dictionary keyed by id_local...
+
+- (NSDictionary*) pyramidPathsForImages:(NSArray*)inIdLocals
+{
+	NSMutableDictionary* pyramidPaths = [NSMutableDictionary dictionaryWithCapacity:inIdLocals.count];
+	NSUInteger count = inIdLocals.count;
+	
+	for (NSUInteger location=0; location<count; location+=kIMBLightroomPyramidPathBatchSize)
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		NSUInteger length = MIN(kIMBLightroomPyramidPathBatchSize,count-location);
+		NSArray* idLocals = [inIdLocals subarrayWithRange:NSMakeRange(location,length)];
+		NSMutableString* placeholders = [NSMutableString stringWithCapacity:2*length];
+		
+		for (NSUInteger i=0; i<length; i++)
+		{
+			[placeholders appendString:(i == 0) ? @"?" : @",?"];
+		}
+		
+		[self fetchPyramidPathsForImages:idLocals placeholders:placeholders into:pyramidPaths];
+		[pool drain];
+	}
+	
+	return pyramidPaths;
+}
+
+
+// Fetches the preview locators for one chunk of images. Subclasses with a different preview cache layout 
+// override this method...
+
+- (void) fetchPyramidPathsForImages:(NSArray*)inIdLocals placeholders:(NSString*)inPlaceholders into:(NSMutableDictionary*)ioPyramidPaths
+{
+	FMDatabase *database = [self checkoutThumbnailDatabase];
 	
 	if (database != nil) {		
-		NSString* query =	@" SELECT apcp.relativeDataPath pyramidPath"
+		NSString* query = [NSString stringWithFormat:
+							@" SELECT ai.id_local, apcp.relativeDataPath pyramidPath"
 							@" FROM Adobe_images ai"
 							@" INNER JOIN Adobe_previewCachePyramids apcp ON apcp.id_local = ai.pyramidIDCache"
-							@" WHERE ai.id_local = ?"
-							@" ORDER BY ai.pyramidIDCache ASC"
-							@" LIMIT 1";
+							@" WHERE ai.id_local IN (%@)"
+							@" ORDER BY ai.pyramidIDCache ASC",
+							inPlaceholders];
 	
-		FMResultSet* results = [database executeQuery:query, idLocal];
+		FMResultSet* results = [database executeQuery:query withArgumentsInArray:inIdLocals];
+		
+		int idLocalColumn = [results columnIndexForName:@"id_local"];
+		int pyramidPathColumn = [results columnIndexForName:@"pyramidPath"];
 		
-		if ([results next]) {				
-			pyramidPath = [results stringForColumn:@"pyramidPath"];
+		while ([results next]) {
+			NSNumber* idLocal = [NSNumber numberWithLong:[results longForColumnIndex:idLocalColumn]];
+			NSString* pyramidPath = [results stringForColumnIndex:pyramidPathColumn];
+			
+			// Keep the first row per image, like the former single-image query with LIMIT 1...
+			
+			if (pyramidPath != nil && [ioPyramidPaths objectForKey:idLocal] == nil) {
+				[ioPyramidPaths setObject:pyramidPath forKey:idLocal];
+			}
 		}
 	
 		[results close];
 	}
 	
-	return pyramidPath;
+	[self checkinThumbnailDatabase:database];
+}
+
+
+// Fills in the preview locators for all objects whose query did not return one, using a single batch lookup. 
+// Accessibility depends on the pyramid file, so it is updated as well...
+
+- (void) resolvePyramidPathsForObjects:(NSArray*)inObjects
+{
+	NSMutableArray* idLocals = [NSMutableArray array];
+	
+	for (IMBLightroomObject* object in inObjects)
+	{
+		if (object.absolutePyramidPath == nil && object.idLocal != nil)
+		{
+			[idLocals addObject:object.idLocal];
+		}
+	}
+	
+	if (idLocals.count == 0) return;
+	
+	NSDictionary* pyramidPaths = [self pyramidPathsForImages:idLocals];
+	NSString* dataPath = self.dataPath;
+	
+	for (IMBLightroomObject* object in inObjects)
+	{
+		if (object.absolutePyramidPath == nil && object.idLocal != nil)
+		{
+			NSString* pyramidPath = [pyramidPaths objectForKey:object.idLocal];
+			
+			if (pyramidPath != nil)
+			{
+				object.absolutePyramidPath = [dataPath stringByAppendingPathComponent:pyramidPath];
+				object.accessibility = [self accessibilityForObject:object];
+			}
+		}
+	}
 }
 
 - (NSData*)previewDataForObject:(IMBObject*)inObject maximumSize:(NSNumber*)maximumSize
@@ -1331,7 +1768,7 @@ static NSArray* sSupportedUTIs = nil;
 	NSData* jpegData = nil;
 	
 	if (absolutePyramidPath != nil) {
-		FMDatabase *database = [self thumbnailDatabase];
+		FMDatabase *database = [self checkoutThumbnailDatabase];
 		
 		if (database != nil) {
 			NSDictionary* metadata = [lightroomObject preliminaryMetadata];
@@ -1375,6 +1812,8 @@ static NSArray* sSupportedUTIs = nil;
 				[results close];
 			}
 		}
+		
+		[self checkinThumbnailDatabase:database];
 	}
 	
 	return jpegData;
@@ -1420,42 +1859,28 @@ static NSArray* sSupportedUTIs = nil;
 	return database;
 }
 
-// NOTE: We return a separate FMDatabase instance per thread. This seems to 
-// eliminate some funky SQLite behavior that was observed when separate threads 
-// try to interact with the same connection from different threads.
+// Connections are leased from a bounded pool. Each connection is only ever used by the thread that checked it out,
+// which avoids the funky SQLite behavior that was observed when separate threads interact with the same 
+// connection. Every checkout must be balanced by a checkin on the same thread...
 
-- (FMDatabase*)database
+- (FMDatabase*) checkoutDatabase
 {
-	FMDatabase* foundDatabase = nil;
-	@synchronized (self) {
-		foundDatabase = [_databases objectForKey:[NSValue valueWithPointer:[NSThread currentThread]]];
-		if (foundDatabase == nil) {
-			foundDatabase = [self libraryDatabase];
-			
-			if ([foundDatabase open]) {
-				[_databases setObject:foundDatabase forKey:[NSValue valueWithPointer:[NSThread currentThread]]];
-			}
-		}
-	}
-	
-	return foundDatabase;
+	return [_databasePool checkoutDatabase];
 }
 
-- (FMDatabase*)thumbnailDatabase
+- (void) checkinDatabase:(FMDatabase*)inDatabase
 {
-	FMDatabase* foundDatabase = nil;
-	@synchronized (self) {
-		foundDatabase = [_thumbnailDatabases objectForKey:[NSValue valueWithPointer:[NSThread currentThread]]];
-		if (foundDatabase == nil) {
-			foundDatabase = [self previewsDatabase];
-			
-			if ([foundDatabase open]) {
-				[_thumbnailDatabases setObject:foundDatabase forKey:[NSValue valueWithPointer:[NSThread currentThread]]];
-			}
-		}
-	}
-	
-	return foundDatabase;
+	[_databasePool checkinDatabase:inDatabase];
+}
+
+- (FMDatabase*) checkoutThumbnailDatabase
+{
+	return [_thumbnailDatabasePool checkoutDatabase];
+}
+
+- (void) checkinThumbnailDatabase:(FMDatabase*)inDatabase
+{
+	[_thumbnailDatabasePool checkinDatabase:inDatabase];
 }
 
 // Get object's resource current accessibility status
@@ -137,7 +137,7 @@
 
 // Simply override these two methods to do nothing...
 
-- (void) loadThumbnail
+- (void) loadThumbnailWithPriority:(IMBThumbnailPriority)inPriority
 {
 
 }
@@ -93,6 +93,9 @@
 	NSMutableArray* _subnodes;
 	NSArray* _objects;
 	IMBNode* _parentNode;	// not retained!
+	NSUInteger* _recursiveObjectCounts;		// prefix sums of subnode object counts (see countOfRecursiveObjects)
+	NSUInteger _recursiveObjectCountsLength;	// number of subnodes covered by the table
+	BOOL _hasRecursiveObjectCounts;
 
 	// Info about our parser...
 	
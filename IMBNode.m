@@ -60,6 +60,7 @@
 #import "IMBParserMessenger.h"
 #import "IMBParser.h"
 #import "IMBLibraryController.h"
+#import "IMBNodeArchiver.h"
 #import "NSString+iMedia.h"
 #import "NSImage+iMedia.h"
 #import "NSURL+iMedia.h"
@@ -74,7 +75,10 @@
 
 @property (assign,readwrite) IMBNode* parentNode;
 @property (retain) NSArray* atomic_subnodes;				
+@property (retain) NSArray* atomic_objects;
+- (void) _invalidateRecursiveObjectCounts;
 - (void) _recursivelyWalkParentsAddingPathIndexTo:(NSMutableArray*)inIndexArray;
++ (NSImage*) iconWithSmallRepresentations:(NSImage*)inImage;
 
 @end
 
@@ -103,7 +107,7 @@
 
 @synthesize parentNode = _parentNode;
 @synthesize atomic_subnodes = _subnodes;
-@synthesize objects = _objects;
+@synthesize atomic_objects = _objects;
 
 // Info about our parser...
 
@@ -215,6 +219,7 @@
 	IMBRelease(_attributes);
 	IMBRelease(_subnodes);
 	IMBRelease(_objects);
+	if (_recursiveObjectCounts) free(_recursiveObjectCounts);
 	IMBRelease(_parserMessenger);
 	IMBRelease(_parserIdentifier);
 	IMBRelease(_error);
@@ -310,6 +315,19 @@
 
 - (id) initWithCoder:(NSCoder*)inCoder
 {
+	// If the subtree was written in the compact binary format, then replace self with the decoded node...
+	
+	NSData* archive = [inCoder allowsKeyedCoding] ? [inCoder decodeObjectForKey:@"archive"] : nil;
+	
+	if (archive)
+	{
+		NSError* error = nil;
+		IMBNode* node = [IMBNodeArchiver nodeWithArchivedData:archive error:&error];
+		if (node == nil) NSLog(@"%s Could not decode node archive: %@",__FUNCTION__,error);
+		[self release];
+		return [node retain];
+	}
+	
 	if ((self = [super init]))
 	{
 		self.name = [inCoder decodeObjectForKey:@"name"];
@@ -373,6 +391,15 @@
 
 - (void) encodeWithCoder:(NSCoder*)inCoder
 {
+	// Whole trees of plain nodes are written in a compact binary format, which is considerably smaller and 
+	// faster than keyed archiving once a node contains thousands of objects...
+	
+	if ([inCoder allowsKeyedCoding] && [IMBNodeArchiver canArchiveNode:self])
+	{
+		[inCoder encodeObject:[IMBNodeArchiver archivedDataWithNode:self] forKey:@"archive"];
+		return;
+	}
+	
 	[inCoder encodeObject:self.name forKey:@"name"];
 	[inCoder encodeObject:self.identifier forKey:@"identifier"];
 	[inCoder encodeObject:self.mediaType forKey:@"mediaType"];
@@ -404,40 +431,32 @@
 	if (self.subnodes) [inCoder encodeObject:self.subnodes forKey:@"subnodes"];
 	if (self.objects) [inCoder encodeObject:self.objects forKey:@"objects"];
 	
-	// Encoding the icon needs special attention. We only need 16x16 pixels (and 32x32 for retina displays),
-	// but the NSImage contains multiple high resolution representations. Instead of encoding them all, we'll
-	// simply encode the small ones...
+	// Encoding the icon needs special attention (see below)...
 	
-    NSImage*(^iconWithSmallRepresentations)(NSImage*) = ^NSImage*(NSImage* inImage)
-    {
-        if (inImage)
-        {
-            NSImage* strippedIcon = [[[NSImage alloc] initWithSize:NSMakeSize(16.0,16.0)]autorelease];
-            for (NSImageRep* iconRep in inImage.representations)
-            {
-                NSSize size = iconRep.size;
-                
-                if (size.width <= 32.0)
-                {
-                    //			if ([rep isKindOfClass:[NSBitmapImageRep class]])
-                    if (YES)
-                    {
-                        //				NSLog(@"%s %@ %@",__FUNCTION__,NSStringFromClass([rep class]),NSStringFromSize(size));
-                        [strippedIcon addRepresentation:iconRep];
-                    }
-                    else
-                    {
-                        // TODO: convert other reps to NSBitmapImageRep
-                    }
-                }
-            }
-            return strippedIcon;
-        }
-        return nil;
-    };
+	[inCoder encodeObject:[IMBNode iconWithSmallRepresentations:self.icon] forKey:@"icon"];
+	[inCoder encodeObject:[IMBNode iconWithSmallRepresentations:self.highlightIcon] forKey:@"highlightIcon"];
+}
+
 
-    [inCoder encodeObject:iconWithSmallRepresentations(self.icon) forKey:@"icon"];
-    [inCoder encodeObject:iconWithSmallRepresentations(self.highlightIcon) forKey:@"highlightIcon"];
+// Encoding the icon needs special attention. We only need 16x16 pixels (and 32x32 for retina displays),
+// but the NSImage contains multiple high resolution representations. Instead of encoding them all, we'll
+// simply encode the small ones. Also used by IMBNodeArchiver...
+
++ (NSImage*) iconWithSmallRepresentations:(NSImage*)inImage
+{
+	if (inImage == nil) return nil;
+	
+	NSImage* strippedIcon = [[[NSImage alloc] initWithSize:NSMakeSize(16.0,16.0)] autorelease];
+	
+	for (NSImageRep* iconRep in inImage.representations)
+	{
+		if (iconRep.size.width <= 32.0)
+		{
+			[strippedIcon addRepresentation:iconRep];
+		}
+	}
+	
+	return strippedIcon;
 }
 
 
@@ -512,11 +531,18 @@
 #pragma mark Subnodes
 
 
+// All mutations of the subnodes array happen under the same lock as the recursive object count tables, and
+// invalidate them before the array is changed (see countOfRecursiveObjects)...
+
 - (void) setSubnodes:(NSArray*)inNodes
 {
-    [_subnodes makeObjectsPerformSelector:@selector(setParentNode:) withObject:nil];
-    self.atomic_subnodes = inNodes;
-    [_subnodes makeObjectsPerformSelector:@selector(setParentNode:) withObject:self];
+	@synchronized ([IMBNode class])
+	{
+		[self _invalidateRecursiveObjectCounts];
+		[_subnodes makeObjectsPerformSelector:@selector(setParentNode:) withObject:nil];
+		self.atomic_subnodes = inNodes;
+		[_subnodes makeObjectsPerformSelector:@selector(setParentNode:) withObject:self];
+	}
 }
 
 
@@ -552,8 +578,12 @@
 	
 	if (inIndex <= _subnodes.count)
 	{
-		[_subnodes insertObject:inNode atIndex:inIndex];
-		inNode.parentNode = self;
+		@synchronized ([IMBNode class])
+		{
+			[self _invalidateRecursiveObjectCounts];
+			[_subnodes insertObject:inNode atIndex:inIndex];
+			inNode.parentNode = self;
+		}
 	}
 	else 
 	{
@@ -566,9 +596,13 @@
 {
 	if (inIndex < _subnodes.count)
 	{
-		IMBNode* node = [_subnodes objectAtIndex:inIndex];
-		node.parentNode = nil;
-		[_subnodes removeObjectAtIndex:inIndex];
+		@synchronized ([IMBNode class])
+		{
+			[self _invalidateRecursiveObjectCounts];
+			IMBNode* node = [_subnodes objectAtIndex:inIndex];
+			node.parentNode = nil;
+			[_subnodes removeObjectAtIndex:inIndex];
+		}
 	}
 	else 
 	{
@@ -581,10 +615,14 @@
 {
 	if (inIndex < _subnodes.count)
 	{
-		IMBNode* node = [_subnodes objectAtIndex:inIndex];
-		node.parentNode = nil;
-		[_subnodes replaceObjectAtIndex:inIndex withObject:inNode];
-		inNode.parentNode = self;
+		@synchronized ([IMBNode class])
+		{
+			[self _invalidateRecursiveObjectCounts];
+			IMBNode* node = [_subnodes objectAtIndex:inIndex];
+			node.parentNode = nil;
+			[_subnodes replaceObjectAtIndex:inIndex withObject:inNode];
+			inNode.parentNode = self;
+		}
 	}
 	else 
 	{
@@ -617,6 +655,19 @@
 #pragma mark Objects
 
 
+- (void) setObjects:(NSArray*)inObjects
+{
+	self.atomic_objects = inObjects;
+	[self _invalidateRecursiveObjectCounts];
+}
+
+
+- (NSArray*) objects
+{
+	return self.atomic_objects;
+}
+
+
 // Shallow object accessors. Use these for binding the NSArrayController. This only returns the objects that are
 // contained directly by this node, but not those contained by any subnodes...
 
@@ -652,16 +703,64 @@
 // substantial performance problems. It is now the responsibility of the parser classes to ensure that parent nodes
 // do not contain any objects that are already contained in subnodes...
 
-- (NSUInteger) countOfRecursiveObjects
+// To make recursive access fast, each node caches a table of prefix sums: entry 0 is the number of shallow objects,
+// entry i+1 adds the recursive object count of subnode i. The last entry is the recursive object count of the node.
+// The table is built lazily and discarded whenever objects or subnodes of the node (or any of its descendants) 
+// change. Invalidation always walks the whole parent chain, as an ancestor may have built its table while this 
+// node was still being populated. Nodes are populated on background threads while the main thread displays
+// them, so all access to the tables (and all mutations of the subnodes arrays) is synchronized on the IMBNode 
+// class (the tables of a tree depend on each other, so a lock per node would not do). The table remembers how
+// many subnodes it covers, and lookups never go beyond that...
+
+- (void) _invalidateRecursiveObjectCounts
 {
-	NSUInteger count = self.countOfShallowObjects;
+	@synchronized ([IMBNode class])
+	{
+		for (IMBNode* node = self; node != nil; node = node->_parentNode)
+		{
+			node->_hasRecursiveObjectCounts = NO;
+		}
+	}
+}
+
+
+- (void) _buildRecursiveObjectCounts
+{
+	NSUInteger n = [_subnodes count];
+	NSUInteger* counts = (NSUInteger*) realloc(_recursiveObjectCounts,(n+1)*sizeof(NSUInteger));
+	if (counts == NULL) return;
 	
-	for (IMBNode* node in _subnodes)
+	_recursiveObjectCounts = counts;
+	_recursiveObjectCountsLength = n;
+	counts[0] = self.countOfShallowObjects;
+	
+	for (NSUInteger i=0; i<n; i++)
 	{
-		count += node.countOfRecursiveObjects;
+		IMBNode* node = [_subnodes objectAtIndex:i];
+		counts[i+1] = counts[i] + node.countOfRecursiveObjects;
 	}
 	
-	return count;
+	_hasRecursiveObjectCounts = YES;
+}
+
+
+// Parsers often fill the objects array in place after assigning it, so we also double check the shallow count...
+
+- (NSUInteger) countOfRecursiveObjects
+{
+	@synchronized ([IMBNode class])
+	{
+		if (_hasRecursiveObjectCounts && 
+			(_recursiveObjectCounts[0] != self.countOfShallowObjects || _recursiveObjectCountsLength != [_subnodes count]))
+		{
+			[self _invalidateRecursiveObjectCounts];
+		}
+		
+		if (!_hasRecursiveObjectCounts) [self _buildRecursiveObjectCounts];
+		if (!_hasRecursiveObjectCounts) return 0;
+		
+		return _recursiveObjectCounts[_recursiveObjectCountsLength];
+	}
 }
 
 
@@ -677,20 +776,33 @@
 		return [self objectInShallowObjectsAtIndex:inIndex];
 	}
 	
-	// If the index is larger, then it must be in one of the subnodes...
+	// If the index is larger, then it must be in one of the subnodes. Do a binary search for the first subnode 
+	// whose range ends after the index...
 	
-	NSUInteger index = inIndex - count;
-	
-	for (IMBNode* node in _subnodes)
+	@synchronized ([IMBNode class])
 	{
-		IMBObject* object = [node objectInRecursiveObjectsAtIndex:index];
-		if (object) return object;
-		else index -= node.countOfRecursiveObjects;
+		if (inIndex >= self.countOfRecursiveObjects)
+		{
+			return nil;
+		}
+		
+		NSUInteger* counts = _recursiveObjectCounts;
+		NSUInteger lo = 0;
+		NSUInteger hi = _recursiveObjectCountsLength;
+		
+		while (lo < hi)
+		{
+			NSUInteger mid = lo + (hi - lo) / 2;
+			
+			if (counts[mid+1] <= inIndex) lo = mid + 1;
+			else hi = mid;
+		}
+		
+		if (lo >= [_subnodes count]) return nil;
+		
+		IMBNode* node = [_subnodes objectAtIndex:lo];
+		return [node objectInRecursiveObjectsAtIndex:inIndex - counts[lo]];
 	}
-	
-	// Couldn't find a object with this index (index to large). Return nil...
-	
-	return nil;
 }
 
 
@@ -700,6 +812,15 @@
 // The bindableObjects property is used to bind the contentArray of IMBObjectArrayController. In this property 
 // the node can select whether it wants to display shallow or deep (recursive) objects...
 
+// Objects may be replaced in place (e.g. when a paged population appends more objects), so the bound 
+// NSArrayController needs to be told...
+
++ (NSSet*) keyPathsForValuesAffectingBindableObjects
+{
+	return [NSSet setWithObjects:@"objects",@"wantsRecursiveObjects",nil];
+}
+
+
 - (NSUInteger) countOfBindableObjects
 {
 	if (self.wantsRecursiveObjects)
@@ -0,0 +1,94 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CLASSES
+
+@class IMBNode;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// IMBNodeArchiver writes a complete node tree (subnodes and objects) in a compact, versioned binary format. All 
+// strings go into a shared string table, scalar properties are stored as fixed width fields, and icons are stored
+// once and referenced by id. The IMBObject subclasses that parsers create in bulk (folder, Lightroom, event and face
+// objects) are written field by field as well. Values that the format does not know about (e.g. exotic metadata 
+// values or objects of other IMBObject subclasses with their own properties) are embedded as NSKeyedArchiver data. 
+// IMBNode uses this format in -encodeWithCoder: (and thus for all results that IMBParserMessenger sends across
+// the XPC connection) whenever +canArchiveNode: returns YES...
+
+@interface IMBNodeArchiver : NSObject
+
+// Can be used to turn the compact format off (e.g. for debugging or comparison). Default is YES...
+
++ (void) setEnabled:(BOOL)inEnabled;
++ (BOOL) isEnabled;
+
+// Returns YES if the format is enabled and the whole tree consists of plain IMBNode instances (subclasses like 
+// IMBFlickrNode encode additional properties and must use keyed archiving)...
+
++ (BOOL) canArchiveNode:(IMBNode*)inNode;
+
++ (NSData*) archivedDataWithNode:(IMBNode*)inNode;
++ (IMBNode*) nodeWithArchivedData:(NSData*)inData error:(NSError**)outError;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
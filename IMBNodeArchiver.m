@@ -0,0 +1,1112 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBNodeArchiver.h"
+#import "IMBNode.h"
+#import "IMBObject.h"
+#import "IMBNodeObject.h"
+#import "IMBFolderObject.h"
+#import "IMBLightroomObject.h"
+#import "IMBSkimmableObject.h"
+#import "IMBiPhotoEventNodeObject.h"
+#import "IMBFaceNodeObject.h"
+#import "NSImage+iMedia.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+static const uint32_t kIMBNodeArchiveMagic = 'IMBA';
+static const uint32_t kIMBNodeArchiveVersion = 2;
+
+// Tags for values...
+
+enum
+{
+	kIMBArchiveNil = 0,
+	kIMBArchiveString,
+	kIMBArchiveURL,
+	kIMBArchiveInteger,
+	kIMBArchiveReal,
+	kIMBArchiveTrue,
+	kIMBArchiveFalse,
+	kIMBArchiveData,
+	kIMBArchiveDate,
+	kIMBArchiveArray,
+	kIMBArchiveDictionary,
+	kIMBArchiveKeyed
+};
+
+// Tags for objects. Besides the plain classes, the subclasses that parsers create in large numbers have their own 
+// tag, which selects the class and the extra fields that follow the common IMBObject fields...
+
+enum
+{
+	kIMBArchiveObject = 0,
+	kIMBArchiveNodeObject,
+	kIMBArchiveKeyedObject,
+	kIMBArchiveFolderObject,
+	kIMBArchiveLightroomObject,
+	kIMBArchiveEventNodeObject,
+	kIMBArchiveFaceNodeObject
+};
+
+// Node flags...
+
+enum
+{
+	kIMBArchiveIsGroupNode = 1 << 0,
+	kIMBArchiveIsTopLevelNode = 1 << 1,
+	kIMBArchiveIsLeafNode = 1 << 2,
+	kIMBArchiveIsLoading = 1 << 3,
+	kIMBArchiveIsUserAdded = 1 << 4,
+	kIMBArchiveIsIncludedInPopup = 1 << 5,
+	kIMBArchiveWantsRecursiveObjects = 1 << 6,
+	kIMBArchiveShouldDisplayObjectView = 1 << 7,
+	kIMBArchiveIsAccessRevocable = 1 << 8,
+	kIMBArchiveHasSubnodes = 1 << 9,
+	kIMBArchiveHasObjects = 1 << 10
+};
+
+// Object flags...
+
+enum
+{
+	kIMBArchiveShouldDrawAdornments = 1 << 0,
+	kIMBArchiveShouldDisableTitle = 1 << 1,
+	kIMBArchiveNeedsImageRepresentation = 1 << 2
+};
+
+static BOOL sEnabled = YES;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Implemented in IMBNode.m...
+
+@interface IMBNode (Archiving)
++ (NSImage*) iconWithSmallRepresentations:(NSImage*)inImage;
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBNodeArchiveWriter : NSObject
+{
+	NSMutableData* _body;
+	NSMutableArray* _strings;
+	NSMutableDictionary* _stringIndexes;
+	NSMutableArray* _icons;
+	CFMutableDictionaryRef _iconIndexes;
+}
+
+- (void) writeNode:(IMBNode*)inNode;
+- (NSData*) data;
+
+@end
+
+
+@implementation IMBNodeArchiveWriter
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_body = [[NSMutableData alloc] initWithCapacity:64*1024];
+		_strings = [[NSMutableArray alloc] init];
+		_stringIndexes = [[NSMutableDictionary alloc] init];
+		_icons = [[NSMutableArray alloc] init];
+		_iconIndexes = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,NULL);
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_body);
+	IMBRelease(_strings);
+	IMBRelease(_stringIndexes);
+	IMBRelease(_icons);
+	if (_iconIndexes) CFRelease(_iconIndexes);
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (void) writeUInt8:(uint8_t)inValue
+{
+	[_body appendBytes:&inValue length:1];
+}
+
+
+- (void) writeUInt32:(uint32_t)inValue
+{
+	uint32_t value = CFSwapInt32HostToLittle(inValue);
+	[_body appendBytes:&value length:4];
+}
+
+
+- (void) writeInt64:(int64_t)inValue
+{
+	uint64_t value = CFSwapInt64HostToLittle((uint64_t)inValue);
+	[_body appendBytes:&value length:8];
+}
+
+
+- (void) writeDouble:(double)inValue
+{
+	CFSwappedFloat64 value = CFConvertFloat64HostToSwapped(inValue);
+	[_body appendBytes:&value length:8];
+}
+
+
+- (void) writeBytes:(NSData*)inData
+{
+	[self writeUInt32:(uint32_t)[inData length]];
+	[_body appendData:inData];
+}
+
+
+// Strings are written as index into the string table (0 means nil)...
+
+- (void) writeString:(NSString*)inString
+{
+	if (inString == nil)
+	{
+		[self writeUInt32:0];
+		return;
+	}
+	
+	NSNumber* index = [_stringIndexes objectForKey:inString];
+	
+	if (index == nil)
+	{
+		[_strings addObject:inString];
+		index = [NSNumber numberWithUnsignedInteger:[_strings count]];
+		[_stringIndexes setObject:index forKey:inString];
+	}
+	
+	[self writeUInt32:(uint32_t)[index unsignedIntegerValue]];
+}
+
+
+// Icons are written as index into the icon table (0 means nil). The same NSImage instance is only stored once...
+
+- (void) writeIcon:(NSImage*)inIcon
+{
+	if (inIcon == nil)
+	{
+		[self writeUInt32:0];
+		return;
+	}
+	
+	uintptr_t index = (uintptr_t) CFDictionaryGetValue(_iconIndexes,inIcon);
+	
+	if (index == 0)
+	{
+		NSImage* icon = [IMBNode iconWithSmallRepresentations:inIcon];
+		NSData* data = nil;
+		
+		@try
+		{
+			data = [NSKeyedArchiver archivedDataWithRootObject:icon];
+		}
+		@catch (NSException* inException)
+		{
+			data = nil;
+		}
+		
+		[_icons addObject:data ? data : [NSData data]];
+		index = [_icons count];
+		CFDictionarySetValue(_iconIndexes,inIcon,(const void*)index);
+	}
+	
+	[self writeUInt32:(uint32_t)index];
+}
+
+
+- (void) writeKeyedValue:(id)inValue
+{
+	NSData* data = nil;
+	
+	@try
+	{
+		data = [NSKeyedArchiver archivedDataWithRootObject:inValue];
+	}
+	@catch (NSException* inException)
+	{
+		data = nil;
+	}
+	
+	if (data)
+	{
+		[self writeUInt8:kIMBArchiveKeyed];
+		[self writeBytes:data];
+	}
+	else
+	{
+		[self writeUInt8:kIMBArchiveNil];
+	}
+}
+
+
+// Property list values get their own tags, everything else is embedded as keyed archive...
+
+- (void) writeValue:(id)inValue
+{
+	if (inValue == nil)
+	{
+		[self writeUInt8:kIMBArchiveNil];
+	}
+	else if ([inValue isKindOfClass:[NSString class]])
+	{
+		[self writeUInt8:kIMBArchiveString];
+		[self writeString:inValue];
+	}
+	else if ([inValue isKindOfClass:[NSURL class]] && [inValue baseURL] == nil)
+	{
+		[self writeUInt8:kIMBArchiveURL];
+		[self writeString:[inValue absoluteString]];
+	}
+	else if ([inValue isKindOfClass:[NSNumber class]])
+	{
+		if ((CFBooleanRef)inValue == kCFBooleanTrue)
+		{
+			[self writeUInt8:kIMBArchiveTrue];
+		}
+		else if ((CFBooleanRef)inValue == kCFBooleanFalse)
+		{
+			[self writeUInt8:kIMBArchiveFalse];
+		}
+		else if (CFNumberIsFloatType((CFNumberRef)inValue))
+		{
+			[self writeUInt8:kIMBArchiveReal];
+			[self writeDouble:[inValue doubleValue]];
+		}
+		else
+		{
+			[self writeUInt8:kIMBArchiveInteger];
+			[self writeInt64:[inValue longLongValue]];
+		}
+	}
+	else if ([inValue isKindOfClass:[NSData class]])
+	{
+		[self writeUInt8:kIMBArchiveData];
+		[self writeBytes:inValue];
+	}
+	else if ([inValue isKindOfClass:[NSDate class]])
+	{
+		[self writeUInt8:kIMBArchiveDate];
+		[self writeDouble:[inValue timeIntervalSinceReferenceDate]];
+	}
+	else if ([inValue isKindOfClass:[NSArray class]])
+	{
+		[self writeUInt8:kIMBArchiveArray];
+		[self writeUInt32:(uint32_t)[inValue count]];
+		
+		for (id value in inValue)
+		{
+			[self writeValue:value];
+		}
+	}
+	else if ([inValue isKindOfClass:[NSDictionary class]])
+	{
+		BOOL hasStringKeys = YES;
+		
+		for (id key in inValue)
+		{
+			if (![key isKindOfClass:[NSString class]]) { hasStringKeys = NO; break; }
+		}
+		
+		if (hasStringKeys)
+		{
+			[self writeUInt8:kIMBArchiveDictionary];
+			[self writeUInt32:(uint32_t)[inValue count]];
+			
+			for (NSString* key in inValue)
+			{
+				[self writeString:key];
+				[self writeValue:[inValue objectForKey:key]];
+			}
+		}
+		else
+		{
+			[self writeKeyedValue:inValue];
+		}
+	}
+	else
+	{
+		[self writeKeyedValue:inValue];
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Returns the tag for the classes that the compact format knows about, or kIMBArchiveKeyedObject for all other 
+// classes (including unknown subclasses of the known ones, which may have additional properties)...
+
+- (uint8_t) tagForObject:(IMBObject*)inObject
+{
+	Class class = [inObject class];
+	
+	if (class == [IMBObject class]) return kIMBArchiveObject;
+	if (class == [IMBNodeObject class]) return kIMBArchiveNodeObject;
+	if (class == [IMBFolderObject class]) return kIMBArchiveFolderObject;
+	if (class == [IMBLightroomObject class]) return kIMBArchiveLightroomObject;
+	if (class == [IMBiPhotoEventNodeObject class]) return kIMBArchiveEventNodeObject;
+	if (class == [IMBFaceNodeObject class]) return kIMBArchiveFaceNodeObject;
+	
+	return kIMBArchiveKeyedObject;
+}
+
+
+// Objects of the known classes are written field by field. Objects of other classes and objects that already 
+// carry a thumbnail are embedded as keyed archive. The extra fields are written in the same order in which the 
+// classes decode them in -initWithCoder:, as setting the skimming index has side effects...
+
+- (void) writeObject:(IMBObject*)inObject
+{
+	uint8_t tag = [self tagForObject:inObject];
+	
+	if (tag == kIMBArchiveKeyedObject || inObject.atomic_imageRepresentation != nil)
+	{
+		[self writeUInt8:kIMBArchiveKeyedObject];
+		[self writeKeyedValue:inObject];
+		return;
+	}
+	
+	[self writeUInt8:tag];
+	
+	[self writeString:inObject.name];
+	[self writeString:inObject.identifier];
+	[self writeString:inObject.persistentResourceIdentifier];
+	[self writeString:inObject.metadataDescription];
+	[self writeString:inObject.parserIdentifier];
+	[self writeString:inObject.imageRepresentationType];
+	
+	[self writeValue:inObject.location];
+	[self writeValue:inObject.locationBookmark];
+	[self writeValue:inObject.imageLocation];
+	[self writeValue:inObject.preliminaryMetadata];
+	[self writeValue:inObject.metadata];
+	[self writeValue:inObject.error];
+	
+	[self writeInt64:(int64_t)inObject.index];
+	[self writeInt64:(int64_t)inObject.accessibility];
+	[self writeInt64:(int64_t)inObject.imageVersion];
+	
+	uint8_t flags = 0;
+	if (inObject.shouldDrawAdornments) flags |= kIMBArchiveShouldDrawAdornments;
+	if (inObject.shouldDisableTitle) flags |= kIMBArchiveShouldDisableTitle;
+	if (inObject.needsImageRepresentation) flags |= kIMBArchiveNeedsImageRepresentation;
+	[self writeUInt8:flags];
+	
+	if (tag == kIMBArchiveLightroomObject)
+	{
+		[self writeString:[(IMBLightroomObject*)inObject absolutePyramidPath]];
+		[self writeValue:[(IMBLightroomObject*)inObject idLocal]];
+	}
+	else if (tag != kIMBArchiveObject)
+	{
+		[self writeString:[(IMBNodeObject*)inObject representedNodeIdentifier]];
+	}
+	
+	// The current image key and face index are private properties of the skimmable classes...
+	
+	if (tag == kIMBArchiveEventNodeObject || tag == kIMBArchiveFaceNodeObject)
+	{
+		[self writeInt64:(int64_t)[(IMBSkimmableObject*)inObject currentSkimmingIndex]];
+		[self writeString:[inObject valueForKey:@"currentImageKey"]];
+	}
+	
+	if (tag == kIMBArchiveFaceNodeObject)
+	{
+		[self writeValue:[inObject valueForKey:@"currentFaceIndex"]];
+	}
+}
+
+
+- (void) writeNode:(IMBNode*)inNode
+{
+	[self writeString:inNode.name];
+	[self writeString:inNode.identifier];
+	[self writeString:inNode.mediaType];
+	[self writeString:inNode.parserIdentifier];
+	[self writeString:inNode.objectCountFormatSingular];
+	[self writeString:inNode.objectCountFormatPlural];
+	[self writeString:inNode.watchedPath];
+	
+	[self writeValue:inNode.mediaSource];
+	[self writeValue:inNode.attributes];
+	[self writeValue:inNode.error];
+	
+	[self writeInt64:(int64_t)inNode.groupType];
+	[self writeInt64:(int64_t)inNode.displayPriority];
+	[self writeInt64:(int64_t)inNode.displayedObjectCount];
+	[self writeInt64:(int64_t)inNode.accessibility];
+	[self writeInt64:(int64_t)inNode.watcherType];
+	
+	NSArray* subnodes = inNode.subnodes;
+	NSArray* objects = inNode.objects;
+	uint32_t flags = 0;
+	
+	if (inNode.isGroupNode) flags |= kIMBArchiveIsGroupNode;
+	if (inNode.isTopLevelNode) flags |= kIMBArchiveIsTopLevelNode;
+	if (inNode.isLeafNode) flags |= kIMBArchiveIsLeafNode;
+	if (inNode.isLoading) flags |= kIMBArchiveIsLoading;
+	if (inNode.isUserAdded) flags |= kIMBArchiveIsUserAdded;
+	if (inNode.isIncludedInPopup) flags |= kIMBArchiveIsIncludedInPopup;
+	if (inNode.wantsRecursiveObjects) flags |= kIMBArchiveWantsRecursiveObjects;
+	if (inNode.shouldDisplayObjectView) flags |= kIMBArchiveShouldDisplayObjectView;
+	if (inNode.isAccessRevocable) flags |= kIMBArchiveIsAccessRevocable;
+	if (subnodes) flags |= kIMBArchiveHasSubnodes;
+	if (objects) flags |= kIMBArchiveHasObjects;
+	[self writeUInt32:flags];
+	
+	[self writeIcon:inNode.icon];
+	[self writeIcon:inNode.highlightIcon];
+	
+	if (subnodes)
+	{
+		[self writeUInt32:(uint32_t)[subnodes count]];
+		
+		for (IMBNode* subnode in subnodes)
+		{
+			[self writeNode:subnode];
+		}
+	}
+	
+	if (objects)
+	{
+		[self writeUInt32:(uint32_t)[objects count]];
+		
+		for (IMBObject* object in objects)
+		{
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			[self writeObject:object];
+			[pool drain];
+		}
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Header, string table and icon table followed by the node tree...
+
+- (NSData*) data
+{
+	NSMutableData* data = [NSMutableData dataWithCapacity:[_body length] + 32*[_strings count] + 1024];
+	uint32_t header[4] = 
+	{ 
+		CFSwapInt32HostToLittle(kIMBNodeArchiveMagic),
+		CFSwapInt32HostToLittle(kIMBNodeArchiveVersion),
+		CFSwapInt32HostToLittle((uint32_t)[_strings count]),
+		CFSwapInt32HostToLittle((uint32_t)[_icons count])
+	};
+	
+	[data appendBytes:header length:sizeof(header)];
+	
+	// Strings are written with an explicit length, as they may contain NUL characters. A string that cannot be 
+	// represented in UTF-8 (e.g. because of an unpaired surrogate) ends up empty...
+	
+	for (NSString* string in _strings)
+	{
+		NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+		uint32_t swappedLength = CFSwapInt32HostToLittle((uint32_t)length);
+		[data appendBytes:&swappedLength length:4];
+		
+		NSUInteger offset = [data length];
+		[data increaseLengthBy:length];
+		[string getBytes:(char*)[data mutableBytes] + offset maxLength:length usedLength:NULL encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0,[string length]) remainingRange:NULL];
+	}
+	
+	for (NSData* icon in _icons)
+	{
+		uint32_t swappedLength = CFSwapInt32HostToLittle((uint32_t)[icon length]);
+		[data appendBytes:&swappedLength length:4];
+		[data appendData:icon];
+	}
+	
+	[data appendData:_body];
+	return data;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// The reader raises an exception when it runs past the end of the data, which is caught by the caller...
+
+@interface IMBNodeArchiveReader : NSObject
+{
+	const uint8_t* _bytes;
+	NSUInteger _length;
+	NSUInteger _offset;
+	NSMutableArray* _strings;
+	NSMutableArray* _icons;
+}
+
+- (id) initWithData:(NSData*)inData;
+- (BOOL) readHeader;
+- (IMBNode*) readNode;
+
+@end
+
+
+@implementation IMBNodeArchiveReader
+
+
+- (id) initWithData:(NSData*)inData
+{
+	if ((self = [super init]))
+	{
+		_bytes = (const uint8_t*) [inData bytes];
+		_length = [inData length];
+		_offset = 0;
+		_strings = [[NSMutableArray alloc] init];
+		_icons = [[NSMutableArray alloc] init];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_strings);
+	IMBRelease(_icons);
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (const uint8_t*) _consume:(NSUInteger)inLength
+{
+	if (inLength > _length - _offset)
+	{
+		[NSException raise:NSRangeException format:@"Unexpected end of node archive"];
+	}
+	
+	const uint8_t* bytes = _bytes + _offset;
+	_offset += inLength;
+	return bytes;
+}
+
+
+- (uint8_t) readUInt8
+{
+	return *[self _consume:1];
+}
+
+
+- (uint32_t) readUInt32
+{
+	uint32_t value;
+	memcpy(&value,[self _consume:4],4);
+	return CFSwapInt32LittleToHost(value);
+}
+
+
+- (int64_t) readInt64
+{
+	uint64_t value;
+	memcpy(&value,[self _consume:8],8);
+	return (int64_t) CFSwapInt64LittleToHost(value);
+}
+
+
+- (double) readDouble
+{
+	CFSwappedFloat64 value;
+	memcpy(&value,[self _consume:8],8);
+	return CFConvertFloat64SwappedToHost(value);
+}
+
+
+- (NSData*) readBytes
+{
+	uint32_t length = [self readUInt32];
+	return [NSData dataWithBytes:[self _consume:length] length:length];
+}
+
+
+- (NSString*) readString
+{
+	uint32_t index = [self readUInt32];
+	if (index == 0) return nil;
+	
+	if (index > [_strings count])
+	{
+		[NSException raise:NSRangeException format:@"Invalid string index in node archive"];
+	}
+	
+	return [_strings objectAtIndex:index-1];
+}
+
+
+- (NSImage*) readIcon
+{
+	uint32_t index = [self readUInt32];
+	if (index == 0) return nil;
+	
+	if (index > [_icons count])
+	{
+		[NSException raise:NSRangeException format:@"Invalid icon index in node archive"];
+	}
+	
+	id icon = [_icons objectAtIndex:index-1];
+	return (icon != [NSNull null]) ? icon : nil;
+}
+
+
+- (id) readKeyedValue
+{
+	NSData* data = [self readBytes];
+	id value = nil;
+	
+	@try
+	{
+		value = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+	}
+	@catch (NSException* inException)
+	{
+		value = nil;
+	}
+	
+	return value;
+}
+
+
+// Containers are always returned mutable, as NSKeyedUnarchiver did for the mutable dictionaries that most 
+// parsers use for metadata...
+
+- (id) readValue
+{
+	uint8_t tag = [self readUInt8];
+	
+	switch (tag)
+	{
+		case kIMBArchiveNil:
+			return nil;
+			
+		case kIMBArchiveString:
+			return [self readString];
+			
+		case kIMBArchiveURL:
+		{
+			NSString* string = [self readString];
+			return string ? [NSURL URLWithString:string] : nil;
+		}
+			
+		case kIMBArchiveInteger:
+			return [NSNumber numberWithLongLong:[self readInt64]];
+			
+		case kIMBArchiveReal:
+			return [NSNumber numberWithDouble:[self readDouble]];
+			
+		case kIMBArchiveTrue:
+			return [NSNumber numberWithBool:YES];
+			
+		case kIMBArchiveFalse:
+			return [NSNumber numberWithBool:NO];
+			
+		case kIMBArchiveData:
+			return [self readBytes];
+			
+		case kIMBArchiveDate:
+			return [NSDate dateWithTimeIntervalSinceReferenceDate:[self readDouble]];
+			
+		case kIMBArchiveArray:
+		{
+			uint32_t count = [self readUInt32];
+			NSMutableArray* array = [NSMutableArray arrayWithCapacity:MIN(count,1024)];
+			
+			for (uint32_t i=0; i<count; i++)
+			{
+				id value = [self readValue];
+				if (value) [array addObject:value];
+			}
+			
+			return array;
+		}
+			
+		case kIMBArchiveDictionary:
+		{
+			uint32_t count = [self readUInt32];
+			NSMutableDictionary* dictionary = [NSMutableDictionary dictionaryWithCapacity:MIN(count,1024)];
+			
+			for (uint32_t i=0; i<count; i++)
+			{
+				NSString* key = [self readString];
+				id value = [self readValue];
+				if (key && value) [dictionary setObject:value forKey:key];
+			}
+			
+			return dictionary;
+		}
+			
+		case kIMBArchiveKeyed:
+			return [self readKeyedValue];
+	}
+	
+	[NSException raise:NSInternalInconsistencyException format:@"Unknown value tag %d in node archive",(int)tag];
+	return nil;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (BOOL) readHeader
+{
+	uint32_t magic = [self readUInt32];
+	uint32_t version = [self readUInt32];
+	if (magic != kIMBNodeArchiveMagic || version != kIMBNodeArchiveVersion) return NO;
+	
+	uint32_t stringCount = [self readUInt32];
+	uint32_t iconCount = [self readUInt32];
+	
+	for (uint32_t i=0; i<stringCount; i++)
+	{
+		uint32_t length = [self readUInt32];
+		const uint8_t* utf8 = [self _consume:length];
+		NSString* string = [[NSString alloc] initWithBytes:utf8 length:length encoding:NSUTF8StringEncoding];
+		[_strings addObject:string ? (id)string : (id)@""];
+		[string release];
+	}
+	
+	for (uint32_t i=0; i<iconCount; i++)
+	{
+		NSData* data = [self readBytes];
+		NSImage* icon = nil;
+		
+		@try
+		{
+			icon = [data length] ? [NSKeyedUnarchiver unarchiveObjectWithData:data] : nil;
+		}
+		@catch (NSException* inException)
+		{
+			icon = [NSImage imb_sharedGenericFolderIcon];
+		}
+		
+		[_icons addObject:icon ? (id)icon : (id)[NSNull null]];
+	}
+	
+	return YES;
+}
+
+
+- (IMBObject*) readObject
+{
+	uint8_t tag = [self readUInt8];
+	
+	if (tag == kIMBArchiveKeyedObject)
+	{
+		uint8_t valueTag = [self readUInt8];
+		return (valueTag == kIMBArchiveKeyed) ? [self readKeyedValue] : nil;
+	}
+	
+	Class class = Nil;
+	
+	switch (tag)
+	{
+		case kIMBArchiveObject: class = [IMBObject class]; break;
+		case kIMBArchiveNodeObject: class = [IMBNodeObject class]; break;
+		case kIMBArchiveFolderObject: class = [IMBFolderObject class]; break;
+		case kIMBArchiveLightroomObject: class = [IMBLightroomObject class]; break;
+		case kIMBArchiveEventNodeObject: class = [IMBiPhotoEventNodeObject class]; break;
+		case kIMBArchiveFaceNodeObject: class = [IMBFaceNodeObject class]; break;
+	}
+	
+	if (class == Nil)
+	{
+		[NSException raise:NSInternalInconsistencyException format:@"Unknown object tag %d in node archive",(int)tag];
+	}
+	
+	IMBObject* object = [[[class alloc] init] autorelease];
+	
+	object.name = [self readString];
+	object.identifier = [self readString];
+	object.persistentResourceIdentifier = [self readString];
+	object.metadataDescription = [self readString];
+	object.parserIdentifier = [self readString];
+	object.imageRepresentationType = [self readString];
+	
+	object.location = [self readValue];
+	object.locationBookmark = [self readValue];
+	object.imageLocation = [self readValue];
+	object.preliminaryMetadata = [self readValue];
+	object.metadata = [self readValue];
+	object.error = [self readValue];
+	
+	object.index = (NSUInteger) [self readInt64];
+	object.accessibility = (IMBResourceAccessibility) [self readInt64];
+	object.imageVersion = (NSUInteger) [self readInt64];
+	
+	uint8_t flags = [self readUInt8];
+	object.shouldDrawAdornments = (flags & kIMBArchiveShouldDrawAdornments) != 0;
+	object.shouldDisableTitle = (flags & kIMBArchiveShouldDisableTitle) != 0;
+	object.needsImageRepresentation = (flags & kIMBArchiveNeedsImageRepresentation) != 0;
+	
+	if (tag == kIMBArchiveLightroomObject)
+	{
+		[(IMBLightroomObject*)object setAbsolutePyramidPath:[self readString]];
+		[(IMBLightroomObject*)object setIdLocal:[self readValue]];
+	}
+	else if (tag != kIMBArchiveObject)
+	{
+		[(IMBNodeObject*)object setRepresentedNodeIdentifier:[self readString]];
+	}
+	
+	if (tag == kIMBArchiveEventNodeObject || tag == kIMBArchiveFaceNodeObject)
+	{
+		[(IMBSkimmableObject*)object setCurrentSkimmingIndex:(NSUInteger)[self readInt64]];
+		[object setValue:[self readString] forKey:@"currentImageKey"];
+	}
+	
+	if (tag == kIMBArchiveFaceNodeObject)
+	{
+		[object setValue:[self readValue] forKey:@"currentFaceIndex"];
+	}
+	
+	return object;
+}
+
+
+- (IMBNode*) readNode
+{
+	IMBNode* node = [[[IMBNode alloc] init] autorelease];
+	
+	node.name = [self readString];
+	node.identifier = [self readString];
+	node.mediaType = [self readString];
+	node.parserIdentifier = [self readString];
+	node.objectCountFormatSingular = [self readString];
+	node.objectCountFormatPlural = [self readString];
+	node.watchedPath = [self readString];
+	
+	node.mediaSource = [self readValue];
+	node.attributes = [self readValue];
+	node.error = [self readValue];
+	
+	node.groupType = (NSUInteger) [self readInt64];
+	node.displayPriority = (NSUInteger) [self readInt64];
+	node.displayedObjectCount = (NSInteger) [self readInt64];
+	node.accessibility = (IMBResourceAccessibility) [self readInt64];
+	node.watcherType = (IMBWatcherType) [self readInt64];
+	
+	uint32_t flags = [self readUInt32];
+	node.isGroupNode = (flags & kIMBArchiveIsGroupNode) != 0;
+	node.isTopLevelNode = (flags & kIMBArchiveIsTopLevelNode) != 0;
+	node.isLeafNode = (flags & kIMBArchiveIsLeafNode) != 0;
+	node.isLoading = (flags & kIMBArchiveIsLoading) != 0;
+	node.isUserAdded = (flags & kIMBArchiveIsUserAdded) != 0;
+	node.isIncludedInPopup = (flags & kIMBArchiveIsIncludedInPopup) != 0;
+	node.wantsRecursiveObjects = (flags & kIMBArchiveWantsRecursiveObjects) != 0;
+	node.shouldDisplayObjectView = (flags & kIMBArchiveShouldDisplayObjectView) != 0;
+	node.isAccessRevocable = (flags & kIMBArchiveIsAccessRevocable) != 0;
+	
+	node.icon = [self readIcon];
+	node.highlightIcon = [self readIcon];
+	
+	if (flags & kIMBArchiveHasSubnodes)
+	{
+		uint32_t count = [self readUInt32];
+		NSMutableArray* subnodes = [NSMutableArray arrayWithCapacity:MIN(count,1024)];
+		
+		for (uint32_t i=0; i<count; i++)
+		{
+			[subnodes addObject:[self readNode]];
+		}
+		
+		node.subnodes = subnodes;
+	}
+	
+	if (flags & kIMBArchiveHasObjects)
+	{
+		uint32_t count = [self readUInt32];
+		NSMutableArray* objects = [NSMutableArray arrayWithCapacity:MIN(count,65536)];
+		
+		for (uint32_t i=0; i<count; i++)
+		{
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			IMBObject* object = [self readObject];
+			if (object) [objects addObject:object];
+			[pool drain];
+		}
+		
+		node.objects = objects;
+	}
+	
+	return node;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBNodeArchiver
+
+
++ (void) setEnabled:(BOOL)inEnabled
+{
+	sEnabled = inEnabled;
+}
+
+
++ (BOOL) isEnabled
+{
+	return sEnabled;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
++ (BOOL) _isPlainNodeTree:(IMBNode*)inNode
+{
+	if ([inNode class] != [IMBNode class]) return NO;
+	
+	for (IMBNode* subnode in inNode.subnodes)
+	{
+		if (![self _isPlainNodeTree:subnode]) return NO;
+	}
+	
+	return YES;
+}
+
+
++ (BOOL) canArchiveNode:(IMBNode*)inNode
+{
+	return sEnabled && inNode != nil && [self _isPlainNodeTree:inNode];
+}
+
+
++ (NSData*) archivedDataWithNode:(IMBNode*)inNode
+{
+	if (inNode == nil) return nil;
+	
+	IMBNodeArchiveWriter* writer = [[IMBNodeArchiveWriter alloc] init];
+	[writer writeNode:inNode];
+	NSData* data = [[writer data] retain];
+	[writer release];
+	
+	return [data autorelease];
+}
+
+
++ (IMBNode*) nodeWithArchivedData:(NSData*)inData error:(NSError**)outError
+{
+	IMBNodeArchiveReader* reader = [[IMBNodeArchiveReader alloc] initWithData:inData];
+	IMBNode* node = nil;
+	NSString* reason = nil;
+	
+	@try
+	{
+		if ([reader readHeader])
+		{
+			node = [[reader readNode] retain];
+		}
+		else
+		{
+			reason = @"Unsupported node archive version";
+		}
+	}
+	@catch (NSException* inException)
+	{
+		reason = [inException reason];
+	}
+	
+	[reader release];
+	
+	if (outError)
+	{
+		NSDictionary* info = reason ? [NSDictionary dictionaryWithObjectsAndKeys:reason,NSLocalizedDescriptionKey,nil] : nil;
+		*outError = node ? nil : [NSError errorWithDomain:kIMBErrorDomain code:kIMBErrorInvalidState userInfo:info];
+	}
+	
+	return [node autorelease];
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
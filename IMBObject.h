@@ -63,6 +63,7 @@
 #import <Quartz/Quartz.h>
 #import "IMBCommon.h"
 #import "IMBImageItem.h"
+#import "IMBThumbnailScheduler.h"
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -72,6 +73,11 @@
 
 extern NSString* kIMBObjectPasteboardType;
 
+// Posted on the main thread (with the object as the notification object) once metadata that was loaded lazily
+// has been stored in an object...
+
+extern NSString* kIMBObjectDidLoadMetadataNotification;
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -198,10 +204,17 @@ extern NSString* kIMBObjectPasteboardType;
 
 @interface IMBObject (LazyLoading)
 
-- (void) loadThumbnail;	
+- (void) loadThumbnail;									// Same as kIMBThumbnailPriorityVisible
+- (void) loadThumbnailWithPriority:(IMBThumbnailPriority)inPriority;
+- (void) cancelThumbnailLoading;
 - (void) unloadThumbnail;
 - (BOOL) isLoadingThumbnail;
 
+// Loads thumbnails for several objects (preferably in display order). Requests are sent to the parser messengers
+// in small batches, so results arrive in chunks...
+
++ (void) loadThumbnailsForObjects:(NSArray*)inObjects priority:(IMBThumbnailPriority)inPriority;
+
 - (void) loadMetadata; 
 - (void) unloadMetadata;
 
@@ -90,6 +90,7 @@
 #import "IMBOperationQueue.h"
 #import "IMBObjectThumbnailLoadOperation.h"
 #import "IMBObjectFifoCache.h"
+#import "IMBThumbnailScheduler.h"
 #import "IMBParserController.h"
 #import "NSString+iMedia.h"
 #import "NSFileManager+iMedia.h"
@@ -108,7 +109,7 @@
 #pragma mark CONSTANTS
 
 NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
-
+NSString* kIMBObjectDidLoadMetadataNotification = @"IMBObjectDidLoadMetadata";
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -119,6 +120,11 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 - (NSURL*) _URLByRequestingAndResolvingBookmark;
 @end
 
+@interface IMBObject (ThumbnailScheduler)
+- (void) _didLoadThumbnailWithObject:(IMBObject*)inPopulatedObject error:(NSError*)inError;
+- (void) _didCancelThumbnailLoading;
+@end
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -463,14 +469,15 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 }
 
 
-// When this method is called we assume that the object is about to be displayed. 
-// So this could be a  possible hook for lazily loading thumbnail and metadata...
+// When this method is called the object may be about to be displayed, but IKImageBrowserView also asks for
+// items it merely prefetches. So the request only gets background priority here. The object view controllers
+// raise it for objects that are actually on screen (see -_requestThumbnailsForVisibleRange:)...
 
 - (id) imageRepresentation
 {
 	if (self.needsImageRepresentation)
 	{
-		[self loadThumbnail];
+		[self loadThumbnailWithPriority:kIMBThumbnailPriorityBackground];
 	}
 	
 	return [[_imageRepresentation retain] autorelease];
@@ -561,7 +568,8 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 {
 	// If we want a URL, we need to request the bookmark and resolve it, or the sandbox will interfere...
 	
-	if ((self.accessibility == kIMBResourceIsAccessible) && [inType isEqualToString:(NSString*)kUTTypeFileURL])
+	if ((self.accessibility == kIMBResourceIsAccessible || self.accessibility == kIMBResourceAccessibilityUnknown) && 
+		[inType isEqualToString:(NSString*)kUTTypeFileURL])
 	{
         NSURL* url = [self _URLByRequestingAndResolvingBookmark];
         if (url) [inItem setString:[url absoluteString] forType:(NSString*)kUTTypeFileURL];
@@ -593,7 +601,9 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 
 - (NSURL*) previewItemURL
 {
-	if (self.accessibility == kIMBResourceIsAccessible || self.accessibility == kIMBResourceIsAccessibleSecurityScoped)
+	if (self.accessibility == kIMBResourceIsAccessible || 
+		self.accessibility == kIMBResourceIsAccessibleSecurityScoped || 
+		self.accessibility == kIMBResourceAccessibilityUnknown)
 	{
         return [self _URLByRequestingAndResolvingBookmark];
 	}
@@ -650,43 +660,88 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 }
 
 
-// If the image representation isn't available yet, then trigger asynchronous loading. When the results come in,
-// copy the properties from the incoming object. Do not replace the old object here, as that would unecessarily
-// upset the NSArrayController. Redrawing of the view will be triggered automatically...
+// If the image representation isn't available yet, then trigger asynchronous loading. Requests go through the 
+// IMBThumbnailScheduler, which batches them and serves objects on screen first. When the results come in, copy 
+// the properties from the incoming object. Do not replace the old object here, as that would unecessarily upset 
+// the NSArrayController. Redrawing of the view will be triggered automatically...
 
 - (void) loadThumbnail
 {
-	if (self.needsImageRepresentation && !self.isLoadingThumbnail)
+	[self loadThumbnailWithPriority:kIMBThumbnailPriorityVisible];
+}
+
+
+// A pending request may be asked again with a higher priority (e.g. when a prefetched object scrolls into view)...
+
+- (void) loadThumbnailWithPriority:(IMBThumbnailPriority)inPriority
+{
+	IMBThumbnailScheduler* scheduler = [IMBThumbnailScheduler sharedScheduler];
+	
+	if (self.needsImageRepresentation)
 	{
-		_isLoadingThumbnail = YES;
-		
-		IMBParserMessenger* messenger = self.parserMessenger;
-		SBPerformSelectorAsync(messenger.connection,
-                               messenger,
-                               @selector(loadThumbnailAndMetadataForObject:error:),
-                               self,
-                               dispatch_get_main_queue(),
+		if (!_isLoadingThumbnail)
+		{
+			_isLoadingThumbnail = YES;
+			[scheduler scheduleObject:self priority:inPriority];
+		}
+		else if ([NSThread isMainThread] && [scheduler isScheduledObject:self])
+		{
+			[scheduler scheduleObject:self priority:inPriority];
+		}
+	}
+}
+
+
+// Convenience method for views that know which objects just became visible (in display order)...
+
++ (void) loadThumbnailsForObjects:(NSArray*)inObjects priority:(IMBThumbnailPriority)inPriority
+{
+	for (IMBObject* object in inObjects)
+	{
+		[object loadThumbnailWithPriority:inPriority];
+	}
+}
+
+
+// Withdraw a pending request (e.g. because the object scrolled out of view). Requests that are already in 
+// flight are not affected...
+
+- (void) cancelThumbnailLoading
+{
+	[[IMBThumbnailScheduler sharedScheduler] cancelObject:self];
+}
+
+
+- (void) _didCancelThumbnailLoading
+{
+	_isLoadingThumbnail = NO;
+}
+
+
+- (void) _didLoadThumbnailWithObject:(IMBObject*)inPopulatedObject error:(NSError*)inError
+{
+	if (inError)
+	{
+		NSLog(@"%s Error trying to load thumbnail of IMBObject %@ (%@)",__FUNCTION__,self.name,inError);
 		
-			^(IMBObject* inPopulatedObject,NSError* inError)
-			{
-				if (inError)
-				{
-					NSLog(@"%s Error trying to load thumbnail of IMBObject %@ (%@)",__FUNCTION__,self.name,inError);
-                    
-                    self.accessibility = kIMBResourceDoesNotExist;
-					self.error = inError;
-				}
-				else {
-					self.error = inPopulatedObject.error;
-				}
-				
-                self.accessibility = inPopulatedObject.accessibility;
-                self.imageRepresentationType = inPopulatedObject.imageRepresentationType;
-                [self storeReceivedImageRepresentation:inPopulatedObject.atomic_imageRepresentation];
-                if (self.metadata == nil) self.metadata = inPopulatedObject.metadata;
-                if (self.metadataDescription == nil) self.metadataDescription = inPopulatedObject.metadataDescription;
-                _isLoadingThumbnail = NO;
-			});
+		self.accessibility = kIMBResourceDoesNotExist;
+		self.error = inError;
+	}
+	else 
+	{
+		self.error = inPopulatedObject.error;
+		self.accessibility = inPopulatedObject.accessibility;
+	}
+	
+	self.imageRepresentationType = inPopulatedObject.imageRepresentationType;
+	[self storeReceivedImageRepresentation:inPopulatedObject.atomic_imageRepresentation];
+	if (self.metadataDescription == nil) self.metadataDescription = inPopulatedObject.metadataDescription;
+	_isLoadingThumbnail = NO;
+	
+	if (self.metadata == nil && inPopulatedObject.metadata != nil)
+	{
+		self.metadata = inPopulatedObject.metadata;
+		[[NSNotificationCenter defaultCenter] postNotificationName:kIMBObjectDidLoadMetadataNotification object:self];
 	}
 }
 
@@ -695,6 +750,7 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 
 - (void) unloadThumbnail
 {
+	[self cancelThumbnailLoading];
 	self.imageRepresentation = nil;
 }
 
@@ -732,6 +788,9 @@ NSString* kIMBObjectPasteboardType = @"com.karelia.imedia.IMBObject";
 				{
 					self.metadata = inPopulatedObject.metadata;
 					self.metadataDescription = inPopulatedObject.metadataDescription;
+					self.accessibility = inPopulatedObject.accessibility;
+					[IMBObjectFifoCache addObject:self];
+					[[NSNotificationCenter defaultCenter] postNotificationName:kIMBObjectDidLoadMetadataNotification object:self];
 				}
 			});
 	}
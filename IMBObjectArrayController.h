@@ -53,6 +53,7 @@
 #pragma mark CLASSES
 
 @class IMBObject;
+@class IMBObjectSearchIndex;
 @protocol IMBObjectArrayControllerDelegate;
 
 #pragma mark 
@@ -64,11 +65,22 @@
 	NSString* _searchString;
 	id <IMBObjectArrayControllerDelegate> _delegate;
 	id _newObject;
+	
+	IMBObjectSearchIndex* _searchIndex;		// Only accessed on _searchQueue
+	dispatch_queue_t _searchQueue;
+	volatile NSUInteger _searchGeneration;
+	NSDictionary* _searchResult;
+	NSArray* _arrangedContent;
+	CFMutableSetRef _contentObjects;		// By pointer, not retained
+	CFMutableSetRef _changedObjects;		// By pointer, retained until the next search
 }
 
 @property (nonatomic, assign) IBOutlet id <IMBObjectArrayControllerDelegate> delegate;
 
-// Filtering...
+// Filtering. Searching uses a trigram index of the searchable properties, which is built once per content and then
+// updated incrementally (with objects that were appended or replaced, and objects that posted 
+// kIMBObjectDidLoadMetadataNotification while being part of the content). Large contents are searched on a background queue, and a search that is still running is
+// cancelled when the user keeps typing...
 
 @property (retain) NSArray* searchableProperties;
 @property (retain) NSString* searchString;
@@ -53,6 +53,7 @@
 #pragma mark HEADERS
 
 #import "IMBObjectArrayController.h"
+#import "IMBObjectSearchIndex.h"
 #import "IMBObject.h"
 #import "IMBNodeObject.h"
 #import "IMBParser.h"
@@ -66,6 +67,80 @@
 
 const NSString* kSearchStringContext = @"searchString";
 
+// Contents with at least this many objects are searched on a background queue...
+
+static const NSUInteger kIMBAsynchronousSearchThreshold = 2000;
+
+static NSString* kIMBSearchResultObjectsKey = @"objects";
+static NSString* kIMBSearchResultStringKey = @"searchString";
+static NSString* kIMBSearchResultMatchesKey = @"matches";
+static NSString* kIMBSearchResultUnindexedKey = @"unindexed";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Content arrays are often recreated with the same objects, so compare them element by element (by pointer). This 
+// is cheap compared to anything else we do with the content...
+
+static BOOL IMBContentStartsWithContent(NSArray* inContent,NSArray* inPrefix)
+{
+	NSUInteger count = [inPrefix count];
+	if ([inContent count] < count) return NO;
+	
+	for (NSUInteger i=0; i<count; i++)
+	{
+		if ([inContent objectAtIndex:i] != [inPrefix objectAtIndex:i]) return NO;
+	}
+	
+	return YES;
+}
+
+
+static BOOL IMBIsSameContent(NSArray* inContent1,NSArray* inContent2)
+{
+	if (inContent1 == inContent2) return YES;
+	if (inContent1 == nil || inContent2 == nil) return NO;
+	if ([inContent1 count] != [inContent2 count]) return NO;
+	
+	return IMBContentStartsWithContent(inContent1,inContent2);
+}
+
+
+// Creates a set that compares objects by pointer, just like the content comparisons above...
+
+static CFMutableSetRef IMBCreateObjectSet(BOOL inRetainsObjects)
+{
+	CFSetCallBacks callbacks = kCFTypeSetCallBacks;
+	callbacks.equal = NULL;
+	callbacks.hash = NULL;
+	
+	if (!inRetainsObjects)
+	{
+		callbacks.retain = NULL;
+		callbacks.release = NULL;
+	}
+	
+	return CFSetCreateMutable(kCFAllocatorDefault,0,&callbacks);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBObjectArrayController ()
+
+- (BOOL) _object:(IMBObject*)inObject matchesSearchString:(NSString*)inSearchString;
+- (dispatch_queue_t) _searchQueue;
+- (NSArray*) _takeChangedObjects;
+- (NSIndexSet*) _indexesOfObjects:(NSArray*)inObjects keyPaths:(NSArray*)inKeyPaths changedObjects:(NSArray*)inChangedObjects matchingString:(NSString*)inSearchString unindexedIndexes:(NSIndexSet**)outUnindexedIndexes isCancelled:(BOOL(^)(void))inIsCancelled;
+- (NSIndexSet*) _indexesOfObjects:(NSArray*)inObjects matchingString:(NSString*)inSearchString unindexedIndexes:(NSIndexSet**)outUnindexedIndexes;
+- (void) _startSearchingObjects:(NSArray*)inObjects;
+
+@end
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -96,14 +171,27 @@ const NSString* kSearchStringContext = @"searchString";
 - (void) awakeFromNib
 {
 	[self addObserver:self forKeyPath:@"searchString" options:0 context:(void*)kSearchStringContext];
+	
+	[[NSNotificationCenter defaultCenter]
+		addObserver:self 
+		selector:@selector(_objectDidLoadMetadata:) 
+		name:kIMBObjectDidLoadMetadataNotification 
+		object:nil];
 }
 
 
 - (void) dealloc
 {
+	[[NSNotificationCenter defaultCenter] removeObserver:self name:kIMBObjectDidLoadMetadataNotification object:nil];
 	[self removeObserver:self forKeyPath:@"searchString"];
+	if (_contentObjects) CFRelease(_contentObjects);
+	if (_changedObjects) CFRelease(_changedObjects);
 	IMBRelease(_searchableProperties);
 	IMBRelease(_searchString);
+	IMBRelease(_searchIndex);
+	IMBRelease(_searchResult);
+	IMBRelease(_arrangedContent);
+	if (_searchQueue) dispatch_release(_searchQueue);
 	[super dealloc];
 }
 
@@ -147,6 +235,73 @@ const NSString* kSearchStringContext = @"searchString";
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// When a paged population appends objects to the current node, the new content starts with the old content.
+// In this case we rearrange, but restore the selected objects afterwards, so that the user doesn't lose the 
+// selection each time another page of objects arrives. We also remember which objects belong to the content, so
+// that only their metadata changes are passed on to the search index...
+
+- (void) setContent:(id)inContent
+{
+	NSArray* oldContent = [self content];
+	NSUInteger oldCount = [oldContent count];
+	BOOL isArray = [inContent isKindOfClass:[NSArray class]];
+	BOOL isAppending = NO;
+	
+	if (oldCount > 0 && isArray && [inContent count] > oldCount)
+	{
+		isAppending = IMBContentStartsWithContent(inContent,oldContent);
+	}
+	
+	NSArray* selectedObjects = isAppending ? [[self selectedObjects] retain] : nil;
+	[super setContent:inContent];
+	
+	if (isAppending)
+	{
+		[self setSelectedObjects:selectedObjects];
+		[selectedObjects release];
+	}
+	
+	if (_contentObjects == NULL) _contentObjects = IMBCreateObjectSet(NO);
+	if (!isAppending) CFSetRemoveAllValues(_contentObjects);
+	
+	if (isArray)
+	{
+		for (NSUInteger i=(isAppending ? oldCount : 0); i<[inContent count]; i++)
+		{
+			CFSetAddValue(_contentObjects,[inContent objectAtIndex:i]);
+		}
+	}
+}
+
+
+// Metadata of an object in our content has been loaded. Remember it, so that the next search reindexes it. This
+// way the search index never has to ask every object whether it has changed...
+
+- (void) _objectDidLoadMetadata:(NSNotification*)inNotification
+{
+	id object = [inNotification object];
+	
+	if (_contentObjects && CFSetContainsValue(_contentObjects,object))
+	{
+		if (_changedObjects == NULL) _changedObjects = IMBCreateObjectSet(YES);
+		CFSetAddValue(_changedObjects,object);
+	}
+}
+
+
+- (NSArray*) _takeChangedObjects
+{
+	if (_changedObjects == NULL || CFSetGetCount(_changedObjects) == 0) return nil;
+	
+	NSArray* objects = [(NSSet*)_changedObjects allObjects];
+	CFSetRemoveAllValues(_changedObjects);
+	return objects;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 // Set default values, and keep reference to new object -- see arrangeObjects:
 
 - (id) newObject
@@ -196,7 +351,7 @@ const NSString* kSearchStringContext = @"searchString";
 		// Also add any newly-created object unconditionally:
 		// (a) You'll get an error if a newly-added object isn't added to arrangedObjects.
 		// (b) The user will see newly-added objects even if they don't match the search term.
-		// (c) The search is not case-sensitive.
+		// (c) The search is neither case nor diacritic sensitive (custom metadata values decide for themselves).
 		
 		NSMutableArray* matchedObjects = [NSMutableArray arrayWithCapacity:[inObjects count]];
 /*
@@ -231,15 +386,83 @@ const NSString* kSearchStringContext = @"searchString";
 */			
 		
 		
-		for (IMBObject* object in inObjects)
+		// Find the objects that match the search string. If a background search for this content and search 
+		// string has finished, then use its result. Large contents are searched in the background, while the 
+		// previous result stays visible (or nothing, if the content has changed). Everything else is searched 
+		// right away...
+		
+		NSIndexSet* indexes = nil;
+		NSIndexSet* unindexedIndexes = nil;
+		
+		if (searching)
+		{
+			NSString* resultString = [_searchResult objectForKey:kIMBSearchResultStringKey];
+			NSArray* resultObjects = [_searchResult objectForKey:kIMBSearchResultObjectsKey];
+			
+			if ([resultString isEqualToString:_searchString] && IMBIsSameContent(resultObjects,inObjects))
+			{
+				indexes = [_searchResult objectForKey:kIMBSearchResultMatchesKey];
+				unindexedIndexes = [_searchResult objectForKey:kIMBSearchResultUnindexedKey];
+			}
+			else if ([inObjects count] >= kIMBAsynchronousSearchThreshold && _newObject == nil)
+			{
+				[self _startSearchingObjects:inObjects];
+				
+				if (IMBIsSameContent(_arrangedContent,inObjects)) return [self arrangedObjects];
+				
+				IMBRelease(_arrangedContent);
+				_arrangedContent = [inObjects retain];
+				return [NSArray array];
+			}
+			else
+			{
+				indexes = [self _indexesOfObjects:inObjects matchingString:_searchString unindexedIndexes:&unindexedIndexes];
+			}
+			
+			// Objects that could not be indexed (custom metadata values) are checked the old way. The same 
+			// goes for a newly created object, which is always added...
+			
+			NSMutableIndexSet* candidates = [[indexes mutableCopy] autorelease];
+			NSUInteger i = [unindexedIndexes firstIndex];
+			
+			while (i != NSNotFound)
+			{
+				if ([self _object:[inObjects objectAtIndex:i] matchesSearchString:_searchString]) [candidates addIndex:i];
+				i = [unindexedIndexes indexGreaterThanIndex:i];
+			}
+			
+			if (_newObject)
+			{
+				NSUInteger newObjectIndex = [inObjects indexOfObjectIdenticalTo:_newObject];
+				if (newObjectIndex != NSNotFound) [candidates addIndex:newObjectIndex];
+			}
+			
+			indexes = candidates;
+		}
+		else
+		{
+			_searchGeneration++;	// Cancel background search
+			IMBRelease(_searchResult);
+			indexes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0,[inObjects count])];
+		}
+		
+		IMBRelease(_arrangedContent);
+		_arrangedContent = [inObjects retain];
+		
+		NSUInteger i = [indexes firstIndex];
+		
+		while (i != NSNotFound)
 		{
 			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
-
+			IMBObject* object = [inObjects objectAtIndex:i];
+			i = [indexes indexGreaterThanIndex:i];
+			
 			// First check whether object passes our delegate's filter
 			// (e.g. used to display badged objects only)
 			
 			if (_delegate && ![object isKindOfClass:[IMBNodeObject class]] && ![_delegate objectArrayController:self filterObject:object])
 			{
+				[pool drain];
 				continue;
 			}
 			
@@ -247,59 +470,152 @@ const NSString* kSearchStringContext = @"searchString";
 			// This way an object can be customized or made more rich...
 			
 			id proxy = hasProxyForObject ? [_delegate proxyForObject:object] : object;
+			[matchedObjects addObject:proxy];
+			if (object == _newObject) _newObject = nil;
 			
-			// If the object has just been created, add it unconditionally...
-			
-			if (object == _newObject)
+			[pool drain];
+		}
+		
+		return [super arrangeObjects:matchedObjects];
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// Search all properties of an object. Please note that we need to check for the existance of a property 
+// (value!=nil) BEFORE checking rangeOfString: or a nil value will provide us with a positive match. 
+// This would yield way to many false results...
+
+- (BOOL) _object:(IMBObject*)inObject matchesSearchString:(NSString*)inSearchString
+{
+	for (NSString* key in _searchableProperties)
+	{
+		id value = [inObject valueForKeyPath:key];
+
+		// We don't test for implementation of the search filtering method, because 
+		// runtime querying for every object could be expensive. The previous contract was
+		// that metadata values had to be NSString. The new contract is that metadata 
+		// values have to either be NSString or else implement this filter message.
+		//
+		// NOTE also that if the client has a custom metadata type. we won't even make assumptions
+		// about whether they want the lowercase string or not, we'll just let them dictate
+		// the entire matching policy based on the user's input string.
+		
+		if (value != nil && [value imb_matchesSearchFilterString:inSearchString])
+		{
+			return YES;
+		}
+	}
+	
+	return NO;
+}
+
+
+// The search index is only accessed on this serial queue, which is created lazily...
+
+- (dispatch_queue_t) _searchQueue
+{
+	if (_searchQueue == NULL)
+	{
+		_searchQueue = dispatch_queue_create("com.karelia.imedia.IMBObjectArrayController.search",NULL);
+	}
+	
+	return _searchQueue;
+}
+
+
+// Must only be called on the search queue. The index is kept around, so that it can be updated incrementally for
+// the next keystroke (or when more objects are appended to the content, or metadata has been loaded)...
+
+- (NSIndexSet*) _indexesOfObjects:(NSArray*)inObjects keyPaths:(NSArray*)inKeyPaths changedObjects:(NSArray*)inChangedObjects matchingString:(NSString*)inSearchString unindexedIndexes:(NSIndexSet**)outUnindexedIndexes isCancelled:(BOOL(^)(void))inIsCancelled
+{
+	if (_searchIndex == nil || ![_searchIndex.keyPaths isEqualToArray:inKeyPaths])
+	{
+		IMBRelease(_searchIndex);
+		_searchIndex = [[IMBObjectSearchIndex alloc] initWithKeyPaths:inKeyPaths];
+	}
+	
+	[_searchIndex updateWithObjects:inObjects];
+	[_searchIndex reindexObjects:inChangedObjects];
+	return [_searchIndex indexesOfObjectsMatchingString:inSearchString unindexedIndexes:outUnindexedIndexes isCancelled:inIsCancelled];
+}
+
+
+// Searches the objects right away. This waits for a background search that may still be running...
+
+- (NSIndexSet*) _indexesOfObjects:(NSArray*)inObjects matchingString:(NSString*)inSearchString unindexedIndexes:(NSIndexSet**)outUnindexedIndexes
+{
+	__block NSIndexSet* indexes = nil;
+	__block NSIndexSet* unindexedIndexes = nil;
+	NSArray* changedObjects = [self _takeChangedObjects];
+	
+	_searchGeneration++;	// Cancel background search
+	
+	dispatch_sync([self _searchQueue],^()
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		indexes = [[self _indexesOfObjects:inObjects keyPaths:_searchableProperties changedObjects:changedObjects matchingString:inSearchString unindexedIndexes:&unindexedIndexes isCancelled:nil] retain];
+		[unindexedIndexes retain];
+		[pool drain];
+	});
+	
+	if (outUnindexedIndexes) *outUnindexedIndexes = [unindexedIndexes autorelease];
+	else [unindexedIndexes release];
+	return [indexes autorelease];
+}
+
+
+// Searches the objects on a background queue. Starting a new search cancels the previous one. When the result 
+// comes in, it is stored and the objects are rearranged, which will then pick up the result...
+
+- (void) _startSearchingObjects:(NSArray*)inObjects
+{
+	NSUInteger generation = ++_searchGeneration;
+	NSArray* objects = [[inObjects copy] autorelease];
+	NSArray* keyPaths = [[_searchableProperties copy] autorelease];
+	NSString* searchString = [[_searchString copy] autorelease];
+	NSArray* changedObjects = [self _takeChangedObjects];
+	
+	dispatch_async([self _searchQueue],^()
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		NSIndexSet* unindexedIndexes = nil;
+		
+		NSIndexSet* indexes = [self 
+			_indexesOfObjects:objects 
+			keyPaths:keyPaths 
+			changedObjects:changedObjects 
+			matchingString:searchString 
+			unindexedIndexes:&unindexedIndexes 
+			isCancelled:^BOOL()
 			{
-				[matchedObjects addObject:proxy];
-				_newObject = nil;
-			}
-			
-			// Search all properties in the array. Please note that we need to check for the existance of a property 
-			// (value!=nil) BEFORE checking rangeOfString: or a nil value will provide us with a positive match. 
-			// This would yield way to many false results...
+				return generation != _searchGeneration;
+			}];
+		
+		if (indexes)
+		{
+			NSDictionary* result = [NSDictionary dictionaryWithObjectsAndKeys:
+				objects,kIMBSearchResultObjectsKey,
+				searchString,kIMBSearchResultStringKey,
+				indexes,kIMBSearchResultMatchesKey,
+				unindexedIndexes,kIMBSearchResultUnindexedKey,
+				nil];
 			
-			else if (searching)
+			dispatch_async(dispatch_get_main_queue(),^()
 			{
-				NSString* value;
-				BOOL foundMatch = NO;
-				
-				for (NSString* key in _searchableProperties)
+				if (generation == _searchGeneration)
 				{
-					value = [object valueForKeyPath:key];
-
-					if (value != nil)
-					{
-						// We don't test for implementation of the search filtering method, because 
-						// runtime querying for every object could be expensive. The previous contract was
-						// that metadata values had to be NSString. The new contract is that metadata 
-						// values have to either be NSString or else implement this filter message.
-						//
-						// NOTE also that if the client has a custom metadata type. we won't even make assumptions
-						// about whether they want the lowercase string or not, we'll just let them dictate
-						// the entire matching policy based on the user's input string.
-						
-						foundMatch = [value imb_matchesSearchFilterString:_searchString];
-					}
-					
-					if (foundMatch)
-					{
-						[matchedObjects addObject:proxy];
-						break;
-					}
+					[_searchResult release];
+					_searchResult = [result retain];
+					[self rearrangeObjects];
 				}
-			}
-			else
-			{
-				[matchedObjects addObject:proxy];
-			}
-				
-			[pool drain];
+			});
 		}
 		
-		return [super arrangeObjects:matchedObjects];
-	}
+		[pool drain];
+	});
 }
 
 
@@ -56,27 +56,70 @@
 #pragma mark CLASSES
 
 @class IMBObject;
+struct IMBObjectCacheEntry;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Keys for the dictionary returned by +statistics...
+
+extern NSString* const kIMBObjectCacheHitsKey;
+extern NSString* const kIMBObjectCacheMissesKey;
+extern NSString* const kIMBObjectCacheThumbnailEvictionsKey;
+extern NSString* const kIMBObjectCacheMetadataEvictionsKey;
+extern NSString* const kIMBObjectCacheCountKey;
+extern NSString* const kIMBObjectCacheThumbnailBytesKey;
+extern NSString* const kIMBObjectCacheMetadataBytesKey;
 
 
 //----------------------------------------------------------------------------------------------------------------------
 
 
 // IMBObjectFifoCache implements a cache of limited size that automatically unloads the thumbnails/metadata   
-// of the oldest IMBObjects in the cache, so that we do not consume too much memory and start swapping...
+// of the least recently used IMBObjects in the cache, so that we do not consume too much memory and start 
+// swapping. Objects are keyed by identity and kept in two intrusive doubly linked lists (one for thumbnails,
+// one for metadata), so touching or evicting an object is O(1). Each list is limited by a budget expressed 
+// in (estimated) decoded bytes. The old object count limit is still honored as an upper bound per list...
 
 @interface IMBObjectFifoCache : NSObject
 {
-	NSMutableArray* _objects;
+	CFMutableDictionaryRef _entries;
+	struct IMBObjectCacheEntry* _thumbnailHead;
+	struct IMBObjectCacheEntry* _thumbnailTail;
+	struct IMBObjectCacheEntry* _metadataHead;
+	struct IMBObjectCacheEntry* _metadataTail;
+	NSUInteger _thumbnailBytes;
+	NSUInteger _metadataBytes;
+	NSUInteger _thumbnailCount;
+	NSUInteger _metadataCount;
+	NSUInteger _hits;
+	NSUInteger _misses;
+	NSUInteger _thumbnailEvictions;
+	NSUInteger _metadataEvictions;
 }
 
 + (void) setSize:(NSUInteger)inSize;	
 + (NSUInteger) size;
 
++ (void) setThumbnailBudget:(NSUInteger)inBytes;
++ (NSUInteger) thumbnailBudget;
+
++ (void) setMetadataBudget:(NSUInteger)inBytes;
++ (NSUInteger) metadataBudget;
+
 + (void) addObject:(IMBObject*)inObject;
 + (void) removeObject:(IMBObject*)inObject;
 + (void) removeAllObjects;
 
 + (NSUInteger) count;
++ (NSUInteger) thumbnailBytes;
+
+// Returns hit/miss/eviction counters and the current byte usage (see keys above)...
+
++ (NSDictionary*) statistics;
 
 @end
 
@@ -63,9 +63,156 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark CONSTANTS
+
+NSString* const kIMBObjectCacheHitsKey = @"hits";
+NSString* const kIMBObjectCacheMissesKey = @"misses";
+NSString* const kIMBObjectCacheThumbnailEvictionsKey = @"thumbnailEvictions";
+NSString* const kIMBObjectCacheMetadataEvictionsKey = @"metadataEvictions";
+NSString* const kIMBObjectCacheCountKey = @"count";
+NSString* const kIMBObjectCacheThumbnailBytesKey = @"thumbnailBytes";
+NSString* const kIMBObjectCacheMetadataBytesKey = @"metadataBytes";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark GLOBALS
 
 static NSUInteger sCacheSize = 512;
+static NSUInteger sThumbnailBudget = 128 * 1024 * 1024;
+static NSUInteger sMetadataBudget = 16 * 1024 * 1024;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark TYPES
+
+// A cache entry is linked into the thumbnail list and/or the metadata list. The lists are ordered from least 
+// recently used (head) to most recently used (tail). The entry retains its object...
+
+typedef struct IMBObjectCacheEntry
+{
+	IMBObject* object;
+	struct IMBObjectCacheEntry* thumbnailPrev;
+	struct IMBObjectCacheEntry* thumbnailNext;
+	struct IMBObjectCacheEntry* metadataPrev;
+	struct IMBObjectCacheEntry* metadataNext;
+	NSUInteger thumbnailCost;
+	NSUInteger metadataCost;
+	void* thumbnailSource;		// Identity of the measured image representation (not retained)
+	void* metadataSource;		// Identity of the measured metadata dictionary (not retained)
+	BOOL inThumbnailList;
+	BOOL inMetadataList;
+}
+IMBObjectCacheEntry;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Cost Estimation
+
+// Estimate how many bytes a thumbnail occupies once it has been decoded. Compressed data and urls are counted
+// at their own size, since the decoded version is owned (and cached) by IKImageBrowserView rather than by us...
+
+static NSUInteger _IMBThumbnailCost(id inImageRepresentation)
+{
+	if (inImageRepresentation == nil)
+	{
+		return 0;
+	}
+	
+	if (CFGetTypeID((CFTypeRef)inImageRepresentation) == CGImageGetTypeID())
+	{
+		CGImageRef image = (CGImageRef)inImageRepresentation;
+		return CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+	}
+	
+	if ([inImageRepresentation isKindOfClass:[NSImage class]])
+	{
+		NSUInteger cost = 0;
+		
+		for (NSImageRep* rep in [(NSImage*)inImageRepresentation representations])
+		{
+			cost += (NSUInteger)[rep pixelsWide] * (NSUInteger)[rep pixelsHigh] * 4;
+		}
+		
+		if (cost == 0)
+		{
+			NSSize size = [(NSImage*)inImageRepresentation size];
+			cost = (NSUInteger)(size.width * size.height * 4.0);
+		}
+		
+		return cost;
+	}
+	
+	if ([inImageRepresentation isKindOfClass:[NSData class]])
+	{
+		return [(NSData*)inImageRepresentation length];
+	}
+	
+	if ([inImageRepresentation isKindOfClass:[NSURL class]])
+	{
+		return [[(NSURL*)inImageRepresentation absoluteString] length] * sizeof(unichar);
+	}
+	
+	if ([inImageRepresentation isKindOfClass:[NSString class]])
+	{
+		return [(NSString*)inImageRepresentation length] * sizeof(unichar);
+	}
+	
+	return 1024;
+}
+
+
+// Rough estimate of the memory consumed by a metadata property list...
+
+static NSUInteger _IMBMetadataCost(id inValue)
+{
+	if (inValue == nil)
+	{
+		return 0;
+	}
+	
+	if ([inValue isKindOfClass:[NSString class]])
+	{
+		return 32 + [(NSString*)inValue length] * sizeof(unichar);
+	}
+	
+	if ([inValue isKindOfClass:[NSData class]])
+	{
+		return 32 + [(NSData*)inValue length];
+	}
+	
+	if ([inValue isKindOfClass:[NSDictionary class]])
+	{
+		NSUInteger cost = 48;
+		
+		for (id key in (NSDictionary*)inValue)
+		{
+			cost += 16 + _IMBMetadataCost(key) + _IMBMetadataCost([(NSDictionary*)inValue objectForKey:key]);
+		}
+		
+		return cost;
+	}
+	
+	if ([inValue isKindOfClass:[NSArray class]])
+	{
+		NSUInteger cost = 32;
+		
+		for (id value in (NSArray*)inValue)
+		{
+			cost += 8 + _IMBMetadataCost(value);
+		}
+		
+		return cost;
+	}
+	
+	return 32;
+}
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -79,6 +226,9 @@ static NSUInteger sCacheSize = 512;
 //----------------------------------------------------------------------------------------------------------------------
 
 
+// The object count limit is kept for backwards compatibility. It is only an upper bound now, as the byte 
+// budgets below are usually reached much earlier...
+
 + (void) setSize:(NSUInteger)inSize
 {
 	sCacheSize = inSize;
@@ -91,6 +241,30 @@ static NSUInteger sCacheSize = 512;
 }
 
 
++ (void) setThumbnailBudget:(NSUInteger)inBytes
+{
+	sThumbnailBudget = inBytes;
+}
+
+
++ (NSUInteger) thumbnailBudget
+{
+	return sThumbnailBudget;
+}
+
+
++ (void) setMetadataBudget:(NSUInteger)inBytes
+{
+	sMetadataBudget = inBytes;
+}
+
+
++ (NSUInteger) metadataBudget
+{
+	return sMetadataBudget;
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
@@ -108,11 +282,14 @@ static NSUInteger sCacheSize = 512;
 }
 
 
+// The dictionary maps object pointers to cache entries. NULL callbacks give us identity semantics 
+// (no -hash or -isEqual: calls) and leave memory management of keys and values to us...
+
 - (id) init
 {
 	if (self = [super init])
 	{
-		_objects = [[NSMutableArray alloc] initWithCapacity:sCacheSize];
+		_entries = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,NULL);
 	}
 	
 	return self;
@@ -121,7 +298,8 @@ static NSUInteger sCacheSize = 512;
 
 - (void) dealloc
 {
-	IMBRelease(_objects);
+	[self _removeAllEntries];
+	if (_entries) CFRelease(_entries);
 	[super dealloc];
 }
 
@@ -130,20 +308,112 @@ static NSUInteger sCacheSize = 512;
 
 
 #pragma mark 
+#pragma mark List Helpers
 
-// Keep removing the oldest objects (lowest indexes) until the array no longer exceeds the cache size...
 
-- (void) _removeOldestObjects
+- (void) _unlinkThumbnailEntry:(IMBObjectCacheEntry*)inEntry
 {
-	if (_objects != nil)
+	if (!inEntry->inThumbnailList) return;
+	
+	if (inEntry->thumbnailPrev) inEntry->thumbnailPrev->thumbnailNext = inEntry->thumbnailNext;
+	else _thumbnailHead = inEntry->thumbnailNext;
+	
+	if (inEntry->thumbnailNext) inEntry->thumbnailNext->thumbnailPrev = inEntry->thumbnailPrev;
+	else _thumbnailTail = inEntry->thumbnailPrev;
+
+	inEntry->thumbnailPrev = NULL;
+	inEntry->thumbnailNext = NULL;
+	inEntry->inThumbnailList = NO;
+	_thumbnailBytes -= inEntry->thumbnailCost;
+	_thumbnailCount--;
+	inEntry->thumbnailCost = 0;
+}
+
+
+- (void) _appendThumbnailEntry:(IMBObjectCacheEntry*)inEntry cost:(NSUInteger)inCost
+{
+	inEntry->thumbnailPrev = _thumbnailTail;
+	inEntry->thumbnailNext = NULL;
+	
+	if (_thumbnailTail) _thumbnailTail->thumbnailNext = inEntry;
+	else _thumbnailHead = inEntry;
+	
+	_thumbnailTail = inEntry;
+	inEntry->inThumbnailList = YES;
+	inEntry->thumbnailCost = inCost;
+	_thumbnailBytes += inCost;
+	_thumbnailCount++;
+}
+
+
+- (void) _unlinkMetadataEntry:(IMBObjectCacheEntry*)inEntry
+{
+	if (!inEntry->inMetadataList) return;
+	
+	if (inEntry->metadataPrev) inEntry->metadataPrev->metadataNext = inEntry->metadataNext;
+	else _metadataHead = inEntry->metadataNext;
+	
+	if (inEntry->metadataNext) inEntry->metadataNext->metadataPrev = inEntry->metadataPrev;
+	else _metadataTail = inEntry->metadataPrev;
+
+	inEntry->metadataPrev = NULL;
+	inEntry->metadataNext = NULL;
+	inEntry->inMetadataList = NO;
+	_metadataBytes -= inEntry->metadataCost;
+	_metadataCount--;
+	inEntry->metadataCost = 0;
+}
+
+
+- (void) _appendMetadataEntry:(IMBObjectCacheEntry*)inEntry cost:(NSUInteger)inCost
+{
+	inEntry->metadataPrev = _metadataTail;
+	inEntry->metadataNext = NULL;
+	
+	if (_metadataTail) _metadataTail->metadataNext = inEntry;
+	else _metadataHead = inEntry;
+	
+	_metadataTail = inEntry;
+	inEntry->inMetadataList = YES;
+	inEntry->metadataCost = inCost;
+	_metadataBytes += inCost;
+	_metadataCount++;
+}
+
+
+// Once an entry is no longer part of either list, it is removed from the dictionary and freed...
+
+- (void) _releaseEntryIfUnused:(IMBObjectCacheEntry*)inEntry
+{
+	if (!inEntry->inThumbnailList && !inEntry->inMetadataList)
 	{
-		while ([_objects count] > sCacheSize)
-		{
-			IMBObject* object = [_objects objectAtIndex:0];
-			[object unloadThumbnail];
-			[object unloadMetadata];
-			[_objects removeObjectAtIndex:0];
-		}
+		CFDictionaryRemoveValue(_entries,inEntry->object);
+		[inEntry->object release];
+		free(inEntry);
+	}
+}
+
+
+- (void) _removeAllEntries
+{
+	IMBObjectCacheEntry* entry = _thumbnailHead;
+	
+	while (entry)
+	{
+		IMBObjectCacheEntry* next = entry->thumbnailNext;
+		[self _unlinkThumbnailEntry:entry];
+		[self _releaseEntryIfUnused:entry];
+		entry = next;
+	}
+	
+	entry = _metadataHead;
+	
+	while (entry)
+	{
+		IMBObjectCacheEntry* next = entry->metadataNext;
+		[self _unlinkMetadataEntry:entry];
+		[self _releaseEntryIfUnused:entry];
+		entry = next;
 	}
 }
 
@@ -151,22 +421,83 @@ static NSUInteger sCacheSize = 512;
 //----------------------------------------------------------------------------------------------------------------------
 
 
-// Add a new object to the end of the array. If we now exceed the cache size, then bump the oldest  
-// objects off the cache...
+#pragma mark 
+
+// Keep evicting the least recently used thumbnails and metadata until we are back within budget. The most 
+// recently used entry is never evicted, even if it exceeds the budget all by itself...
+
+- (void) _removeOldestObjects
+{
+	while (_thumbnailHead != NULL && _thumbnailHead != _thumbnailTail && 
+		  (_thumbnailBytes > sThumbnailBudget || _thumbnailCount > sCacheSize))
+	{
+		IMBObjectCacheEntry* entry = _thumbnailHead;
+		IMBObject* object = [entry->object retain];
+		[self _unlinkThumbnailEntry:entry];
+		[self _releaseEntryIfUnused:entry];
+		[object unloadThumbnail];
+		[object release];
+		_thumbnailEvictions++;
+	}
+
+	while (_metadataHead != NULL && _metadataHead != _metadataTail && 
+		  (_metadataBytes > sMetadataBudget || _metadataCount > sCacheSize))
+	{
+		IMBObjectCacheEntry* entry = _metadataHead;
+		IMBObject* object = [entry->object retain];
+		[self _unlinkMetadataEntry:entry];
+		[self _releaseEntryIfUnused:entry];
+		[object unloadMetadata];
+		[object release];
+		_metadataEvictions++;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
 
+// Move the object to the most recently used end of both lists (or add it if it is not in the cache yet). 
+// Costs are only computed when a thumbnail or metadata dictionary enters the cache. Touching an object again
+// reuses the stored cost, unless its thumbnail or metadata has been replaced in the meantime. If we now exceed 
+// a budget, then bump the least recently used objects off the cache...
 
 - (void) _addObject:(IMBObject*)inObject
 {
-    // Do not add an object that is already in the cache (e.g. when skimming)
-    // (Instead just move it to the end of the cache so it is "last out")
-    
-    NSUInteger index = [_objects indexOfObjectIdenticalTo:inObject];
-    
-    [inObject retain];
-    if (index != NSNotFound) [_objects removeObjectAtIndex:index];
-    [_objects addObject:inObject];
-    [inObject release];
-    
+	if (inObject == nil) return;
+	
+	IMBObjectCacheEntry* entry = (IMBObjectCacheEntry*) CFDictionaryGetValue(_entries,inObject);
+	
+	if (entry)
+	{
+		_hits++;
+	}
+	else
+	{
+		_misses++;
+		entry = (IMBObjectCacheEntry*) calloc(1,sizeof(IMBObjectCacheEntry));
+		entry->object = [inObject retain];
+		CFDictionarySetValue(_entries,inObject,entry);
+	}
+	
+	id imageRepresentation = inObject.imageRepresentation;
+	NSDictionary* metadata = inObject.metadata;
+	
+	BOOL isSameThumbnail = entry->inThumbnailList && entry->thumbnailSource == (void*)imageRepresentation;
+	BOOL isSameMetadata = entry->inMetadataList && entry->metadataSource == (void*)metadata;
+	NSUInteger thumbnailCost = isSameThumbnail ? entry->thumbnailCost : _IMBThumbnailCost(imageRepresentation);
+	NSUInteger metadataCost = isSameMetadata ? entry->metadataCost : _IMBMetadataCost(metadata);
+	
+	[self _unlinkThumbnailEntry:entry];
+	[self _unlinkMetadataEntry:entry];
+	
+	entry->thumbnailSource = (void*)imageRepresentation;
+	entry->metadataSource = (void*)metadata;
+	
+	if (imageRepresentation) [self _appendThumbnailEntry:entry cost:thumbnailCost];
+	if (metadata) [self _appendMetadataEntry:entry cost:metadataCost];
+	
+	[self _releaseEntryIfUnused:entry];
     [self _removeOldestObjects];
 }
 
@@ -185,20 +516,20 @@ static NSUInteger sCacheSize = 512;
 
 #pragma mark 
 
-// Remove the given object from the cache. Please note that it may be in the cache multiple times. All 
-// occurences are removed...
+// Remove the given object from the cache and unload its thumbnail and metadata...
 
 - (void) _removeObject:(IMBObject*)inObject
 {
 	[inObject unloadThumbnail];
 	[inObject unloadMetadata];
 
-	if (_objects != nil)
+	IMBObjectCacheEntry* entry = (IMBObjectCacheEntry*) CFDictionaryGetValue(_entries,inObject);
+	
+	if (entry)
 	{
-		while ([_objects indexOfObject:inObject])
-		{
-			[_objects removeObject:inObject];
-		}
+		[self _unlinkThumbnailEntry:entry];
+		[self _unlinkMetadataEntry:entry];
+		[self _releaseEntryIfUnused:entry];
 	}
 }
 
@@ -219,8 +550,22 @@ static NSUInteger sCacheSize = 512;
 
 - (void) _removeAllObjects
 {
-	[_objects makeObjectsPerformSelector:@selector(unloadThumbnail)];
-	[_objects makeObjectsPerformSelector:@selector(unloadMetadata)];
+	NSMutableArray* objects = [NSMutableArray arrayWithCapacity:CFDictionaryGetCount(_entries)];
+	
+	for (IMBObjectCacheEntry* entry = _thumbnailHead; entry; entry = entry->thumbnailNext)
+	{
+		[objects addObject:entry->object];
+	}
+	
+	for (IMBObjectCacheEntry* entry = _metadataHead; entry; entry = entry->metadataNext)
+	{
+		if (!entry->inThumbnailList) [objects addObject:entry->object];
+	}
+	
+	[self _removeAllEntries];
+	
+	[objects makeObjectsPerformSelector:@selector(unloadThumbnail)];
+	[objects makeObjectsPerformSelector:@selector(unloadMetadata)];
 }
 
 
@@ -238,27 +583,76 @@ static NSUInteger sCacheSize = 512;
 
 #pragma mark 
 
-// Returns the current count of objects in the cache...
+// All state is owned by the main thread. Queries from other threads are forwarded synchronously, while 
+// queries on the main thread are answered directly (a dispatch_sync to our own queue would deadlock)...
 
-- (NSUInteger) _count
++ (void) _performOnMainThread:(void(^)(IMBObjectFifoCache* inCache))inBlock
 {
-	return [_objects count];
+	if ([NSThread isMainThread])
+	{
+		inBlock([self sharedCache]);
+	}
+	else
+	{
+		dispatch_sync(dispatch_get_main_queue(),^()
+		{
+			inBlock([self sharedCache]);
+		});
+	}
 }
 
 
+// Returns the current count of objects in the cache...
+
 + (NSUInteger) count
 {
 	__block NSUInteger count = 0;
 
-	dispatch_sync(dispatch_get_main_queue(),^()
+	[self _performOnMainThread:^(IMBObjectFifoCache* inCache)
 	{
-		count = [[self sharedCache] _count];
-	});
+		count = (NSUInteger) CFDictionaryGetCount(inCache->_entries);
+	}];
 
 	return count;
 }
 
 
+// Returns the estimated number of bytes currently occupied by cached thumbnails...
+
++ (NSUInteger) thumbnailBytes
+{
+	__block NSUInteger bytes = 0;
+
+	[self _performOnMainThread:^(IMBObjectFifoCache* inCache)
+	{
+		bytes = inCache->_thumbnailBytes;
+	}];
+
+	return bytes;
+}
+
+
++ (NSDictionary*) statistics
+{
+	__block NSDictionary* statistics = nil;
+
+	[self _performOnMainThread:^(IMBObjectFifoCache* inCache)
+	{
+		statistics = [[NSDictionary alloc] initWithObjectsAndKeys:
+			[NSNumber numberWithUnsignedInteger:inCache->_hits],kIMBObjectCacheHitsKey,
+			[NSNumber numberWithUnsignedInteger:inCache->_misses],kIMBObjectCacheMissesKey,
+			[NSNumber numberWithUnsignedInteger:inCache->_thumbnailEvictions],kIMBObjectCacheThumbnailEvictionsKey,
+			[NSNumber numberWithUnsignedInteger:inCache->_metadataEvictions],kIMBObjectCacheMetadataEvictionsKey,
+			[NSNumber numberWithUnsignedInteger:(NSUInteger)CFDictionaryGetCount(inCache->_entries)],kIMBObjectCacheCountKey,
+			[NSNumber numberWithUnsignedInteger:inCache->_thumbnailBytes],kIMBObjectCacheThumbnailBytesKey,
+			[NSNumber numberWithUnsignedInteger:inCache->_metadataBytes],kIMBObjectCacheMetadataBytesKey,
+			nil];
+	}];
+
+	return [statistics autorelease];
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
@@ -0,0 +1,113 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// IMBObjectSearchIndex speeds up filtering of a (possibly very large) array of objects by a search string. For each 
+// object the values of the searchable key paths are folded (case and diacritic insensitive) and broken into trigrams.
+// A query then only needs to check objects that contain all trigrams of the search string. If the search string
+// extends the previous one, only the previous matches (plus objects that were added or changed since) are checked.
+//
+// The index is maintained incrementally: objects appended to the array are simply added, objects that replaced 
+// another one take over its slot, and objects that the caller reports as changed are reindexed. The index never 
+// asks the objects themselves whether they have changed. Values that are neither strings nor arrays of strings cannot 
+// be indexed, so these objects are reported separately and must be checked by the caller. An index is not thread-safe, but it may be 
+// used from any thread, as long as it is only used from one thread at a time...
+
+@interface IMBObjectSearchIndex : NSObject
+{
+	NSArray* _keyPaths;
+	NSMutableArray* _objects;
+	NSMutableArray* _texts;
+	CFMutableDictionaryRef _postings;
+	NSMutableIndexSet* _unindexedIndexes;
+	NSMutableIndexSet* _changedIndexes;
+	NSString* _lastSearchString;
+	NSIndexSet* _lastMatchingIndexes;
+}
+
+- (id) initWithKeyPaths:(NSArray*)inKeyPaths;
+
+@property (readonly) NSArray* keyPaths;
+@property (readonly) NSArray* objects;
+
+// Brings the index up to date with inObjects. Objects are compared by pointer. Appended objects are added and objects 
+// that replaced another one are reindexed in place. If inObjects is shorter than the indexed objects, or most of them
+// are different, then the index is rebuilt...
+
+- (void) updateWithObjects:(NSArray*)inObjects;
+
+// Reindexes those of inObjects that are indexed, e.g. because their metadata has been loaded in the meantime.
+// Other objects are ignored...
+
+- (void) reindexObjects:(id<NSFastEnumeration>)inObjects;
+
+// Returns the indexes of all indexed objects that match inSearchString. Objects that could not be indexed are
+// returned in outUnindexedIndexes. Returns nil if inIsCancelled returns YES during the search...
+
+- (NSIndexSet*) indexesOfObjectsMatchingString:(NSString*)inSearchString 
+	unindexedIndexes:(NSIndexSet**)outUnindexedIndexes 
+	isCancelled:(BOOL(^)(void))inIsCancelled;
+
+// Returns the case and diacritic folded variant of a string, as it is used for indexing...
+
++ (NSString*) foldedString:(NSString*)inString;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,495 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBObjectSearchIndex.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// How often (in number of checked objects) a query asks whether it has been cancelled...
+
+#define kIMBSearchIndexCancellationInterval 1024
+
+// Separates the values of an object in its searchable text...
+
+static NSString* kIMBSearchIndexValueSeparator = @"\n";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// A trigram is packed into a pointer sized key. The high bit is always set, so that a key is never NULL. On 32 bit
+// the first character gets truncated, which merely leads to a few more candidates that fail the final check...
+
+static inline uintptr_t IMBTrigramKey(unichar inChar0,unichar inChar1,unichar inChar2)
+{
+	uint64_t key = (1ULL << 63) | ((uint64_t)inChar0 << 32) | ((uint64_t)inChar1 << 16) | (uint64_t)inChar2;
+	return (uintptr_t)key;
+}
+
+
+// Returns a malloced array with the trigrams of a string (in order, including duplicates). The caller must free it...
+
+static uintptr_t* IMBCreateTrigrams(NSString* inString,NSUInteger* outCount)
+{
+	NSUInteger length = [inString length];
+	*outCount = 0;
+	
+	if (length < 3) return NULL;
+	
+	unichar* chars = (unichar*) malloc(length * sizeof(unichar));
+	uintptr_t* trigrams = (uintptr_t*) malloc((length-2) * sizeof(uintptr_t));
+	[inString getCharacters:chars range:NSMakeRange(0,length)];
+	
+	for (NSUInteger i=0; i<length-2; i++)
+	{
+		trigrams[i] = IMBTrigramKey(chars[i],chars[i+1],chars[i+2]);
+	}
+	
+	free(chars);
+	*outCount = length-2;
+	return trigrams;
+}
+
+
+// Appends a searchable value to the text of an object. Returns NO if the value cannot be indexed...
+
+static BOOL IMBAppendSearchableValue(NSMutableString* ioText,id inValue)
+{
+	if (inValue == nil || inValue == [NSNull null])
+	{
+		return YES;
+	}
+	else if ([inValue isKindOfClass:[NSString class]])
+	{
+		if ([ioText length]) [ioText appendString:kIMBSearchIndexValueSeparator];
+		[ioText appendString:inValue];
+		return YES;
+	}
+	else if ([inValue isKindOfClass:[NSArray class]])
+	{
+		for (id value in (NSArray*)inValue)
+		{
+			if (!IMBAppendSearchableValue(ioText,value)) return NO;
+		}
+		
+		return YES;
+	}
+	
+	return NO;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBObjectSearchIndex ()
+
+- (void) _removeAllObjects;
+- (void) _indexObjectAtIndex:(NSUInteger)inIndex;
+- (void) _addPostingsForText:(NSString*)inText index:(NSUInteger)inIndex;
+- (void) _removePostingsForText:(NSString*)inText index:(NSUInteger)inIndex;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBObjectSearchIndex
+
+@synthesize keyPaths = _keyPaths;
+@synthesize objects = _objects;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (id) initWithKeyPaths:(NSArray*)inKeyPaths
+{
+	if (self = [super init])
+	{
+		_keyPaths = [inKeyPaths copy];
+		_objects = [[NSMutableArray alloc] init];
+		_texts = [[NSMutableArray alloc] init];
+		_postings = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,&kCFTypeDictionaryValueCallBacks);
+		_unindexedIndexes = [[NSMutableIndexSet alloc] init];
+		_changedIndexes = [[NSMutableIndexSet alloc] init];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	[self _removeAllObjects];
+	if (_postings) CFRelease(_postings);
+	
+	IMBRelease(_keyPaths);
+	IMBRelease(_objects);
+	IMBRelease(_texts);
+	IMBRelease(_unindexedIndexes);
+	IMBRelease(_changedIndexes);
+	IMBRelease(_lastSearchString);
+	IMBRelease(_lastMatchingIndexes);
+	
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Indexing
+
+
++ (NSString*) foldedString:(NSString*)inString
+{
+	return [inString stringByFoldingWithOptions:NSCaseInsensitiveSearch|NSDiacriticInsensitiveSearch locale:nil];
+}
+
+
+- (void) updateWithObjects:(NSArray*)inObjects
+{
+	NSUInteger oldCount = [_objects count];
+	NSUInteger newCount = [inObjects count];
+	
+	// Find the slots whose object has been replaced. A content that is mostly different is cheaper to rebuild, 
+	// because removing the old postings of each object costs about as much as indexing it...
+	
+	NSMutableIndexSet* replacedIndexes = [NSMutableIndexSet indexSet];
+	
+	if (newCount >= oldCount)
+	{
+		for (NSUInteger i=0; i<oldCount; i++)
+		{
+			if ([inObjects objectAtIndex:i] != [_objects objectAtIndex:i]) [replacedIndexes addIndex:i];
+		}
+	}
+	
+	if (newCount < oldCount || [replacedIndexes count] > oldCount/2)
+	{
+		[self _removeAllObjects];
+		[replacedIndexes removeAllIndexes];
+		oldCount = 0;
+	}
+	
+	NSUInteger index = [replacedIndexes firstIndex];
+	
+	while (index != NSNotFound)
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		[_objects replaceObjectAtIndex:index withObject:[inObjects objectAtIndex:index]];
+		[self _indexObjectAtIndex:index];
+		index = [replacedIndexes indexGreaterThanIndex:index];
+		[pool drain];
+	}
+	
+	// Add the new objects...
+	
+	for (NSUInteger i=oldCount; i<newCount; i++)
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		[_objects addObject:[inObjects objectAtIndex:i]];
+		[_texts addObject:[NSNull null]];
+		[self _indexObjectAtIndex:i];
+		[pool drain];
+	}
+}
+
+
+- (void) reindexObjects:(id<NSFastEnumeration>)inObjects
+{
+	CFMutableSetRef objects = CFSetCreateMutable(kCFAllocatorDefault,0,NULL);	// By pointer, not retained
+	for (id object in inObjects) CFSetAddValue(objects,object);
+	
+	if (CFSetGetCount(objects) > 0)
+	{
+		NSUInteger count = [_objects count];
+		
+		for (NSUInteger i=0; i<count; i++)
+		{
+			if (CFSetContainsValue(objects,[_objects objectAtIndex:i]))
+			{
+				NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+				[self _indexObjectAtIndex:i];
+				[pool drain];
+			}
+		}
+	}
+	
+	CFRelease(objects);
+}
+
+
+- (void) _removeAllObjects
+{
+	[_objects removeAllObjects];
+	[_texts removeAllObjects];
+	if (_postings) CFDictionaryRemoveAllValues(_postings);
+	[_unindexedIndexes removeAllIndexes];
+	[_changedIndexes removeAllIndexes];
+	IMBRelease(_lastSearchString);
+	IMBRelease(_lastMatchingIndexes);
+}
+
+
+// Collects the searchable values of an object into a single folded text and adds its trigrams to the postings.
+// The old postings are removed first, so that the postings always reflect the current text of each object...
+
+- (void) _indexObjectAtIndex:(NSUInteger)inIndex
+{
+	id object = [_objects objectAtIndex:inIndex];
+	id oldText = [_texts objectAtIndex:inIndex];
+	
+	if (oldText != [NSNull null])
+	{
+		[self _removePostingsForText:oldText index:inIndex];
+	}
+	
+	NSMutableString* text = [NSMutableString string];
+	BOOL isIndexable = YES;
+	
+	for (NSString* keyPath in _keyPaths)
+	{
+		if (!IMBAppendSearchableValue(text,[object valueForKeyPath:keyPath]))
+		{
+			isIndexable = NO;
+			break;
+		}
+	}
+	
+	if (isIndexable)
+	{
+		NSString* foldedText = [[self class] foldedString:text];
+		[_texts replaceObjectAtIndex:inIndex withObject:foldedText];
+		[self _addPostingsForText:foldedText index:inIndex];
+		[_unindexedIndexes removeIndex:inIndex];
+	}
+	else
+	{
+		[_texts replaceObjectAtIndex:inIndex withObject:[NSNull null]];
+		[_unindexedIndexes addIndex:inIndex];
+	}
+	
+	[_changedIndexes addIndex:inIndex];
+}
+
+
+- (void) _addPostingsForText:(NSString*)inText index:(NSUInteger)inIndex
+{
+	NSUInteger count = 0;
+	uintptr_t* trigrams = IMBCreateTrigrams(inText,&count);
+	
+	for (NSUInteger i=0; i<count; i++)
+	{
+		NSMutableIndexSet* indexes = (NSMutableIndexSet*) CFDictionaryGetValue(_postings,(const void*)trigrams[i]);
+		
+		if (indexes == nil)
+		{
+			indexes = [[NSMutableIndexSet alloc] init];
+			CFDictionarySetValue(_postings,(const void*)trigrams[i],indexes);
+			[indexes release];
+		}
+		
+		[indexes addIndex:inIndex];
+	}
+	
+	if (trigrams) free(trigrams);
+}
+
+
+- (void) _removePostingsForText:(NSString*)inText index:(NSUInteger)inIndex
+{
+	NSUInteger count = 0;
+	uintptr_t* trigrams = IMBCreateTrigrams(inText,&count);
+	
+	for (NSUInteger i=0; i<count; i++)
+	{
+		NSMutableIndexSet* indexes = (NSMutableIndexSet*) CFDictionaryGetValue(_postings,(const void*)trigrams[i]);
+		[indexes removeIndex:inIndex];
+	}
+	
+	if (trigrams) free(trigrams);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Searching
+
+
+// Candidates are all objects, or just the previous matches (plus changed objects) if the search string extends the
+// previous one. They are narrowed down further to objects that contain all trigrams of the search string. Only the 
+// remaining objects have their text checked for the search string...
+
+- (NSIndexSet*) indexesOfObjectsMatchingString:(NSString*)inSearchString 
+	unindexedIndexes:(NSIndexSet**)outUnindexedIndexes 
+	isCancelled:(BOOL(^)(void))inIsCancelled
+{
+	NSString* searchString = [[self class] foldedString:inSearchString ? inSearchString : @""];
+	NSUInteger count = [_objects count];
+	NSIndexSet* candidates = nil;
+	
+	if (_lastSearchString && [searchString rangeOfString:_lastSearchString options:NSLiteralSearch].location != NSNotFound)
+	{
+		NSMutableIndexSet* indexes = [[_lastMatchingIndexes mutableCopy] autorelease];
+		[indexes addIndexes:_changedIndexes];
+		candidates = indexes;
+	}
+	else
+	{
+		candidates = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0,count)];
+	}
+	
+	// Collect the postings of all distinct trigrams, smallest first. A missing trigram means there can't be a match...
+	
+	NSMutableArray* postings = [NSMutableArray array];
+	NSUInteger trigramCount = 0;
+	uintptr_t* trigrams = IMBCreateTrigrams(searchString,&trigramCount);
+	
+	for (NSUInteger i=0; i<trigramCount; i++)
+	{
+		NSIndexSet* indexes = (NSIndexSet*) CFDictionaryGetValue(_postings,(const void*)trigrams[i]);
+		
+		if ([indexes count] == 0)
+		{
+			candidates = [NSIndexSet indexSet];
+			break;
+		}
+		
+		if ([postings indexOfObjectIdenticalTo:indexes] == NSNotFound)
+		{
+			[postings addObject:indexes];
+		}
+	}
+	
+	if (trigrams) free(trigrams);
+	
+	[postings sortUsingComparator:^NSComparisonResult(NSIndexSet* inIndexes1,NSIndexSet* inIndexes2)
+	{
+		NSUInteger count1 = [inIndexes1 count];
+		NSUInteger count2 = [inIndexes2 count];
+		if (count1 < count2) return NSOrderedAscending;
+		if (count1 > count2) return NSOrderedDescending;
+		return NSOrderedSame;
+	}];
+	
+	// Walk the smaller of candidates and the smallest posting, and check the remaining objects...
+	
+	NSIndexSet* source = candidates;
+	
+	if ([candidates count] && [postings count] && [[postings objectAtIndex:0] count] < [candidates count])
+	{
+		source = [postings objectAtIndex:0];
+	}
+	
+	NSMutableIndexSet* matches = [NSMutableIndexSet indexSet];
+	__block NSUInteger checked = 0;
+	__block BOOL isCancelled = NO;
+	
+	[source enumerateIndexesUsingBlock:^(NSUInteger inIndex,BOOL* outStop)
+	{
+		if (inIsCancelled && (checked++ % kIMBSearchIndexCancellationInterval) == 0 && inIsCancelled())
+		{
+			isCancelled = YES;
+			*outStop = YES;
+			return;
+		}
+		
+		if (source != candidates && ![candidates containsIndex:inIndex]) return;
+
+		for (NSIndexSet* indexes in postings)
+		{
+			if (indexes != source && ![indexes containsIndex:inIndex]) return;
+		}
+		
+		id text = [_texts objectAtIndex:inIndex];
+		
+		if (text != [NSNull null] && 
+			([searchString length] == 0 || [text rangeOfString:searchString options:NSLiteralSearch].location != NSNotFound))
+		{
+			[matches addIndex:inIndex];
+		}
+	}];
+	
+	if (isCancelled) return nil;
+	
+	// Remember the result, so that the next query can be narrowed down if the user keeps typing...
+	
+	IMBRelease(_lastSearchString);
+	IMBRelease(_lastMatchingIndexes);
+	_lastSearchString = [searchString copy];
+	_lastMatchingIndexes = [matches copy];
+	[_changedIndexes removeAllIndexes];
+	
+	if (outUnindexedIndexes) *outUnindexedIndexes = [[_unindexedIndexes copy] autorelease];
+	return matches;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -150,6 +150,7 @@ extern NSString* kIMBObjectBadgesDidChangeNotification;
 	NSString* _objectCountFormatSingular;
 	NSString* _objectCountFormatPlural;
 	NSMutableSet* _observedVisibleItems;
+	NSSet* _thumbnailRequestedItems;
 	
 	// Event Handling...
 	
@@ -128,6 +128,7 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 - (void) _reloadListView;
 - (void) _reloadComboView;
 - (void) _updateTooltips;
+- (void) _requestThumbnailsForVisibleRange:(NSRange)inVisibleRange;
 
 @end
 
@@ -377,6 +378,7 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
     }
 	
     IMBRelease(_observedVisibleItems);
+    IMBRelease(_thumbnailRequestedItems);
 	
 	// Other cleanup...
 
@@ -1038,6 +1040,45 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 - (void) iconViewVisibleItemsChanged:(NSNotification*)inNotification
 {
 	[self _updateTooltips];
+	
+	NSIndexSet* indexes = [ibIconView visibleItemIndexes];
+	
+	if ([indexes count] > 0)
+	{
+		NSRange range = NSMakeRange([indexes firstIndex],[indexes lastIndex]-[indexes firstIndex]+1);
+		[self _requestThumbnailsForVisibleRange:range];
+	}
+}
+
+
+// Tell the thumbnail scheduler what is on screen now. Objects that are visible get top priority, the next page
+// is prefetched, and pending requests for objects that have scrolled out of view are cancelled, so that they 
+// do not hold up the objects that the user is looking at...
+
+- (void) _requestThumbnailsForVisibleRange:(NSRange)inVisibleRange
+{
+	NSArray* objects = [ibObjectArrayController arrangedObjects];
+	NSUInteger count = [objects count];
+	
+	NSUInteger visibleStart = MIN(inVisibleRange.location,count);
+	NSUInteger visibleEnd = MIN(NSMaxRange(inVisibleRange),count);
+	NSUInteger prefetchEnd = MIN(visibleEnd + (visibleEnd-visibleStart),count);
+	
+	NSArray* visibleObjects = [objects subarrayWithRange:NSMakeRange(visibleStart,visibleEnd-visibleStart)];
+	NSArray* prefetchObjects = [objects subarrayWithRange:NSMakeRange(visibleEnd,prefetchEnd-visibleEnd)];
+	NSMutableSet* requestedItems = [NSMutableSet setWithArray:visibleObjects];
+	[requestedItems addObjectsFromArray:prefetchObjects];
+	
+	for (IMBObject* object in _thumbnailRequestedItems)
+	{
+		if (![requestedItems containsObject:object]) [object cancelThumbnailLoading];
+	}
+	
+	[IMBObject loadThumbnailsForObjects:visibleObjects priority:kIMBThumbnailPriorityVisible];
+	[IMBObject loadThumbnailsForObjects:prefetchObjects priority:kIMBThumbnailPriorityPrefetch];
+	
+	[_thumbnailRequestedItems release];
+	_thumbnailRequestedItems = [requestedItems copy];
 }
 
 - (void) objectBadgesDidChange:(NSNotification*)inNotification
@@ -1423,7 +1464,15 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 	{
 		[object addObserver:self forKeyPath:kIMBObjectImageRepresentationKey options:0 context:(void*)kIMBObjectImageRepresentationKey];
      }
-	
+
+	// The combo view displays thumbnails, so request them for the visible rows (top to bottom) and prefetch 
+	// the next page...
+
+	if (inTableView == (IMBDynamicTableView*)ibComboView)
+	{
+		[self _requestThumbnailsForVisibleRange:inNewVisibleRows];
+	}
+
 	// Finally cache our old visible items set...
 	
 	[_observedVisibleItems release];
@@ -1969,7 +2018,8 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 #pragma mark Dragging
 
 
-// Filter the dragged indexes to only include the selectable (and thus draggable) ones...
+// Filter the dragged indexes to only include the selectable (and thus draggable) ones. Objects whose accessibility
+// hasn't been resolved yet are treated as accessible (parsers probe them lazily)...
 
 - (NSIndexSet*) filteredDraggingIndexes:(NSIndexSet*)inIndexes
 {
@@ -1982,7 +2032,8 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 	{
 		IMBObject* object = [objects objectAtIndex:index];
 		if (object.isSelectable && (object.accessibility == kIMBResourceIsAccessible ||
-                                    object.accessibility == kIMBResourceIsAccessibleSecurityScoped)) {
+                                    object.accessibility == kIMBResourceIsAccessibleSecurityScoped ||
+                                    object.accessibility == kIMBResourceAccessibilityUnknown)) {
             [indexes addIndex:index];
         }
 		index = [inIndexes indexGreaterThanIndex:index];
@@ -2082,7 +2133,8 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 	for (IMBObject* object in inObjects)
 	{
 		if (object.accessibility == kIMBResourceIsAccessible ||
-            object.accessibility == kIMBResourceIsAccessibleSecurityScoped)
+            object.accessibility == kIMBResourceIsAccessibleSecurityScoped ||
+            object.accessibility == kIMBResourceAccessibilityUnknown)
 		{
 			[object requestBookmarkWithCompletionBlock:^(NSError* inError)
 			{
@@ -2160,7 +2212,8 @@ static NSMutableDictionary* sRegisteredObjectViewControllerClasses = nil;
 	for (IMBObject* object in objects)
 	{
 		if (object.accessibility == kIMBResourceIsAccessible ||
-            object.accessibility == kIMBResourceIsAccessibleSecurityScoped) {
+            object.accessibility == kIMBResourceIsAccessibleSecurityScoped ||
+            object.accessibility == kIMBResourceAccessibilityUnknown) {
             [filteredObjects addObject:object];
         }
 	}
@@ -71,6 +71,20 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark CONSTANTS
+
+// Keys for the dictionary returned by -changesForNode:error:...
+
+extern NSString* const kIMBNodeChangesAddedObjectsKey;				// NSArray of IMBObjects
+extern NSString* const kIMBNodeChangesModifiedObjectsKey;			// NSArray of IMBObjects (replace objects with same location)
+extern NSString* const kIMBNodeChangesRemovedLocationsKey;			// NSArray of NSURLs (objects with these locations are removed)
+extern NSString* const kIMBNodeChangesAddedSubnodesKey;				// NSArray of IMBNodes
+extern NSString* const kIMBNodeChangesRemovedSubnodeIdentifiersKey;	// NSArray of NSStrings
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark 
 
 @interface IMBParser : NSObject
@@ -98,6 +112,19 @@
 - (BOOL) populateNode:(IMBNode*)inNode error:(NSError**)outError;
 - (IMBNode*) reloadNodeTree:(IMBNode*)inNode error:(NSError**)outError;
 
+// Parsers that can cheaply determine what changed in an already populated node (e.g. after a file system event)
+// may override this method and return a dictionary with the keys listed above. The changes are then applied to 
+// the existing node in place instead of replacing the whole node tree. An empty dictionary means that nothing 
+// has changed. The default implementation returns nil, which means that the node tree must be reloaded...
+
+- (NSDictionary*) changesForNode:(IMBNode*)inNode error:(NSError**)outError;
+
+// Parsers whose -populateNode:error: can safely be called for different nodes at the same time (i.e. that do not 
+// touch shared state without locking) may return YES here. -reloadNodeTree:error: then repopulates independent
+// subtrees in parallel. The default implementation returns NO...
+
+- (BOOL) canPopulateNodesConcurrently;
+
 // The following three methods are used to load thumbnails or metadata, or create a security-scoped bookmark for  
 // full media file access. They are called on the XPC service side...
 
@@ -105,6 +132,19 @@
 - (NSDictionary*) metadataForObject:(IMBObject*)inObject error:(NSError**)outError;
 - (NSData*) bookmarkForObject:(IMBObject*)inObject error:(NSError**)outError;
 
+// When thumbnails are requested in batches, these two methods bracket the calls to the methods above for all 
+// objects of a batch (in display order). Parsers can override them to amortize work across a batch, e.g. to 
+// fetch data for all objects with a single database query. The default implementations do nothing...
+
+- (void) willLoadThumbnailsForObjects:(NSArray*)inObjects;
+- (void) didLoadThumbnailsForObjects:(NSArray*)inObjects;
+
+// Thumbnails are cached on disk with a key derived from the object's file. Parsers that render thumbnails from a 
+// separate preview (which changes when the image is edited) should return a string describing the current state 
+// of that preview, so that edits invalidate the cached thumbnail. The default implementation returns nil...
+
+- (NSString*) thumbnailStampForObject:(IMBObject*)inObject;
+
 // Get parser's media source current accessibility status. Defaults to imb_accessibility of media source URL.
 // Override in subclass to suit other parsers' needs.
 
@@ -119,6 +159,13 @@
 
 - (IMBResourceAccessibility) accessibilityForObject:(IMBObject*)inObject;
 
+// Parsers may populate objects with kIMBResourceAccessibilityUnknown instead of probing each file. This method 
+// is then called with batches of objects (e.g. the visible ones) before their thumbnails or metadata are loaded. 
+// The default implementation probes file URLs grouped by parent directory, unless the subclass overrides
+// accessibilityForObject:, in which case that method is called for each object...
+
+- (void) resolveAccessibilityForObjects:(NSArray*)inObjects;
+
 @end
 
 
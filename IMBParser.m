@@ -68,13 +68,29 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark CONSTANTS
+
+NSString* const kIMBNodeChangesAddedObjectsKey = @"addedObjects";
+NSString* const kIMBNodeChangesModifiedObjectsKey = @"modifiedObjects";
+NSString* const kIMBNodeChangesRemovedLocationsKey = @"removedLocations";
+NSString* const kIMBNodeChangesAddedSubnodesKey = @"addedSubnodes";
+NSString* const kIMBNodeChangesRemovedSubnodeIdentifiersKey = @"removedSubnodeIdentifiers";
+
+// Set to 1 to log how long repopulating each subtree takes during -reloadNodeTree:error:...
+
+#define LOG_RELOAD_TIMES 0
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark
 
 @interface IMBParser ()
 
-- (NSArray*) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode;
-- (void) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode identifiers:(NSMutableArray*)inIdentifiers;
-- (BOOL) _populateNodeTree:(IMBNode*)inNode populatedNodeIdentifiers:(NSArray*)inPopulatedNodeIdentifiers error:(NSError**)outError;
+- (NSSet*) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode;
+- (void) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode identifiers:(NSMutableSet*)inIdentifiers;
+- (BOOL) _populateNodeTree:(IMBNode*)inNode populatedNodeIdentifiers:(NSSet*)inPopulatedNodeIdentifiers concurrently:(BOOL)inConcurrently error:(NSError**)outError;
 
 @end
 
@@ -156,7 +172,7 @@
 {
 	NSError* error = nil;
 	IMBNode* newNode = nil;
-	NSArray* identifiers = [self _identifiersOfPopulatedSubnodesOfNode:inNode];
+	NSSet* identifiers = [self _identifiersOfPopulatedSubnodesOfNode:inNode];
 
 	if (inNode.isTopLevelNode)
 	{
@@ -169,7 +185,7 @@
 	
 	if (newNode)
 	{
-		[self _populateNodeTree:newNode populatedNodeIdentifiers:identifiers error:&error];
+		[self _populateNodeTree:newNode populatedNodeIdentifiers:identifiers concurrently:[self canPopulateNodesConcurrently] error:&error];
 	}
 	
 	if (outError) *outError = error;
@@ -177,16 +193,31 @@
 }
 
 
+// By default we cannot tell what changed, so the caller will have to reload the whole node tree...
+
+- (NSDictionary*) changesForNode:(IMBNode*)inNode error:(NSError**)outError
+{
+	if (outError) *outError = nil;
+	return nil;
+}
+
+
+- (BOOL) canPopulateNodesConcurrently
+{
+	return NO;
+}
+
+
 // Gather the identifiers of all populated subnodes...
 
-- (NSArray*) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode
+- (NSSet*) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode
 {
-	NSMutableArray* identifiers = [NSMutableArray array];
+	NSMutableSet* identifiers = [NSMutableSet set];
 	[self _identifiersOfPopulatedSubnodesOfNode:inNode identifiers:identifiers];
-	return (NSArray*)identifiers;
+	return (NSSet*)identifiers;
 }
 
-- (void) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode identifiers:(NSMutableArray*)inIdentifiers
+- (void) _identifiersOfPopulatedSubnodesOfNode:(IMBNode*)inNode identifiers:(NSMutableSet*)inIdentifiers
 {
 	if (inNode.isPopulated)
 	{
@@ -200,21 +231,73 @@
 }
 
 
-// 
-- (BOOL) _populateNodeTree:(IMBNode*)inNode populatedNodeIdentifiers:(NSArray*)inPopulatedNodeIdentifiers error:(NSError**)outError
+// Repopulate the node and all its subnodes that were populated before. If requested, the subtrees below the node  
+// are repopulated in parallel (each subtree by itself is repopulated serially). Each subtree only modifies its own
+// nodes, so no locking is needed here...
+
+- (BOOL) _populateNodeTree:(IMBNode*)inNode populatedNodeIdentifiers:(NSSet*)inPopulatedNodeIdentifiers concurrently:(BOOL)inConcurrently error:(NSError**)outError
 {
 	NSError* error = nil;
 
-	if ([inPopulatedNodeIdentifiers indexOfObject:inNode.identifier] != NSNotFound)
+	if ([inPopulatedNodeIdentifiers containsObject:inNode.identifier])
 	{
 		[inNode unpopulate];
 		[self populateNode:inNode error:&error];
 		
-		if (error == nil)
+		NSMutableArray* subnodes = [NSMutableArray array];
+		
+		for (IMBNode* subnode in inNode.subnodes)
+		{
+			if ([inPopulatedNodeIdentifiers containsObject:subnode.identifier]) [subnodes addObject:subnode];
+		}
+		
+		if (error == nil && inConcurrently && [subnodes count] > 1)
 		{
-			for (IMBNode* subnode in inNode.subnodes)
+			__block NSError* firstError = nil;
+			
+			dispatch_apply([subnodes count],dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0),^(size_t i)
 			{
-				[self _populateNodeTree:subnode populatedNodeIdentifiers:inPopulatedNodeIdentifiers error:&error];
+				NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+				IMBNode* subnode = [subnodes objectAtIndex:i];
+				NSError* subtreeError = nil;
+				
+				#if LOG_RELOAD_TIMES
+				CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+				#endif
+				
+				[self _populateNodeTree:subnode populatedNodeIdentifiers:inPopulatedNodeIdentifiers concurrently:NO error:&subtreeError];
+				
+				#if LOG_RELOAD_TIMES
+				NSLog(@"%s Repopulated subtree '%@' in %.3fs",__FUNCTION__,subnode.identifier,CFAbsoluteTimeGetCurrent()-start);
+				#endif
+				
+				if (subtreeError)
+				{
+					@synchronized(subnodes)
+					{
+						if (firstError == nil) firstError = [subtreeError retain];
+					}
+				}
+				
+				[pool drain];
+			});
+			
+			error = [firstError autorelease];
+		}
+		else if (error == nil)
+		{
+			for (IMBNode* subnode in subnodes)
+			{
+				#if LOG_RELOAD_TIMES
+				CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+				#endif
+				
+				[self _populateNodeTree:subnode populatedNodeIdentifiers:inPopulatedNodeIdentifiers concurrently:NO error:&error];
+				
+				#if LOG_RELOAD_TIMES
+				if (inConcurrently) NSLog(@"%s Repopulated subtree '%@' in %.3fs",__FUNCTION__,subnode.identifier,CFAbsoluteTimeGetCurrent()-start);
+				#endif
+				
 				if (error) break;
 			}
 		}
@@ -262,6 +345,26 @@
 }
 
 
+// May be overridden by subclasses that can prepare a whole batch at once...
+
+- (void) willLoadThumbnailsForObjects:(NSArray*)inObjects
+{
+
+}
+
+
+- (void) didLoadThumbnailsForObjects:(NSArray*)inObjects
+{
+
+}
+
+
+- (NSString*) thumbnailStampForObject:(IMBObject*)inObject
+{
+	return nil;
+}
+
+
 // Get parser's media source current accessibility status. Defaults to imb_accessibility of media source URL.
 // Override in subclass to suit other parsers' needs.
 
@@ -287,6 +390,72 @@
 }
 
 
+- (void) resolveAccessibilityForObjects:(NSArray*)inObjects
+{
+	NSMutableArray* objects = [NSMutableArray arrayWithCapacity:[inObjects count]];
+	
+	for (IMBObject* object in inObjects)
+	{
+		if (object.accessibility == kIMBResourceAccessibilityUnknown) [objects addObject:object];
+	}
+	
+	if ([objects count] == 0) return;
+	
+	// Subclasses with their own notion of accessibility get asked for each object. Otherwise probe all URLs 
+	// in one go...
+	
+	NSArray* accessibilities = nil;
+	SEL selector = @selector(accessibilityForObject:);
+	
+	if ([[self class] instanceMethodForSelector:selector] != [IMBParser instanceMethodForSelector:selector])
+	{
+		NSMutableArray* values = [NSMutableArray arrayWithCapacity:[objects count]];
+		
+		for (IMBObject* object in objects)
+		{
+			[values addObject:[NSNumber numberWithUnsignedInteger:[self accessibilityForObject:object]]];
+		}
+		
+		accessibilities = values;
+	}
+	else
+	{
+		NSMutableArray* urls = [NSMutableArray arrayWithCapacity:[objects count]];
+		
+		for (IMBObject* object in objects)
+		{
+			NSURL* url = [object URL];
+			[urls addObject:url ? (id)url : (id)[NSNull null]];
+		}
+		
+		accessibilities = [NSURL imb_accessibilityForURLs:urls];
+	}
+	
+	// Only the slow part above runs in the background. The objects may be bound to the user interface, so the
+	// property itself is only ever changed on the main thread. This is done synchronously, so that callers 
+	// (e.g. the messenger, which passes the objects back to the host) see the resolved values on return...
+	
+	void (^apply)(void) = ^()
+	{
+		NSUInteger i = 0;
+		
+		for (IMBObject* object in objects)
+		{
+			object.accessibility = [[accessibilities objectAtIndex:i++] unsignedIntegerValue];
+		}
+	};
+	
+	if ([NSThread isMainThread])
+	{
+		apply();
+	}
+	else
+	{
+		dispatch_sync(dispatch_get_main_queue(),apply);
+	}
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
@@ -58,6 +58,29 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
+#pragma mark CONSTANTS
+
+// Keys for the options dictionary of -loadThumbnailsForObjects:options:error:...
+
+extern NSString* const kIMBLoadThumbnailsIncludeMetadataKey;		// NSNumber (BOOL), defaults to YES
+
+// Keys of the batch dictionary that is sent across the XPC connection (see -loadThumbnailsForBatch:error:)...
+
+extern NSString* const kIMBThumbnailBatchObjectsKey;				// NSArray of IMBObjects
+extern NSString* const kIMBThumbnailBatchOptionsKey;				// NSDictionary (optional)
+
+// Keys of the request and reply dictionaries for paged population (see -populateNodeInPages:error:)...
+
+extern NSString* const kIMBPopulatePageNodeKey;					// IMBNode
+extern NSString* const kIMBPopulatePageSizeKey;					// NSNumber (NSUInteger), 0 cancels a paged population
+extern NSString* const kIMBPopulatePageOffsetKey;				// NSNumber (NSUInteger)
+extern NSString* const kIMBPopulatePageTokenKey;				// NSString, only present if there are more objects 
+extern NSString* const kIMBPopulatePageTotalCountKey;			// NSNumber (NSUInteger)
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 #pragma mark CLASSES
 
 @class IMBNode;
@@ -136,12 +159,35 @@
 - (IMBNode*) populateNode:(IMBNode*)inNode error:(NSError**)outError;
 - (IMBNode*) reloadNodeTree:(IMBNode*)inNode error:(NSError**)outError;
 
+// Paged variant of -populateNode:error: for nodes with many objects. The reply dictionary contains the node with 
+// only the first page of objects, the total object count, and a token if more objects are left. The remaining 
+// objects are then fetched page by page with the token. A request with a page size of 0 discards them instead.
+// Both methods take a single dictionary, so that they can be sent with SBPerformSelectorAsync. Should NOT be 
+// overridden in subclasses...
+
+- (NSDictionary*) populateNodeInPages:(NSDictionary*)inRequest error:(NSError**)outError;
+- (NSArray*) objectsPage:(NSDictionary*)inRequest error:(NSError**)outError;
+
+// Returns the changes of an already populated node (see -[IMBParser changesForNode:error:]). Returns nil if the
+// parser cannot tell, in which case the node tree should be reloaded. Should NOT be overridden in subclasses...
+
+- (NSDictionary*) changesForNode:(IMBNode*)inNode error:(NSError**)outError;
+
 // Loads thumbnail (CGImageRef) and metadata (NSDictionary) for a given object. Should NOT be overridden in subclasses...
 
 - (IMBObject*) loadThumbnailForObject:(IMBObject*)inObject error:(NSError**)outError;
 - (IMBObject*) loadMetadataForObject:(IMBObject*)inObject error:(NSError**)outError;
 - (IMBObject*) loadThumbnailAndMetadataForObject:(IMBObject*)inObject error:(NSError**)outError;
 
+// Loads thumbnails (and metadata unless turned off in the options) for an ordered batch of objects, giving the 
+// parser a chance to amortize work across the batch. The returned array has the same count and order as inObjects.
+// Each element is either the loaded object or an NSError if loading failed for that particular object. The second 
+// method takes a single batch dictionary, so that it can be sent with SBPerformSelectorAsync. Should NOT be 
+// overridden in subclasses...
+
+- (NSArray*) loadThumbnailsForObjects:(NSArray*)inObjects options:(NSDictionary*)inOptions error:(NSError**)outError;
+- (NSArray*) loadThumbnailsForBatch:(NSDictionary*)inBatch error:(NSError**)outError;
+
 // Creates a security scoped bookmark for accessing the media file in the non-privilegded app process...
 
 - (NSData*) bookmarkForObject:(IMBObject*)inObject error:(NSError**)outError;
@@ -65,6 +65,43 @@
 #import "IMBConfig.h"
 #import "IMBAccessRightsController.h"
 #import "IMBAccessRightsViewController.h"
+#import "IMBThumbnailDiskCache.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+NSString* const kIMBLoadThumbnailsIncludeMetadataKey = @"includeMetadata";
+NSString* const kIMBThumbnailBatchObjectsKey = @"objects";
+NSString* const kIMBThumbnailBatchOptionsKey = @"options";
+NSString* const kIMBPopulatePageNodeKey = @"node";
+NSString* const kIMBPopulatePageSizeKey = @"pageSize";
+NSString* const kIMBPopulatePageOffsetKey = @"offset";
+NSString* const kIMBPopulatePageTokenKey = @"token";
+NSString* const kIMBPopulatePageTotalCountKey = @"totalCount";
+
+// Pending objects that haven't been asked for within this many seconds are discarded (e.g. because the app went 
+// away or a page request failed)...
+
+static const NSTimeInterval kIMBPendingObjectPagesTimeout = 120.0;
+
+static NSString* const kIMBPendingObjectsKey = @"objects";
+static NSString* const kIMBPendingNodeIdentifierKey = @"nodeIdentifier";
+static NSString* const kIMBPendingAccessTimeKey = @"accessTime";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark GLOBALS
+
+// Objects of paged populations that haven't been fetched by the app yet, keyed by token. Each entry also stores the 
+// identifier of the node and the time of the last access. Access is synchronized on the IMBParserMessenger class...
+
+static NSMutableDictionary* sPendingObjectPages = nil;
+static BOOL sIsEvictionScheduled = NO;
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -82,6 +119,8 @@
 #pragma mark
 
 @interface IMBParserMessenger ()
++ (void) _evictPendingObjectPagesForNodeIdentifier:(NSString*)inNodeIdentifier;
++ (void) _scheduleEvictionOfPendingObjectPages;
 @end
 
 @implementation IMBParserMessenger
@@ -420,6 +459,158 @@
 }
 
 
+// The parser still creates all objects in one go, but only the first page is sent back to the app right away. 
+// Archiving, sending and unarchiving tens of thousands of objects is what makes large nodes appear so slowly...
+
+- (NSDictionary*) populateNodeInPages:(NSDictionary*)inRequest error:(NSError**)outError
+{
+	IMBNode* node = [inRequest objectForKey:kIMBPopulatePageNodeKey];
+	NSUInteger pageSize = [[inRequest objectForKey:kIMBPopulatePageSizeKey] unsignedIntegerValue];
+	NSError* error = nil;
+	
+	node = [self populateNode:node error:&error];
+	
+	if (node == nil)
+	{
+		if (outError) *outError = error;
+		return nil;
+	}
+	
+	NSArray* objects = node.objects;
+	NSUInteger totalCount = [objects count];
+	NSMutableDictionary* reply = [NSMutableDictionary dictionaryWithCapacity:3];
+	[reply setObject:[NSNumber numberWithUnsignedInteger:totalCount] forKey:kIMBPopulatePageTotalCountKey];
+	
+	if (pageSize > 0 && totalCount > pageSize)
+	{
+		NSString* token = [[NSProcessInfo processInfo] globallyUniqueString];
+		
+		NSMutableDictionary* entry = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+			objects,kIMBPendingObjectsKey,
+			[NSDate date],kIMBPendingAccessTimeKey,
+			node.identifier,kIMBPendingNodeIdentifierKey,	// May be nil, so it goes last
+			nil];
+			
+		// The node was populated again, so pages of a previous population will never be asked for...
+		
+		@synchronized ([IMBParserMessenger class])
+		{
+			[IMBParserMessenger _evictPendingObjectPagesForNodeIdentifier:node.identifier];
+			if (sPendingObjectPages == nil) sPendingObjectPages = [[NSMutableDictionary alloc] init];
+			[sPendingObjectPages setObject:entry forKey:token];
+		}
+		
+		[IMBParserMessenger _scheduleEvictionOfPendingObjectPages];
+		
+		node.objects = [objects subarrayWithRange:NSMakeRange(0,pageSize)];
+		[reply setObject:token forKey:kIMBPopulatePageTokenKey];
+	}
+	
+	[reply setObject:node forKey:kIMBPopulatePageNodeKey];
+	if (outError) *outError = error;
+	return reply;
+}
+
+
+// Returns the requested range of the pending objects. Once the last page has been fetched (or the request was 
+// cancelled) the pending objects are discarded...
+
+- (NSArray*) objectsPage:(NSDictionary*)inRequest error:(NSError**)outError
+{
+	NSString* token = [inRequest objectForKey:kIMBPopulatePageTokenKey];
+	NSUInteger offset = [[inRequest objectForKey:kIMBPopulatePageOffsetKey] unsignedIntegerValue];
+	NSUInteger pageSize = [[inRequest objectForKey:kIMBPopulatePageSizeKey] unsignedIntegerValue];
+	NSArray* page = nil;
+	
+	@synchronized ([IMBParserMessenger class])
+	{
+		NSMutableDictionary* entry = [sPendingObjectPages objectForKey:token];
+		NSArray* objects = [entry objectForKey:kIMBPendingObjectsKey];
+		NSUInteger count = [objects count];
+		
+		if (offset < count && pageSize > 0)
+		{
+			NSUInteger length = MIN(pageSize,count-offset);
+			page = [objects subarrayWithRange:NSMakeRange(offset,length)];
+			[entry setObject:[NSDate date] forKey:kIMBPendingAccessTimeKey];
+			if (offset + length >= count) [sPendingObjectPages removeObjectForKey:token];
+		}
+		else
+		{
+			[sPendingObjectPages removeObjectForKey:token];
+		}
+	}
+	
+	if (page == nil && pageSize > 0)
+	{
+		NSString* description = [NSString stringWithFormat:@"No pending objects for paged population at offset %lu",(unsigned long)offset];
+		NSDictionary* info = [NSDictionary dictionaryWithObjectsAndKeys:description,NSLocalizedDescriptionKey,nil];
+		if (outError) *outError = [NSError errorWithDomain:kIMBErrorDomain code:kIMBErrorInvalidState userInfo:info];
+		return nil;
+	}
+	
+	if (outError) *outError = nil;
+	return page ? page : [NSArray array];
+}
+
+
+// Discards the pending objects of the specified node, and those that haven't been accessed for a while. Pass nil
+// to only discard the expired ones. Must be called while synchronized on the IMBParserMessenger class...
+
++ (void) _evictPendingObjectPagesForNodeIdentifier:(NSString*)inNodeIdentifier
+{
+	NSDate* expirationDate = [NSDate dateWithTimeIntervalSinceNow:-kIMBPendingObjectPagesTimeout];
+	NSMutableArray* tokens = [NSMutableArray array];
+	
+	for (NSString* token in sPendingObjectPages)
+	{
+		NSDictionary* entry = [sPendingObjectPages objectForKey:token];
+		NSString* nodeIdentifier = [entry objectForKey:kIMBPendingNodeIdentifierKey];
+		NSDate* accessTime = [entry objectForKey:kIMBPendingAccessTimeKey];
+		
+		if ((inNodeIdentifier != nil && [nodeIdentifier isEqualToString:inNodeIdentifier]) ||
+			[accessTime compare:expirationDate] == NSOrderedAscending)
+		{
+			[tokens addObject:token];
+		}
+	}
+	
+	[sPendingObjectPages removeObjectsForKeys:tokens];
+}
+
+
+// Checks for expired pending objects once the timeout has passed, and keeps checking for as long as there are
+// any left...
+
++ (void) _scheduleEvictionOfPendingObjectPages
+{
+	@synchronized ([IMBParserMessenger class])
+	{
+		if (sIsEvictionScheduled) return;
+		sIsEvictionScheduled = YES;
+	}
+	
+	dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW,(int64_t)(kIMBPendingObjectPagesTimeout * NSEC_PER_SEC));
+	
+	dispatch_after(when,dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW,0),^()
+	{
+		BOOL hasPendingObjects = NO;
+		
+		@synchronized ([IMBParserMessenger class])
+		{
+			[IMBParserMessenger _evictPendingObjectPagesForNodeIdentifier:nil];
+			hasPendingObjects = [sPendingObjectPages count] > 0;
+			sIsEvictionScheduled = NO;
+		}
+		
+		if (hasPendingObjects) [IMBParserMessenger _scheduleEvictionOfPendingObjectPages];
+	});
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
 - (IMBNode*) reloadNodeTree:(IMBNode*)inNode error:(NSError**)outError
 {
     // Since inNode was most likely instantiated through initWithCoder (coming from the app)
@@ -442,6 +633,39 @@
 }
 
 
+- (NSDictionary*) changesForNode:(IMBNode*)inNode error:(NSError**)outError
+{
+    inNode.parserMessenger = self;
+    
+	NSError* error = nil;
+	IMBParser* parser = [self parserWithIdentifier:inNode.parserIdentifier];
+	NSDictionary* changes = [parser changesForNode:inNode error:&error];
+	
+	if (changes)
+	{
+		NSMutableArray* objects = [NSMutableArray array];
+		[objects addObjectsFromArray:[changes objectForKey:kIMBNodeChangesAddedObjectsKey]];
+		[objects addObjectsFromArray:[changes objectForKey:kIMBNodeChangesModifiedObjectsKey]];
+		
+		for (IMBObject* object in objects)
+		{
+			object.parserIdentifier = parser.identifier;
+			if (!object.identifier) object.identifier = [parser identifierForObject:object];
+			object.persistentResourceIdentifier = [parser persistentResourceIdentifierForObject:object];
+		}
+		
+		for (IMBNode* subnode in [changes objectForKey:kIMBNodeChangesAddedSubnodesKey])
+		{
+			[self _setParserIdentifierWithParser:parser onNodeTree:subnode];
+			[self _setObjectIdentifierWithParser:parser onNodeTree:subnode];
+		}
+	}
+	
+	if (outError) *outError = error;
+	return changes;
+}
+
+
 // Since it is absolutely essential that all IMBNodes and IMBObjects have their parserIdentifier set correctly,
 // we'll use the following helper method to make sure of that and remove the burden from the parser developers.
 // Simply call this method on any node that we get from a IMBParser instance...
@@ -492,7 +716,9 @@
 
 
 // This method is used to load thumbnail and metadata for a given IMBObject. No need to override this method,
-// as the real work is done by two methods in IMBParser subclasses...
+// as the real work is done by two methods in IMBParser subclasses. Thumbnails of local files are looked up in 
+// (and stored to) the persistent IMBThumbnailDiskCache, so that we do not need to decode the originals again 
+// on the next launch...
 
 
 - (IMBObject*) loadThumbnailForObject:(IMBObject*)inObject error:(NSError**)outError
@@ -501,10 +727,34 @@
     
 	NSError* error = nil;
 	IMBParser* parser = [self parserWithIdentifier:inObject.parserIdentifier];
+	[parser resolveAccessibilityForObjects:[NSArray arrayWithObject:inObject]];
 	
-	if (error == nil)
+	IMBThumbnailDiskCache* diskCache = [IMBThumbnailDiskCache isEnabled] ? [IMBThumbnailDiskCache sharedCache] : nil;
+	NSString* cacheKey = nil;
+	
+	if (diskCache)
+	{
+		NSString* stamp = [parser thumbnailStampForObject:inObject];
+		cacheKey = [diskCache keyForObject:inObject maximumPixelSize:(NSUInteger)kIMBMaxThumbnailSize stamp:stamp];
+	}
+	
+	CGImageRef cachedThumbnail = [diskCache copyThumbnailForKey:cacheKey];
+	
+	if (cachedThumbnail)
 	{
-		inObject.imageRepresentation = [parser thumbnailForObject:inObject error:&error];
+		inObject.imageRepresentationType = IKImageBrowserCGImageRepresentationType;
+		inObject.imageRepresentation = (id)cachedThumbnail;
+		CGImageRelease(cachedThumbnail);
+	}
+	else
+	{
+		id thumbnail = [parser thumbnailForObject:inObject error:&error];
+		inObject.imageRepresentation = thumbnail;
+		
+		if (cacheKey && thumbnail && CFGetTypeID((CFTypeRef)thumbnail) == CGImageGetTypeID())
+		{
+			[diskCache storeThumbnail:(CGImageRef)thumbnail forKey:cacheKey];
+		}
 	}
 
 	if (outError) *outError = error;
@@ -518,6 +768,7 @@
     
 	NSError* error = nil;
 	IMBParser* parser = [self parserWithIdentifier:inObject.parserIdentifier];
+	[parser resolveAccessibilityForObjects:[NSArray arrayWithObject:inObject]];
 	
 	if (error == nil)
 	{
@@ -555,6 +806,69 @@
 }
 
 
+// Batched variant of the method above. Objects are handed to their parsers in runs of consecutive objects with 
+// the same parser, so that each parser can prepare the whole run (e.g. with a single database query) before the
+// individual thumbnails are loaded. Accessibility that wasn't probed during population is resolved for the whole
+// run at once. A failure for one object does not affect the other objects of the batch...
+
+- (NSArray*) loadThumbnailsForObjects:(NSArray*)inObjects options:(NSDictionary*)inOptions error:(NSError**)outError
+{
+	NSNumber* includeMetadata = [inOptions objectForKey:kIMBLoadThumbnailsIncludeMetadataKey];
+	BOOL shouldLoadMetadata = includeMetadata ? [includeMetadata boolValue] : YES;
+	NSMutableArray* results = [NSMutableArray arrayWithCapacity:[inObjects count]];
+	NSUInteger count = [inObjects count];
+	NSUInteger start = 0;
+	
+	while (start < count)
+	{
+		NSString* parserIdentifier = [[inObjects objectAtIndex:start] parserIdentifier];
+		NSUInteger end = start + 1;
+		
+		while (end < count && [[[inObjects objectAtIndex:end] parserIdentifier] isEqualToString:parserIdentifier])
+		{
+			end++;
+		}
+		
+		NSArray* run = [inObjects subarrayWithRange:NSMakeRange(start,end-start)];
+		IMBParser* parser = [self parserWithIdentifier:parserIdentifier];
+		[parser resolveAccessibilityForObjects:run];
+		[parser willLoadThumbnailsForObjects:run];
+		
+		for (IMBObject* object in run)
+		{
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			NSError* error = nil;
+			
+			if (shouldLoadMetadata)
+			{
+				[self loadThumbnailAndMetadataForObject:object error:&error];
+			}
+			else
+			{
+				[self loadThumbnailForObject:object error:&error];
+			}
+			
+			[results addObject:error ? (id)error : (id)object];
+			[pool drain];
+		}
+		
+		[parser didLoadThumbnailsForObjects:run];
+		start = end;
+	}
+	
+	if (outError) *outError = nil;
+	return results;
+}
+
+
+- (NSArray*) loadThumbnailsForBatch:(NSDictionary*)inBatch error:(NSError**)outError
+{
+	NSArray* objects = [inBatch objectForKey:kIMBThumbnailBatchObjectsKey];
+	NSDictionary* options = [inBatch objectForKey:kIMBThumbnailBatchOptionsKey];
+	return [self loadThumbnailsForObjects:objects options:options error:outError];
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 
@@ -0,0 +1,136 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CLASSES
+
+@class IMBObject;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+// IMBThumbnailDiskCache is a persistent thumbnail cache that survives app launches. It lives on the XPC service 
+// side (or in the host app when XPC services are not used), in front of -[IMBParserMessenger loadThumbnailForObject:
+// error:]. Thumbnails are stored pre-scaled and encoded in a single pack file, which is memory mapped for reading, 
+// plus a small index file. Keys are derived from the content of the source file (persistent resource identifier,
+// file size, modification date and requested thumbnail size), so stale entries are never returned. Once the pack 
+// file exceeds the disk budget, the least recently used thumbnails are dropped by compacting the pack file.
+// A cache directory is locked by the process using it. Each record in the pack file also carries its key, which 
+// is checked on read...
+
+@interface IMBThumbnailDiskCache : NSObject
+{
+	NSURL* _directoryURL;
+	NSURL* _packURL;
+	NSURL* _indexURL;
+	NSMutableDictionary* _entries;
+	NSData* _mappedPack;
+	NSFileHandle* _packHandle;
+	unsigned long long _packSize;
+	unsigned long long _accessClock;
+	unsigned long long _diskBudget;
+	dispatch_queue_t _queue;
+	int _lockFile;
+	BOOL _needsSaveIndex;
+}
+
+// Global settings. The budget applies to the shared cache and defaults to 256MB. It may be set before the shared
+// cache is created...
+
++ (void) setEnabled:(BOOL)inEnabled;
++ (BOOL) isEnabled;
+
++ (void) setDiskBudget:(unsigned long long)inBytes;
++ (unsigned long long) diskBudget;
+
+// The shared cache resides in a subfolder (named after the bundle identifier) of the caches folder of the current 
+// process (or its sandbox container)...
+
++ (IMBThumbnailDiskCache*) sharedCache;
+
+- (id) initWithDirectoryURL:(NSURL*)inDirectoryURL;
+
+@property (retain,readonly) NSURL* directoryURL;
+@property (assign) unsigned long long diskBudget;
+@property (readonly) unsigned long long packSize;
+
+// Returns the cache key for the thumbnail of an object, or nil if the object is not backed by a local file...
+
+- (NSString*) keyForObject:(IMBObject*)inObject maximumPixelSize:(NSUInteger)inMaxPixelSize;
+
+// Same as above, but the key also includes a stamp supplied by the parser (see -[IMBParser thumbnailStampForObject:])...
+
+- (NSString*) keyForObject:(IMBObject*)inObject maximumPixelSize:(NSUInteger)inMaxPixelSize stamp:(NSString*)inStamp;
+
+// Returns a thumbnail (following the Create Rule) or NULL if there is no entry for the key...
+
+- (CGImageRef) copyThumbnailForKey:(NSString*)inKey CF_RETURNS_RETAINED;
+
+// Encodes and appends a thumbnail to the pack file. May trigger eviction...
+
+- (void) storeThumbnail:(CGImageRef)inThumbnail forKey:(NSString*)inKey;
+
+// Writes the index to disk. This happens automatically a few seconds after the cache was modified...
+
+- (void) synchronize;
+
+- (void) removeAllThumbnails;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,647 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBThumbnailDiskCache.h"
+#import "IMBObject.h"
+#import <sys/stat.h>
+#import <sys/file.h>
+#import <fcntl.h>
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+static NSString* kIMBThumbnailDiskCacheFolderName = @"com.karelia.imedia.thumbnails";
+static NSString* kIMBThumbnailDiskCachePackFilename = @"Thumbnails.pack";
+static NSString* kIMBThumbnailDiskCacheIndexFilename = @"Thumbnails.index";
+static NSString* kIMBThumbnailDiskCacheLockFilename = @"Thumbnails.lock";
+static NSString* kIMBThumbnailDiskCacheVersionKey = @"version";
+static NSString* kIMBThumbnailDiskCacheEntriesKey = @"entries";
+static NSInteger kIMBThumbnailDiskCacheVersion = 2;
+static int64_t kIMBThumbnailDiskCacheSaveDelay = 5;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark GLOBALS
+
+static BOOL sEnabled = YES;
+static unsigned long long sDiskBudget = 256 * 1024 * 1024;
+static IMBThumbnailDiskCache* sSharedCache = nil;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Location of a single thumbnail inside the pack file. The access value is a logical clock used for LRU eviction.
+// Each record in the pack file starts with the length of the key (32 bit little endian) and the UTF-8 bytes of
+// the key, followed by the encoded image. Offset and length describe the whole record...
+
+@interface IMBThumbnailDiskCacheEntry : NSObject
+{
+	@public
+	unsigned long long offset;
+	unsigned long long length;
+	unsigned long long access;
+}
+@end
+
+@implementation IMBThumbnailDiskCacheEntry
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBThumbnailDiskCache ()
+- (void) _loadIndex;
+- (void) _scheduleSaveIndex;
+- (void) _saveIndex;
+- (BOOL) _mapPackIfNeeded:(unsigned long long)inRequiredLength;
+- (NSData*) _imageDataForEntry:(IMBThumbnailDiskCacheEntry*)inEntry key:(NSString*)inKey;
+- (void) _evictIfNeeded;
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBThumbnailDiskCache
+
+@synthesize directoryURL = _directoryURL;
+@synthesize diskBudget = _diskBudget;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
++ (void) setEnabled:(BOOL)inEnabled
+{
+	sEnabled = inEnabled;
+}
+
+
++ (BOOL) isEnabled
+{
+	return sEnabled;
+}
+
+
+// The budget is picked up by the shared cache when it is created. Only if it already exists do we update it...
+
++ (void) setDiskBudget:(unsigned long long)inBytes
+{
+	sDiskBudget = inBytes;
+	[sSharedCache setDiskBudget:inBytes];
+}
+
+
++ (unsigned long long) diskBudget
+{
+	return sDiskBudget;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
++ (IMBThumbnailDiskCache*) sharedCache
+{
+	static dispatch_once_t sOnceToken = 0;
+	
+    dispatch_once(&sOnceToken,
+    ^{
+		// Unsandboxed host apps all share the same caches folder, so every app gets its own subfolder...
+		
+		NSString* identifier = [[NSBundle mainBundle] bundleIdentifier];
+		if (identifier == nil) identifier = [[NSProcessInfo processInfo] processName];
+		
+		NSArray* paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory,NSUserDomainMask,YES);
+		NSString* path = [paths count] > 0 ? [paths objectAtIndex:0] : NSTemporaryDirectory();
+		path = [path stringByAppendingPathComponent:kIMBThumbnailDiskCacheFolderName];
+		path = [path stringByAppendingPathComponent:identifier];
+		sSharedCache = [[IMBThumbnailDiskCache alloc] initWithDirectoryURL:[NSURL fileURLWithPath:path isDirectory:YES]];
+	});
+	
+	return sSharedCache;
+}
+
+
+- (id) initWithDirectoryURL:(NSURL*)inDirectoryURL
+{
+	if (self = [super init])
+	{
+		_directoryURL = [inDirectoryURL retain];
+		_packURL = [[inDirectoryURL URLByAppendingPathComponent:kIMBThumbnailDiskCachePackFilename] retain];
+		_indexURL = [[inDirectoryURL URLByAppendingPathComponent:kIMBThumbnailDiskCacheIndexFilename] retain];
+		_entries = [[NSMutableDictionary alloc] init];
+		_diskBudget = sDiskBudget;
+		_queue = dispatch_queue_create("com.karelia.imedia.IMBThumbnailDiskCache",DISPATCH_QUEUE_SERIAL);
+		_lockFile = -1;
+		
+		[[NSFileManager defaultManager] createDirectoryAtURL:inDirectoryURL withIntermediateDirectories:YES attributes:nil error:NULL];
+
+		// Pack and index are rewritten in place and offsets are held in memory, so only one process may use a
+		// directory at any time. If it is already locked by someone else (e.g. a second instance of the same app),
+		// this cache simply stays empty and doesn't write anything...
+		
+		NSString* lockPath = [[inDirectoryURL URLByAppendingPathComponent:kIMBThumbnailDiskCacheLockFilename] path];
+		int fd = open([lockPath fileSystemRepresentation],O_RDWR|O_CREAT|O_CLOEXEC,0644);
+		
+		if (fd >= 0 && flock(fd,LOCK_EX|LOCK_NB) == 0)
+		{
+			_lockFile = fd;
+			[self _loadIndex];
+		}
+		else
+		{
+			if (fd >= 0) close(fd);
+			NSLog(@"%s Thumbnail cache at %@ is in use by another process",__FUNCTION__,inDirectoryURL);
+		}
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (_needsSaveIndex) [self _saveIndex];
+	[_packHandle closeFile];
+	if (_lockFile >= 0) close(_lockFile);
+	
+	IMBRelease(_directoryURL);
+	IMBRelease(_packURL);
+	IMBRelease(_indexURL);
+	IMBRelease(_entries);
+	IMBRelease(_mappedPack);
+	IMBRelease(_packHandle);
+	if (_queue) dispatch_release(_queue);
+	
+	[super dealloc];
+}
+
+
+- (unsigned long long) packSize
+{
+	__block unsigned long long size = 0;
+	dispatch_sync(_queue,^(){ size = _packSize; });
+	return size;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Keys
+
+// The key identifies the content of the image file the thumbnail is generated from. For skimmable objects and
+// objects with a separate lores preview that is imageLocation rather than the original file. If the file is 
+// touched in any way, the key changes and the stale entry simply ages out of the cache...
+
+- (NSString*) keyForObject:(IMBObject*)inObject maximumPixelSize:(NSUInteger)inMaxPixelSize
+{
+	return [self keyForObject:inObject maximumPixelSize:inMaxPixelSize stamp:nil];
+}
+
+
+// Some parsers do not render thumbnails from the file itself, but from a preview that changes when the image is
+// edited (e.g. Lightroom). The stamp describes that preview, so editing the image also changes the key...
+
+- (NSString*) keyForObject:(IMBObject*)inObject maximumPixelSize:(NSUInteger)inMaxPixelSize stamp:(NSString*)inStamp
+{
+	NSURL* url = [inObject imageLocationURL];
+	if (url == nil) url = [inObject URL];
+	if (![url isFileURL]) return nil;
+	
+	struct stat info;
+	if (stat([[url path] fileSystemRepresentation],&info) != 0) return nil;
+	if (!S_ISREG(info.st_mode)) return nil;
+	
+	NSString* identifier = inObject.persistentResourceIdentifier;
+	if (identifier == nil) identifier = [inObject.URL absoluteString];
+	
+	NSString* key = [NSString stringWithFormat:@"%@|%@|%lld|%ld.%09ld|%lu",
+		identifier,
+		[url path],
+		(long long)info.st_size,
+		(long)info.st_mtimespec.tv_sec,
+		(long)info.st_mtimespec.tv_nsec,
+		(unsigned long)inMaxPixelSize];
+	
+	return inStamp ? [key stringByAppendingFormat:@"|%@",inStamp] : key;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Reading & Writing
+
+
+- (CGImageRef) copyThumbnailForKey:(NSString*)inKey
+{
+	if (inKey == nil) return NULL;
+	
+	__block NSData* data = nil;
+	
+	dispatch_sync(_queue,^()
+	{
+		IMBThumbnailDiskCacheEntry* entry = [_entries objectForKey:inKey];
+		
+		if (entry && [self _mapPackIfNeeded:entry->offset + entry->length])
+		{
+			data = [[self _imageDataForEntry:entry key:inKey] retain];
+			
+			if (data)
+			{
+				entry->access = ++_accessClock;
+			}
+			else
+			{
+				[_entries removeObjectForKey:inKey];
+			}
+			
+			[self _scheduleSaveIndex];
+		}
+	});
+	
+	if (data == nil) return NULL;
+	
+	CGImageRef thumbnail = NULL;
+	CGImageSourceRef source = CGImageSourceCreateWithData((CFDataRef)data,NULL);
+	
+	if (source)
+	{
+		thumbnail = CGImageSourceCreateImageAtIndex(source,0,NULL);
+		CFRelease(source);
+	}
+	
+	[data release];
+	return thumbnail;
+}
+
+
+// Thumbnails without alpha channel are stored as JPEG, all others as PNG. Encoding happens outside of the 
+// serial queue, so that concurrent thumbnail requests only contend for the (cheap) append...
+
+- (void) storeThumbnail:(CGImageRef)inThumbnail forKey:(NSString*)inKey
+{
+	if (inThumbnail == NULL || inKey == nil) return;
+	
+	CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(inThumbnail);
+	BOOL hasAlpha = !(alphaInfo == kCGImageAlphaNone || alphaInfo == kCGImageAlphaNoneSkipFirst || alphaInfo == kCGImageAlphaNoneSkipLast);
+	CFStringRef type = hasAlpha ? kUTTypePNG : kUTTypeJPEG;
+	
+	NSData* keyData = [inKey dataUsingEncoding:NSUTF8StringEncoding];
+	uint32_t keyLength = NSSwapHostIntToLittle((uint32_t)[keyData length]);
+	
+	NSMutableData* data = [NSMutableData data];
+	[data appendBytes:&keyLength length:sizeof(keyLength)];
+	[data appendData:keyData];
+	
+	CGImageDestinationRef destination = CGImageDestinationCreateWithData((CFMutableDataRef)data,type,1,NULL);
+	if (destination == NULL) return;
+	
+	NSDictionary* properties = [NSDictionary dictionaryWithObject:[NSNumber numberWithFloat:0.8] forKey:(NSString*)kCGImageDestinationLossyCompressionQuality];
+	CGImageDestinationAddImage(destination,inThumbnail,(CFDictionaryRef)properties);
+	BOOL success = CGImageDestinationFinalize(destination);
+	CFRelease(destination);
+	if (!success) return;
+	
+	dispatch_sync(_queue,^()
+	{
+		if (_lockFile < 0) return;
+		
+		if (_packHandle == nil)
+		{
+			if (![[NSFileManager defaultManager] fileExistsAtPath:[_packURL path]])
+			{
+				[[NSFileManager defaultManager] createFileAtPath:[_packURL path] contents:nil attributes:nil];
+			}
+			
+			_packHandle = [[NSFileHandle fileHandleForWritingAtPath:[_packURL path]] retain];
+		}
+		
+		if (_packHandle == nil) return;
+		
+		@try
+		{
+			unsigned long long offset = [_packHandle seekToEndOfFile];
+			[_packHandle writeData:data];
+			
+			IMBThumbnailDiskCacheEntry* entry = [[IMBThumbnailDiskCacheEntry alloc] init];
+			entry->offset = offset;
+			entry->length = [data length];
+			entry->access = ++_accessClock;
+			[_entries setObject:entry forKey:inKey];
+			[entry release];
+			
+			_packSize = offset + [data length];
+		}
+		@catch (NSException* inException)
+		{
+			NSLog(@"%s Could not write thumbnail to %@ (%@)",__FUNCTION__,_packURL,inException);
+			return;
+		}
+		
+		[self _evictIfNeeded];
+		[self _scheduleSaveIndex];
+	});
+}
+
+
+// The pack file only ever grows between compactions, so a mapping is still valid for all entries it covers.
+// We only need to remap if an entry was appended after the file was mapped. Must be called on _queue...
+
+- (BOOL) _mapPackIfNeeded:(unsigned long long)inRequiredLength
+{
+	if (_mappedPack != nil && [_mappedPack length] >= inRequiredLength)
+	{
+		return YES;
+	}
+	
+	[_packHandle synchronizeFile];
+	IMBRelease(_mappedPack);
+	_mappedPack = [[NSData alloc] initWithContentsOfURL:_packURL options:NSDataReadingMappedAlways error:NULL];
+	
+	return _mappedPack != nil && [_mappedPack length] >= inRequiredLength;
+}
+
+
+// Returns the encoded image of a record, or nil if the record doesn't belong to the key. That way an index that 
+// doesn't match the pack file (for whatever reason) results in a cache miss instead of a wrong thumbnail. Must 
+// be called on _queue after the pack file was mapped...
+
+- (NSData*) _imageDataForEntry:(IMBThumbnailDiskCacheEntry*)inEntry key:(NSString*)inKey
+{
+	const uint8_t* bytes = (const uint8_t*)[_mappedPack bytes] + inEntry->offset;
+	unsigned long long length = inEntry->length;
+	uint32_t keyLength = 0;
+	
+	if (length < sizeof(keyLength)) return nil;
+	memcpy(&keyLength,bytes,sizeof(keyLength));
+	keyLength = NSSwapLittleIntToHost(keyLength);
+	
+	bytes += sizeof(keyLength);
+	length -= sizeof(keyLength);
+	if (keyLength >= length) return nil;
+	
+	NSData* keyData = [inKey dataUsingEncoding:NSUTF8StringEncoding];
+	if ([keyData length] != keyLength || memcmp([keyData bytes],bytes,keyLength) != 0) return nil;
+	
+	NSUInteger offset = (NSUInteger)(inEntry->offset + sizeof(keyLength) + keyLength);
+	return [_mappedPack subdataWithRange:NSMakeRange(offset,(NSUInteger)(length - keyLength))];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Eviction
+
+// When the budget is exceeded, keep the most recently used thumbnails that fit into 75% of the budget and write
+// them to a fresh pack file, which then atomically replaces the old one. The old index is removed first, so that 
+// a crash before the new index is saved leaves a pack file without index, which is discarded on next launch. 
+// Must be called on _queue...
+
+- (void) _evictIfNeeded
+{
+	if (_packSize <= _diskBudget) return;
+	if (![self _mapPackIfNeeded:_packSize]) return;
+
+	NSArray* keys = [_entries keysSortedByValueUsingComparator:^NSComparisonResult(id inEntry1,id inEntry2)
+	{
+		unsigned long long access1 = ((IMBThumbnailDiskCacheEntry*)inEntry1)->access;
+		unsigned long long access2 = ((IMBThumbnailDiskCacheEntry*)inEntry2)->access;
+		if (access1 > access2) return NSOrderedAscending;
+		if (access1 < access2) return NSOrderedDescending;
+		return NSOrderedSame;
+	}];
+	
+	unsigned long long budget = _diskBudget - _diskBudget/4;
+	unsigned long long size = 0;
+	NSMutableData* pack = [NSMutableData dataWithCapacity:(NSUInteger)MIN(budget,_packSize)];
+	NSMutableDictionary* entries = [NSMutableDictionary dictionaryWithCapacity:[keys count]];
+	
+	for (NSString* key in keys)
+	{
+		IMBThumbnailDiskCacheEntry* entry = [_entries objectForKey:key];
+		if (size + entry->length > budget) break;
+		
+		[pack appendData:[_mappedPack subdataWithRange:NSMakeRange((NSUInteger)entry->offset,(NSUInteger)entry->length)]];
+		entry->offset = size;
+		size += entry->length;
+		[entries setObject:entry forKey:key];
+	}
+
+	[_packHandle closeFile];
+	IMBRelease(_packHandle);
+	IMBRelease(_mappedPack);
+	
+	[[NSFileManager defaultManager] removeItemAtURL:_indexURL error:NULL];
+
+	if ([pack writeToURL:_packURL atomically:YES])
+	{
+		[_entries setDictionary:entries];
+		_packSize = size;
+	}
+	else
+	{
+		[_entries removeAllObjects];
+		[[NSFileManager defaultManager] removeItemAtURL:_packURL error:NULL];
+		_packSize = 0;
+	}
+	
+	[self _saveIndex];
+}
+
+
+- (void) removeAllThumbnails
+{
+	dispatch_sync(_queue,^()
+	{
+		if (_lockFile < 0) return;
+		
+		[_packHandle closeFile];
+		IMBRelease(_packHandle);
+		IMBRelease(_mappedPack);
+		[_entries removeAllObjects];
+		_packSize = 0;
+		_accessClock = 0;
+		
+		[[NSFileManager defaultManager] removeItemAtURL:_packURL error:NULL];
+		[[NSFileManager defaultManager] removeItemAtURL:_indexURL error:NULL];
+	});
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Index
+
+// The index is a binary property list mapping keys to (offset,length,access) triples. Entries that point past
+// the end of the pack file (e.g. after a crash during a write) are discarded...
+
+- (void) _loadIndex
+{
+	NSDictionary* attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[_packURL path] error:NULL];
+	_packSize = attributes ? [attributes fileSize] : 0;
+	
+	NSData* data = [NSData dataWithContentsOfURL:_indexURL];
+	NSDictionary* index = data ? [NSPropertyListSerialization propertyListWithData:data options:0 format:NULL error:NULL] : nil;
+	
+	if (![index isKindOfClass:[NSDictionary class]] || 
+		[[index objectForKey:kIMBThumbnailDiskCacheVersionKey] integerValue] != kIMBThumbnailDiskCacheVersion)
+	{
+		[[NSFileManager defaultManager] removeItemAtURL:_packURL error:NULL];
+		_packSize = 0;
+		return;
+	}
+	
+	NSDictionary* entries = [index objectForKey:kIMBThumbnailDiskCacheEntriesKey];
+	
+	for (NSString* key in entries)
+	{
+		NSArray* values = [entries objectForKey:key];
+		if ([values count] != 3) continue;
+		
+		IMBThumbnailDiskCacheEntry* entry = [[IMBThumbnailDiskCacheEntry alloc] init];
+		entry->offset = [[values objectAtIndex:0] unsignedLongLongValue];
+		entry->length = [[values objectAtIndex:1] unsignedLongLongValue];
+		entry->access = [[values objectAtIndex:2] unsignedLongLongValue];
+		
+		if (entry->offset + entry->length <= _packSize)
+		{
+			[_entries setObject:entry forKey:key];
+			_accessClock = MAX(_accessClock,entry->access);
+		}
+		
+		[entry release];
+	}
+}
+
+
+// Coalesce index writes, so that scrolling through a large folder doesn't rewrite the index for every thumbnail.
+// Must be called on _queue...
+
+- (void) _scheduleSaveIndex
+{
+	if (_needsSaveIndex) return;
+	_needsSaveIndex = YES;
+	
+	[self retain];
+	
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW,kIMBThumbnailDiskCacheSaveDelay * NSEC_PER_SEC),_queue,^()
+	{
+		if (_needsSaveIndex) [self _saveIndex];
+		[self release];
+	});
+}
+
+
+- (void) _saveIndex
+{
+	if (_lockFile < 0) return;
+	
+	NSMutableDictionary* entries = [NSMutableDictionary dictionaryWithCapacity:[_entries count]];
+	
+	for (NSString* key in _entries)
+	{
+		IMBThumbnailDiskCacheEntry* entry = [_entries objectForKey:key];
+		NSArray* values = [NSArray arrayWithObjects:
+			[NSNumber numberWithUnsignedLongLong:entry->offset],
+			[NSNumber numberWithUnsignedLongLong:entry->length],
+			[NSNumber numberWithUnsignedLongLong:entry->access],
+			nil];
+		[entries setObject:values forKey:key];
+	}
+	
+	NSDictionary* index = [NSDictionary dictionaryWithObjectsAndKeys:
+		[NSNumber numberWithInteger:kIMBThumbnailDiskCacheVersion],kIMBThumbnailDiskCacheVersionKey,
+		entries,kIMBThumbnailDiskCacheEntriesKey,
+		nil];
+
+	[_packHandle synchronizeFile];
+	
+	NSData* data = [NSPropertyListSerialization dataWithPropertyList:index format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+	[data writeToURL:_indexURL atomically:YES];
+	_needsSaveIndex = NO;
+}
+
+
+- (void) synchronize
+{
+	dispatch_sync(_queue,^()
+	{
+		[self _saveIndex];
+	});
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+@end
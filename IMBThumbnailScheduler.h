@@ -0,0 +1,129 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Thumbnail requests are served in this order. Within one priority class requests are served in the order 
+// they were made (which is display order for the views)...
+
+typedef enum
+{
+	kIMBThumbnailPriorityVisible = 0,		// Object is currently on screen
+	kIMBThumbnailPriorityPrefetch,			// Object is likely to scroll into view soon
+	kIMBThumbnailPriorityBackground,		// Everything else
+	kIMBThumbnailPriorityCount
+} 
+IMBThumbnailPriority;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CLASSES
+
+@class IMBObject;
+@class IMBParserMessenger;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// IMBThumbnailScheduler decides which thumbnail requests are sent to the parser messengers, and when. Pending  
+// requests are kept in three priority classes, so that objects that are on screen overtake requests for objects 
+// that have already scrolled out of view. Only a limited number of batches is in flight per parser messenger
+// (derived from the number of cores for local files, and a fixed number for network based parsers), which keeps 
+// pending requests cancellable for as long as possible. All methods must be called on the main thread (except
+// -scheduleObject:priority: and -cancelObject:, which hop to the main thread)...
+
+@interface IMBThumbnailScheduler : NSObject
+{
+	NSMutableArray* _queues;
+	CFMutableDictionaryRef _states;
+	CFMutableDictionaryRef _inflightCounts;
+	NSUInteger _batchSize;
+	NSUInteger _maxConcurrentLocalBatches;
+	NSUInteger _maxConcurrentRemoteBatches;
+	BOOL _isDispatchScheduled;
+}
+
++ (IMBThumbnailScheduler*) sharedScheduler;
+
+// Adds a request for the object, or raises the priority of a pending request. Objects that are already in flight
+// are not affected...
+
+- (void) scheduleObject:(IMBObject*)inObject priority:(IMBThumbnailPriority)inPriority;
+
+// Removes a pending request. Returns NO if there was none (e.g. because it is already in flight). When called on 
+// another thread, the request is cancelled asynchronously on the main thread and NO is returned...
+
+- (BOOL) cancelObject:(IMBObject*)inObject;
+
+- (BOOL) isScheduledObject:(IMBObject*)inObject;
+- (NSUInteger) countOfPendingObjects;
+
+// Tuning parameters...
+
+@property (assign) NSUInteger batchSize;						// Objects per XPC message (default 16)
+@property (assign) NSUInteger maxConcurrentLocalBatches;		// Default is number of active cores (2...8)
+@property (assign) NSUInteger maxConcurrentRemoteBatches;		// Default is 8
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,411 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBThumbnailScheduler.h"
+#import "IMBObject.h"
+#import "IMBParserMessenger.h"
+#import "SBUtilities.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Values of _states. Pending objects store their priority + 1...
+
+static const uintptr_t kIMBThumbnailStateInflight = 0xFF;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// Implemented in IMBObject.m...
+
+@interface IMBObject (ThumbnailScheduler)
+- (void) _didLoadThumbnailWithObject:(IMBObject*)inPopulatedObject error:(NSError*)inError;
+- (void) _didCancelThumbnailLoading;
+@end
+
+@interface IMBThumbnailScheduler ()
+- (void) _setNeedsDispatch;
+- (void) _dispatch;
+- (NSUInteger) _maxConcurrentBatchesForMessenger:(IMBParserMessenger*)inMessenger;
+- (NSUInteger) _countOfInflightBatchesForMessenger:(IMBParserMessenger*)inMessenger;
+- (void) _setCountOfInflightBatches:(NSUInteger)inCount forMessenger:(IMBParserMessenger*)inMessenger;
+- (void) _sendBatch:(NSArray*)inObjects toMessenger:(IMBParserMessenger*)inMessenger;
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBThumbnailScheduler
+
+@synthesize batchSize = _batchSize;
+@synthesize maxConcurrentLocalBatches = _maxConcurrentLocalBatches;
+@synthesize maxConcurrentRemoteBatches = _maxConcurrentRemoteBatches;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
++ (IMBThumbnailScheduler*) sharedScheduler
+{
+	static IMBThumbnailScheduler* sSharedScheduler = nil;
+	static dispatch_once_t sOnceToken = 0;
+
+    dispatch_once(&sOnceToken,
+    ^{
+		sSharedScheduler = [[IMBThumbnailScheduler alloc] init];
+	});
+
+	return sSharedScheduler;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_queues = [[NSMutableArray alloc] initWithCapacity:kIMBThumbnailPriorityCount];
+		
+		for (NSUInteger i=0; i<kIMBThumbnailPriorityCount; i++)
+		{
+			[_queues addObject:[NSMutableArray array]];
+		}
+		
+		_states = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,NULL);
+		_inflightCounts = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,NULL);
+		
+		// Decoding thumbnails of local files is mostly CPU bound, so we go as wide as we have cores (but  
+		// not wider than the old fixed limit). Network based parsers are latency bound, so they keep the 
+		// old limit of 8 parallel requests...
+		
+		NSUInteger cores = [[NSProcessInfo processInfo] activeProcessorCount];
+		_batchSize = 16;
+		_maxConcurrentLocalBatches = MIN(MAX(cores,2),8);
+		_maxConcurrentRemoteBatches = 8;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_queues);
+	if (_states) CFRelease(_states);
+	if (_inflightCounts) CFRelease(_inflightCounts);
+	[super dealloc];
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Requests
+
+
+- (void) scheduleObject:(IMBObject*)inObject priority:(IMBThumbnailPriority)inPriority
+{
+	if (inObject == nil || inPriority >= kIMBThumbnailPriorityCount) return;
+	
+	if (![NSThread isMainThread])
+	{
+		dispatch_async(dispatch_get_main_queue(),^()
+		{
+			[self scheduleObject:inObject priority:inPriority];
+		});
+		
+		return;
+	}
+	
+	uintptr_t state = (uintptr_t) CFDictionaryGetValue(_states,inObject);
+	
+	if (state == kIMBThumbnailStateInflight)
+	{
+		return;
+	}
+	
+	// Already pending with the same or a higher priority. Nothing to do...
+	
+	if (state != 0 && state-1 <= (uintptr_t)inPriority)
+	{
+		return;
+	}
+	
+	// Move the request to the end of the queue for its new priority...
+	
+	[inObject retain];
+	
+	if (state != 0)
+	{
+		[[_queues objectAtIndex:state-1] removeObjectIdenticalTo:inObject];
+	}
+	
+	[[_queues objectAtIndex:inPriority] addObject:inObject];
+	CFDictionarySetValue(_states,inObject,(const void*)(uintptr_t)(inPriority+1));
+	[inObject release];
+	
+	[self _setNeedsDispatch];
+}
+
+
+- (BOOL) cancelObject:(IMBObject*)inObject
+{
+	if (inObject == nil) return NO;
+	
+	if (![NSThread isMainThread])
+	{
+		dispatch_async(dispatch_get_main_queue(),^()
+		{
+			[self cancelObject:inObject];
+		});
+		
+		return NO;
+	}
+	
+	uintptr_t state = (uintptr_t) CFDictionaryGetValue(_states,inObject);
+	
+	if (state == 0 || state == kIMBThumbnailStateInflight)
+	{
+		return NO;
+	}
+	
+	[inObject retain];
+	CFDictionaryRemoveValue(_states,inObject);
+	[[_queues objectAtIndex:state-1] removeObjectIdenticalTo:inObject];
+	[inObject _didCancelThumbnailLoading];
+	[inObject release];
+	
+	return YES;
+}
+
+
+- (BOOL) isScheduledObject:(IMBObject*)inObject
+{
+	return inObject != nil && CFDictionaryContainsKey(_states,inObject);
+}
+
+
+- (NSUInteger) countOfPendingObjects
+{
+	NSUInteger count = 0;
+	
+	for (NSArray* queue in _queues)
+	{
+		count += [queue count];
+	}
+	
+	return count;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Dispatching
+
+
+// Requests are not sent right away, but collected until the current pass of the main runloop is done. That way
+// all objects that are asked for their thumbnail during one redraw can end up in the same batch...
+
+- (void) _setNeedsDispatch
+{
+	if (!_isDispatchScheduled)
+	{
+		_isDispatchScheduled = YES;
+		
+		dispatch_async(dispatch_get_main_queue(),^()
+		{
+			_isDispatchScheduled = NO;
+			[self _dispatch];
+		});
+	}
+}
+
+
+- (NSUInteger) _maxConcurrentBatchesForMessenger:(IMBParserMessenger*)inMessenger
+{
+	NSURL* mediaSource = inMessenger.mediaSource;
+	BOOL isLocal = inMessenger == nil || [mediaSource isFileURL];
+	return isLocal ? _maxConcurrentLocalBatches : _maxConcurrentRemoteBatches;
+}
+
+
+// In flight batches are counted per parser messenger (objects without messenger share one counter)...
+
+- (NSUInteger) _countOfInflightBatchesForMessenger:(IMBParserMessenger*)inMessenger
+{
+	id key = inMessenger ? (id)inMessenger : (id)[NSNull null];
+	return (NSUInteger)(uintptr_t) CFDictionaryGetValue(_inflightCounts,key);
+}
+
+
+- (void) _setCountOfInflightBatches:(NSUInteger)inCount forMessenger:(IMBParserMessenger*)inMessenger
+{
+	id key = inMessenger ? (id)inMessenger : (id)[NSNull null];
+	if (inCount > 0) CFDictionarySetValue(_inflightCounts,key,(const void*)(uintptr_t)inCount);
+	else CFDictionaryRemoveValue(_inflightCounts,key);
+}
+
+
+// Send as many batches as the concurrency limits allow, highest priority first. A batch only contains objects of 
+// one parser messenger and one priority class (in request order). Once a messenger has reached its limit, its 
+// requests stay pending (and thus cancellable) while requests for other messengers may still go out...
+
+- (void) _dispatch
+{
+	while (YES)
+	{
+		NSMutableArray* batchQueue = nil;
+		IMBParserMessenger* batchMessenger = nil;
+		
+		for (NSMutableArray* queue in _queues)
+		{
+			for (IMBObject* object in queue)
+			{
+				IMBParserMessenger* messenger = object.parserMessenger;
+				
+				if ([self _countOfInflightBatchesForMessenger:messenger] < [self _maxConcurrentBatchesForMessenger:messenger])
+				{
+					batchQueue = queue;
+					batchMessenger = messenger;
+					break;
+				}
+			}
+			
+			if (batchQueue) break;
+		}
+		
+		if (batchQueue == nil) break;
+		
+		NSMutableArray* batch = [NSMutableArray arrayWithCapacity:_batchSize];
+		NSMutableIndexSet* batchIndexes = [NSMutableIndexSet indexSet];
+		NSUInteger index = 0;
+		
+		for (IMBObject* object in batchQueue)
+		{
+			if (object.parserMessenger == batchMessenger)
+			{
+				[batch addObject:object];
+				[batchIndexes addIndex:index];
+				CFDictionarySetValue(_states,object,(const void*)kIMBThumbnailStateInflight);
+			}
+			
+			if ([batch count] >= _batchSize) break;
+			index++;
+		}
+		
+		// Remove the whole batch from its queue in a single pass...
+		
+		[batchQueue removeObjectsAtIndexes:batchIndexes];
+		
+		[self _sendBatch:batch toMessenger:batchMessenger];
+	}
+}
+
+
+- (void) _sendBatch:(NSArray*)inObjects toMessenger:(IMBParserMessenger*)inMessenger
+{
+	NSUInteger inflight = [self _countOfInflightBatchesForMessenger:inMessenger];
+	[self _setCountOfInflightBatches:inflight+1 forMessenger:inMessenger];
+	[inMessenger retain];
+	
+	NSDictionary* batch = [NSDictionary dictionaryWithObjectsAndKeys:inObjects,kIMBThumbnailBatchObjectsKey,nil];
+	
+	SBPerformSelectorAsync(inMessenger.connection,
+                           inMessenger,
+                           @selector(loadThumbnailsForBatch:error:),
+                           batch,
+                           dispatch_get_main_queue(),
+	
+		^(NSArray* inResults,NSError* inError)
+		{
+			NSUInteger count = [self _countOfInflightBatchesForMessenger:inMessenger];
+			[self _setCountOfInflightBatches:(count > 0 ? count-1 : 0) forMessenger:inMessenger];
+			
+			NSUInteger i = 0;
+			
+			for (IMBObject* object in inObjects)
+			{
+				id result = (inError == nil && i < [inResults count]) ? [inResults objectAtIndex:i] : nil;
+				CFDictionaryRemoveValue(_states,object);
+				
+				if ([result isKindOfClass:[NSError class]])
+				{
+					[object _didLoadThumbnailWithObject:nil error:result];
+				}
+				else
+				{
+					[object _didLoadThumbnailWithObject:result error:result ? nil : inError];
+				}
+				
+				i++;
+			}
+			
+			[inMessenger release];
+			[self _dispatch];
+		});
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+@end
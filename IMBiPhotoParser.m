@@ -537,44 +537,29 @@
 
 - (NSDictionary*) childrenInfoForNode:(NSDictionary*)inNodeDict images:(NSDictionary*)inImages
 {
-	// Determine images relevant to this view.
-	// Note that everything regarding 'ImageFaceMetadata' is only relevant
-	// when providing a faces node. Otherwise it will be nil'ed.
+	// Determine images relevant to this view. Faces don't come here, their lists are already filtered
+	// while collecting them (see -shouldUseFacesOfImage:)...
 	
 	NSArray* imageKeys = [inNodeDict objectForKey:@"KeyList"];
 	NSMutableArray* relevantImageKeys = [NSMutableArray array];
-	NSArray* imageFaceMetadataList = [inNodeDict objectForKey:@"ImageFaceMetadataList"];
-	NSMutableArray* relevantImageFaceMetadataList = imageFaceMetadataList ? [NSMutableArray array] : nil;
 	
-	// Loop setup
-	NSString* key = nil;
-	NSDictionary* imageFaceMetadata = nil;
-	NSDictionary* imageDict = nil;
-	
-	for (NSUInteger i = 0; i < [imageKeys count]; i++)
+	for (NSString* key in imageKeys)
 	{
-		key = [imageKeys objectAtIndex:i];
-		imageFaceMetadata = [imageFaceMetadataList objectAtIndex:i];
-		
-		imageDict = [inImages objectForKey:key];
+		NSDictionary* imageDict = [inImages objectForKey:key];
 		
 		if ([self shouldUseObject:imageDict])
 		{
 			[relevantImageKeys addObject:key];
-			
-			if (imageFaceMetadata) [relevantImageFaceMetadataList addObject:imageFaceMetadata];
 		}		
 	}
 	
 	// Ensure that key image for movies is movie related:
 	
 	NSString* keyPhotoKey = nil;
-	NSNumber* keyImageFaceIndex = nil;
 	
 	if ([[self iPhotoMediaType] isEqualToString:@"Movie"] && [relevantImageKeys count] > 0)
 	{
 		keyPhotoKey = [relevantImageKeys objectAtIndex:0];
-		keyImageFaceIndex = [[relevantImageFaceMetadataList objectAtIndex:0] objectForKey:@"face index"];
 	} else {
 		keyPhotoKey = [inNodeDict objectForKey:@"KeyPhotoKey"];
 	}
@@ -582,9 +567,15 @@
     return [NSDictionary dictionaryWithObjectsAndKeys:
 			relevantImageKeys, @"KeyList",
 			[NSNumber numberWithUnsignedInteger:[relevantImageKeys count]], @"PhotoCount", 
-			keyPhotoKey, @"KeyPhotoKey",
-			relevantImageFaceMetadataList, @"ImageFaceMetadataList",   // May be nil
-			keyImageFaceIndex, @"key image face index", nil];          // May be nil
+			keyPhotoKey, @"KeyPhotoKey", nil];
+}
+
+
+// Faces on images of the other media type are not shown...
+
+- (BOOL) shouldUseFacesOfImage:(NSDictionary*)inImageDict
+{
+	return [self shouldUseObject:inImageDict];
 }
 
 
@@ -739,7 +730,7 @@
 			[object release];
 			
 			object.location = [NSURL fileURLWithPath:path isDirectory:NO];
-            object.accessibility = [self accessibilityForObject:object];
+            object.accessibility = kIMBResourceAccessibilityUnknown;		// Resolved lazily in batches
 			object.name = name;
             
             NSMutableDictionary *metadata = [imageDict mutableCopy];
@@ -852,7 +843,7 @@
         [object release];
         
         object.location = [NSURL fileURLWithPath:path isDirectory:NO];
-        object.accessibility = [self accessibilityForObject:object];
+        object.accessibility = kIMBResourceAccessibilityUnknown;		// Resolved lazily in batches
         object.name = name;
         object.preliminaryMetadata = imageDict;	// This metadata from the XML file is available immediately
         object.metadata = nil;					// Build lazily when needed (takes longer)
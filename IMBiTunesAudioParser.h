@@ -61,6 +61,7 @@
 #pragma mark CLASSES
 
 @class IMBTimecodeTransformer;
+@class IMBiTunesLibraryStore;
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -71,7 +72,9 @@
 @interface IMBiTunesAudioParser : IMBParser
 {
 	NSString* _appPath;
-	NSDictionary* _plist;
+	IMBiTunesLibraryStore* _library;
+	NSDictionary* _playlistsByIdentifier;
+	NSDictionary* _childPlaylistIdentifiers;
 	NSDate* _modificationDate;
 	BOOL _shouldDisplayLibraryName;
 	NSInteger _version;
@@ -79,7 +82,7 @@
 }
 
 @property (retain) NSString* appPath;
-@property (retain,readonly) NSDictionary* plist;
+@property (retain,readonly) IMBiTunesLibraryStore* library;
 @property (retain) NSDate* modificationDate;
 @property (assign) BOOL shouldDisplayLibraryName;
 @property (assign) NSInteger version;
@@ -54,6 +54,7 @@
 #pragma mark HEADERS
 
 #import "IMBiTunesAudioParser.h"
+#import "IMBiTunesLibraryStore.h"
 #import "IMBConfig.h"
 #import "IMBParserController.h"
 #import "IMBNode.h"
@@ -75,15 +76,18 @@
 
 @interface IMBiTunesAudioParser ()
 
-@property (retain) NSDictionary* atomic_plist;
+@property (retain) IMBiTunesLibraryStore* atomic_library;
+@property (retain) NSDictionary* playlistsByIdentifier;
+@property (retain) NSDictionary* childPlaylistIdentifiers;
 
 - (NSString*) identifierWithPersistentID:(NSString*)inPersistentID;
 - (BOOL) shoudlUsePlaylist:(NSDictionary*)inPlaylistDict;
 - (BOOL) shouldUseTrack:(NSDictionary*)inTrackDict;
 - (BOOL) isLeafPlaylist:(NSDictionary*)inPlaylistDict;
 - (NSImage*) iconForPlaylist:(NSDictionary*)inPlaylistDict;
-- (void) addSubnodesToNode:(IMBNode*)inParentNode playlists:(NSArray*)inPlaylists tracks:(NSDictionary*)inTracks;
-- (void) populateNode:(IMBNode*)inNode playlists:(NSArray*)inPlaylists tracks:(NSDictionary*)inTracks;
+- (void) buildPlaylistIndexForLibrary:(IMBiTunesLibraryStore*)inLibrary;
+- (void) addSubnodesToNode:(IMBNode*)inParentNode;
+- (void) populateNode:(IMBNode*)inNode tracks:(IMBiTunesLibraryStore*)inTracks;
 - (NSString*) metadataDescriptionForMetadata:(NSDictionary*)inMetadata;
 
 @end
@@ -97,7 +101,9 @@
 @implementation IMBiTunesAudioParser
 
 @synthesize appPath = _appPath;
-@synthesize atomic_plist = _plist;
+@synthesize atomic_library = _library;
+@synthesize playlistsByIdentifier = _playlistsByIdentifier;
+@synthesize childPlaylistIdentifiers = _childPlaylistIdentifiers;
 @synthesize modificationDate = _modificationDate;
 @synthesize shouldDisplayLibraryName = _shouldDisplayLibraryName;
 @synthesize version = _version;
@@ -122,7 +128,9 @@
 - (void) dealloc
 {
 	IMBRelease(_appPath);
-	IMBRelease(_plist);
+	IMBRelease(_library);
+	IMBRelease(_playlistsByIdentifier);
+	IMBRelease(_childPlaylistIdentifiers);
 	IMBRelease(_modificationDate);
 	IMBRelease(_timecodeTransformer);
 	[super dealloc];
@@ -175,12 +183,10 @@
 
 - (BOOL) populateNode:(IMBNode*)inNode error:(NSError**)outError
 {
-	NSDictionary* plist = self.plist;
-	NSArray* playlists = [plist objectForKey:@"Playlists"];
-	NSDictionary* tracks = [plist objectForKey:@"Tracks"];
+	IMBiTunesLibraryStore* tracks = self.library;
 	
-	[self addSubnodesToNode:inNode playlists:playlists tracks:tracks]; 
-	[self populateNode:inNode playlists:playlists tracks:tracks]; 
+	[self addSubnodesToNode:inNode]; 
+	[self populateNode:inNode tracks:tracks]; 
 
 	// If we are populating the top-level node, then also populate the "Music" node (first subnode) and mirror 
 	// its objects array into the objects array of the root node. Please note that this is non-standard parser 
@@ -241,10 +247,11 @@
 #pragma mark 
 #pragma mark Helper Methods
 
-// Load the XML file into a plist lazily (on demand). If we notice that an existing cached plist is out-of-date 
-// we get rid of it and load it anew...
+// Load the XML file into a compact library store lazily (on demand). If we notice that an existing cached store 
+// is out-of-date we get rid of it and load it anew. The XML file is streamed, so we never hold the whole plist
+// in memory...
 
-- (NSDictionary*) plist
+- (IMBiTunesLibraryStore*) library
 {
 	NSURL* url = self.mediaSource;
 	
@@ -256,18 +263,67 @@
 	{
 		if ([self.modificationDate compare:modificationDate] == NSOrderedAscending)
 		{
-			self.atomic_plist = nil;
+			self.atomic_library = nil;
+			self.playlistsByIdentifier = nil;
+			self.childPlaylistIdentifiers = nil;
 		}
 		
-		if (_plist == nil)
+		if (_library == nil)
 		{
-			self.atomic_plist = [NSDictionary dictionaryWithContentsOfURL:url];
+			self.atomic_library = [IMBiTunesLibraryStore storeWithContentsOfURL:url error:NULL];
 			self.modificationDate = modificationDate;
-			self.version = [[_plist objectForKey:@"Application Version"] intValue];
+			self.version = [[_library.properties objectForKey:@"Application Version"] intValue];
+			[self buildPlaylistIndexForLibrary:_library];
 		}
 	}
 	
-	return self.atomic_plist;
+	return self.atomic_library;
+}
+
+
+// Build lookup tables for playlists once per load of the library, so that populating a node doesn't need to scan
+// all playlists (and create identifiers for each of them) again. Child identifiers are stored in the order of the
+// XML file, and only for playlists that are shown by this parser...
+
+- (void) buildPlaylistIndexForLibrary:(IMBiTunesLibraryStore*)inLibrary
+{
+	NSArray* playlists = inLibrary.playlists;
+	NSMutableDictionary* playlistsByIdentifier = [NSMutableDictionary dictionaryWithCapacity:[playlists count]];
+	NSMutableDictionary* childPlaylistIdentifiers = [NSMutableDictionary dictionary];
+	NSString* rootIdentifier = [self identifierForPath:@"/"];
+	
+	for (NSDictionary* playlistDict in playlists)
+	{
+		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		
+		NSString* playlistID = [playlistDict objectForKey:@"Playlist Persistent ID"];
+		NSString* parentID = [playlistDict objectForKey:@"Parent Persistent ID"];
+		NSString* identifier = [self identifierWithPersistentID:playlistID];
+		NSString* parentIdentifier = parentID ? [self identifierWithPersistentID:parentID] : rootIdentifier;
+
+		if ([playlistsByIdentifier objectForKey:identifier] == nil)
+		{
+			[playlistsByIdentifier setObject:playlistDict forKey:identifier];
+		}
+		
+		if ([self shoudlUsePlaylist:playlistDict])
+		{
+			NSMutableArray* children = [childPlaylistIdentifiers objectForKey:parentIdentifier];
+			
+			if (children == nil)
+			{
+				children = [NSMutableArray array];
+				[childPlaylistIdentifiers setObject:children forKey:parentIdentifier];
+			}
+			
+			[children addObject:identifier];
+		}
+		
+		[pool drain];
+	}
+	
+	self.playlistsByIdentifier = playlistsByIdentifier;
+	self.childPlaylistIdentifiers = childPlaylistIdentifiers;
 }
 
 
@@ -501,45 +557,39 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
-- (void) addSubnodesToNode:(IMBNode*)inParentNode playlists:(NSArray*)inPlaylists tracks:(NSDictionary*)inTracks
+- (void) addSubnodesToNode:(IMBNode*)inParentNode
 {
 	// Create the subNodes array on demand - even if turns out to be empty after exiting this method, 
 	// because without creating an array we would cause an endless loop...
 	
 	NSMutableArray* subnodes = [inParentNode mutableArrayForPopulatingSubnodes];
 
-	// Now parse the iTunes XML plist and look for albums whose parent matches our parent node. We are 
-	// only going to add subnodes that are direct children of inParentNode...
+	// Look up the playlists whose parent matches our parent node. We are only going to add subnodes 
+	// that are direct children of inParentNode...
+	
+	NSDictionary* playlistsByIdentifier = self.playlistsByIdentifier;
+	NSArray* childIdentifiers = [self.childPlaylistIdentifiers objectForKey:inParentNode.identifier];
 	
-	for (NSDictionary* playlistDict in inPlaylists)
+	for (NSString* identifier in childIdentifiers)
 	{
 		NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+		NSDictionary* playlistDict = [playlistsByIdentifier objectForKey:identifier];
 		
-		NSString* albumName = [playlistDict objectForKey:@"Name"];
-		NSString* parentID = [playlistDict objectForKey:@"Parent Persistent ID"];
-		NSString* parentIdentifier = parentID ? [self identifierWithPersistentID:parentID] : [self identifierForPath:@"/"];
+		// Create node for this album...
 		
-		if ([self shoudlUsePlaylist:playlistDict] && [inParentNode.identifier isEqualToString:parentIdentifier])
-		{
-			// Create node for this album...
-			
-			IMBNode* playlistNode = [[[IMBNode alloc] initWithParser:self topLevel:NO] autorelease];
-			
-			playlistNode.isLeafNode = [self isLeafPlaylist:playlistDict];
-			playlistNode.icon = [self iconForPlaylist:playlistDict];
-			playlistNode.name = albumName;
+		IMBNode* playlistNode = [[[IMBNode alloc] initWithParser:self topLevel:NO] autorelease];
+		
+		playlistNode.isLeafNode = [self isLeafPlaylist:playlistDict];
+		playlistNode.icon = [self iconForPlaylist:playlistDict];
+		playlistNode.name = [playlistDict objectForKey:@"Name"];
 
-			// Set the node's identifier. This is needed later to link it to the correct parent node. Please note 
-			// that older versions of iPhoto didn't have AlbumId, so we are generating fake AlbumIds in this case
-			// for backwards compatibility...
-			
-			NSString* playlistID = [playlistDict objectForKey:@"Playlist Persistent ID"];
-			playlistNode.identifier = [self identifierWithPersistentID:playlistID];
+		// Set the node's identifier. This is needed later to link it to the correct parent node...
+		
+		playlistNode.identifier = identifier;
 
-			// Add the new album node to its parent (inRootNode)...
-			
-			[subnodes addObject:playlistNode];
-		}
+		// Add the new album node to its parent (inRootNode)...
+		
+		[subnodes addObject:playlistNode];
 		
 		[pool drain];
 	}
@@ -549,91 +599,89 @@
 //----------------------------------------------------------------------------------------------------------------------
 
 
-- (void) populateNode:(IMBNode*)inNode playlists:(NSArray*)inPlaylists tracks:(NSDictionary*)inTracks
+- (void) populateNode:(IMBNode*)inNode tracks:(IMBiTunesLibraryStore*)inTracks
 {
 	// Create the objects array on demand  - even if turns out to be empty after exiting this method, because
 	// without creating an array we would cause an endless loop...
 	
 	NSMutableArray* objects = [NSMutableArray array];
     
-	// Look for the correct playlist in the iTunes XML plist. Once we find it, populate the node with IMBVisualObjects
+	// Look up the correct playlist in the index. Once we find it, populate the node with IMBVisualObjects
 	// for each song in this playlist...
 	
-	for (NSDictionary* playlistDict in inPlaylists)
+	NSDictionary* playlistDict = [self.playlistsByIdentifier objectForKey:inNode.identifier];
+	
+	if (playlistDict)
 	{
-		NSAutoreleasePool* pool1 = [[NSAutoreleasePool alloc] init];
-		NSString* playlistID = [playlistDict objectForKey:@"Playlist Persistent ID"];
-		NSString* playlistIdentifier = [self identifierWithPersistentID:playlistID];
+		NSData* trackIDs = [playlistDict objectForKey:kIMBiTunesPlaylistTrackIDsKey];
+		const uint32_t* trackID = (const uint32_t*) [trackIDs bytes];
+		NSUInteger count = [trackIDs length] / sizeof(uint32_t);
+		NSUInteger index = 0;
 
-		if ([inNode.identifier isEqualToString:playlistIdentifier])
+		for (NSUInteger i=0; i<count; i++)
 		{
-			NSArray* trackKeys = [playlistDict objectForKey:@"Playlist Items"];
-			NSUInteger index = 0;
-
-			for (NSDictionary* trackID in trackKeys)
+			NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+			NSDictionary* trackDict = [inTracks trackWithID:trackID[i]];
+		
+			if ([self shouldUseTrack:trackDict])
 			{
-				NSAutoreleasePool* pool2 = [[NSAutoreleasePool alloc] init];
-				NSString* key = [[trackID objectForKey:@"Track ID"] stringValue];
-				NSDictionary* trackDict = [inTracks objectForKey:key];
-			
-				if ([self shouldUseTrack:trackDict])
-				{
-					// Get name and path to file...
-					
-					NSString* name = [trackDict objectForKey:@"Name"];
-					NSString* location = [trackDict objectForKey:@"Location"];
-					NSURL* url = [NSURL URLWithString:location];
-					
-					// Create an object...
-					
-					IMBObject* object = [[IMBObject alloc] init];
-					[objects addObject:object];
-					[object release];
-
-					// For local files path is preferred (as we gain automatic support for some context menu items).
-					// For remote files we'll use a URL (less context menu support)...
-					
-					object.location = url;
-                    object.accessibility = [self accessibilityForObject:object];
-					object.name = name;
-					object.parserIdentifier = self.identifier;
-					object.index = index++;
-					
-					object.imageLocation = (id)url;
-					object.imageRepresentationType = IKImageBrowserCGImageRepresentationType; 
-					object.imageRepresentation = nil;	// will be loaded lazily when needed
-
-					// Add metadata and convert the duration property to seconds. Also note that the original
-					// key "Total Time" is not bindings compatible as it contains a space...
-					
-					NSMutableDictionary* metadata = [NSMutableDictionary dictionaryWithDictionary:trackDict];
-					object.metadata = metadata;
-					
-					double duration = [[trackDict objectForKey:@"Total Time"] doubleValue] / 1000.0;
-					[metadata setObject:[NSNumber numberWithDouble:duration] forKey:@"duration"]; 
-					
-					NSString* artist = [trackDict objectForKey:@"Artist"];
-					if (artist) [metadata setObject:artist forKey:@"artist"]; 
-					
-					NSString* album = [trackDict objectForKey:@"Album"];
-					if (album) [metadata setObject:album forKey:@"album"]; 
-					
-					NSString* genre = [trackDict objectForKey:@"Genre"];
-					if (genre) [metadata setObject:genre forKey:@"genre"]; 
-
-					NSString* comment = [trackDict objectForKey:@"Comment"];
-					if (comment) [metadata setObject:comment forKey:@"comment"]; 
-					
-					object.metadataDescription = [self metadataDescriptionForMetadata:metadata];
-				}
+				// Get name and path to file...
+				
+				NSString* name = [trackDict objectForKey:@"Name"];
+				NSString* location = [trackDict objectForKey:@"Location"];
+				NSURL* url = [NSURL URLWithString:location];
+				
+				// Create an object...
 				
-				[pool2 drain];
+				IMBObject* object = [[IMBObject alloc] init];
+				[objects addObject:object];
+				[object release];
+
+				// For local files path is preferred (as we gain automatic support for some context menu items).
+				// For remote files we'll use a URL (less context menu support)...
+				
+				object.location = url;
+                object.accessibility = kIMBResourceAccessibilityUnknown;		// Resolved in one batch below
+				object.name = name;
+				object.parserIdentifier = self.identifier;
+				object.index = index++;
+				
+				object.imageLocation = (id)url;
+				object.imageRepresentationType = IKImageBrowserCGImageRepresentationType; 
+				object.imageRepresentation = nil;	// will be loaded lazily when needed
+
+				// Add metadata and convert the duration property to seconds. Also note that the original
+				// key "Total Time" is not bindings compatible as it contains a space...
+				
+				NSMutableDictionary* metadata = [NSMutableDictionary dictionaryWithDictionary:trackDict];
+				object.metadata = metadata;
+				
+				double duration = [[trackDict objectForKey:@"Total Time"] doubleValue] / 1000.0;
+				[metadata setObject:[NSNumber numberWithDouble:duration] forKey:@"duration"]; 
+				
+				NSString* artist = [trackDict objectForKey:@"Artist"];
+				if (artist) [metadata setObject:artist forKey:@"artist"]; 
+				
+				NSString* album = [trackDict objectForKey:@"Album"];
+				if (album) [metadata setObject:album forKey:@"album"]; 
+				
+				NSString* genre = [trackDict objectForKey:@"Genre"];
+				if (genre) [metadata setObject:genre forKey:@"genre"]; 
+
+				NSString* comment = [trackDict objectForKey:@"Comment"];
+				if (comment) [metadata setObject:comment forKey:@"comment"]; 
+				
+				object.metadataDescription = [self metadataDescriptionForMetadata:metadata];
 			}
+			
+			[pool drain];
 		}
-		
-		[pool1 drain];
 	}
     
+	// The audio list never loads thumbnails, which is where other objects get their accessibility resolved. So 
+	// resolve it here (one directory listing per album folder), otherwise missing tracks would appear playable...
+	
+	[self resolveAccessibilityForObjects:objects];
     inNode.objects = objects;
 }
 
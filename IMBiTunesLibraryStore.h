@@ -0,0 +1,122 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBCommon.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+// Playlist dictionaries returned by IMBiTunesLibraryStore do not contain the (huge) "Playlist Items" array. 
+// Instead the track IDs are stored as packed uint32_t values in an NSData under this key...
+
+extern NSString* const kIMBiTunesPlaylistTrackIDsKey;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// IMBiTunesLibraryStore reads "iTunes Music Library.xml" with a streaming (SAX style) parser, so that the 
+// XML DOM is never materialized in memory. Tracks are stored in a compact columnar table (track IDs, durations,
+// interned strings for artist/album/genre/kind, locations, plus the remaining scalar values of each track), while 
+// playlists are kept as small dictionaries with packed track ID arrays. Dates are parsed into NSDate objects. Peak memory is thus proportional to the compact table rather than the XML file.
+// Instances are immutable once loaded and can be shared between threads...
+
+@interface IMBiTunesLibraryStore : NSObject
+{
+	NSDictionary* _properties;
+	NSArray* _playlists;
+	
+	NSUInteger _trackCount;
+	NSMutableData* _trackIDs;
+	NSMutableData* _totalTimes;
+	NSMutableData* _artists;
+	NSMutableData* _albums;
+	NSMutableData* _genres;
+	NSMutableData* _kinds;
+	NSMutableData* _videoSizes;
+	NSMutableData* _flags;
+	NSMutableArray* _names;
+	NSMutableArray* _locations;
+	NSMutableDictionary* _comments;
+	NSMutableDictionary* _otherValues;
+	NSMutableArray* _strings;
+	CFMutableDictionaryRef _stringIndexes;
+	CFMutableDictionaryRef _rowsByTrackID;
+}
+
+// Parses the XML file. Returns nil (and an error) if the file could not be read or is not a valid plist...
+
++ (IMBiTunesLibraryStore*) storeWithContentsOfURL:(NSURL*)inURL error:(NSError**)outError;
+
+// Top level scalar values of the XML file (e.g. "Application Version")...
+
+@property (retain,readonly) NSDictionary* properties;
+
+// Playlist dictionaries in the order of the XML file (see kIMBiTunesPlaylistTrackIDsKey)...
+
+@property (retain,readonly) NSArray* playlists;
+
+// Returns a dictionary with all scalar values of the original track dictionary (with their original property list
+// types), or nil if there is no track with the given ID. Nested arrays, dictionaries and data are not kept...
+
+- (NSDictionary*) trackWithID:(uint32_t)inTrackID;
+
+@property (readonly) NSUInteger trackCount;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
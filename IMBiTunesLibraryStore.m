@@ -0,0 +1,631 @@
+/*
+ iMedia Browser Framework <http://karelia.com/imedia/>
+ 
+ Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+ iMedia Browser is based on code originally developed by Jason Terhorst,
+ further developed for Sandvox by Greg Hulands, Dan Wood, and Terrence Talbot.
+ The new architecture for version 2.0 was developed by Peter Baumgartner.
+ Contributions have also been made by Matt Gough, Martin Wennerberg and others
+ as indicated in source files.
+ 
+ The iMedia Browser Framework is licensed under the following terms:
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in all or substantial portions of the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to permit
+ persons to whom the Software is furnished to do so, subject to the following
+ conditions:
+ 
+	Redistributions of source code must retain the original terms stated here,
+	including this list of conditions, the disclaimer noted below, and the
+	following copyright notice: Copyright (c) 2005-2012 by Karelia Software et al.
+ 
+	Redistributions in binary form must include, in an end-user-visible manner,
+	e.g., About window, Acknowledgments window, or similar, either a) the original
+	terms stated here, including this list of conditions, the disclaimer noted
+	below, and the aforementioned copyright notice, or b) the aforementioned
+	copyright notice and a link to karelia.com/imedia.
+ 
+	Neither the name of Karelia Software, nor Sandvox, nor the names of
+	contributors to iMedia Browser may be used to endorse or promote products
+	derived from the Software without prior and express written permission from
+	Karelia Software or individual contributors, as appropriate.
+ 
+ Disclaimer: THE SOFTWARE IS PROVIDED BY THE COPYRIGHT OWNER AND CONTRIBUTORS
+ "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ LIABLE FOR ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ CONTRACT, TORT, OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION WITH, THE
+ SOFTWARE OR THE USE OF, OR OTHER DEALINGS IN, THE SOFTWARE.
+*/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark HEADERS
+
+#import "IMBiTunesLibraryStore.h"
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark CONSTANTS
+
+NSString* const kIMBiTunesPlaylistTrackIDsKey = @"IMBTrackIDs";
+
+enum
+{
+	kIMBiTunesTrackHasVideo = 1 << 0,
+	kIMBiTunesTrackIsProtected = 1 << 1,
+	kIMBiTunesTrackHasTotalTime = 1 << 2,
+	kIMBiTunesTrackHasVideoSize = 1 << 3
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@interface IMBiTunesLibraryStore ()
+
+- (void) _setProperties:(NSDictionary*)inProperties playlists:(NSArray*)inPlaylists;
+- (void) _addTrack:(NSDictionary*)inTrackDict;
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+// The builder is the NSXMLParser delegate. It keeps a stack of the containers that are currently open. Track
+// dictionaries are handed over to the store as soon as they are complete and then discarded, and the contents 
+// of "Playlist Items" arrays are directly packed into an NSMutableData. Everything else (top level values and
+// playlist dictionaries) is small and built like a regular property list...
+
+@interface IMBiTunesLibraryStoreBuilder : NSObject <NSXMLParserDelegate>
+{
+	IMBiTunesLibraryStore* _store;
+	NSMutableArray* _containers;
+	NSMutableArray* _containerKeys;
+	NSString* _pendingKey;
+	NSMutableString* _text;
+	BOOL _isCollectingText;
+	
+	NSMutableDictionary* _root;
+	NSMutableDictionary* _tracks;
+	NSMutableArray* _playlists;
+	
+	NSMutableData* _playlistItems;
+	NSUInteger _playlistItemsDepth;
+	BOOL _isTrackIDKey;
+	
+	NSDateFormatter* _dateFormatter;
+}
+
+- (id) initWithStore:(IMBiTunesLibraryStore*)inStore;
+- (NSDictionary*) root;
+- (NSArray*) playlists;
+
+@end
+
+
+@implementation IMBiTunesLibraryStoreBuilder
+
+
+- (id) initWithStore:(IMBiTunesLibraryStore*)inStore
+{
+	if (self = [super init])
+	{
+		_store = inStore;
+		_containers = [[NSMutableArray alloc] init];
+		_containerKeys = [[NSMutableArray alloc] init];
+		_text = [[NSMutableString alloc] init];
+		
+		// Dates in property lists are always ISO 8601 in UTC...
+		
+		_dateFormatter = [[NSDateFormatter alloc] init];
+		[_dateFormatter setLocale:[[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"] autorelease]];
+		[_dateFormatter setTimeZone:[NSTimeZone timeZoneForSecondsFromGMT:0]];
+		[_dateFormatter setDateFormat:@"yyyy'-'MM'-'dd'T'HH':'mm':'ss'Z'"];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_containers);
+	IMBRelease(_containerKeys);
+	IMBRelease(_pendingKey);
+	IMBRelease(_text);
+	IMBRelease(_root);
+	IMBRelease(_tracks);
+	IMBRelease(_playlists);
+	IMBRelease(_playlistItems);
+	IMBRelease(_dateFormatter);
+	[super dealloc];
+}
+
+
+- (NSDictionary*) root
+{
+	return _root;
+}
+
+
+- (NSArray*) playlists
+{
+	return _playlists;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+- (void) _addValue:(id)inValue
+{
+	id container = [_containers lastObject];
+	
+	if ([container isKindOfClass:[NSMutableDictionary class]])
+	{
+		if (_pendingKey) [container setObject:inValue forKey:_pendingKey];
+		IMBRelease(_pendingKey);
+	}
+	else
+	{
+		[container addObject:inValue];
+	}
+}
+
+
+- (void) parser:(NSXMLParser*)inParser didStartElement:(NSString*)inElementName namespaceURI:(NSString*)inNamespaceURI qualifiedName:(NSString*)inQualifiedName attributes:(NSDictionary*)inAttributes
+{
+	BOOL isDict = [inElementName isEqualToString:@"dict"];
+	BOOL isArray = [inElementName isEqualToString:@"array"];
+	
+	// Inside "Playlist Items" we only care about "Track ID" keys and their integer values...
+	
+	if (_playlistItemsDepth > 0)
+	{
+		if (isDict || isArray) _playlistItemsDepth++;
+		_isCollectingText = [inElementName isEqualToString:@"key"] || [inElementName isEqualToString:@"integer"];
+		[_text setString:@""];
+		return;
+	}
+	
+	if (isArray && [_pendingKey isEqualToString:@"Playlist Items"] && [_containers count] == 3 && [_containers objectAtIndex:1] == _playlists)
+	{
+		_playlistItemsDepth = 1;
+		IMBRelease(_playlistItems);
+		_playlistItems = [[NSMutableData alloc] init];
+		return;
+	}
+	
+	if (isDict || isArray)
+	{
+		id container = isDict ? [[NSMutableDictionary alloc] init] : [[NSMutableArray alloc] init];
+		
+		if (_root == nil && isDict)
+		{
+			_root = [container retain];
+		}
+		else if ([_containers count] == 1 && [_pendingKey isEqualToString:@"Tracks"] && isDict)
+		{
+			_tracks = [container retain];
+		}
+		else if ([_containers count] == 1 && [_pendingKey isEqualToString:@"Playlists"] && isArray)
+		{
+			_playlists = [container retain];
+		}
+		
+		[_containers addObject:container];
+		[_containerKeys addObject:_pendingKey ? (id)_pendingKey : (id)[NSNull null]];
+		IMBRelease(_pendingKey);
+		[container release];
+		return;
+	}
+	
+	// Binary data (artwork, smart playlist criteria) is never needed, so we do not even collect its text...
+	
+	_isCollectingText = ![inElementName isEqualToString:@"data"];
+	[_text setString:@""];
+}
+
+
+- (void) parser:(NSXMLParser*)inParser foundCharacters:(NSString*)inString
+{
+	if (_isCollectingText) [_text appendString:inString];
+}
+
+
+- (void) parser:(NSXMLParser*)inParser didEndElement:(NSString*)inElementName namespaceURI:(NSString*)inNamespaceURI qualifiedName:(NSString*)inQualifiedName
+{
+	BOOL isDict = [inElementName isEqualToString:@"dict"];
+	BOOL isArray = [inElementName isEqualToString:@"array"];
+
+	// Pack track IDs of playlist items...
+	
+	if (_playlistItemsDepth > 0)
+	{
+		if (isDict || isArray)
+		{
+			if (--_playlistItemsDepth == 0)
+			{
+				[[_containers lastObject] setObject:_playlistItems forKey:kIMBiTunesPlaylistTrackIDsKey];
+				IMBRelease(_playlistItems);
+				IMBRelease(_pendingKey);
+			}
+		}
+		else if ([inElementName isEqualToString:@"key"])
+		{
+			_isTrackIDKey = [_text isEqualToString:@"Track ID"];
+		}
+		else if ([inElementName isEqualToString:@"integer"] && _isTrackIDKey)
+		{
+			uint32_t trackID = (uint32_t) [_text longLongValue];
+			[_playlistItems appendBytes:&trackID length:sizeof(trackID)];
+		}
+		
+		_isCollectingText = NO;
+		return;
+	}
+	
+	// Close a container. Completed track dictionaries go straight into the store... 
+	
+	if (isDict || isArray)
+	{
+		id container = [[_containers lastObject] retain];
+		id key = [[_containerKeys lastObject] retain];
+		[_containers removeLastObject];
+		[_containerKeys removeLastObject];
+		
+		if ([_containers count] > 0)
+		{
+			if ([_containers lastObject] == _tracks)
+			{
+				[_store _addTrack:container];
+			}
+			else if (container != _tracks)
+			{
+				IMBRelease(_pendingKey);
+				_pendingKey = (key == [NSNull null]) ? nil : [key retain];
+				[self _addValue:container];
+			}
+		}
+		
+		[container release];
+		[key release];
+		return;
+	}
+	
+	// Scalar values...
+	
+	id value = nil;
+	
+	if ([inElementName isEqualToString:@"key"])
+	{
+		IMBRelease(_pendingKey);
+		_pendingKey = [_text copy];
+	}
+	else if ([inElementName isEqualToString:@"string"])
+	{
+		value = [[_text copy] autorelease];
+	}
+	else if ([inElementName isEqualToString:@"date"])
+	{
+		value = [_dateFormatter dateFromString:_text];
+	}
+	else if ([inElementName isEqualToString:@"integer"])
+	{
+		value = [NSNumber numberWithLongLong:[_text longLongValue]];
+	}
+	else if ([inElementName isEqualToString:@"real"])
+	{
+		value = [NSNumber numberWithDouble:[_text doubleValue]];
+	}
+	else if ([inElementName isEqualToString:@"true"])
+	{
+		value = [NSNumber numberWithBool:YES];
+	}
+	else if ([inElementName isEqualToString:@"false"])
+	{
+		value = [NSNumber numberWithBool:NO];
+	}
+	else if ([inElementName isEqualToString:@"data"])
+	{
+		value = [NSData data];
+	}
+	
+	if (value && [_containers count] > 0)
+	{
+		[self _addValue:value];
+	}
+	
+	_isCollectingText = NO;
+}
+
+
+@end
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+
+@implementation IMBiTunesLibraryStore
+
+@synthesize properties = _properties;
+@synthesize playlists = _playlists;
+@synthesize trackCount = _trackCount;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
++ (IMBiTunesLibraryStore*) storeWithContentsOfURL:(NSURL*)inURL error:(NSError**)outError
+{
+	IMBiTunesLibraryStore* store = [[[IMBiTunesLibraryStore alloc] init] autorelease];
+	IMBiTunesLibraryStoreBuilder* builder = [[IMBiTunesLibraryStoreBuilder alloc] initWithStore:store];
+	NSInputStream* stream = [NSInputStream inputStreamWithURL:inURL];
+	NSXMLParser* parser = [[NSXMLParser alloc] initWithStream:stream];
+	NSError* error = nil;
+	
+	[parser setDelegate:builder];
+	[parser setShouldResolveExternalEntities:NO];
+	
+	if ([parser parse] && [builder root] != nil)
+	{
+		NSMutableDictionary* properties = [NSMutableDictionary dictionaryWithDictionary:[builder root]];
+		[properties removeObjectForKey:@"Tracks"];
+		[properties removeObjectForKey:@"Playlists"];
+		[store _setProperties:properties playlists:[builder playlists]];
+	}
+	else
+	{
+		error = [parser parserError];
+		
+		if (error == nil)
+		{
+			NSString* description = [NSString stringWithFormat:@"Could not read iTunes library at %@",inURL];
+			NSDictionary* info = [NSDictionary dictionaryWithObjectsAndKeys:description,NSLocalizedDescriptionKey,nil];
+			error = [NSError errorWithDomain:kIMBErrorDomain code:kIMBErrorInvalidState userInfo:info];
+		}
+		
+		store = nil;
+	}
+	
+	[parser release];
+	[builder release];
+	
+	if (outError) *outError = error;
+	return store;
+}
+
+
+- (id) init
+{
+	if (self = [super init])
+	{
+		_trackIDs = [[NSMutableData alloc] init];
+		_totalTimes = [[NSMutableData alloc] init];
+		_artists = [[NSMutableData alloc] init];
+		_albums = [[NSMutableData alloc] init];
+		_genres = [[NSMutableData alloc] init];
+		_kinds = [[NSMutableData alloc] init];
+		_videoSizes = [[NSMutableData alloc] init];
+		_flags = [[NSMutableData alloc] init];
+		_names = [[NSMutableArray alloc] init];
+		_locations = [[NSMutableArray alloc] init];
+		_comments = [[NSMutableDictionary alloc] init];
+		_otherValues = [[NSMutableDictionary alloc] init];
+		_strings = [[NSMutableArray alloc] initWithObjects:[NSNull null],nil];
+		_rowsByTrackID = CFDictionaryCreateMutable(kCFAllocatorDefault,0,NULL,NULL);
+		_stringIndexes = CFDictionaryCreateMutable(kCFAllocatorDefault,0,&kCFTypeDictionaryKeyCallBacks,NULL);
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	IMBRelease(_properties);
+	IMBRelease(_playlists);
+	IMBRelease(_trackIDs);
+	IMBRelease(_totalTimes);
+	IMBRelease(_artists);
+	IMBRelease(_albums);
+	IMBRelease(_genres);
+	IMBRelease(_kinds);
+	IMBRelease(_videoSizes);
+	IMBRelease(_flags);
+	IMBRelease(_names);
+	IMBRelease(_locations);
+	IMBRelease(_comments);
+	IMBRelease(_otherValues);
+	IMBRelease(_strings);
+	if (_rowsByTrackID) CFRelease(_rowsByTrackID);
+	if (_stringIndexes) CFRelease(_stringIndexes);
+	[super dealloc];
+}
+
+
+- (void) _setProperties:(NSDictionary*)inProperties playlists:(NSArray*)inPlaylists
+{
+	_properties = [inProperties copy];
+	_playlists = inPlaylists ? [inPlaylists copy] : [[NSArray alloc] init];
+	
+	// The interning dictionary is not needed anymore once loading is done...
+	
+	if (_stringIndexes) CFRelease(_stringIndexes);
+	_stringIndexes = NULL;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+#pragma mark 
+#pragma mark Track Table
+
+// Artists, albums, genres and kinds repeat a lot, so they are interned and stored as uint32_t indexes. Index 0
+// means "no value"...
+
+static uint32_t _IMBInternString(NSMutableArray* inStrings,CFMutableDictionaryRef inIndexes,NSString* inString)
+{
+	if (![inString isKindOfClass:[NSString class]]) return 0;
+	
+	const void* index = NULL;
+	
+	if (CFDictionaryGetValueIfPresent(inIndexes,inString,&index))
+	{
+		return (uint32_t)(uintptr_t)index;
+	}
+	
+	uint32_t newIndex = (uint32_t)[inStrings count];
+	[inStrings addObject:inString];
+	CFDictionarySetValue(inIndexes,inString,(const void*)(uintptr_t)newIndex);
+	return newIndex;
+}
+
+
+// Keys that are stored in the columns of the track table...
+
+static BOOL _IMBIsTrackColumnKey(NSString* inKey)
+{
+	static NSSet* sKeys = nil;
+	static dispatch_once_t sOnceToken = 0;
+	
+	dispatch_once(&sOnceToken,
+	^{
+		sKeys = [[NSSet alloc] initWithObjects:
+			@"Track ID",@"Name",@"Location",@"Artist",@"Album",@"Genre",@"Kind",@"Comments",
+			@"Total Time",@"Has Video",@"Protected",@"Video Width",@"Video Height",
+			nil];
+	});
+	
+	return [sKeys containsObject:inKey];
+}
+
+
+- (void) _addTrack:(NSDictionary*)inTrackDict
+{
+	uint32_t trackID = (uint32_t) [[inTrackDict objectForKey:@"Track ID"] longLongValue];
+	uint64_t totalTime = (uint64_t) [[inTrackDict objectForKey:@"Total Time"] longLongValue];
+	uint32_t artist = _IMBInternString(_strings,_stringIndexes,[inTrackDict objectForKey:@"Artist"]);
+	uint32_t album = _IMBInternString(_strings,_stringIndexes,[inTrackDict objectForKey:@"Album"]);
+	uint32_t genre = _IMBInternString(_strings,_stringIndexes,[inTrackDict objectForKey:@"Genre"]);
+	uint32_t kind = _IMBInternString(_strings,_stringIndexes,[inTrackDict objectForKey:@"Kind"]);
+	uint32_t videoSize[2] = { 
+		(uint32_t)[[inTrackDict objectForKey:@"Video Width"] longLongValue], 
+		(uint32_t)[[inTrackDict objectForKey:@"Video Height"] longLongValue] };
+	
+	uint8_t flags = 0;
+	if ([[inTrackDict objectForKey:@"Has Video"] boolValue]) flags |= kIMBiTunesTrackHasVideo;
+	if ([[inTrackDict objectForKey:@"Protected"] boolValue]) flags |= kIMBiTunesTrackIsProtected;
+	if ([inTrackDict objectForKey:@"Total Time"]) flags |= kIMBiTunesTrackHasTotalTime;
+	if ([inTrackDict objectForKey:@"Video Width"] && [inTrackDict objectForKey:@"Video Height"]) flags |= kIMBiTunesTrackHasVideoSize;
+	
+	NSString* name = [inTrackDict objectForKey:@"Name"];
+	NSString* location = [inTrackDict objectForKey:@"Location"];
+	NSString* comment = [inTrackDict objectForKey:@"Comments"];
+
+	// All other scalar values (play counts, ratings, dates, etc.) are kept with their original type. Their keys 
+	// are the same for every track, so they are interned like the strings above...
+	
+	NSMutableDictionary* otherValues = nil;
+	
+	for (NSString* key in inTrackDict)
+	{
+		if (_IMBIsTrackColumnKey(key)) continue;
+		
+		id value = [inTrackDict objectForKey:key];
+		
+		if ([value isKindOfClass:[NSString class]] || [value isKindOfClass:[NSNumber class]] || [value isKindOfClass:[NSDate class]])
+		{
+			if (otherValues == nil) otherValues = [NSMutableDictionary dictionaryWithCapacity:[inTrackDict count]];
+			uint32_t keyIndex = _IMBInternString(_strings,_stringIndexes,key);
+			[otherValues setObject:value forKey:[_strings objectAtIndex:keyIndex]];
+		}
+	}
+
+	[_trackIDs appendBytes:&trackID length:sizeof(trackID)];
+	[_totalTimes appendBytes:&totalTime length:sizeof(totalTime)];
+	[_artists appendBytes:&artist length:sizeof(artist)];
+	[_albums appendBytes:&album length:sizeof(album)];
+	[_genres appendBytes:&genre length:sizeof(genre)];
+	[_kinds appendBytes:&kind length:sizeof(kind)];
+	[_videoSizes appendBytes:videoSize length:sizeof(videoSize)];
+	[_flags appendBytes:&flags length:sizeof(flags)];
+	[_names addObject:name ? (id)name : (id)[NSNull null]];
+	[_locations addObject:location ? (id)location : (id)[NSNull null]];
+	if (comment) [_comments setObject:comment forKey:[NSNumber numberWithUnsignedInteger:_trackCount]];
+	if (otherValues) [_otherValues setObject:[[otherValues copy] autorelease] forKey:[NSNumber numberWithUnsignedInteger:_trackCount]];
+	
+	CFDictionarySetValue(_rowsByTrackID,(const void*)(uintptr_t)trackID,(const void*)(uintptr_t)_trackCount);
+	_trackCount++;
+}
+
+
+- (NSDictionary*) trackWithID:(uint32_t)inTrackID
+{
+	const void* value = NULL;
+	if (!CFDictionaryGetValueIfPresent(_rowsByTrackID,(const void*)(uintptr_t)inTrackID,&value)) return nil;
+	NSUInteger row = (NSUInteger)(uintptr_t)value;
+	
+	uint8_t flags = ((const uint8_t*)[_flags bytes])[row];
+	uint32_t artist = ((const uint32_t*)[_artists bytes])[row];
+	uint32_t album = ((const uint32_t*)[_albums bytes])[row];
+	uint32_t genre = ((const uint32_t*)[_genres bytes])[row];
+	uint32_t kind = ((const uint32_t*)[_kinds bytes])[row];
+	const uint32_t* videoSize = ((const uint32_t*)[_videoSizes bytes]) + 2*row;
+	id name = [_names objectAtIndex:row];
+	id location = [_locations objectAtIndex:row];
+	NSString* comment = [_comments objectForKey:[NSNumber numberWithUnsignedInteger:row]];
+	NSDictionary* otherValues = [_otherValues objectForKey:[NSNumber numberWithUnsignedInteger:row]];
+	
+	NSMutableDictionary* track = [NSMutableDictionary dictionaryWithCapacity:12 + [otherValues count]];
+	if (otherValues) [track addEntriesFromDictionary:otherValues];
+	[track setObject:[NSNumber numberWithUnsignedInt:inTrackID] forKey:@"Track ID"];
+	if (name != [NSNull null]) [track setObject:name forKey:@"Name"];
+	if (location != [NSNull null]) [track setObject:location forKey:@"Location"];
+	if (artist) [track setObject:[_strings objectAtIndex:artist] forKey:@"Artist"];
+	if (album) [track setObject:[_strings objectAtIndex:album] forKey:@"Album"];
+	if (genre) [track setObject:[_strings objectAtIndex:genre] forKey:@"Genre"];
+	if (kind) [track setObject:[_strings objectAtIndex:kind] forKey:@"Kind"];
+	if (comment) [track setObject:comment forKey:@"Comments"];
+	
+	if (flags & kIMBiTunesTrackHasTotalTime)
+	{
+		uint64_t totalTime = ((const uint64_t*)[_totalTimes bytes])[row];
+		[track setObject:[NSNumber numberWithUnsignedLongLong:totalTime] forKey:@"Total Time"];
+	}
+	
+	if (flags & kIMBiTunesTrackHasVideo) [track setObject:[NSNumber numberWithBool:YES] forKey:@"Has Video"];
+	if (flags & kIMBiTunesTrackIsProtected) [track setObject:[NSNumber numberWithBool:YES] forKey:@"Protected"];
+	
+	if (flags & kIMBiTunesTrackHasVideoSize)
+	{
+		[track setObject:[NSNumber numberWithUnsignedInt:videoSize[0]] forKey:@"Video Width"];
+		[track setObject:[NSNumber numberWithUnsignedInt:videoSize[1]] forKey:@"Video Height"];
+	}
+	
+	return track;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+@end
@@ -33,6 +33,12 @@
 
 #import <Cocoa/Cocoa.h>
 
+// Plain C byte pattern search over a buffer. Candidates are filtered with SIMD compares of the first and last 
+// pattern byte (SSE2 or NEON, with a scalar fallback), only those are verified with memcmp. Returns NSNotFound 
+// if the pattern does not occur...
+
+extern NSUInteger SKIndexOfBytes(const void *bytes, NSUInteger length, const void *patternBytes, NSUInteger patternLength, BOOL backwards);
+
 @interface NSData (SKExtensions)
 
 - (NSUInteger)lastIndexOfBytes:(const void *)patternBytes length:(NSUInteger)patternLength;
@@ -33,6 +33,104 @@
 
 #import "NSData+SKExtensions.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Number of candidate positions tested per block, and how many mask bits describe one position...
+
+#define SK_BLOCK_SIZE 16
+
+#if defined(__ARM_NEON)
+#define SK_MASK_BITS_PER_BYTE 4
+#else
+#define SK_MASK_BITS_PER_BYTE 1
+#endif
+
+// Returns a mask of the positions in a block of SK_BLOCK_SIZE bytes where the first pattern byte matches at 
+// firstPtr and the last pattern byte matches at lastPtr...
+
+static inline uint64_t SKCandidateMask(const unsigned char *firstPtr, const unsigned char *lastPtr, unsigned char firstByte, unsigned char lastByte)
+{
+#if defined(__SSE2__)
+    __m128i first = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)firstPtr), _mm_set1_epi8((char)firstByte));
+    __m128i last = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)lastPtr), _mm_set1_epi8((char)lastByte));
+    return (uint64_t)_mm_movemask_epi8(_mm_and_si128(first, last));
+#elif defined(__ARM_NEON)
+    uint8x16_t first = vceqq_u8(vld1q_u8(firstPtr), vdupq_n_u8(firstByte));
+    uint8x16_t last = vceqq_u8(vld1q_u8(lastPtr), vdupq_n_u8(lastByte));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(first, last)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+#else
+    uint64_t mask = 0;
+    NSUInteger i;
+    for (i = 0; i < SK_BLOCK_SIZE; i++) {
+        if (firstPtr[i] == firstByte && lastPtr[i] == lastByte)
+            mask |= (uint64_t)1 << i;
+    }
+    return mask;
+#endif
+}
+
+static inline BOOL SKMatchesAt(const unsigned char *ptr, const unsigned char *pattern, NSUInteger patternLength)
+{
+    // First and last byte have already been compared...
+    return patternLength <= 2 || memcmp(ptr + 1, pattern + 1, patternLength - 2) == 0;
+}
+
+NSUInteger SKIndexOfBytes(const void *bytes, NSUInteger length, const void *patternBytes, NSUInteger patternLength, BOOL backwards)
+{
+    const unsigned char *buffer = bytes;
+    const unsigned char *pattern = patternBytes;
+    
+    if (patternLength == 0)
+        return backwards ? length : 0;
+    if (patternLength > length || buffer == NULL)
+        return NSNotFound;
+    
+    unsigned char firstByte = pattern[0];
+    unsigned char lastByte = pattern[patternLength - 1];
+    NSUInteger lastStart = length - patternLength;  // highest possible match position
+    NSUInteger i;
+    
+    if (backwards == NO) {
+        for (i = 0; lastStart >= SK_BLOCK_SIZE - 1 && i <= lastStart - (SK_BLOCK_SIZE - 1); i += SK_BLOCK_SIZE) {
+            uint64_t mask = SKCandidateMask(buffer + i, buffer + i + patternLength - 1, firstByte, lastByte);
+            while (mask) {
+                NSUInteger offset = __builtin_ctzll(mask) / SK_MASK_BITS_PER_BYTE;
+                if (SKMatchesAt(buffer + i + offset, pattern, patternLength))
+                    return i + offset;
+                mask &= ~((((uint64_t)1 << SK_MASK_BITS_PER_BYTE) - 1) << (offset * SK_MASK_BITS_PER_BYTE));
+            }
+        }
+        for (; i <= lastStart; i++) {
+            if (buffer[i] == firstByte && buffer[i + patternLength - 1] == lastByte && SKMatchesAt(buffer + i, pattern, patternLength))
+                return i;
+        }
+    } else {
+        // i is the exclusive upper bound of the candidates still to be tested...
+        for (i = lastStart + 1; i >= SK_BLOCK_SIZE; i -= SK_BLOCK_SIZE) {
+            NSUInteger blockStart = i - SK_BLOCK_SIZE;
+            uint64_t mask = SKCandidateMask(buffer + blockStart, buffer + blockStart + patternLength - 1, firstByte, lastByte);
+            while (mask) {
+                NSUInteger offset = (63 - __builtin_clzll(mask)) / SK_MASK_BITS_PER_BYTE;
+                if (SKMatchesAt(buffer + blockStart + offset, pattern, patternLength))
+                    return blockStart + offset;
+                mask &= ~((((uint64_t)1 << SK_MASK_BITS_PER_BYTE) - 1) << (offset * SK_MASK_BITS_PER_BYTE));
+            }
+        }
+        while (i-- > 0) {
+            if (buffer[i] == firstByte && buffer[i + patternLength - 1] == lastByte && SKMatchesAt(buffer + i, pattern, patternLength))
+                return i;
+        }
+    }
+    
+    return NSNotFound;
+}
+
+
 @implementation NSData (SKExtensions)
 
 - (NSUInteger)lastIndexOfBytes:(const void *)patternBytes length:(NSUInteger)patternLength
@@ -56,10 +154,6 @@
     if (searchRange.location > selfLength || NSMaxRange(searchRange) > selfLength)
         [NSException raise:NSRangeException format:@"Range {%lu,%lu} exceeds length %lu", (unsigned long)searchRange.location, (unsigned long)searchRange.length, (unsigned long)selfLength];
     
-    unsigned const char *selfBufferStart, *selfPtr, *selfPtrEnd, *selfPtrMax;
-    unsigned const char firstPatternByte = *(const char *)patternBytes;
-    BOOL backward = (mask & NSBackwardsSearch) != 0;
-    
     if (patternLength == 0)
         return searchRange.location;
     if (patternLength > searchRange.length) {
@@ -67,37 +161,10 @@
         return NSNotFound;
     }
     
-    selfBufferStart = [self bytes];
-    selfPtrMax = selfBufferStart + NSMaxRange(searchRange) + 1 - patternLength;
-    if (backward) {
-        selfPtr = selfPtrMax - 1;
-        selfPtrEnd = selfBufferStart + searchRange.location - 1;
-    } else {
-        selfPtr = selfBufferStart + searchRange.location;
-        selfPtrEnd = selfPtrMax;
-    }
+    const unsigned char *selfBufferStart = [self bytes];
+    NSUInteger index = SKIndexOfBytes(selfBufferStart + searchRange.location, searchRange.length, patternBytes, patternLength, (mask & NSBackwardsSearch) != 0);
     
-    for (;;) {
-        if (memcmp(selfPtr, patternBytes, patternLength) == 0)
-            return (selfPtr - selfBufferStart);
-        
-        if (backward) {
-            do {
-                selfPtr--;
-            } while (*selfPtr != firstPatternByte && selfPtr > selfPtrEnd);
-            if (*selfPtr != firstPatternByte)
-                break;
-        } else {
-            selfPtr++;
-            if (selfPtr == selfPtrEnd)
-                break;
-            selfPtr = memchr(selfPtr, firstPatternByte, (selfPtrMax - selfPtr));
-            if (selfPtr == NULL)
-                break;
-        }
-    }
-	
-    return NSNotFound;
+    return index == NSNotFound ? NSNotFound : searchRange.location + index;
 }
 
 @end
\ No newline at end of file
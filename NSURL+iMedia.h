@@ -62,6 +62,12 @@
 
 - (IMBResourceAccessibility) imb_accessibility;
 
+// Returns accessibility of many URLs at once (as NSNumbers in the same order). File URLs are grouped by their
+// parent directory, so that a single directory read tells which files exist. Readability is still checked for
+// each file. Directory listings are cached briefly along with the modification date of the directory...
+
++ (NSArray*) imb_accessibilityForURLs:(NSArray*)inURLs;
+
 // Return name of volume for this URL (or nil if on boot volume).
 - (NSString*) imb_externalVolumeName;
 
@@ -47,6 +47,7 @@
 // Author: Dan Wood, Mike Abdullah, Jörg Jacobsen
 
 #include <sys/xattr.h>
+#include <errno.h>
 
 #import "NSURL+iMedia.h"
 #import "NSWorkspace+iMedia.h"
@@ -276,6 +277,139 @@
 }
 
 
+// Directory listings (names of the files in a directory) keyed by directory path. The cache is bounded, and a
+// listing is only used while the modification date of the directory is unchanged, and for a few seconds at most. 
+// Readability is not cached at all, as changing the permissions or ACL of a file doesn't touch its directory...
+
+static NSCache* sDirectoryListings = nil;
+static const NSUInteger kIMBDirectoryListingCountLimit = 64;
+static const NSTimeInterval kIMBDirectoryListingLifetime = 5.0;
+static NSString* const kIMBDirectoryListingDateKey = @"date";
+static NSString* const kIMBDirectoryListingTimestampKey = @"timestamp";
+static NSString* const kIMBDirectoryListingFilesKey = @"files";
+
+
++ (NSSet*) _imb_filenamesInDirectory:(NSURL*)inDirectory
+{
+	static dispatch_once_t sOnceToken = 0;
+	
+	dispatch_once(&sOnceToken,
+	^{
+		sDirectoryListings = [[NSCache alloc] init];
+		[sDirectoryListings setCountLimit:kIMBDirectoryListingCountLimit];
+	});
+	
+	NSString* path = [inDirectory path];
+	NSDate* modificationDate = nil;
+	
+	if (![inDirectory getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:NULL] || modificationDate == nil)
+	{
+		return nil;		// Directory doesn't exist or cannot be read
+	}
+	
+	NSDictionary* listing = [sDirectoryListings objectForKey:path];
+	NSDate* timestamp = [listing objectForKey:kIMBDirectoryListingTimestampKey];
+	
+	if ([[listing objectForKey:kIMBDirectoryListingDateKey] isEqualToDate:modificationDate] && 
+		-[timestamp timeIntervalSinceNow] < kIMBDirectoryListingLifetime)
+	{
+		return [listing objectForKey:kIMBDirectoryListingFilesKey];
+	}
+	
+	// Read the directory once...
+	
+	NSArray* names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:path error:NULL];
+	if (names == nil) return nil;
+	
+	NSSet* files = [NSSet setWithArray:names];
+	
+	[sDirectoryListings setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+		modificationDate,kIMBDirectoryListingDateKey,
+		[NSDate date],kIMBDirectoryListingTimestampKey,
+		files,kIMBDirectoryListingFilesKey,
+		nil]
+		forKey:path];
+	
+	return files;
+}
+
+
+// A file that is known to exist only needs a single access() call. If it went away in the meantime, we can
+// still tell by the error...
+
+static IMBResourceAccessibility _IMBAccessibilityOfListedFile(NSURL* inURL)
+{
+	const char* path = [[inURL path] cStringUsingEncoding:NSUTF8StringEncoding];
+	if (path == NULL) return kIMBResourceDoesNotExist;
+	if (access(path,R_OK) == 0) return kIMBResourceIsAccessible;
+	return errno == ENOENT ? kIMBResourceDoesNotExist : kIMBResourceNoPermission;
+}
+
+
++ (NSArray*) imb_accessibilityForURLs:(NSArray*)inURLs
+{
+	NSUInteger count = [inURLs count];
+	NSMutableArray* results = [NSMutableArray arrayWithCapacity:count];
+	NSMutableDictionary* indexesByDirectory = [NSMutableDictionary dictionary];
+	NSNumber* accessible = [NSNumber numberWithUnsignedInteger:kIMBResourceIsAccessible];
+	
+	// Group the file URLs by their parent directory. Non-file URLs are always accessible...
+	
+	for (NSUInteger i=0; i<count; i++)
+	{
+		NSURL* url = [inURLs objectAtIndex:i];
+		[results addObject:accessible];
+		
+		if ([url isKindOfClass:[NSURL class]] && [url isFileURL])
+		{
+			NSString* directory = [[url path] stringByDeletingLastPathComponent];
+			NSMutableIndexSet* indexes = [indexesByDirectory objectForKey:directory];
+			
+			if (indexes == nil)
+			{
+				indexes = [NSMutableIndexSet indexSet];
+				[indexesByDirectory setObject:indexes forKey:directory];
+			}
+			
+			[indexes addIndex:i];
+		}
+	}
+	
+	// Validate all files of a directory with a single read of that directory. If the directory doesn't exist, then
+	// neither do its files. If we lack permission to list it, then the files must be probed one by one...
+	
+	for (NSString* directory in indexesByDirectory)
+	{
+		NSURL* directoryURL = [NSURL fileURLWithPath:directory isDirectory:YES];
+		NSSet* files = [self _imb_filenamesInDirectory:directoryURL];
+		BOOL directoryExists = files != nil || [directoryURL imb_accessibility] != kIMBResourceDoesNotExist;
+		NSIndexSet* indexes = [indexesByDirectory objectForKey:directory];
+		NSUInteger i = [indexes firstIndex];
+		
+		while (i != NSNotFound)
+		{
+			NSURL* url = [inURLs objectAtIndex:i];
+			IMBResourceAccessibility accessibility = kIMBResourceDoesNotExist;
+			
+			if (files)
+			{
+				if ([files containsObject:[url lastPathComponent]]) accessibility = _IMBAccessibilityOfListedFile(url);
+				else accessibility = [url imb_accessibility];	// Name may differ in Unicode normalization, so check
+			}
+			else if (directoryExists)
+			{
+				accessibility = [url imb_accessibility];
+			}
+			
+			[results replaceObjectAtIndex:i withObject:[NSNumber numberWithUnsignedInteger:accessibility]];
+			i = [indexes indexGreaterThanIndex:i];
+		}
+	}
+	
+	return results;
+}
+
+
 // Returns the name of the volume this file resides on (or nil if on boot volume)...
 
 - (NSString*) imb_externalVolumeName
@@ -30,11 +30,17 @@
     id							delegate;           // Delegate must respond to UKFileWatcherDelegate protocol.
 	CFTimeInterval				latency;			// Time that must pass before events are being sent.
 	FSEventStreamCreateFlags	flags;				// See FSEvents.h
-    NSMutableDictionary*		eventStreams;		// List of FSEventStreamRef pointers in NSValues, with the pathnames as their keys.
 	dispatch_queue_t			dispatchQueue;
 	NSCountedSet*				eventStreamPaths;	// To support a client adding the same path multiple times, we 
 													// count the number of times it's been added, and only remove when 
 													// the number goes to zero...
+	FSEventStreamRef			eventStream;		// A single stream that covers all of eventStreamRoots.
+	NSArray*					eventStreamRoots;	// Minimal set of paths in eventStreamPaths (nested paths are left out).
+	BOOL						rebuildScheduled;	// YES while a (coalesced) rebuild of eventStream is pending.
+	FSEventStreamEventId		lastEventId;		// Latest event that was delivered. Persisted across launches.
+	BOOL						persistScheduled;	// YES while a (coalesced) write of lastEventId is pending.
+	BOOL						replayingHistory;	// YES while events from before launch are being delivered.
+	NSMutableDictionary*		rootStartEventIds;	// Roots added to a running stream, mapped to the event id they start at.
 }
 
 + (id) sharedFileWatcher;
@@ -58,6 +64,24 @@
 // removeAllPaths ensures that every watched path is no longer watched, regardless
 // of the number of times addPath: has been called on a given path.
 //
+// All watched paths share a single FSEventStream, which is rebuilt lazily whenever
+// the set of paths changes. The id of the last delivered event is stored in the user
+// defaults, so that changes that happened while the app wasn't running are replayed
+// on the next launch. These are sent as UKFileWatcherHistoryWriteNotification. The id
+// is only trusted as long as the FSEvents database of the boot volume keeps its UUID.
+// Paths that are added while the stream is running only get events from that point on.
+//
+// If FSEvents coalesced or dropped events (kFSEventStreamEventFlagMustScanSubDirs,
+// kFSEventStreamEventFlagUserDropped, kFSEventStreamEventFlagKernelDropped), then a
+// UKFileWatcherRescanNotification is sent instead. In that case everything at or below
+// the path must be rescanned.
+//
+// The event id is written at most every few seconds and when the app terminates.
+// Processes without NSApplication (e.g. an XPC service) should call persistLastEventId
+// before they go away.
+//
+
+- (void) persistLastEventId;
 
 - (void) addPath: (NSString*)path;
 - (void) removePath: (NSString*)path;
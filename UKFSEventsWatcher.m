@@ -17,6 +17,7 @@
 
 #import "UKFSEventsWatcher.h"
 #import <CoreServices/CoreServices.h>
+#import <sys/stat.h>
 
 // -----------------------------------------------------------------------------
 //  FSEventCallback
@@ -25,6 +26,39 @@
 
 #if MAC_OS_X_VERSION_MAX_ALLOWED > MAC_OS_X_VERSION_10_4
 
+// Key under which the id of the last delivered event is stored in the user defaults...
+
+static NSString* kUKFSEventsWatcherLastEventIdKey = @"UKFSEventsWatcherLastEventId";
+
+// Event ids are only valid for the FSEvents database they came from, so its UUID is stored along with the id...
+
+static NSString* kUKFSEventsWatcherEventsUUIDKey = @"UKFSEventsWatcherEventsUUID";
+
+// Events are delivered every latency seconds, so the id of the last one is only written this often...
+
+static const double kUKFSEventsWatcherPersistInterval = 10.0;
+
+@interface UKFSEventsWatcher (Private)
+- (BOOL) isReplayingHistory;
+- (void) _historyDone;
+- (void) _didDeliverEventId:(FSEventStreamEventId)inEventId;
+- (NSDictionary*) _rootStartEventIds;
+- (void) _setNeedsPersistEventId;
+@end
+
+// -----------------------------------------------------------------------------
+//  _UKPathIsInsideRoot:
+//		YES if the path is the root itself or anywhere below it. Paths that
+//		FSEvents delivers end with a slash, roots do not...
+// -----------------------------------------------------------------------------
+
+static BOOL _UKPathIsInsideRoot(NSString* inPath,NSString* inRoot)
+{
+	if ([inRoot isEqualToString:@"/"]) return YES;
+	if (![inPath hasPrefix:inRoot]) return NO;
+	return [inPath length] == [inRoot length] || [inPath characterAtIndex:[inRoot length]] == '/';
+}
+
 static void FSEventCallback(ConstFSEventStreamRef inStreamRef, 
 							void* inClientCallBackInfo, 
 							size_t inNumEvents, 
@@ -34,32 +68,74 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 {
 	UKFSEventsWatcher* watcher = (UKFSEventsWatcher*)inClientCallBackInfo;
 	const FSEventStreamEventFlags kFolderMetadataMod = kFSEventStreamEventFlagItemInodeMetaMod|kFSEventStreamEventFlagItemIsDir;
+	const FSEventStreamEventFlags kMustRescan = kFSEventStreamEventFlagMustScanSubDirs|kFSEventStreamEventFlagUserDropped|kFSEventStreamEventFlagKernelDropped;
+	FSEventStreamEventId lastEventId = 0;
 	
-	if (watcher != nil && [watcher delegate] != nil)
+	if (watcher != nil)
 	{
 		id delegate = [watcher delegate];
+		NSDictionary* rootStartEventIds = [watcher _rootStartEventIds];
+		BOOL respondsToDelegate = [delegate respondsToSelector:@selector(watcher:receivedNotification:forPath:)];
+		NSArray* paths = (NSArray*)inEventPaths;
+		NSUInteger i = 0;
 		
-		if ([delegate respondsToSelector:@selector(watcher:receivedNotification:forPath:)])
+		for (NSString* path in paths)
 		{
-			NSArray* paths = (NSArray*)inEventPaths;
-			NSUInteger i = 0;
+			FSEventStreamEventFlags flags = inEventFlags[i];
+			FSEventStreamEventId eventId = inEventIds[i];
+			i++;
+			
+			// The end of the replayed history is marked by a pseudo event that doesn't refer to any path...
+			
+			if (flags & kFSEventStreamEventFlagHistoryDone)
+			{
+				[watcher _historyDone];
+				continue;
+			}
+			
+			if (eventId > lastEventId) lastEventId = eventId;
 			
-			for (NSString* path in paths)
+			// If events were coalesced or dropped, the client needs to rescan everything below the path...
+			
+			BOOL mustRescan = (flags & kMustRescan) != 0;
+			
+			// A root that was added to a running stream only gets events from that point on, even though the
+			// stream replays the history of the roots that were already watched...
+			
+			if (!mustRescan && [rootStartEventIds count] > 0)
 			{
-				FSEventStreamEventFlags flags = inEventFlags[i];
-				i++;
+				BOOL isBeforeStart = NO;
 				
-				if (flags != kFolderMetadataMod) // PB 14.05.2015: Filter out creation of hardlinks
+				for (NSString* root in rootStartEventIds)
 				{
-					[delegate watcher:watcher receivedNotification:UKFileWatcherWriteNotification forPath:path];
-					
-					[[[NSWorkspace sharedWorkspace] notificationCenter] 
-						postNotificationName: UKFileWatcherWriteNotification
-						object:watcher
-						userInfo:[NSDictionary dictionaryWithObjectsAndKeys:path,@"path",nil]];
+					if (_UKPathIsInsideRoot(path,root))
+					{
+						isBeforeStart = eventId <= [[rootStartEventIds objectForKey:root] unsignedLongLongValue];
+						break;
+					}
 				}
+				
+				if (isBeforeStart) continue;
+			}
+			
+			if (respondsToDelegate && flags != kFolderMetadataMod) // PB 14.05.2015: Filter out creation of hardlinks
+			{
+				NSString* notification = nil;
+				
+				if (mustRescan) notification = UKFileWatcherRescanNotification;
+				else if ([watcher isReplayingHistory]) notification = UKFileWatcherHistoryWriteNotification;
+				else notification = UKFileWatcherWriteNotification;
+					
+				[delegate watcher:watcher receivedNotification:notification forPath:path];
+				
+				[[[NSWorkspace sharedWorkspace] notificationCenter] 
+					postNotificationName: notification
+					object:watcher
+					userInfo:[NSDictionary dictionaryWithObjectsAndKeys:path,@"path",[NSNumber numberWithUnsignedInt:flags],@"flags",nil]];
 			}
 		}
+		
+		if (lastEventId != 0) [watcher _didDeliverEventId:lastEventId];
 	}
 }
 
@@ -96,8 +172,14 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 	{
 		latency = 1.0;
 		flags = kFSEventStreamCreateFlagUseCFTypes | kFSEventStreamCreateFlagWatchRoot;
-		eventStreams = [[NSMutableDictionary alloc] init];
 		eventStreamPaths = [[NSCountedSet alloc] init];
+		rootStartEventIds = [[NSMutableDictionary alloc] init];
+		
+		[[NSNotificationCenter defaultCenter] 
+			addObserver:self 
+			selector:@selector(persistLastEventId) 
+			name:NSApplicationWillTerminateNotification 
+			object:nil];
     }
 	
     return self;
@@ -109,10 +191,11 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 
 - (void) dealloc
 {
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
 	if (dispatchQueue) dispatch_release(dispatchQueue);
 	[self removeAllPaths];
-    [eventStreams release];
 	[eventStreamPaths release];
+	[rootStartEventIds release];
     [super dealloc];
 }
 
@@ -218,35 +301,326 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 	return inPath;		
 }
 
-- (BOOL) _registerFSEventsObserverForPath:(NSString*)path
+// -----------------------------------------------------------------------------
+//  _rootPathsForPaths:
+//		Returns the minimal set of folders that covers all given paths. Since
+//		FSEvents watches whole subtrees anyway, nested paths don't need to be
+//		part of the stream. In a literally sorted list all paths that share a
+//		prefix are adjacent, so a single pass over the sorted paths suffices...
+// -----------------------------------------------------------------------------
+
+- (NSArray*) _rootPathsForPaths:(NSArray*)inPaths
 {
-	BOOL succeeded = YES;
-	FSEventStreamContext context;
-	context.version = 0;
-	context.info = (void*) self;
-	context.retain = NULL;
-	context.release = NULL;
-	context.copyDescription = NULL;
-
-	NSArray* pathArray = [NSArray arrayWithObject:path];
-	FSEventStreamRef stream = FSEventStreamCreate(NULL,&FSEventCallback,&context,(CFArrayRef)pathArray,kFSEventStreamEventIdSinceNow,latency,flags);
-
-	if (stream)
+	NSMutableArray* folders = [NSMutableArray arrayWithCapacity:[inPaths count]];
+	
+	for (NSString* path in inPaths)
 	{
-		if (dispatchQueue) FSEventStreamSetDispatchQueue(stream,dispatchQueue);  
-		else FSEventStreamScheduleWithRunLoop(stream,CFRunLoopGetMain(),kCFRunLoopCommonModes);
+		if (![path hasSuffix:@"/"]) path = [path stringByAppendingString:@"/"];
+		[folders addObject:path];
+	}
+	
+	[folders sortUsingComparator:^NSComparisonResult(NSString* inPath1,NSString* inPath2)
+	{
+		return [inPath1 compare:inPath2 options:NSLiteralSearch];
+	}];
+	
+	NSMutableArray* roots = [NSMutableArray arrayWithCapacity:[folders count]];
+	NSString* root = nil;
+	
+	for (NSString* folder in folders)
+	{
+		if (root == nil || ![folder hasPrefix:root])
+		{
+			root = folder;
+			[roots addObject:[folder length] > 1 ? [folder substringToIndex:[folder length]-1] : folder];
+		}
+	}
+	
+	return roots;
+}
 
-		FSEventStreamStart(stream);
+// -----------------------------------------------------------------------------
+//  _persistedEventId:
+//		Returns the id of the last event that was delivered in a previous
+//		session, or 0 if there is none (or if it can't be trusted anymore,
+//		e.g. because the FSEvents database was reset or the volume was
+//		restored from a backup)...
+// -----------------------------------------------------------------------------
 
-		[eventStreams setObject:[NSValue valueWithPointer:stream] forKey:path];
-	}	
-	else
+- (NSString*) _eventsUUID
+{
+	struct stat info;
+	if (stat("/",&info) != 0) return nil;
+	
+	CFUUIDRef uuid = FSEventsCopyUUIDForDevice(info.st_dev);
+	if (uuid == NULL) return nil;
+	
+	NSString* string = [(NSString*)CFUUIDCreateString(NULL,uuid) autorelease];
+	CFRelease(uuid);
+	return string;
+}
+
+- (FSEventStreamEventId) _persistedEventId
+{
+	NSUserDefaults* defaults = [NSUserDefaults standardUserDefaults];
+	NSNumber* number = [defaults objectForKey:kUKFSEventsWatcherLastEventIdKey];
+	NSString* uuid = [defaults objectForKey:kUKFSEventsWatcherEventsUUIDKey];
+	FSEventStreamEventId eventId = [number unsignedLongLongValue];
+	
+	if (eventId > FSEventsGetCurrentEventId()) eventId = 0;
+	if (uuid == nil || ![uuid isEqual:[self _eventsUUID]]) eventId = 0;
+	return eventId;
+}
+
+- (void) _persistEventId:(FSEventStreamEventId)inEventId
+{
+	NSUserDefaults* defaults = [NSUserDefaults standardUserDefaults];
+	NSString* uuid = [self _eventsUUID];
+	
+	[defaults setObject:[NSNumber numberWithUnsignedLongLong:inEventId] forKey:kUKFSEventsWatcherLastEventIdKey];
+	
+	if (uuid) [defaults setObject:uuid forKey:kUKFSEventsWatcherEventsUUIDKey];
+	else [defaults removeObjectForKey:kUKFSEventsWatcherEventsUUIDKey];
+}
+
+// -----------------------------------------------------------------------------
+//  persistLastEventId:
+//		Writes the id of the last delivered event to the user defaults right 
+//		away. Called by the persist timer and when the app terminates...
+// -----------------------------------------------------------------------------
+
+- (void) persistLastEventId
+{
+	FSEventStreamEventId eventId = 0;
+	
+	@synchronized (self)
+	{
+		persistScheduled = NO;
+		eventId = lastEventId;
+	}
+	
+	if (eventId != 0)
+	{
+		[self _persistEventId:eventId];
+		[[NSUserDefaults standardUserDefaults] synchronize];
+	}
+}
+
+// -----------------------------------------------------------------------------
+//  _setNeedsPersistEventId:
+//		Events arrive every latency seconds, so writing the user defaults for 
+//		each callback would be wasteful. Instead the write is coalesced...
+// -----------------------------------------------------------------------------
+
+- (void) _setNeedsPersistEventId
+{
+	@synchronized (self)
 	{
-		NSLog( @"UKFSEventsWatcher _registerFSEventObserverForPath:%@ failed",path);
-		succeeded = NO;
+		if (persistScheduled) return;
+		persistScheduled = YES;
 	}
 	
-	return succeeded;
+	dispatch_queue_t queue = dispatchQueue ? dispatchQueue : dispatch_get_main_queue();
+	dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW,(int64_t)(kUKFSEventsWatcherPersistInterval * NSEC_PER_SEC));
+	
+	dispatch_after(when,queue,^()
+	{
+		[self persistLastEventId];
+	});
+}
+
+// -----------------------------------------------------------------------------
+//  Callback support:
+//		These are only called on the queue (or runloop) of the stream. The
+//		state they share with addPath: and the persist timer is accessed while
+//		synchronized...
+// -----------------------------------------------------------------------------
+
+- (BOOL) isReplayingHistory
+{
+	return replayingHistory;
+}
+
+- (void) _historyDone
+{
+	replayingHistory = NO;
+}
+
+- (void) _didDeliverEventId:(FSEventStreamEventId)inEventId
+{
+	@synchronized (self)
+	{
+		if (inEventId > lastEventId)
+		{
+			lastEventId = inEventId;
+			[self _setNeedsPersistEventId];
+		}
+	}
+}
+
+- (NSDictionary*) _rootStartEventIds
+{
+	@synchronized (self)
+	{
+		return [[rootStartEventIds copy] autorelease];
+	}
+}
+
+// -----------------------------------------------------------------------------
+//  _stopEventStream:
+//		Stops the current stream and remembers the latest event it has seen, 
+//		so that a new stream can pick up exactly where this one stopped...
+// -----------------------------------------------------------------------------
+
+- (void) _stopEventStream
+{
+	if (eventStream)
+	{
+		FSEventStreamStop(eventStream);
+		
+		FSEventStreamEventId latestEventId = FSEventStreamGetLatestEventId(eventStream);
+		
+		if (latestEventId != kFSEventStreamEventIdSinceNow && latestEventId > lastEventId)
+		{
+			lastEventId = latestEventId;
+			[self _persistEventId:latestEventId];
+		}
+		
+		FSEventStreamInvalidate(eventStream);
+		FSEventStreamRelease(eventStream);
+		eventStream = NULL;
+	}
+	
+	[eventStreamRoots release];
+	eventStreamRoots = nil;
+}
+
+// -----------------------------------------------------------------------------
+//  _rebuildEventStream:
+//		Replaces the current stream with one that covers the current set of
+//		root paths. The very first stream starts at the event id persisted in
+//		the previous session, so that changes made while we weren't running are
+//		replayed. Later streams start where the previous one stopped, so that
+//		no events are lost or delivered twice. Since a stream only has a single
+//		start id, roots that weren't part of the previous stream are recorded
+//		with the current event id, and older events for them are dropped in 
+//		the callback...
+// -----------------------------------------------------------------------------
+
+- (void) _rebuildEventStream
+{
+	@synchronized (self)
+	{
+		rebuildScheduled = NO;
+		
+		NSArray* roots = [self _rootPathsForPaths:[eventStreamPaths allObjects]];
+		if ([roots isEqualToArray:eventStreamRoots]) return;
+		
+		NSArray* previousRoots = [[eventStreamRoots retain] autorelease];
+		[self _stopEventStream];
+		if ([roots count] == 0) return;
+		
+		FSEventStreamEventId sinceWhen = lastEventId;
+		
+		if (sinceWhen == 0)
+		{
+			sinceWhen = [self _persistedEventId];
+			replayingHistory = sinceWhen != 0;
+			
+			if (sinceWhen == 0) sinceWhen = FSEventsGetCurrentEventId();
+			lastEventId = sinceWhen;
+			[rootStartEventIds removeAllObjects];
+		}
+		else
+		{
+			// A root that is neither inside nor around one of the previous roots is new. Roots that are still
+			// behind their start id keep it...
+			
+			FSEventStreamEventId now = FSEventsGetCurrentEventId();
+			NSMutableDictionary* startEventIds = [NSMutableDictionary dictionaryWithCapacity:[roots count]];
+			
+			for (NSString* root in roots)
+			{
+				NSNumber* startEventId = [rootStartEventIds objectForKey:root];
+				BOOL isNew = YES;
+				
+				for (NSString* previousRoot in previousRoots)
+				{
+					if (_UKPathIsInsideRoot(root,previousRoot) || _UKPathIsInsideRoot(previousRoot,root))
+					{
+						isNew = NO;
+						break;
+					}
+				}
+				
+				if (startEventId != nil && [startEventId unsignedLongLongValue] > sinceWhen)
+				{
+					[startEventIds setObject:startEventId forKey:root];
+				}
+				else if (isNew && now > sinceWhen)
+				{
+					[startEventIds setObject:[NSNumber numberWithUnsignedLongLong:now] forKey:root];
+				}
+			}
+			
+			[rootStartEventIds setDictionary:startEventIds];
+		}
+		
+		FSEventStreamContext context;
+		context.version = 0;
+		context.info = (void*) self;
+		context.retain = NULL;
+		context.release = NULL;
+		context.copyDescription = NULL;
+
+		eventStream = FSEventStreamCreate(NULL,&FSEventCallback,&context,(CFArrayRef)roots,sinceWhen,latency,flags);
+
+		if (eventStream)
+		{
+			if (dispatchQueue) FSEventStreamSetDispatchQueue(eventStream,dispatchQueue);  
+			else FSEventStreamScheduleWithRunLoop(eventStream,CFRunLoopGetMain(),kCFRunLoopCommonModes);
+
+			FSEventStreamStart(eventStream);
+			eventStreamRoots = [roots copy];
+		}	
+		else
+		{
+			NSLog( @"UKFSEventsWatcher _rebuildEventStream for %@ failed",roots);
+			replayingHistory = NO;
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+//  _setNeedsRebuildEventStreamAfterDelay:
+//		Schedules a rebuild of the stream on the queue (or main runloop) that 
+//		the stream is delivered on. Additions are coalesced, so that a burst of 
+//		addPath: calls (e.g. at launch) only creates a single stream. Removals
+//		are applied right away, since a volume can't be unmounted while it is 
+//		being watched. Must be called while synchronized...
+// -----------------------------------------------------------------------------
+
+- (void) _setNeedsRebuildEventStreamAfterDelay:(double)inDelay
+{
+	dispatch_queue_t queue = dispatchQueue ? dispatchQueue : dispatch_get_main_queue();
+	
+	if (inDelay > 0.0)
+	{
+		if (rebuildScheduled) return;
+		rebuildScheduled = YES;
+		
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW,(int64_t)(inDelay * NSEC_PER_SEC)),queue,^()
+		{
+			[self _rebuildEventStream];
+		});
+	}
+	else
+	{
+		dispatch_async(queue,^()
+		{
+			[self _rebuildEventStream];
+		});
+	}
 }
 
 // -----------------------------------------------------------------------------
@@ -259,33 +633,20 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 {
 	path = [self pathToParentFolderOfFile:path];
 
-	// Do we already have a stream scheduled for this path?
 	// NOTE: Synchronize the whole thing so we don't run the risk of the current count changing while 
 	// we're busy updating it with our new addition.
 	@synchronized (self)
 	{
-		BOOL succeeded = YES;
-		
 		NSUInteger currentRegistrationCount = [eventStreamPaths countForObject:path];
+		[eventStreamPaths addObject:path];
+		
 		if (currentRegistrationCount == 0)
 		{
-			succeeded = [self _registerFSEventsObserverForPath:path];
+			[self _setNeedsRebuildEventStreamAfterDelay:latency];
 		}		
-		
-		if (succeeded)
-		{
-			[eventStreamPaths addObject:path];
-		}
 	}
 }
 
-- (void) _unregisterFSEventStream:(FSEventStreamRef)stream
-{
-	FSEventStreamStop(stream);
-	FSEventStreamInvalidate(stream);
-	FSEventStreamRelease(stream);
-}
-
 // -----------------------------------------------------------------------------
 //  removePath:
 //		Decrease the watch count for the given path, and if the count has gone 
@@ -298,8 +659,6 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 	// the normalization done in addPath to make sure removePath for the same path will succeed.
 	path = [self pathToParentFolderOfFile:path];
 
-    NSValue* valueToRemove = nil;
-		
     @synchronized (self)
     {
 		// We are sometimes asked to removePath on a path that we were never asked to add. That's 
@@ -310,26 +669,13 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 		{
 			[eventStreamPaths removeObject:path];
 			
-			NSUInteger newRegistrationCount = [eventStreamPaths countForObject:path];
-			
-			// Clear everything out if we've gone to zero
-			if (newRegistrationCount == 0)
+			// Rebuild the stream if we've gone to zero
+			if ([eventStreamPaths countForObject:path] == 0)
 			{
-				valueToRemove = [[[eventStreams objectForKey:path] retain] autorelease];
-				[eventStreams removeObjectForKey:path];				
+				[self _setNeedsRebuildEventStreamAfterDelay:0.0];
 			}
 		}
     }
-    
-	if (valueToRemove)
-	{
-		FSEventStreamRef stream = [valueToRemove pointerValue];
-		
-		if (stream)
-		{
-			[self _unregisterFSEventStream:stream];
-		}
-	}
 }
 
 // -----------------------------------------------------------------------------
@@ -341,24 +687,7 @@ static void FSEventCallback(ConstFSEventStreamRef inStreamRef,
 {
 	@synchronized (self)
 	{
-		// We don't really need the paths, we just need the open FSEventStreamRefs.
-		// Unregister them all indiscriminately, then remove all objects from 
-		// our tracking collections.
-		
-		NSEnumerator* eventStreamEnum = [[eventStreams allValues] objectEnumerator];
-		NSValue* thisEventStreamPointer = nil;
-		
-		while (thisEventStreamPointer = [eventStreamEnum nextObject])
-		{
-			FSEventStreamRef stream = [thisEventStreamPointer pointerValue];
-
-			if (stream)
-			{
-				[self _unregisterFSEventStream:stream];				
-			}
-		}
-		
-		[eventStreams removeAllObjects];
+		[self _stopEventStream];
 		[eventStreamPaths removeAllObjects];
 	}
 }
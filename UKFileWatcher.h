@@ -55,6 +55,8 @@
 	These notifications are sent via the NSWorkspace notification center */
 extern NSString* UKFileWatcherRenameNotification;
 extern NSString* UKFileWatcherWriteNotification;
+extern NSString* UKFileWatcherHistoryWriteNotification;		// A write that happened while nobody was watching (replayed from the FSEvents history).
+extern NSString* UKFileWatcherRescanNotification;			// Events were coalesced or dropped, everything at or below the path must be rescanned.
 extern NSString* UKFileWatcherDeleteNotification;
 extern NSString* UKFileWatcherAttributeChangeNotification;
 extern NSString* UKFileWatcherSizeIncreaseNotification;
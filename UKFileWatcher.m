@@ -29,6 +29,8 @@
 
 NSString* UKFileWatcherRenameNotification				= @"UKKQueueFileRenamedNotification";
 NSString* UKFileWatcherWriteNotification				= @"UKKQueueFileWrittenToNotification";
+NSString* UKFileWatcherHistoryWriteNotification			= @"UKFSEventsHistoryFileWrittenToNotification";
+NSString* UKFileWatcherRescanNotification				= @"UKFSEventsRescanNotification";
 NSString* UKFileWatcherDeleteNotification				= @"UKKQueueFileDeletedNotification";
 NSString* UKFileWatcherAttributeChangeNotification		= @"UKKQueueFileAttributesChangedNotification";
 NSString* UKFileWatcherSizeIncreaseNotification			= @"UKKQueueFileSizeIncreasedNotification";
@@ -65,6 +65,8 @@
 
 #define UKFileWatcherRenameNotification					IMBFileWatcherRenameNotification 
 #define UKFileWatcherWriteNotification					IMBFileWatcherWriteNotification 
+#define UKFileWatcherHistoryWriteNotification			IMBFileWatcherHistoryWriteNotification 
+#define UKFileWatcherRescanNotification					IMBFileWatcherRescanNotification 
 #define UKFileWatcherDeleteNotification					IMBFileWatcherDeleteNotification 
 #define UKFileWatcherAttributeChangeNotification		IMBFileWatcherAttributeChangeNotification 
 #define UKFileWatcherSizeIncreaseNotification			IMBFileWatcherSizeIncreaseNotification 
@@ -65,6 +65,8 @@
 
 #undef UKFileWatcherRenameNotification
 #undef UKFileWatcherWriteNotification
+#undef UKFileWatcherHistoryWriteNotification
+#undef UKFileWatcherRescanNotification
 #undef UKFileWatcherDeleteNotification
 #undef UKFileWatcherAttributeChangeNotification
 #undef UKFileWatcherSizeIncreaseNotification
@@ -96,6 +96,7 @@
     sqlite3_stmt *statement;
     NSString *query;
     long useCount;
+    BOOL inUse;
 }
 
 
@@ -111,6 +112,9 @@
 - (long)useCount;
 - (void)setUseCount:(long)value;
 
+- (BOOL)inUse;
+- (void)setInUse:(BOOL)value;
+
 
 @end
 
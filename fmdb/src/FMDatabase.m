@@ -270,6 +270,12 @@
     
     if (shouldCacheStatements) {
         statement = [self cachedStatementForQuery:sql];
+        
+        // a cached statement that still backs an open result set can't be rebound, so prepare a fresh one...
+        if ([statement inUse]) {
+            statement = 0x00;
+        }
+        
         pStmt = statement ? [statement statement] : 0x00;
     }
     
@@ -361,6 +367,7 @@
     [rs setQuery:sql];
     
     statement.useCount = statement.useCount + 1;
+    statement.inUse = YES;
     
     [statement release];    
     
@@ -402,9 +409,17 @@
     
     if (shouldCacheStatements) {
         cachedStmt = [self cachedStatementForQuery:sql];
+        
+        // a cached statement that still backs an open result set can't be rebound, so prepare a fresh one...
+        if ([cachedStmt inUse]) {
+            cachedStmt = 0x00;
+        }
+        
         pStmt = cachedStmt ? [cachedStmt statement] : 0x00;
     }
     
+    [cachedStmt setInUse:YES];
+    
     int numberOfRetries = 0;
     BOOL retry          = NO;
     
@@ -474,7 +489,15 @@
     
     if (idx != queryCount) {
         NSLog(@"Error: the bind count is not correct for the # of variables (%@) (executeUpdate)", sql);
-        sqlite3_finalize(pStmt);
+        
+        if (cachedStmt) {
+            [cachedStmt setInUse:NO];
+            sqlite3_reset(pStmt);
+        }
+        else {
+            sqlite3_finalize(pStmt);
+        }
+        
         [self setInUse:NO];
         return NO;
     }
@@ -534,6 +557,7 @@
     
     if (cachedStmt) {
         cachedStmt.useCount = cachedStmt.useCount + 1;
+        cachedStmt.inUse = NO;
         rc = sqlite3_reset(pStmt);
     }
     else {
@@ -743,6 +767,14 @@
     }
 }
 
+- (BOOL)inUse {
+    return inUse;
+}
+
+- (void)setInUse:(BOOL)value {
+    inUse = value;
+}
+
 - (NSString*) description {
     return [NSString stringWithFormat:@"%@ %ld hit(s) for query %@", [super description], useCount, query];
 }
@@ -31,6 +31,13 @@
 
 - (BOOL) hasColumnWithName:(NSString*)columnName;
 - (int) columnIndexForName:(NSString*)columnName;
+
+/*
+Resolve column indexes once per result set (before or after the first -next) and use the ...ForColumnIndex:
+getters in the row loop, instead of looking up the column name for every row. optionalColumnIndexForName:
+returns -1 without logging a warning if there is no such column; the index getters return nil/0 for -1.
+*/
+- (int) optionalColumnIndexForName:(NSString*)columnName;
 - (NSString*) columnNameForIndex:(int)columnIdx;
 
 - (int) intForColumn:(NSString*)columnName;
@@ -68,6 +75,12 @@ If you don't, you're going to be in a world of hurt when you try and use the dat
 - (NSData*) dataNoCopyForColumn:(NSString*)columnName;
 - (NSData*) dataNoCopyForColumnIndex:(int)columnIdx;
 
+/*
+Same caveat as above: the returned string points directly at SQLite's UTF-8 buffer for the current row. Only use
+it for comparisons or to build other strings, never keep it around.
+*/
+- (NSString*) stringNoCopyForColumnIndex:(int)columnIdx;
+
 - (BOOL) columnIndexIsNull:(int)columnIdx;
 - (BOOL) columnIsNull:(NSString*)columnName;
 
@@ -34,6 +34,7 @@
 - (void) close {
     
     [statement reset];
+    [statement setInUse:NO];
     [statement release];
     statement = nil;
     
@@ -158,6 +159,17 @@
     return -1;
 }
 
+- (int) optionalColumnIndexForName:(NSString*)columnName {
+    
+    if (!columnNamesSetup) {
+        [self setupColumnNames];
+    }
+    
+    NSNumber *n = [columnNameToIndexMap objectForKey:[columnName lowercaseString]];
+    
+    return n ? [n intValue] : -1;
+}
+
 
 
 - (int) intForColumn:(NSString*)columnName {
@@ -202,7 +214,7 @@
 
 - (NSString*) stringForColumnIndex:(int)columnIdx {
     
-    if (sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL || (columnIdx < 0)) {
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
 		return nil;
 	}
     
@@ -213,7 +225,27 @@
         return nil;
     }
     
-    return [NSString stringWithUTF8String:c];
+    // sqlite already knows the length, so skip the strlen of stringWithUTF8String:
+    int length = sqlite3_column_bytes(statement.statement, columnIdx);
+    
+    return [[[NSString alloc] initWithBytes:c length:length encoding:NSUTF8StringEncoding] autorelease];
+}
+
+- (NSString*) stringNoCopyForColumnIndex:(int)columnIdx {
+    
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
+		return nil;
+	}
+    
+    const char *c = (const char *)sqlite3_column_text(statement.statement, columnIdx);
+    
+    if (!c) {
+        return nil;
+    }
+    
+    int length = sqlite3_column_bytes(statement.statement, columnIdx);
+    
+    return [[[NSString alloc] initWithBytesNoCopy:(void *)c length:length encoding:NSUTF8StringEncoding freeWhenDone:NO] autorelease];
 }
 
 - (NSString*) stringForColumn:(NSString*)columnName {
@@ -226,7 +258,7 @@
 
 - (NSDate*) dateForColumnIndex:(int)columnIdx {
     
-    if (sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL || (columnIdx < 0)) {
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
 		return nil;
 	}
     
@@ -240,7 +272,7 @@
 
 - (NSData*) dataForColumnIndex:(int)columnIdx {
     
-    if (sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL || (columnIdx < 0)) {
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
 		return nil;
 	}
     
@@ -260,7 +292,7 @@
 
 - (NSData*) dataNoCopyForColumnIndex:(int)columnIdx {
     
-    if (sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL || (columnIdx < 0)) {
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
 		return nil;
 	}
     
@@ -282,7 +314,7 @@
 
 - (const unsigned char *) UTF8StringForColumnIndex:(int)columnIdx {
     
-    if (sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL || (columnIdx < 0)) {
+    if ((columnIdx < 0) || sqlite3_column_type(statement.statement, columnIdx) == SQLITE_NULL) {
 		return nil;
 	}
     
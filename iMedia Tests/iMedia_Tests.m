@@ -11,11 +11,28 @@
 #import <iMedia/IMBiPhotoParserMessenger.h>
 #import <iMedia/IMBiPhotoParserMessenger.h>
 #import <iMedia/SBUtilities.h>
+#import <iMedia/IMBNodeArchiver.h>
+#import <iMedia/IMBImageFolderParser.h>
+#import <iMedia/NSData+SKExtensions.h>
+#import <iMedia/IMBAlbumDataStore.h>
+#import <iMedia/NSURL+iMedia.h>
+#import <iMedia/IMBObjectSearchIndex.h>
+#import <iMedia/IMBObjectFifoCache.h>
+#import <iMedia/IMBFolderObject.h>
+#import <iMedia/IMBLightroomObject.h>
+#import <iMedia/IMBLightroomModernParser.h>
 
 @interface iMedia_Tests : XCTestCase
 
 @end
 
+@interface IMBAlbumDataStore (Test)
+
++ (NSString *)_storePathForFileAtPath:(NSString *)inPath variant:(NSString *)inVariant;
+- (id)initWithData:(NSData *)inData;
+
+@end
+
 @implementation IMBiPhotoParserMessenger (Test)
 
 - (id)returnObject:(id)object
@@ -69,4 +86,643 @@
     }
 }
 
+/**
+ Compares the compact node archive with plain keyed archiving on a synthetic node tree.
+ @discussion
+ Logs sizes and timings of both formats and checks that the compact format survives a round trip.
+ */
+- (void)testNodeArchiverBenchmark
+{
+    IMBNode *root = [[IMBNode alloc] init];
+    root.name = @"Root";
+    root.identifier = @"IMBTestParser://";
+    root.mediaType = kIMBMediaTypeImage;
+    NSMutableArray *subnodes = [NSMutableArray array];
+    
+    for (int i=0; i<10; i++) {
+        IMBNode *subnode = [[IMBNode alloc] init];
+        subnode.name = [NSString stringWithFormat:@"Folder %d", i];
+        subnode.identifier = [NSString stringWithFormat:@"IMBTestParser://Folder%d", i];
+        subnode.mediaType = kIMBMediaTypeImage;
+        NSMutableArray *objects = [NSMutableArray array];
+        
+        for (int j=0; j<3000; j++) {
+            NSString *path = [NSString stringWithFormat:@"/Users/test/Pictures/Folder %d/IMG_%04d.JPG", i, j];
+            IMBObject *object = [[IMBObject alloc] init];
+            object.location = [NSURL fileURLWithPath:path];
+            object.name = [path lastPathComponent];
+            object.identifier = [NSString stringWithFormat:@"IMBTestParser:/%@", path];
+            object.parserIdentifier = @"IMBTestParser";
+            object.imageRepresentationType = IKImageBrowserCGImageRepresentationType;
+            object.index = j;
+            object.preliminaryMetadata = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                          path, @"path",
+                                          [NSNumber numberWithInt:4000], @"width",
+                                          [NSNumber numberWithInt:3000], @"height",
+                                          [NSNumber numberWithDouble:j * 0.5], @"duration",
+                                          [NSDate date], @"dateTime",
+                                          nil];
+            [objects addObject:object];
+        }
+        
+        subnode.objects = objects;
+        [subnodes addObject:subnode];
+    }
+    
+    root.subnodes = subnodes;
+    root.objects = [NSArray array];
+    
+    for (int k=0; k<2; k++) {
+        BOOL compact = (k == 1);
+        [IMBNodeArchiver setEnabled:compact];
+        
+        NSDate *start = [NSDate date];
+        NSData *data = [NSKeyedArchiver archivedDataWithRootObject:root];
+        NSTimeInterval archiveTime = -[start timeIntervalSinceNow];
+        
+        start = [NSDate date];
+        IMBNode *copy = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+        NSTimeInterval unarchiveTime = -[start timeIntervalSinceNow];
+        
+        NSLog(@"%@: %lu bytes, archive %.3fs, unarchive %.3fs",
+              compact ? @"IMBNodeArchiver" : @"NSKeyedArchiver",
+              (unsigned long)data.length, archiveTime, unarchiveTime);
+        
+        XCTAssertEqual(copy.subnodes.count, root.subnodes.count);
+        XCTAssertEqualObjects(copy.name, root.name);
+        
+        IMBNode *subnode = copy.subnodes.lastObject;
+        IMBObject *object = subnode.objects.lastObject;
+        XCTAssertEqual(subnode.objects.count, (NSUInteger)3000);
+        XCTAssertEqualObjects(subnode.parentNode, copy);
+        XCTAssertEqualObjects(object.name, @"IMG_2999.JPG");
+        XCTAssertEqualObjects([object.preliminaryMetadata objectForKey:@"width"], [NSNumber numberWithInt:4000]);
+    }
+    
+    [IMBNodeArchiver setEnabled:YES];
+}
+
+/**
+ Archives a node with keyed archiving and with the compact format, logs sizes and timings of both and returns
+ the copy made with the compact format.
+ */
+- (IMBNode *)_archiveNodeWithBothFormats:(IMBNode *)node label:(NSString *)label
+{
+    IMBNode *copy = nil;
+    
+    for (int k=0; k<2; k++) {
+        BOOL compact = (k == 1);
+        [IMBNodeArchiver setEnabled:compact];
+        
+        NSDate *start = [NSDate date];
+        NSData *data = [NSKeyedArchiver archivedDataWithRootObject:node];
+        NSTimeInterval archiveTime = -[start timeIntervalSinceNow];
+        
+        start = [NSDate date];
+        copy = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+        NSTimeInterval unarchiveTime = -[start timeIntervalSinceNow];
+        
+        NSLog(@"%@ %@: %lu bytes, archive %.3fs, unarchive %.3fs",
+              label, compact ? @"IMBNodeArchiver" : @"NSKeyedArchiver",
+              (unsigned long)data.length, archiveTime, unarchiveTime);
+    }
+    
+    [IMBNodeArchiver setEnabled:YES];
+    return copy;
+}
+
+/**
+ Compares both formats on a folder node (IMBFolderObjects for its subfolders) and on a Lightroom node.
+ @discussion
+ Checks that the subclasses survive the compact round trip with their extra properties.
+ */
+- (void)testNodeArchiverSubclassBenchmark
+{
+    IMBNode *folderNode = [[IMBNode alloc] init];
+    folderNode.name = @"Pictures";
+    folderNode.identifier = @"IMBTestFolderParser://Pictures";
+    folderNode.mediaType = kIMBMediaTypeImage;
+    NSMutableArray *objects = [NSMutableArray array];
+    
+    for (int i=0; i<20000; i++) {
+        NSString *path = [NSString stringWithFormat:@"/Users/test/Pictures/Folder %05d", i];
+        IMBFolderObject *object = [[IMBFolderObject alloc] init];
+        object.location = [NSURL fileURLWithPath:path];
+        object.name = [path lastPathComponent];
+        object.identifier = [NSString stringWithFormat:@"IMBTestFolderParser:/%@", path];
+        object.representedNodeIdentifier = object.identifier;
+        object.parserIdentifier = @"IMBTestFolderParser";
+        object.index = i;
+        [objects addObject:object];
+    }
+    
+    folderNode.objects = objects;
+    
+    IMBNode *folderCopy = [self _archiveNodeWithBothFormats:folderNode label:@"Folder node"];
+    IMBFolderObject *folderObject = folderCopy.objects.lastObject;
+    XCTAssertEqual(folderCopy.objects.count, (NSUInteger)20000);
+    XCTAssertEqualObjects([folderObject class], [IMBFolderObject class]);
+    XCTAssertEqualObjects(folderObject.representedNodeIdentifier, @"IMBTestFolderParser://Users/test/Pictures/Folder 19999");
+    
+    IMBNode *lightroomNode = [[IMBNode alloc] init];
+    lightroomNode.name = @"Catalog";
+    lightroomNode.identifier = @"IMBTestLightroomParser://Catalog";
+    lightroomNode.mediaType = kIMBMediaTypeImage;
+    objects = [NSMutableArray array];
+    
+    for (int i=0; i<20000; i++) {
+        NSString *path = [NSString stringWithFormat:@"/Users/test/Pictures/Shoot/IMG_%05d.CR2", i];
+        IMBLightroomObject *object = [[IMBLightroomObject alloc] init];
+        object.location = [NSURL fileURLWithPath:path];
+        object.name = [path lastPathComponent];
+        object.identifier = [NSString stringWithFormat:@"IMBTestLightroomParser:/%@", path];
+        object.parserIdentifier = @"IMBTestLightroomParser";
+        object.idLocal = [NSNumber numberWithInt:100000 + i];
+        object.absolutePyramidPath = [NSString stringWithFormat:@"/Users/test/Previews.lrdata/%X/%05d.lrprev", i % 16, i];
+        object.index = i;
+        object.preliminaryMetadata = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                      path, @"path",
+                                      object.idLocal, @"idLocal",
+                                      [NSNumber numberWithInt:5472], @"width",
+                                      [NSNumber numberWithInt:3648], @"height",
+                                      nil];
+        [objects addObject:object];
+    }
+    
+    lightroomNode.objects = objects;
+    
+    IMBNode *lightroomCopy = [self _archiveNodeWithBothFormats:lightroomNode label:@"Lightroom node"];
+    IMBLightroomObject *lightroomObject = lightroomCopy.objects.lastObject;
+    XCTAssertEqual(lightroomCopy.objects.count, (NSUInteger)20000);
+    XCTAssertEqualObjects([lightroomObject class], [IMBLightroomObject class]);
+    XCTAssertEqualObjects(lightroomObject.idLocal, [NSNumber numberWithInt:119999]);
+    XCTAssertEqualObjects(lightroomObject.absolutePyramidPath, @"/Users/test/Previews.lrdata/F/19999.lrprev");
+}
+
+/**
+ Measures how long IMBFolderParser takes to populate a synthetic folder.
+ @discussion
+ Creates a temporary folder with 10k image files (set fileCount to 100000 or 1000000 for larger runs) and
+ a few hundred subfolders, then logs the time of a first and a second (cached) population.
+ */
+- (void)testFolderParserBenchmark
+{
+    NSUInteger fileCount = 10000;
+    NSUInteger folderCount = 200;
+    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    NSString *root = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [fileManager createDirectoryAtPath:root withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    for (NSUInteger i=0; i<fileCount; i++) {
+        NSString *extension = (i % 10 == 0) ? @"txt" : @"jpg";
+        NSString *path = [root stringByAppendingPathComponent:[NSString stringWithFormat:@"IMG_%06lu.%@", (unsigned long)i, extension]];
+        [fileManager createFileAtPath:path contents:nil attributes:nil];
+    }
+    
+    for (NSUInteger i=0; i<folderCount; i++) {
+        NSString *path = [root stringByAppendingPathComponent:[NSString stringWithFormat:@"Folder %04lu/Sub", (unsigned long)i]];
+        [fileManager createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    
+    IMBImageFolderParser *parser = [[IMBImageFolderParser alloc] init];
+    parser.identifier = @"IMBTestFolderParser";
+    parser.mediaType = kIMBMediaTypeImage;
+    parser.mediaSource = [NSURL fileURLWithPath:root];
+    parser.fileUTI = (NSString *)kUTTypeImage;
+    
+    for (int k=0; k<2; k++) {
+        IMBNode *node = [[IMBNode alloc] initWithParser:parser topLevel:YES];
+        node.identifier = [parser identifierForPath:root];
+        node.mediaSource = parser.mediaSource;
+        
+        NSError *error = nil;
+        NSDate *start = [NSDate date];
+        BOOL success = [parser populateNode:node error:&error];
+        NSTimeInterval time = -[start timeIntervalSinceNow];
+        
+        NSLog(@"IMBFolderParser populate %@: %lu objects, %lu subnodes in %.3fs",
+              k == 0 ? @"(cold)" : @"(cached)",
+              (unsigned long)node.objects.count, (unsigned long)node.subnodes.count, time);
+        
+        XCTAssertTrue(success);
+        XCTAssertEqual(node.subnodes.count, folderCount);
+        XCTAssertEqual(node.displayedObjectCount, (NSInteger)(fileCount - fileCount / 10));
+    }
+    
+    [fileManager removeItemAtPath:root error:NULL];
+}
+
+/**
+ Checks SKIndexOfBytes against a naive search and measures it on a 4 MB buffer.
+ @discussion
+ Places a pattern at every position of buffers around the SIMD block size (and checks that it is not found in a
+ buffer that ends one byte early), compares forward and backward results for many small random buffers over a 
+ three letter alphabet (lots of partial matches), then logs the time to find a marker near the end of the buffer.
+ */
+- (void)testByteSearch
+{
+    const unsigned char pattern[6] = { 'A', 'B', 'C', 'D', 'E', 'F' };
+    unsigned char buffer[100];
+    
+    for (NSUInteger length=0; length<=48; length++) {
+        for (NSUInteger patternLength=1; patternLength<=sizeof(pattern); patternLength++) {
+            memset(buffer, 'x', sizeof(buffer));
+            XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, NO), (NSUInteger)NSNotFound);
+            XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, YES), (NSUInteger)NSNotFound);
+            
+            for (NSUInteger i=0; i+patternLength<=length; i++) {
+                memset(buffer, 'x', sizeof(buffer));
+                memcpy(buffer + i, pattern, patternLength);
+                XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, NO), i);
+                XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, YES), i);
+                XCTAssertEqual(SKIndexOfBytes(buffer, i + patternLength - 1, pattern, patternLength, NO), (NSUInteger)NSNotFound);
+            }
+            
+            if (2 * patternLength <= length) {
+                memset(buffer, 'x', sizeof(buffer));
+                memcpy(buffer, pattern, patternLength);
+                memcpy(buffer + length - patternLength, pattern, patternLength);
+                XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, NO), (NSUInteger)0);
+                XCTAssertEqual(SKIndexOfBytes(buffer, length, pattern, patternLength, YES), length - patternLength);
+            }
+        }
+    }
+    
+    XCTAssertEqual(SKIndexOfBytes(buffer, 10, pattern, 0, NO), (NSUInteger)0);
+    XCTAssertEqual(SKIndexOfBytes(buffer, 10, pattern, 0, YES), (NSUInteger)10);
+    
+    srandom(1);
+    
+    for (int t=0; t<20000; t++) {
+        unsigned char randomPattern[6];
+        NSUInteger length = random() % 100;
+        NSUInteger patternLength = 1 + random() % 6;
+        for (NSUInteger i=0; i<length; i++) buffer[i] = "ABC"[random() % 3];
+        for (NSUInteger i=0; i<patternLength; i++) randomPattern[i] = "ABC"[random() % 3];
+        
+        NSUInteger forward = NSNotFound, backward = NSNotFound;
+        for (NSUInteger i=0; i+patternLength<=length; i++) {
+            if (memcmp(buffer + i, randomPattern, patternLength) == 0) {
+                if (forward == NSNotFound) forward = i;
+                backward = i;
+            }
+        }
+        
+        XCTAssertEqual(SKIndexOfBytes(buffer, length, randomPattern, patternLength, NO), forward);
+        XCTAssertEqual(SKIndexOfBytes(buffer, length, randomPattern, patternLength, YES), backward);
+    }
+    
+    NSUInteger length = 4 * 1024 * 1024;
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    unsigned char *bytes = [data mutableBytes];
+    for (NSUInteger i=0; i<length; i++) bytes[i] = (unsigned char)(i % 251);
+    
+    const char marker[4] = { 'A', 'g', 'H', 'g' };
+    memcpy(bytes + length - 100, marker, 4);
+    
+    // A match that straddles the end of the search range must not be found...
+    
+    XCTAssertEqual([data indexOfBytes:marker length:4 options:0 range:NSMakeRange(0, length - 97)], (NSUInteger)NSNotFound);
+    XCTAssertEqual([data indexOfBytes:marker length:4 options:0 range:NSMakeRange(length - 100, 4)], length - 100);
+    XCTAssertEqual([data indexOfBytes:marker length:4 options:NSBackwardsSearch range:NSMakeRange(0, length)], length - 100);
+    
+    NSDate *start = [NSDate date];
+    NSUInteger index = [data indexOfBytes:marker length:4 options:0 range:NSMakeRange(0, length)];
+    NSTimeInterval forwardTime = -[start timeIntervalSinceNow];
+    
+    NSLog(@"SKIndexOfBytes: %lu MB forward %.4fs", (unsigned long)(length >> 20), forwardTime);
+    XCTAssertEqual(index, length - 100);
+}
+
+/**
+ Converts a small AlbumData.xml style property list into an IMBAlbumDataStore and compares the result.
+ @discussion
+ Covers numeric key dictionaries and key lists, large integers (like the special album ids), reals, dates, booleans
+ and data, as well as lookups of keys that are not present.
+ */
+- (void)testAlbumDataStore
+{
+    NSMutableDictionary *images = [NSMutableDictionary dictionary];
+    for (NSUInteger i=1; i<=500; i++) {
+        NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)(i * 7)];
+        [images setObject:@{ @"Caption" : [NSString stringWithFormat:@"Image %lu", (unsigned long)i],
+                             @"MediaType" : @"Image",
+                             @"DateAsTimerInterval" : @(i * 1000.5),
+                             @"Faces" : @[ @{ @"face key" : @"3", @"face index" : @0 } ] }
+                   forKey:key];
+    }
+    
+    NSDictionary *plist = @{ @"Application Version" : @"9.4.3",
+                             @"Master Image List" : images,
+                             @"List of Albums" : @[ @{ @"AlbumId" : @(UINT_MAX - 4811),
+                                                       @"AlbumName" : @"Événements",
+                                                       @"KeyList" : @[ @"7", @"14", @"0021" ],
+                                                       @"Master" : @YES },
+                                                    @{ @"AlbumId" : @(-5),
+                                                       @"KeyList" : @[ @"70", @"7" ],
+                                                       @"Created" : [NSDate dateWithTimeIntervalSinceReferenceDate:1234.5],
+                                                       @"Blob" : [@"xyz" dataUsingEncoding:NSUTF8StringEncoding] } ],
+                             @"List of Faces" : @{ @"3" : @{ @"name" : @"Joe", @"key" : @3 } } };
+    
+    IMBAlbumDataStore *store = [IMBAlbumDataStore storeWithPropertyList:plist];
+    NSDictionary *root = store.rootDictionary;
+    
+    XCTAssertEqualObjects(root, plist);
+    XCTAssertEqualObjects([root objectForKey:@"Master Image List"], images);
+    XCTAssertEqualObjects([[[root objectForKey:@"Master Image List"] objectForKey:@"3500"] objectForKey:@"Caption"], @"Image 500");
+    XCTAssertNil([[root objectForKey:@"Master Image List"] objectForKey:@"3501"]);
+    XCTAssertNil([[root objectForKey:@"Master Image List"] objectForKey:@"007"]);
+    XCTAssertNil([root objectForKey:@"List of Rolls"]);
+    XCTAssertEqual([[[[root objectForKey:@"List of Albums"] objectAtIndex:0] objectForKey:@"AlbumId"] unsignedIntegerValue], (NSUInteger)(UINT_MAX - 4811));
+    XCTAssertEqualObjects([[[root objectForKey:@"List of Albums"] objectAtIndex:1] objectForKey:@"KeyList"], (@[ @"70", @"7" ]));
+    XCTAssertEqual([[[root objectForKey:@"Master Image List"] allKeys] count], (NSUInteger)500);
+    
+    NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:[root objectForKey:@"List of Faces"]];
+    XCTAssertEqualObjects([NSKeyedUnarchiver unarchiveObjectWithData:archive], [plist objectForKey:@"List of Faces"]);
+}
+
+/**
+ Feeds truncated and corrupt store files to IMBAlbumDataStore.
+ @discussion
+ Every prefix of a valid store must be rejected. Overwriting any word of the store must either get the file rejected
+ or leave a store that can be walked completely. A damaged store file in the caches folder must be rebuilt.
+ */
+- (void)testCorruptAlbumDataStore
+{
+    NSDictionary *plist = @{ @"Application Version" : @"9.4.3",
+                             @"Master Image List" : @{ @"7" : @{ @"Caption" : @"Seven", @"Rating" : @(1LL << 40) },
+                                                       @"14" : @{ @"Caption" : @"Fourteen", @"Date" : [NSDate dateWithTimeIntervalSinceReferenceDate:1.5] } },
+                             @"List of Albums" : @[ @{ @"KeyList" : @[ @"7", @"14" ], @"Blob" : [NSData dataWithBytes:"xyz" length:3] } ] };
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSData data] writeToFile:path atomically:NO];
+    __block NSUInteger buildCount = 0;
+    NSDictionary *(^builder)(void) = ^NSDictionary *{ buildCount++; return plist; };
+    
+    XCTAssertEqualObjects([[IMBAlbumDataStore storeForFileAtPath:path variant:@"Test" builder:builder] rootDictionary], plist);
+    XCTAssertEqual(buildCount, (NSUInteger)1);
+    
+    NSString *storePath = [IMBAlbumDataStore _storePathForFileAtPath:path variant:@"Test"];
+    NSData *file = [NSData dataWithContentsOfFile:storePath];
+    XCTAssertNotNil(file);
+    XCTAssertEqualObjects([[[IMBAlbumDataStore alloc] initWithData:file] rootDictionary], plist);
+    
+    for (NSUInteger length=0; length<file.length; length++) {
+        XCTAssertNil([[IMBAlbumDataStore alloc] initWithData:[file subdataWithRange:NSMakeRange(0, length)]]);
+    }
+    
+    static const uint32_t values[] = { 0, 1, 2, 3, 7, 10, 11, 12, 64, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF };
+    NSUInteger rejected = 0;
+    
+    for (NSUInteger offset=0; offset+4<=file.length; offset+=4) {
+        for (NSUInteger i=0; i<sizeof(values)/sizeof(values[0]); i++) {
+            NSMutableData *corrupt = [file mutableCopy];
+            [corrupt replaceBytesInRange:NSMakeRange(offset, 4) withBytes:&values[i]];
+            IMBAlbumDataStore *store = [[IMBAlbumDataStore alloc] initWithData:corrupt];
+            if (store) XCTAssertNotNil([store.rootDictionary description]);
+            else rejected++;
+        }
+    }
+    
+    XCTAssertTrue(rejected > 0);
+    
+    NSMutableData *corrupt = [file mutableCopy];
+    uint32_t rootNode = 0xFFFFFFFF;
+    [corrupt replaceBytesInRange:NSMakeRange(12, 4) withBytes:&rootNode];
+    XCTAssertTrue([corrupt writeToFile:storePath atomically:NO]);
+    XCTAssertEqualObjects([[IMBAlbumDataStore storeForFileAtPath:path variant:@"Test" builder:builder] rootDictionary], plist);
+    XCTAssertEqual(buildCount, (NSUInteger)2);
+    
+    [[NSFileManager defaultManager] removeItemAtPath:storePath error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+/**
+ Checks the batched accessibility lookup of NSURL for readable, unreadable, missing and remote files.
+ */
+- (void)testAccessibilityForURLs
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssertTrue([fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL]);
+    
+    NSString *readable = [directory stringByAppendingPathComponent:@"readable.jpg"];
+    NSString *unreadable = [directory stringByAppendingPathComponent:@"unreadable.jpg"];
+    [[NSData data] writeToFile:readable atomically:NO];
+    [[NSData data] writeToFile:unreadable atomically:NO];
+    [fileManager setAttributes:@{ NSFilePosixPermissions : @0 } ofItemAtPath:unreadable error:NULL];
+    
+    NSArray *urls = @[ [NSURL fileURLWithPath:readable],
+                       [NSURL fileURLWithPath:unreadable],
+                       [NSURL fileURLWithPath:[directory stringByAppendingPathComponent:@"missing.jpg"]],
+                       [NSURL fileURLWithPath:@"/nonexistent/folder/missing.jpg"],
+                       [NSURL URLWithString:@"http://karelia.com/imedia/image.jpg"] ];
+    NSArray *expected = @[ @(kIMBResourceIsAccessible), @(kIMBResourceNoPermission), @(kIMBResourceDoesNotExist),
+                           @(kIMBResourceDoesNotExist), @(kIMBResourceIsAccessible) ];
+    
+    XCTAssertEqualObjects([NSURL imb_accessibilityForURLs:urls], expected);
+    XCTAssertEqualObjects([NSURL imb_accessibilityForURLs:urls], expected);     // Served from the cached listing
+    
+    // Permission changes do not touch the directory, but must be noticed anyway...
+    
+    [fileManager setAttributes:@{ NSFilePosixPermissions : @0 } ofItemAtPath:readable error:NULL];
+    XCTAssertEqualObjects([[NSURL imb_accessibilityForURLs:@[ [NSURL fileURLWithPath:readable] ]] firstObject], @(kIMBResourceNoPermission));
+    [fileManager setAttributes:@{ NSFilePosixPermissions : @0644 } ofItemAtPath:readable error:NULL];
+    XCTAssertEqualObjects([[NSURL imb_accessibilityForURLs:@[ [NSURL fileURLWithPath:readable] ]] firstObject], @(kIMBResourceIsAccessible));
+    
+    // A changed directory must be read again (wait a bit, since HFS+ dates only have a resolution of one second)...
+    
+    [NSThread sleepForTimeInterval:1.0];
+    [fileManager removeItemAtPath:readable error:NULL];
+    XCTAssertEqualObjects([[NSURL imb_accessibilityForURLs:@[ [NSURL fileURLWithPath:readable] ]] firstObject], @(kIMBResourceDoesNotExist));
+    
+    [fileManager removeItemAtPath:directory error:NULL];
+}
+
+/**
+ Checks LRU order, eviction and metadata cost accounting of IMBObjectFifoCache.
+ */
+- (void)testObjectFifoCache
+{
+    NSUInteger oldSize = [IMBObjectFifoCache size];
+    NSUInteger oldBudget = [IMBObjectFifoCache metadataBudget];
+    void (^drainMainQueue)(void) = ^{
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    };
+    
+    [IMBObjectFifoCache removeAllObjects];
+    [IMBObjectFifoCache setSize:3];
+    [IMBObjectFifoCache setMetadataBudget:NSUIntegerMax];
+    drainMainQueue();
+    
+    NSMutableArray *objects = [NSMutableArray array];
+    for (int i=0; i<5; i++) {
+        IMBObject *object = [[IMBObject alloc] init];
+        object.metadata = @{ @"Comment" : [NSString stringWithFormat:@"Comment %d", i] };
+        [objects addObject:object];
+    }
+    
+    // Touching an object makes it the most recently used one, and does not change its cost...
+    
+    for (int i=0; i<3; i++) [IMBObjectFifoCache addObject:objects[i]];
+    drainMainQueue();
+    NSDictionary *statistics = [IMBObjectFifoCache statistics];
+    NSUInteger bytes = [statistics[kIMBObjectCacheMetadataBytesKey] unsignedIntegerValue];
+    NSUInteger hits = [statistics[kIMBObjectCacheHitsKey] unsignedIntegerValue];
+    
+    [IMBObjectFifoCache addObject:objects[0]];
+    drainMainQueue();
+    statistics = [IMBObjectFifoCache statistics];
+    XCTAssertEqual([statistics[kIMBObjectCacheMetadataBytesKey] unsignedIntegerValue], bytes);
+    XCTAssertEqual([statistics[kIMBObjectCacheHitsKey] unsignedIntegerValue], hits + 1);
+    
+    // Adding two more objects evicts the two least recently used ones...
+    
+    [IMBObjectFifoCache addObject:objects[3]];
+    [IMBObjectFifoCache addObject:objects[4]];
+    drainMainQueue();
+    XCTAssertEqual([IMBObjectFifoCache count], (NSUInteger)3);
+    XCTAssertNotNil([objects[0] metadata]);
+    XCTAssertNil([objects[1] metadata]);
+    XCTAssertNil([objects[2] metadata]);
+    XCTAssertNotNil([objects[3] metadata]);
+    XCTAssertNotNil([objects[4] metadata]);
+    
+    // Replaced metadata is measured again...
+    
+    bytes = [[IMBObjectFifoCache statistics][kIMBObjectCacheMetadataBytesKey] unsignedIntegerValue];
+    [objects[0] setMetadata:@{ @"Comment" : @"A much longer comment than before", @"artist" : @"Someone" }];
+    [IMBObjectFifoCache addObject:objects[0]];
+    drainMainQueue();
+    XCTAssertTrue([[IMBObjectFifoCache statistics][kIMBObjectCacheMetadataBytesKey] unsignedIntegerValue] > bytes);
+    
+    [IMBObjectFifoCache removeAllObjects];
+    [IMBObjectFifoCache setSize:oldSize];
+    [IMBObjectFifoCache setMetadataBudget:oldBudget];
+    drainMainQueue();
+    XCTAssertEqual([IMBObjectFifoCache count], (NSUInteger)0);
+}
+
+/**
+ Checks matching, incremental updates and reindexing of IMBObjectSearchIndex.
+ */
+- (void)testObjectSearchIndex
+{
+    NSMutableArray *objects = [NSMutableArray array];
+    NSArray *names = @[ @"Café del Mar", @"Cafeteria", @"Mariachi", @"Marathon", @"ab" ];
+    for (NSString *name in names) {
+        IMBObject *object = [[IMBObject alloc] init];
+        object.name = name;
+        [objects addObject:object];
+    }
+    [[objects objectAtIndex:2] setPreliminaryMetadata:@{ @"artist" : @[ @"Los CAFÉ Tacvba" ] }];
+    
+    IMBObjectSearchIndex *index = [[IMBObjectSearchIndex alloc] initWithKeyPaths:@[ @"name", @"preliminaryMetadata.artist" ]];
+    [index updateWithObjects:objects];
+    
+    NSIndexSet *unindexed = nil;
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"cafe" unindexedIndexes:&unindexed isCancelled:nil], ([NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0,3)]));
+    XCTAssertEqual([unindexed count], (NSUInteger)0);
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"CAFÉ D" unindexedIndexes:NULL isCancelled:nil], [NSIndexSet indexSetWithIndex:0]);
+    
+    NSMutableIndexSet *expected = [NSMutableIndexSet indexSetWithIndex:0];
+    [expected addIndexesInRange:NSMakeRange(2,2)];
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"ma" unindexedIndexes:NULL isCancelled:nil], expected);
+    
+    NSMutableIndexSet *expectedB = [NSMutableIndexSet indexSetWithIndex:2];
+    [expectedB addIndex:4];
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"b" unindexedIndexes:NULL isCancelled:nil], expectedB);
+    XCTAssertEqual([[index indexesOfObjectsMatchingString:@"xyz" unindexedIndexes:NULL isCancelled:nil] count], (NSUInteger)0);
+    
+    // Appended, replaced and reported objects are picked up, even when the previous search is narrowed down. 
+    // Changed objects that are not reported are not...
+    
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"mar" unindexedIndexes:NULL isCancelled:nil], expected);
+    [[objects objectAtIndex:1] setName:@"Marina"];
+    IMBObject *object = [[IMBObject alloc] init];
+    object.name = @"Marimba";
+    object.preliminaryMetadata = @{ @"artist" : [NSDate date] };
+    [objects addObject:object];
+    [index updateWithObjects:objects];
+    
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"mari" unindexedIndexes:&unindexed isCancelled:nil], [NSIndexSet indexSetWithIndex:2]);
+    XCTAssertEqualObjects(unindexed, [NSIndexSet indexSetWithIndex:5]);
+    
+    [index reindexObjects:@[ [objects objectAtIndex:1], [[IMBObject alloc] init] ]];
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"mari" unindexedIndexes:NULL isCancelled:nil], ([NSIndexSet indexSetWithIndexesInRange:NSMakeRange(1,2)]));
+    
+    IMBObject *replacement = [[IMBObject alloc] init];
+    replacement.name = @"Marinade";
+    [objects replaceObjectAtIndex:3 withObject:replacement];
+    [index updateWithObjects:objects];
+    
+    XCTAssertEqual([index.objects objectAtIndex:3], replacement);
+    NSMutableIndexSet *expectedMarin = [NSMutableIndexSet indexSetWithIndex:1];
+    [expectedMarin addIndex:3];
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"marin" unindexedIndexes:NULL isCancelled:nil], expectedMarin);
+    XCTAssertEqual([[index indexesOfObjectsMatchingString:@"marathon" unindexedIndexes:NULL isCancelled:nil] count], (NSUInteger)0);
+    
+    [index updateWithObjects:[objects subarrayWithRange:NSMakeRange(0,2)]];
+    XCTAssertEqual([index.objects count], (NSUInteger)2);
+    XCTAssertEqualObjects([index indexesOfObjectsMatchingString:@"mar" unindexedIndexes:NULL isCancelled:nil], ([NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0,2)]));
+    
+    XCTAssertNil([index indexesOfObjectsMatchingString:@"a" unindexedIndexes:NULL isCancelled:^BOOL{ return YES; }]);
+}
+
+/**
+ Appends one section of a Lightroom preview file (see IMBLightroomPreviewDirectory) to data.
+ */
+- (void)_appendPreviewSectionTo:(NSMutableData *)data headerLength:(uint16_t)headerLength contents:(NSData *)contents
+{
+    NSMutableData *header = [NSMutableData dataWithLength:headerLength];
+    uint8_t *bytes = header.mutableBytes;
+    uint16_t swappedHeaderLength = NSSwapHostShortToBig(headerLength);
+    unsigned long long swappedDataLength = NSSwapHostLongLongToBig(contents.length);
+    memcpy(bytes, "AgHg", 4);
+    memcpy(bytes + 4, &swappedHeaderLength, 2);
+    bytes[7] = 1;
+    memcpy(bytes + 8, &swappedDataLength, 8);
+    [data appendData:header];
+    [data appendData:contents];
+}
+
+/**
+ Feeds complete, truncated and corrupt preview files to the preview directory.
+ @discussion
+ Every prefix of a valid file must be rejected without reading past the end, as must a section header that is 
+ longer than the rest of the file.
+ */
+- (void)testTruncatedLightroomPreview
+{
+    static const uint8_t jpeg[] = { 0xFF,0xD8, 0xFF,0xC0, 0x00,0x11, 0x08, 0x00,0x60, 0x00,0x80, 0x03, 0,0,0,0,0,0,0,0, 0xFF,0xD9 };
+    NSData *jpegData = [NSData dataWithBytes:jpeg length:sizeof(jpeg)];
+    NSMutableData *file = [NSMutableData data];
+    [self _appendPreviewSectionTo:file headerLength:32 contents:[@"header" dataUsingEncoding:NSUTF8StringEncoding]];
+    [self _appendPreviewSectionTo:file headerLength:32 contents:jpegData];
+    
+    NSString *folder = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:folder withIntermediateDirectories:YES attributes:nil error:NULL];
+    IMBLightroomObject *object = [[IMBLightroomObject alloc] init];
+    
+    object.absolutePyramidPath = [folder stringByAppendingPathComponent:@"complete.lrprev"];
+    [file writeToFile:object.absolutePyramidPath atomically:NO];
+    XCTAssertEqualObjects([IMBLightroomModernParser previewDataForLightroomObject:object maximumSize:nil], jpegData);
+    
+    for (NSUInteger length=0; length<file.length; length++) {
+        object.absolutePyramidPath = [folder stringByAppendingPathComponent:[NSString stringWithFormat:@"truncated%lu.lrprev", (unsigned long)length]];
+        [[file subdataWithRange:NSMakeRange(0, length)] writeToFile:object.absolutePyramidPath atomically:NO];
+        XCTAssertNil([IMBLightroomModernParser previewDataForLightroomObject:object maximumSize:nil]);
+    }
+    
+    NSMutableData *corrupt = [NSMutableData data];
+    [self _appendPreviewSectionTo:corrupt headerLength:32 contents:jpegData];
+    uint16_t hugeHeaderLength = NSSwapHostShortToBig(60000);
+    [corrupt replaceBytesInRange:NSMakeRange(4, 2) withBytes:&hugeHeaderLength];
+    object.absolutePyramidPath = [folder stringByAppendingPathComponent:@"corrupt.lrprev"];
+    [corrupt writeToFile:object.absolutePyramidPath atomically:NO];
+    XCTAssertNil([IMBLightroomModernParser previewDataForLightroomObject:object maximumSize:nil]);
+    
+    [[NSFileManager defaultManager] removeItemAtPath:folder error:NULL];
+}
+
 @end